@@ -25,17 +25,35 @@
 #ifndef SYNTHETIC_PROCESS_ALLOCATOR_HPP
 #define SYNTHETIC_PROCESS_ALLOCATOR_HPP
 
-//Windows header files:
-#include <Windows.h>
+//Synthetic header files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <Windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+#endif
 
 //C++ header files:
 #include <list>
+#include <map>
+#include <vector>
 #include <algorithm>
+#include <stdexcept>
 
 //Synthetic header files:
 #include "Process.hpp"
 #include "Types.hpp"
-#include "WinException.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "RemoteSyscall.hpp"
+	#include "PosixException.hpp"
+#endif
 
 namespace Synthetic
 {
@@ -44,6 +62,14 @@ namespace Synthetic
 	* Becomes invalid as soon as Process reference becomes invalid\n
 	* scoped_release = If set to true all allocated memory is
 	* released by the destructor\n
+	* On Linux the target maps and unmaps memory itself, a thread of it is
+	* briefly stopped and made to execute the system calls. Every stop
+	* costs tens of microseconds, so the vector overloads or
+	* beginBatch()/endBatch() should be used for multiple operations.
+	* Unlike on Windows, memory can only be freed by the allocator which
+	* allocated it, since unmapping requires the size.\n
+	* The try functions return the error instead of throwing it. On Linux
+	* they still throw if the target can't be stopped.\n
 	*/
 	template <bool scoped_release>
 	class Allocator
@@ -55,7 +81,10 @@ namespace Synthetic
 		* @param proc Reference to a Process object which has to be valid the
 		* whole lifetime.
 		*/
-		Allocator(const Process& proc) : proc_(proc)
+		Allocator(const Process& proc) :	proc_(proc)
+													#if defined(SYNTHETIC_ISLINUX)
+														, syscalls_(proc)
+													#endif
 		{ }
 
 		/**
@@ -75,6 +104,32 @@ namespace Synthetic
 		template<typename data_t>
 		ptr_t allocate(size_t count)
 		{
+			ptr_t allocated;
+			errorcode_t error = tryAllocate<data_t>(count, allocated);
+			if(error)
+			{
+			#if defined(SYNTHETIC_ISWINDOWS)
+				throw WinException(	"Allocator::allocate()",
+											"VirtualAllocEx()",
+											error);
+			#elif defined(SYNTHETIC_ISLINUX)
+				throw PosixException("Allocator::allocate()", "mmap()", error);
+			#endif
+			}
+
+			return allocated;
+		}
+
+		/**
+		* Allocates memory without throwing.
+		* @param count The count of elements of typ data_t to allocate
+		* @param dest Reference receiving the address of the memory
+		* @return errorcode_t Zero on success, the error otherwise
+		*/
+		template<typename data_t>
+		errorcode_t tryAllocate(size_t count, ptr_t& dest)
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
 			//Get memory
 			void* allocatedMemory = VirtualAllocEx(	proc_.getHandle(),
 																	NULL,
@@ -82,20 +137,110 @@ namespace Synthetic
 																	MEM_COMMIT,
 																	PAGE_EXECUTE_READWRITE);
 			if(!allocatedMemory)
-			{
-				dword_t error = GetLastError();
-				throw WinException(	"Allocator::allocate()",
-											"VirtualAllocEx()",
-											error);
-			}
+				return GetLastError();
 
-			ptr_t temp = reinterpret_cast<ptr_t>(allocatedMemory);
+			dest = reinterpret_cast<ptr_t>(allocatedMemory);
+		#elif defined(SYNTHETIC_ISLINUX)
+			const size_t size = count * sizeof(data_t);
+			qword_t result = syscalls_.execute(	getMmapNumber_(),
+																0,
+																size,
+																PROT_READ | PROT_WRITE | PROT_EXEC,
+																MAP_PRIVATE | MAP_ANONYMOUS,
+																static_cast<ptr_t>(-1),
+																0);
+			if(RemoteSyscall::getError(result))
+				return RemoteSyscall::getError(result);
+
+			dest = static_cast<ptr_t>(result);
+			sizes_[dest] = size;
+		#endif
 
 			//If case scoped_release was specified we need to store the pointer
 			if(scoped_release)
-				allocations_.push_back(temp);
+				allocations_.push_back(dest);
 
-			return temp;
+			return 0;
+		}
+
+		/**
+		* Allocates several blocks at once, on Linux within a single stop.
+		* Either all blocks get allocated or none.
+		* @param sizes The blocks' sizes in bytes.
+		* @param dest Reference to a vector to hold the blocks' addresses.
+		* @return size_t Number of allocated blocks.
+		*/
+		size_t allocate(const std::vector<size_t>& sizes, std::vector<ptr_t>& dest)
+		{
+			size_t previousSize = dest.size();
+
+		#if defined(SYNTHETIC_ISWINDOWS)
+			try
+			{
+				for(size_t i = 0; i < sizes.size(); ++i)
+					dest.push_back(allocate<byte_t>(sizes[i]));
+			}
+			catch(...)
+			{
+				std::vector<ptr_t> allocated(dest.begin() + previousSize, dest.end());
+				dest.resize(previousSize);
+				deallocate(allocated);
+				throw;
+			}
+		#elif defined(SYNTHETIC_ISLINUX)
+			const long mmapNumber = getMmapNumber_();
+
+			std::vector<SyscallRequest> requests(sizes.size());
+			for(size_t i = 0; i < sizes.size(); ++i)
+			{
+				SyscallRequest request =
+				{
+					mmapNumber,
+					{
+						0,
+						sizes[i],
+						PROT_READ | PROT_WRITE | PROT_EXEC,
+						MAP_PRIVATE | MAP_ANONYMOUS,
+						static_cast<ptr_t>(-1),
+						0
+					}
+				};
+				requests[i] = request;
+			}
+
+			std::vector<qword_t> results;
+			syscalls_.execute(requests, results);
+
+			//Register successful mappings first, so a failure doesn't leak
+			int error = 0;
+			for(size_t i = 0; i < results.size(); ++i)
+			{
+				int callError = RemoteSyscall::getError(results[i]);
+				if(callError)
+				{
+					error = callError;
+					continue;
+				}
+
+				ptr_t address = static_cast<ptr_t>(results[i]);
+				sizes_[address] = sizes[i];
+				dest.push_back(address);
+
+				if(scoped_release)
+					allocations_.push_back(address);
+			}
+
+			if(error)
+			{
+				std::vector<ptr_t> allocated(dest.begin() + previousSize, dest.end());
+				dest.resize(previousSize);
+				deallocate(allocated);
+
+				throw PosixException("Allocator::allocate()", "mmap()", error);
+			}
+		#endif
+
+			return dest.size() - previousSize;
 		}
 
 		/**
@@ -104,31 +249,94 @@ namespace Synthetic
 		*/
 		void deallocate(ptr_t ptr)
 		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			errorcode_t error = tryDeallocate(ptr);
+			if(error)
+			{
+				throw WinException(	"Allocator::deallocate()",
+											"VirtualFreeEx()",
+											error);
+			}
+		#elif defined(SYNTHETIC_ISLINUX)
+			deallocate(std::vector<ptr_t>(1, ptr));
+		#endif
+		}
+
+		/**
+		* Frees memory without throwing.
+		* @param ptr Address of the memory to deallocate
+		* @return errorcode_t Zero on success, the error otherwise, on Linux
+		* EINVAL for memory not allocated by this allocator
+		*/
+		errorcode_t tryDeallocate(ptr_t ptr)
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
 			//Free memory
 			int ec = VirtualFreeEx(	proc_.getHandle(),
 											reinterpret_cast<void*>(ptr),
 											0,
 											MEM_RELEASE);
 			if(!ec)
-			{
-				dword_t error = GetLastError();
-				throw WinException(	"Process::freeMemory()",
-											"VirtualFreeEx()",
-											error);
-			}
+				return GetLastError();
+		#elif defined(SYNTHETIC_ISLINUX)
+			std::map<ptr_t, size_t>::iterator known = sizes_.find(ptr);
+			if(known == sizes_.end())
+				return EINVAL;
+
+			qword_t result = syscalls_.execute(SYS_munmap, ptr, known->second);
+			if(RemoteSyscall::getError(result))
+				return RemoteSyscall::getError(result);
+
+			sizes_.erase(known);
+		#endif
 
 			//If case scoped_release was specified we need to remove the pointer
 			if(scoped_release)
+				allocations_.remove(ptr);
+
+			return 0;
+		}
+
+		/**
+		* Frees several blocks at once, on Linux within a single stop.
+		* @param ptrs Addresses of the memory to deallocate
+		*/
+		void deallocate(const std::vector<ptr_t>& ptrs)
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			for(size_t i = 0; i < ptrs.size(); ++i)
+				deallocate(ptrs[i]);
+		#elif defined(SYNTHETIC_ISLINUX)
+			if(ptrs.empty())
+				return;
+
+			std::vector<SyscallRequest> requests(ptrs.size());
+			for(size_t i = 0; i < ptrs.size(); ++i)
 			{
-				if(allocations_.size() == 0)
-					return;
+				SyscallRequest request = { SYS_munmap, { ptrs[i], getSize_(ptrs[i]) } };
+				requests[i] = request;
+			}
 
-				AllocIter element;
-				element = std::find(allocations_.begin(), allocations_.end(), ptr);
+			std::vector<qword_t> results;
+			syscalls_.execute(requests, results);
 
-				if((*element) == ptr)
-					allocations_.erase(element);
+			int error = 0;
+			for(size_t i = 0; i < results.size(); ++i)
+			{
+				if(RemoteSyscall::getError(results[i]))
+				{
+					error = RemoteSyscall::getError(results[i]);
+					continue;
+				}
+
+				sizes_.erase(ptrs[i]);
+				if(scoped_release)
+					allocations_.remove(ptrs[i]);
 			}
+
+			if(error)
+				throw PosixException("Allocator::deallocate()", "munmap()", error);
+		#endif
 		}
 
 		/**
@@ -136,23 +344,138 @@ namespace Synthetic
 		*/
 		void deallocateAll()
 		{
-			if(allocations_.size() == 0)
-				return;
+			//deallocate() removes the entries, so work on a copy
+			std::vector<ptr_t> allocations(allocations_.begin(), allocations_.end());
+			deallocate(allocations);
+		}
 
-			if(allocations_.size() == 1)
+		/**
+		* Changes the access rights of memory
+		* @param ptr Address of the memory, rounded down to a page boundary
+		* @param size Size of the memory in bytes
+		* @param protection Combination of MemoryProtection flags
+		*/
+		void protect(ptr_t ptr, size_t size, int protection)
+		{
+			errorcode_t error = tryProtect(ptr, size, protection);
+			if(error)
 			{
-				deallocate(*allocations_.begin());
-				return;
+			#if defined(SYNTHETIC_ISWINDOWS)
+				throw WinException(	"Allocator::protect()",
+											"VirtualProtectEx()",
+											error);
+			#elif defined(SYNTHETIC_ISLINUX)
+				throw PosixException("Allocator::protect()", "mprotect()", error);
+			#endif
 			}
+		}
+
+		/**
+		* Changes the access rights of memory without throwing.
+		* @param ptr Address of the memory, rounded down to a page boundary
+		* @param size Size of the memory in bytes
+		* @param protection Combination of MemoryProtection flags
+		* @return errorcode_t Zero on success, the error otherwise
+		*/
+		errorcode_t tryProtect(ptr_t ptr, size_t size, int protection)
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			static const DWORD pageProtection[] =
+			{
+				PAGE_NOACCESS,				PAGE_READONLY,
+				PAGE_READWRITE,			PAGE_READWRITE,
+				PAGE_EXECUTE,				PAGE_EXECUTE_READ,
+				PAGE_EXECUTE_READWRITE,	PAGE_EXECUTE_READWRITE
+			};
+
+			DWORD oldProtection;
+			BOOL ec = VirtualProtectEx(	proc_.getHandle(),
+													reinterpret_cast<void*>(ptr),
+													size,
+													pageProtection[protection & 7],
+													&oldProtection);
+
+			return ec ? 0 : GetLastError();
+		#elif defined(SYNTHETIC_ISLINUX)
+			int prot = 0;
+			if(protection & PROTECTION_READ)
+				prot |= PROT_READ;
+			if(protection & PROTECTION_WRITE)
+				prot |= PROT_WRITE;
+			if(protection & PROTECTION_EXECUTE)
+				prot |= PROT_EXEC;
+
+			const ptr_t pageMask = ~static_cast<ptr_t>(0xFFF);
+			qword_t result = syscalls_.execute(	SYS_mprotect,
+																ptr & pageMask,
+																size + (ptr & ~pageMask),
+																prot);
 
-			for(AllocIter i = allocations_.begin(); i != allocations_.end(); ++i)
-				deallocate(*i);
+			return RemoteSyscall::getError(result);
+		#endif
+		}
+
+		/**
+		* Keeps the target stopped until endBatch(), so all following
+		* operations share one stop. Does nothing on Windows.
+		*/
+		void beginBatch()
+		{
+		#if defined(SYNTHETIC_ISLINUX)
+			syscalls_.stop();
+		#endif
+		}
+
+		/**
+		* Lets the target continue after beginBatch().
+		*/
+		void endBatch()
+		{
+		#if defined(SYNTHETIC_ISLINUX)
+			syscalls_.resume();
+		#endif
 		}
 
 	private:
+
+	#if defined(SYNTHETIC_ISLINUX)
+
+		/*
+		* mmap takes the offset in pages on 32 bit
+		*/
+		static long getMmapNumber_()
+		{
+		#if defined(SYS_mmap2)
+			return SYS_mmap2;
+		#else
+			return SYS_mmap;
+		#endif
+		}
+
+		/*
+		* Returns the size of an allocation, munmap needs it
+		*/
+		size_t getSize_(ptr_t ptr) const
+		{
+			std::map<ptr_t, size_t>::const_iterator known = sizes_.find(ptr);
+			if(known == sizes_.end())
+			{
+				throw std::invalid_argument(	"Allocator::deallocate() Error : "\
+														"Memory wasn't allocated by this allocator");
+			}
+
+			return known->second;
+		}
+
+	#endif
+
 		const Process& proc_;
 		std::list<ptr_t> allocations_;
-		typedef std::list<ptr_t>::iterator AllocIter;
+
+	#if defined(SYNTHETIC_ISLINUX)
+		std::map<ptr_t, size_t> sizes_;
+		RemoteSyscall syscalls_;
+	#endif
 	};
 
 	typedef Allocator<true>		ScopedAllocator;
@@ -163,4 +486,4 @@ namespace Synthetic
 
 /******************
 ******* EOF *******
-******************/
\ No newline at end of file
+******************/
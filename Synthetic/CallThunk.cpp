@@ -0,0 +1,490 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//C++ header files:
+#include <algorithm>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "CallThunk.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Alignment of argument data and stack frames
+	const size_t ALIGNMENT = 16;
+
+	//Register numbers as used in the instruction encoding
+	const byte_t RCX = 1;
+	const byte_t RDX = 2;
+	const byte_t RSI = 6;
+	const byte_t RDI = 7;
+	const byte_t R8 = 8;
+	const byte_t R9 = 9;
+
+	const size_t WIN64_REGISTERS = 4;
+	const size_t SYSV_INT_REGISTERS = 6;
+	const size_t SYSV_XMM_REGISTERS = 8;
+
+	const byte_t win64IntRegisters[WIN64_REGISTERS] = { RCX, RDX, R8, R9 };
+	const byte_t sysvIntRegisters[SYSV_INT_REGISTERS] = { RDI, RSI, RDX, RCX, R8, R9 };
+
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	template<typename data_t>
+	void emit(vector<byte_t>& code, data_t value)
+	{
+		const byte_t* bytes = reinterpret_cast<const byte_t*>(&value);
+		code.insert(code.end(), bytes, bytes + sizeof(value));
+	}
+
+	void emitBytes(vector<byte_t>& code, const byte_t* bytes, size_t count)
+	{
+		code.insert(code.end(), bytes, bytes + count);
+	}
+
+	//mov reg64, imm64
+	void emitMovImm64(vector<byte_t>& code, byte_t reg, qword_t value)
+	{
+		code.push_back(reg >= 8 ? 0x49 : 0x48);
+		code.push_back(0xB8 + (reg & 7));
+		emit(code, value);
+	}
+
+	//mov rax, imm64 / movq xmmN, rax
+	void emitMovXmm(vector<byte_t>& code, byte_t xmm, qword_t value)
+	{
+		emitMovImm64(code, 0, value);
+
+		const byte_t movq[] = { 0x66, 0x48, 0x0F, 0x6E };
+		emitBytes(code, movq, sizeof(movq));
+		code.push_back(0xC0 | (xmm << 3));
+	}
+
+	//mov rax, imm64 / mov [rsp + offset], rax
+	void emitStackArgument64(vector<byte_t>& code, dword_t offset, qword_t value)
+	{
+		emitMovImm64(code, 0, value);
+
+		const byte_t mov[] = { 0x48, 0x89, 0x84, 0x24 };
+		emitBytes(code, mov, sizeof(mov));
+		emit(code, offset);
+	}
+
+	/*
+	* Returns the value passed for an argument, data arguments are
+	* relocated to the address the data block is copied to
+	*/
+	qword_t argumentValue(const CallArgument& arg, qword_t dataAddress)
+	{
+		return arg.type == ARGUMENT_DATA ? dataAddress + arg.value : arg.value;
+	}
+
+	bool isFloating(const CallArgument& arg)
+	{
+		return arg.type == ARGUMENT_FLOAT || arg.type == ARGUMENT_DOUBLE;
+	}
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+CallArguments& CallArguments::addInteger(ptr_t value)
+{
+	return add_(ARGUMENT_INTEGER, value);
+}
+
+CallArguments& CallArguments::addInt64(qword_t value)
+{
+	return add_(ARGUMENT_INT64, value);
+}
+
+CallArguments& CallArguments::addFloat(float value)
+{
+	dword_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return add_(ARGUMENT_FLOAT, bits);
+}
+
+CallArguments& CallArguments::addDouble(double value)
+{
+	qword_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return add_(ARGUMENT_DOUBLE, bits);
+}
+
+CallArguments& CallArguments::addData(const void* data, size_t size)
+{
+	//Keep every buffer aligned, the thunk doesn't know what's inside
+	size_t offset = data_.size();
+	data_.resize(alignUp(offset + size, ALIGNMENT), 0);
+	if(size)
+		memcpy(&data_[offset], data, size);
+
+	return add_(ARGUMENT_DATA, offset, size);
+}
+
+CallArguments& CallArguments::addString(const string& str)
+{
+	return addData(str.c_str(), (str.size() + 1) * sizeof(char));
+}
+
+CallArguments& CallArguments::addString(const wstring& str)
+{
+	return addData(str.c_str(), (str.size() + 1) * sizeof(wchar_t));
+}
+
+void CallArguments::clear()
+{
+	arguments_.clear();
+	data_.clear();
+}
+
+size_t CallArguments::size() const
+{
+	return arguments_.size();
+}
+
+const vector<CallArgument>& CallArguments::getArguments() const
+{
+	return arguments_;
+}
+
+const vector<byte_t>& CallArguments::getData() const
+{
+	return data_;
+}
+
+size_t CallThunk::generate(	CallingConvention convention,
+										ptr_t function,
+										const CallArguments& args,
+										ptr_t dataAddress,
+										ptr_t resultAddress,
+										ResultType resultType,
+										vector<byte_t>& dest)
+{
+	#if defined(SYNTHETIC_ISX64)
+		//RAX and XMM0 are both stored, the caller picks the one it needs
+		static_cast<void>(resultType);
+
+		return generateX64(	convention,
+									function,
+									args,
+									dataAddress,
+									resultAddress,
+									dest);
+	#else
+		return generateX86(	convention,
+									function,
+									args,
+									dataAddress,
+									resultAddress,
+									resultType,
+									dest);
+	#endif
+}
+
+size_t CallThunk::generateX86(	CallingConvention convention,
+											ptr32_t function,
+											const CallArguments& args,
+											ptr32_t dataAddress,
+											ptr32_t resultAddress,
+											ResultType resultType,
+											vector<byte_t>& dest)
+{
+	if(convention == WIN64_CONVENTION || convention == SYSV_CONVENTION)
+	{
+		throw invalid_argument(	"CallThunk::generateX86() Error : "\
+										"Calling convention is x64 only");
+	}
+
+	const vector<CallArgument>& arguments = args.getArguments();
+	size_t i = 0;
+
+	//__thiscall passes this in ecx, everything else goes on the stack
+	bool hasThis = convention == THISCALL_CONVENTION && !arguments.empty();
+	if(hasThis && (isFloating(arguments[0]) || arguments[0].type == ARGUMENT_INT64))
+	{
+		throw invalid_argument(	"CallThunk::generateX86() Error : "\
+										"this has to be a pointer");
+	}
+
+	//Stack slots from left to right, 64-bit values take two
+	vector<dword_t> slots;
+	slots.reserve(arguments.size() * 2);
+	for(i = hasThis ? 1 : 0; i < arguments.size(); ++i)
+	{
+		qword_t value = argumentValue(arguments[i], dataAddress);
+		slots.push_back(static_cast<dword_t>(value));
+
+		if(arguments[i].type == ARGUMENT_INT64 || arguments[i].type == ARGUMENT_DOUBLE)
+			slots.push_back(static_cast<dword_t>(value >> 32));
+	}
+
+	size_t begin = dest.size();
+
+	//Keep the stack 16 byte aligned at the call for compiler generated code
+	const byte_t prolog[] =
+	{
+		0x53,									//push ebx
+		0x55,									//push ebp
+		0x89, 0xE5,							//mov ebp, esp
+		0x83, 0xE4, 0xF0					//and esp, -16
+	};
+	emitBytes(dest, prolog, sizeof(prolog));
+
+	size_t padding = alignUp(slots.size() * 4, ALIGNMENT) - slots.size() * 4;
+	if(padding)
+	{
+		dest.push_back(0x83);				//sub esp, padding
+		dest.push_back(0xEC);
+		dest.push_back(static_cast<byte_t>(padding));
+	}
+
+	for(vector<dword_t>::reverse_iterator slot = slots.rbegin();
+		slot != slots.rend();
+		++slot)
+	{
+		dest.push_back(0x68);				//push imm32
+		emit(dest, *slot);
+	}
+
+	if(hasThis)
+	{
+		dest.push_back(0xB9);				//mov ecx, imm32
+		emit(dest, static_cast<dword_t>(argumentValue(arguments[0], dataAddress)));
+	}
+
+	dest.push_back(0xB8);					//mov eax, function
+	emit(dest, function);
+
+	const byte_t call[] =
+	{
+		0xFF, 0xD0							//call eax
+	};
+	emitBytes(dest, call, sizeof(call));
+
+	dest.push_back(0xBB);					//mov ebx, resultAddress
+	emit(dest, resultAddress);
+
+	const byte_t storeInteger[] =
+	{
+		0x89, 0x03,							//mov [ebx], eax
+		0x89, 0x53, 0x04					//mov [ebx+4], edx
+	};
+	emitBytes(dest, storeInteger, sizeof(storeInteger));
+
+	//ST0 may only be popped if the function actually returned something
+	if(resultType == RESULT_FLOAT)
+	{
+		const byte_t storeFloat[] =
+		{
+			0xD9, 0x5B, 0x08				//fstp dword ptr [ebx+8]
+		};
+		emitBytes(dest, storeFloat, sizeof(storeFloat));
+	}
+	else if(resultType == RESULT_DOUBLE)
+	{
+		const byte_t storeDouble[] =
+		{
+			0xDD, 0x5B, 0x08				//fstp qword ptr [ebx+8]
+		};
+		emitBytes(dest, storeDouble, sizeof(storeDouble));
+	}
+	else
+	{
+		//A floating point result nobody asked for would stay on the x87
+		//stack, it's popped if ST0 isn't empty
+		const byte_t discardFloat[] =
+		{
+			0xD9, 0xE5,							//fxam
+			0xDF, 0xE0,							//fnstsw ax
+			0x80, 0xE4, 0x45,					//and ah, C3 | C2 | C0
+			0x80, 0xFC, 0x41,					//cmp ah, C3 | C0 (empty)
+			0x74, 0x02,							//je skip
+			0xDD, 0xD8							//fstp st(0)
+												//skip:
+		};
+		emitBytes(dest, discardFloat, sizeof(discardFloat));
+	}
+
+	//Restoring esp from ebp covers caller and callee cleanup
+	const byte_t epilog[] =
+	{
+		0x89, 0xEC,							//mov esp, ebp
+		0x5D,									//pop ebp
+		0x5B,									//pop ebx
+		0xC2, 0x04, 0x00					//ret 4
+	};
+	emitBytes(dest, epilog, sizeof(epilog));
+
+	return dest.size() - begin;
+}
+
+size_t CallThunk::generateX64(	CallingConvention convention,
+											ptr64_t function,
+											const CallArguments& args,
+											ptr64_t dataAddress,
+											ptr64_t resultAddress,
+											vector<byte_t>& dest)
+{
+	const vector<CallArgument>& arguments = args.getArguments();
+	const bool sysv = convention == SYSV_CONVENTION;
+
+	//Assign registers and stack slots
+	vector<qword_t> stack;
+	vector<size_t> intRegisters;
+	vector<size_t> xmmRegisters;
+	size_t i;
+
+	for(i = 0; i < arguments.size(); ++i)
+	{
+		if(!sysv)
+		{
+			//Position decides, the first four go into registers
+			if(i >= WIN64_REGISTERS)
+				stack.push_back(argumentValue(arguments[i], dataAddress));
+			else if(isFloating(arguments[i]))
+				xmmRegisters.push_back(i);
+			else
+				intRegisters.push_back(i);
+		}
+		else
+		{
+			//Integer and vector registers are counted separately
+			if(isFloating(arguments[i]) && xmmRegisters.size() < SYSV_XMM_REGISTERS)
+				xmmRegisters.push_back(i);
+			else if(!isFloating(arguments[i]) && intRegisters.size() < SYSV_INT_REGISTERS)
+				intRegisters.push_back(i);
+			else
+				stack.push_back(argumentValue(arguments[i], dataAddress));
+		}
+	}
+
+	//Win64 reserves home space for the register arguments
+	size_t stackOffset = sysv ? 0 : WIN64_REGISTERS * sizeof(qword_t);
+	size_t frameSize = alignUp(stackOffset + stack.size() * sizeof(qword_t), ALIGNMENT);
+
+	size_t begin = dest.size();
+
+	//Entry rsp is 8 mod 16, three pushes align it again. rsi and rdi are
+	//volatile for System V but not for the caller
+	const byte_t prolog[] =
+	{
+		0x53,									//push rbx
+		0x56,									//push rsi
+		0x57,									//push rdi
+		0x48, 0x81, 0xEC					//sub rsp, frameSize
+	};
+	emitBytes(dest, prolog, sizeof(prolog));
+	emit(dest, static_cast<dword_t>(frameSize));
+
+	for(i = 0; i < stack.size(); ++i)
+	{
+		emitStackArgument64(	dest,
+									static_cast<dword_t>(stackOffset + i * sizeof(qword_t)),
+									stack[i]);
+	}
+
+	for(i = 0; i < xmmRegisters.size(); ++i)
+	{
+		const CallArgument& arg = arguments[xmmRegisters[i]];
+		byte_t xmm = static_cast<byte_t>(sysv ? i : xmmRegisters[i]);
+		emitMovXmm(dest, xmm, arg.value);
+
+		//Variadic Win64 functions expect floats in integer registers too
+		if(!sysv)
+			emitMovImm64(dest, win64IntRegisters[xmmRegisters[i]], arg.value);
+	}
+
+	for(i = 0; i < intRegisters.size(); ++i)
+	{
+		byte_t reg = sysv ? sysvIntRegisters[i] : win64IntRegisters[intRegisters[i]];
+		emitMovImm64(dest, reg, argumentValue(arguments[intRegisters[i]], dataAddress));
+	}
+
+	//System V variadic functions read the number of vector registers in al
+	if(sysv)
+	{
+		dest.push_back(0xB8);				//mov eax, imm32
+		emit(dest, static_cast<dword_t>(xmmRegisters.size()));
+	}
+
+	emitMovImm64(dest, 11, function);	//mov r11, function
+
+	const byte_t call[] =
+	{
+		0x41, 0xFF, 0xD3					//call r11
+	};
+	emitBytes(dest, call, sizeof(call));
+
+	emitMovImm64(dest, 3, resultAddress);	//mov rbx, resultAddress
+
+	const byte_t epilog[] =
+	{
+		0x48, 0x89, 0x03,					//mov [rbx], rax
+		0x66, 0x0F, 0xD6, 0x43, 0x08,	//movq [rbx+8], xmm0
+		0x48, 0x81, 0xC4					//add rsp, frameSize
+	};
+	emitBytes(dest, epilog, sizeof(epilog));
+	emit(dest, static_cast<dword_t>(frameSize));
+
+	const byte_t ret[] =
+	{
+		0x5F,									//pop rdi
+		0x5E,									//pop rsi
+		0x5B,									//pop rbx
+		0xC3									//ret
+	};
+	emitBytes(dest, ret, sizeof(ret));
+
+	return dest.size() - begin;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+CallArguments& CallArguments::add_(ArgumentType type, qword_t value, size_t size)
+{
+	CallArgument arg;
+	arg.type = type;
+	arg.value = value;
+	arg.size = size;
+
+	arguments_.push_back(arg);
+	return *this;
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,317 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_CALLTHUNK_HPP
+#define SYNTHETIC_PROCESS_CALLTHUNK_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <cstring>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* Kinds of arguments a CallArguments list can hold
+	*/
+	enum ArgumentType
+	{
+		ARGUMENT_INTEGER,		//Pointer sized integer
+		ARGUMENT_INT64,		//64-bit integer, two stack slots on x86
+		ARGUMENT_FLOAT,
+		ARGUMENT_DOUBLE,
+		ARGUMENT_DATA			//Pointer to a copy of a local buffer
+	};
+
+	/**
+	* Register a call's return value is taken from
+	*/
+	enum ResultType
+	{
+		RESULT_INTEGER,		//RAX or EDX:EAX
+		RESULT_FLOAT,			//XMM0 or ST0 stored as float
+		RESULT_DOUBLE			//XMM0 or ST0 stored as double
+	};
+
+	/**
+	* A single argument of a remote call
+	*/
+	struct CallArgument
+	{
+		ArgumentType type;
+
+		/**
+		* The value, floating point values are stored bitwise in the lower
+		* bytes. For ARGUMENT_DATA the offset into the argument data.
+		*/
+		qword_t value;
+
+		/**
+		* Size of the data passed by an ARGUMENT_DATA argument
+		*/
+		size_t size;
+	};
+
+	/**
+	* The raw return registers of a remote call
+	*/
+	struct CallResult
+	{
+		qword_t integer;
+		qword_t floating;
+	};
+
+	/**
+	* Argument list of a remote call.\n
+	* Buffers and strings are collected into one data block which gets
+	* copied into the target together with the call thunk.\n
+	*/
+	class CallArguments
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Appends a pointer sized integer or a remote pointer.
+		* @param value The value.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addInteger(ptr_t value);
+
+		/**
+		* Appends a 64-bit integer.
+		* @param value The value.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addInt64(qword_t value);
+
+		/**
+		* Appends a single precision floating point value.
+		* @param value The value.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addFloat(float value);
+
+		/**
+		* Appends a double precision floating point value.
+		* @param value The value.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addDouble(double value);
+
+		/**
+		* Appends a pointer to a copy of a local buffer.
+		* @param data The buffer to copy into the target.
+		* @param size Size of the buffer in bytes.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addData(const void* data, size_t size);
+
+		/**
+		* Appends a pointer to a copy of a zero terminated string.
+		* @param str The string.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addString(const std::string& str);
+
+		/**
+		* Appends a pointer to a copy of a zero terminated wide string.
+		* @param str The string.
+		* @return CallArguments& Reference to this list.
+		*/
+		CallArguments& addString(const std::wstring& str);
+
+		/**
+		* Removes all arguments.
+		*/
+		void clear();
+
+		/**
+		* @return size_t Number of arguments.
+		*/
+		size_t size() const;
+
+		/**
+		* @return const std::vector<CallArgument>& The arguments in order.
+		*/
+		const std::vector<CallArgument>& getArguments() const;
+
+		/**
+		* @return const std::vector<byte_t>& Data referenced by
+		* ARGUMENT_DATA arguments, each entry aligned to 16 bytes.
+		*/
+		const std::vector<byte_t>& getData() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Appends an argument of given type
+		*/
+		CallArguments& add_(ArgumentType type, qword_t value, size_t size = 0);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<CallArgument> arguments_;
+		std::vector<byte_t> data_;
+	};
+
+	/**
+	* Generates machine code calling a function with a given convention.\n
+	* A thunk can be called like a thread procedure, it loads all
+	* arguments as immediates, calls the function and stores the return
+	* registers as CallResult at a fixed address.\n
+	* x86 thunks support STDCALL_CONVENTION, CDECL_CONVENTION,
+	* THISCALL_CONVENTION and GCCTHISCALL_CONVENTION. x64 thunks support
+	* WIN64_CONVENTION and SYSV_CONVENTION, the x86 conventions are
+	* treated as WIN64_CONVENTION there.\n
+	*/
+	class CallThunk
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Generates a thunk for the architecture Synthetic is compiled for.
+		* @param convention The function's calling convention.
+		* @param function Address of the function in the target.
+		* @param args The arguments.
+		* @param dataAddress Address args.getData() gets copied to.
+		* @param resultAddress Address of the CallResult to fill.
+		* @param resultType Register the return value is taken from.
+		* @param dest Reference to a vector the code is appended to.
+		* @return size_t Size of the generated code.
+		*/
+		static size_t generate(	CallingConvention convention,
+										ptr_t function,
+										const CallArguments& args,
+										ptr_t dataAddress,
+										ptr_t resultAddress,
+										ResultType resultType,
+										std::vector<byte_t>& dest);
+
+		/**
+		* Generates a thunk for a 32-bit target.
+		* @see generate()
+		*/
+		static size_t generateX86(	CallingConvention convention,
+											ptr32_t function,
+											const CallArguments& args,
+											ptr32_t dataAddress,
+											ptr32_t resultAddress,
+											ResultType resultType,
+											std::vector<byte_t>& dest);
+
+		/**
+		* Generates a thunk for a 64-bit target.
+		* @see generate()
+		*/
+		static size_t generateX64(	CallingConvention convention,
+											ptr64_t function,
+											const CallArguments& args,
+											ptr64_t dataAddress,
+											ptr64_t resultAddress,
+											std::vector<byte_t>& dest);
+
+		/**
+		* Converts the raw return registers to the requested type.
+		* @param result The raw registers.
+		* @return result_t The return value.
+		*/
+		template<typename result_t>
+		static result_t convertResult(const CallResult& result)
+		{
+			return static_cast<result_t>(result.integer);
+		}
+
+		/**
+		* Selects the register holding a return value of result_t.
+		* @return ResultType The register.
+		*/
+		template<typename result_t>
+		static ResultType getResultType()
+		{
+			return RESULT_INTEGER;
+		}
+	};
+
+	template<>
+	inline float CallThunk::convertResult<float>(const CallResult& result)
+	{
+		float value;
+		std::memcpy(&value, &result.floating, sizeof(value));
+		return value;
+	}
+
+	template<>
+	inline double CallThunk::convertResult<double>(const CallResult& result)
+	{
+		double value;
+		std::memcpy(&value, &result.floating, sizeof(value));
+		return value;
+	}
+
+	template<>
+	inline ResultType CallThunk::getResultType<float>()
+	{
+		return RESULT_FLOAT;
+	}
+
+	template<>
+	inline ResultType CallThunk::getResultType<double>()
+	{
+		return RESULT_DOUBLE;
+	}
+}
+
+#endif //SYNTHETIC_PROCESS_CALLTHUNK_HPP
+
+/******************
+******* EOF *******
+******************/
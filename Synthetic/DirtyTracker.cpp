@@ -0,0 +1,135 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+
+//C++ header files:
+#include <stdexcept>
+
+//Synthetic header files:
+#include "DirtyTracker.hpp"
+#include "PosixException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Written to clear_refs to clear the soft-dirty bits
+	const char CLEAR_SOFT_DIRTY[] = "4";
+
+	/*
+	* Fresh memory is soft-dirty if the kernel tracks it at all
+	*/
+	bool checkSupport()
+	{
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		void* page = mmap(NULL, pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(page == MAP_FAILED)
+			return false;
+
+		*static_cast<volatile char*>(page) = 1;
+
+		bool supported = false;
+		int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+		if(fd != -1)
+		{
+			qword_t entry;
+			const off_t offset = static_cast<off_t>(reinterpret_cast<ptr_t>(page) / pageSize) * sizeof(entry);
+			if(pread(fd, &entry, sizeof(entry), offset) == sizeof(entry))
+				supported = (entry & PageMap::SOFT_DIRTY) != 0;
+
+			close(fd);
+		}
+
+		munmap(page, pageSize);
+		return supported;
+	}
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+DirtyTracker::DirtyTracker(const Process& proc) : proc_(proc), pageMap_(proc)
+{
+	if(!isSupported())
+		throw runtime_error("DirtyTracker::DirtyTracker() Error : The kernel doesn't track soft-dirty pages");
+}
+
+void DirtyTracker::checkpoint()
+{
+	char path[32];
+	sprintf(path, "/proc/%d/clear_refs", static_cast<int>(proc_.getId()));
+
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if(fd == -1)
+		throw PosixException("DirtyTracker::checkpoint()", "open()", errno);
+
+	if(write(fd, CLEAR_SOFT_DIRTY, sizeof(CLEAR_SOFT_DIRTY) - 1) == -1)
+	{
+		int error = errno;
+		close(fd);
+		throw PosixException("DirtyTracker::checkpoint()", "write()", error);
+	}
+
+	close(fd);
+}
+
+size_t DirtyTracker::getDirtyRanges(ptr_t address, size_t size, vector<MemoryRange>& dest) const
+{
+	return pageMap_.getRanges(address, size, PageMap::SOFT_DIRTY, dest);
+}
+
+size_t DirtyTracker::getDirtyRanges(const RegionMap& regions, vector<MemoryRange>& dest) const
+{
+	size_t found = 0;
+	const vector<MemoryRegion>& all = regions.regions();
+	for(vector<MemoryRegion>::const_iterator i = all.begin(); i != all.end(); ++i)
+	{
+		if(i->protection & PROTECTION_READ)
+			found += pageMap_.getRanges(i->address, i->size, PageMap::SOFT_DIRTY, dest);
+	}
+
+	return found;
+}
+
+bool DirtyTracker::isSupported()
+{
+	static const bool supported = checkSupport();
+	return supported;
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+/******************
+******* EOF *******
+******************/
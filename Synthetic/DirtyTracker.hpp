@@ -0,0 +1,131 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_DIRTYTRACKER_HPP
+#define SYNTHETIC_PROCESS_DIRTYTRACKER_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "RegionMap.hpp"
+#include "PageMap.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* Finds the pages a process wrote to since a checkpoint.\n
+	* A checkpoint clears the soft-dirty bits of all pages through
+	* /proc/pid/clear_refs, the kernel sets them again on the next write.
+	* Rescans then only need to read the dirty pages instead of all of
+	* the memory.\n
+	* Clearing write-protects the pages, so the first write to each page
+	* afterwards costs the process a minor fault. Memory mapped after the
+	* checkpoint counts as dirty.\n
+	* Needs a kernel built with CONFIG_MEM_SOFT_DIRTY.\n
+	*/
+	class DirtyTracker
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Doesn't set a checkpoint, until then all pages count as dirty.
+		* @param proc The process. Has to be valid the whole lifetime.
+		*/
+		DirtyTracker(const Process& proc);
+
+		/**
+		* Clears the soft-dirty bits of all pages of the process.
+		*/
+		void checkpoint();
+
+		/**
+		* Searches the pages of a range written since the checkpoint.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param dest Reference to a vector the dirty ranges are appended to.
+		* @return size_t Number of dirty bytes.
+		*/
+		size_t getDirtyRanges(ptr_t address, size_t size, std::vector<MemoryRange>& dest) const;
+
+		/**
+		* Searches the readable pages written since the checkpoint.
+		* @param regions The regions of the process.
+		* @param dest Reference to a vector the dirty ranges are appended to.
+		* @return size_t Number of dirty bytes.
+		*/
+		size_t getDirtyRanges(const RegionMap& regions, std::vector<MemoryRange>& dest) const;
+
+		/**
+		* @return bool true if the kernel tracks soft-dirty pages.
+		*/
+		static bool isSupported();
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Not copyable
+		*/
+		DirtyTracker(const DirtyTracker&);
+		DirtyTracker& operator=(const DirtyTracker&);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		PageMap pageMap_;
+	};
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+#endif //SYNTHETIC_PROCESS_DIRTYTRACKER_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,431 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <sys/epoll.h>
+	#include <sys/syscall.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <time.h>
+	#include <errno.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+
+//Synthetic header files:
+#include "ExitMonitor.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
+#if defined(SYNTHETIC_ISLINUX) && !defined(SYS_pidfd_open)
+	#define SYS_pidfd_open 434
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+#if defined(SYNTHETIC_ISLINUX)
+
+	//Interval processes without pidfd are checked at
+	const dword_t POLL_INTERVAL = 50;
+
+	//Events fetched per epoll_wait()
+	const int MAX_EVENTS = 64;
+
+	dword_t getMilliseconds()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<dword_t>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+	}
+
+#endif
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+ExitMonitor::ExitMonitor()
+{
+	//Auto-reset, one wake-up collects everything
+	event_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(!event_)
+		throw WinException("ExitMonitor::ExitMonitor()", "CreateEvent()", GetLastError());
+
+	InitializeCriticalSection(&lock_);
+}
+
+ExitMonitor::~ExitMonitor()
+{
+	for(unordered_map<pid_t, Watch*>::iterator i = watches_.begin(); i != watches_.end(); ++i)
+		release_(i->second);
+
+	DeleteCriticalSection(&lock_);
+	CloseHandle(event_);
+}
+
+void ExitMonitor::add(pid_t pid)
+{
+	if(watches_.find(pid) != watches_.end())
+		return;
+
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+	if(!process)
+	{
+		dword_t error = GetLastError();
+
+		//No such process
+		if(error == ERROR_INVALID_PARAMETER)
+		{
+			EnterCriticalSection(&lock_);
+			exited_.push_back(pid);
+			LeaveCriticalSection(&lock_);
+			return;
+		}
+
+		throw WinException("ExitMonitor::add()", "OpenProcess()", error);
+	}
+
+	Watch* watch = new Watch;
+	watch->monitor = this;
+	watch->pid = pid;
+	watch->process = process;
+
+	if(!RegisterWaitForSingleObject(	&watch->wait,
+												process,
+												onExit_,
+												watch,
+												INFINITE,
+												WT_EXECUTEONLYONCE))
+	{
+		dword_t error = GetLastError();
+		CloseHandle(process);
+		delete watch;
+
+		throw WinException("ExitMonitor::add()", "RegisterWaitForSingleObject()", error);
+	}
+
+	watches_[pid] = watch;
+}
+
+bool ExitMonitor::remove(pid_t pid)
+{
+	unordered_map<pid_t, Watch*>::iterator found = watches_.find(pid);
+	bool watched = (found != watches_.end());
+
+	//Waits for a running callback, so it's either queued or never will be
+	if(watched)
+	{
+		release_(found->second);
+		watches_.erase(found);
+	}
+
+	EnterCriticalSection(&lock_);
+	exited_.erase(std::remove(exited_.begin(), exited_.end(), pid), exited_.end());
+	LeaveCriticalSection(&lock_);
+
+	return watched;
+}
+
+size_t ExitMonitor::wait(vector<pid_t>& dest, dword_t timeout)
+{
+	const dword_t start = GetTickCount();
+
+	for(;;)
+	{
+		if(size_t count = collect_(dest))
+			return count;
+
+		dword_t remaining = timeout;
+		if(timeout != TIMEOUT_INFINITE)
+		{
+			dword_t elapsed = GetTickCount() - start;
+			if(elapsed >= timeout)
+				return 0;
+
+			remaining = timeout - elapsed;
+		}
+
+		//The event may be left over from processes collected before,
+		//so waking up doesn't guarantee new ones
+		dword_t result = WaitForSingleObject(event_, remaining);
+		if(result == WAIT_TIMEOUT)
+			return collect_(dest);
+
+		if(result != WAIT_OBJECT_0)
+			throw WinException("ExitMonitor::wait()", "WaitForSingleObject()", GetLastError());
+	}
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+ExitMonitor::ExitMonitor() : polled_(0)
+{
+	epoll_ = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_ == -1)
+		throw PosixException("ExitMonitor::ExitMonitor()", "epoll_create1()", errno);
+}
+
+ExitMonitor::~ExitMonitor()
+{
+	for(unordered_map<pid_t, int>::iterator i = watches_.begin(); i != watches_.end(); ++i)
+		release_(i->second);
+
+	::close(epoll_);
+}
+
+void ExitMonitor::add(pid_t pid)
+{
+	if(watches_.find(pid) != watches_.end())
+		return;
+
+	int descriptor = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+	if(descriptor == -1)
+	{
+		if(errno == ESRCH)
+		{
+			exited_.push_back(pid);
+			return;
+		}
+
+		if(errno != ENOSYS)
+			throw PosixException("ExitMonitor::add()", "pidfd_open()", errno);
+
+		//Old kernel, the process is checked by wait() instead
+		if(kill(pid, 0) == -1 && errno == ESRCH)
+		{
+			exited_.push_back(pid);
+			return;
+		}
+
+		watches_[pid] = -1;
+		++polled_;
+		return;
+	}
+
+	//The pidfd becomes readable as soon as the process exits
+	epoll_event event = epoll_event();
+	event.events = EPOLLIN;
+	event.data.u64 = static_cast<qword_t>(pid);
+
+	if(epoll_ctl(epoll_, EPOLL_CTL_ADD, descriptor, &event) == -1)
+	{
+		int error = errno;
+		::close(descriptor);
+
+		throw PosixException("ExitMonitor::add()", "epoll_ctl()", error);
+	}
+
+	watches_[pid] = descriptor;
+}
+
+bool ExitMonitor::remove(pid_t pid)
+{
+	exited_.erase(std::remove(exited_.begin(), exited_.end(), pid), exited_.end());
+
+	unordered_map<pid_t, int>::iterator found = watches_.find(pid);
+	if(found == watches_.end())
+		return false;
+
+	if(found->second == -1)
+		--polled_;
+
+	release_(found->second);
+	watches_.erase(found);
+	return true;
+}
+
+size_t ExitMonitor::wait(vector<pid_t>& dest, dword_t timeout)
+{
+	const dword_t start = getMilliseconds();
+	epoll_event events[MAX_EVENTS];
+
+	for(;;)
+	{
+		checkPolled_();
+
+		//Exited processes are reported without blocking, but along with
+		//all others which exited meanwhile
+		dword_t remaining = 0;
+		if(exited_.empty() && timeout != TIMEOUT_INFINITE)
+		{
+			dword_t elapsed = getMilliseconds() - start;
+			remaining = (elapsed < timeout) ? timeout - elapsed : 0;
+		}
+		else if(exited_.empty())
+		{
+			remaining = TIMEOUT_INFINITE;
+		}
+
+		if(polled_)
+			remaining = min(remaining, POLL_INTERVAL);
+
+		int waitTime = (remaining == TIMEOUT_INFINITE) ? -1 : static_cast<int>(remaining);
+		int count;
+		do
+		{
+			count = epoll_wait(epoll_, events, MAX_EVENTS, waitTime);
+			if(count == -1 && errno != EINTR)
+				throw PosixException("ExitMonitor::wait()", "epoll_wait()", errno);
+
+			//Closing the pidfds right away keeps them from being reported
+			//again by the next epoll_wait()
+			for(int i = 0; i < count; ++i)
+			{
+				pid_t pid = static_cast<pid_t>(events[i].data.u64);
+				unordered_map<pid_t, int>::iterator found = watches_.find(pid);
+				if(found != watches_.end())
+				{
+					release_(found->second);
+					watches_.erase(found);
+				}
+
+				exited_.push_back(pid);
+			}
+
+			waitTime = 0;
+		}
+		while(count == MAX_EVENTS);
+
+		if(size_t collected = collect_(dest))
+			return collected;
+
+		if(timeout != TIMEOUT_INFINITE && getMilliseconds() - start >= timeout)
+			return 0;
+	}
+}
+
+#endif
+
+size_t ExitMonitor::size() const
+{
+	return watches_.size();
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+size_t ExitMonitor::collect_(vector<pid_t>& dest)
+{
+	vector<pid_t> exited;
+
+	EnterCriticalSection(&lock_);
+	exited.swap(exited_);
+	LeaveCriticalSection(&lock_);
+
+	for(size_t i = 0; i < exited.size(); ++i)
+	{
+		unordered_map<pid_t, Watch*>::iterator found = watches_.find(exited[i]);
+		if(found == watches_.end())
+			continue;
+
+		release_(found->second);
+		watches_.erase(found);
+	}
+
+	dest.insert(dest.end(), exited.begin(), exited.end());
+	return exited.size();
+}
+
+void CALLBACK ExitMonitor::onExit_(void* context, BOOLEAN)
+{
+	Watch* watch = static_cast<Watch*>(context);
+	ExitMonitor* monitor = watch->monitor;
+
+	EnterCriticalSection(&monitor->lock_);
+	monitor->exited_.push_back(watch->pid);
+	LeaveCriticalSection(&monitor->lock_);
+
+	SetEvent(monitor->event_);
+}
+
+void ExitMonitor::release_(Watch* watch)
+{
+	//INVALID_HANDLE_VALUE waits for a running callback to return
+	UnregisterWaitEx(watch->wait, INVALID_HANDLE_VALUE);
+	CloseHandle(watch->process);
+	delete watch;
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+size_t ExitMonitor::collect_(vector<pid_t>& dest)
+{
+	size_t count = exited_.size();
+	dest.insert(dest.end(), exited_.begin(), exited_.end());
+	exited_.clear();
+
+	return count;
+}
+
+void ExitMonitor::checkPolled_()
+{
+	if(!polled_)
+		return;
+
+	for(unordered_map<pid_t, int>::iterator i = watches_.begin(); i != watches_.end();)
+	{
+		if(i->second != -1 || kill(i->first, 0) != -1 || errno != ESRCH)
+		{
+			++i;
+			continue;
+		}
+
+		exited_.push_back(i->first);
+		i = watches_.erase(i);
+		--polled_;
+	}
+}
+
+void ExitMonitor::release_(int descriptor)
+{
+	if(descriptor == -1)
+		return;
+
+	//Closing removes it from the epoll set as well
+	::close(descriptor);
+}
+
+#endif
+
+/******************
+******* EOF *******
+******************/
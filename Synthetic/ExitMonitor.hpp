@@ -0,0 +1,197 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_EXITMONITOR_HPP
+#define SYNTHETIC_PROCESS_EXITMONITOR_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows Header Files:
+	#include <Windows.h>
+#endif
+
+//C++ Header Files:
+#include <vector>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* Reports the exit of any number of processes to a single thread.\n
+	* On Linux every process is watched through a pidfd registered with one
+	* epoll instance. Kernels without pidfd_open (before 5.3) fall back to
+	* checking the watched processes every 50 ms.\n
+	* On Windows WaitForMultipleObjects is limited to 64 handles, so every
+	* process gets a wait registered with the system's wait threads, all
+	* of them signalling one event.\n
+	* A process which exits is reported once and isn't watched anymore
+	* afterwards.\n
+	*/
+	class ExitMonitor
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates a monitor watching no process.
+		*/
+		ExitMonitor();
+
+		/**
+		* Destructor.
+		* Stops watching all processes.
+		*/
+		~ExitMonitor();
+
+		/**
+		* Starts watching a process. A process which doesn't exist anymore is
+		* reported by the next wait().
+		* @param pid The process' PID.
+		*/
+		void add(pid_t pid);
+
+		/**
+		* Stops watching a process.
+		* @param pid The process' PID.
+		* @return bool true if the process was watched.
+		*/
+		bool remove(pid_t pid);
+
+		/**
+		* @return size_t Number of watched processes.
+		*/
+		size_t size() const;
+
+		/**
+		* Waits until at least one of the watched processes exits.
+		* @param dest Reference to a vector the PIDs of all exited processes
+		* are appended to.
+		* @param timeout (optional) Time to wait in milliseconds, 0 only
+		* checks.
+		* @return size_t Number of exited processes, 0 if the time ran out.
+		*/
+		size_t wait(std::vector<pid_t>& dest, dword_t timeout = TIMEOUT_INFINITE);
+
+	private:
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+
+		/*
+		* A process and the wait registered for it
+		*/
+		struct Watch
+		{
+			ExitMonitor* monitor;
+			pid_t pid;
+			HANDLE process;
+			HANDLE wait;
+		};
+
+	#endif
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Not copyable
+		*/
+		ExitMonitor(const ExitMonitor&);
+		ExitMonitor& operator=(const ExitMonitor&);
+
+		/*
+		* Moves all exited processes to dest, on Windows it stops watching
+		* them as well
+		*/
+		size_t collect_(std::vector<pid_t>& dest);
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+
+		/*
+		* Called by a wait thread when a process exits
+		*/
+		static void CALLBACK onExit_(void* context, BOOLEAN timedOut);
+
+		/*
+		* Unregisters the wait and closes the handle
+		*/
+		static void release_(Watch* watch);
+
+	#elif defined(SYNTHETIC_ISLINUX)
+
+		/*
+		* Moves processes without pidfd which don't exist anymore to exited_
+		*/
+		void checkPolled_();
+
+		/*
+		* Removes the pidfd from epoll and closes it
+		*/
+		void release_(int descriptor);
+
+	#endif
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Exited processes not reported yet
+		std::vector<pid_t> exited_;
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+		std::unordered_map<pid_t, Watch*> watches_;
+
+		//exited_ is filled by the wait threads
+		CRITICAL_SECTION lock_;
+		HANDLE event_;
+	#elif defined(SYNTHETIC_ISLINUX)
+		//pidfd by PID, -1 for processes checked by polling
+		std::unordered_map<pid_t, int> watches_;
+		size_t polled_;
+		int epoll_;
+	#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_EXITMONITOR_HPP
+
+/******************
+******* EOF *******
+******************/
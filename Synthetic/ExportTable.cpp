@@ -0,0 +1,776 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "ExportTable.hpp"
+#include "MappedFile.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+//Windows header files:
+#include <Windows.h>
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <elf.h>
+#include <link.h>
+
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+const dword_t ExportTable::NO_NAME;
+
+namespace
+{
+	//Upper bound for export counts, protects against corrupted headers
+	const dword_t MAX_EXPORTS = 0x100000;
+
+	//Upper bound for single names and whole string tables
+	const size_t MAX_EXPORT_NAME = 0x1000;
+	const size_t MAX_STRING_TABLE = 0x4000000;
+
+	/*
+	* Orders exports by address, named aliases behind unnamed ones
+	*/
+	bool compareEntry(const ExportEntry& lhs, const ExportEntry& rhs)
+	{
+		if(lhs.rva != rhs.rva)
+			return lhs.rva < rhs.rva;
+
+		const bool lhsNamed = lhs.name != ExportTable::NO_NAME;
+		const bool rhsNamed = rhs.name != ExportTable::NO_NAME;
+		if(lhsNamed != rhsNamed)
+			return rhsNamed;
+		return lhs.ordinal < rhs.ordinal;
+	}
+
+	/*
+	* FNV-1a hash of an export name
+	*/
+	dword_t hashName(const char* name, size_t length)
+	{
+		dword_t hash = 2166136261u;
+		for(size_t i = 0; i < length; ++i)
+		{
+			hash ^= static_cast<byte_t>(name[i]);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	/*
+	* Copies bytes of a file mapping, throws if they're outside of it
+	*/
+	void copyFromFile(const byte_t* data, size_t size, size_t offset, void* dest, size_t amount)
+	{
+		if(offset > size || amount > size - offset)
+			throw runtime_error("ExportTable::load() Error : Image exceeds the file");
+
+		memcpy(dest, data + offset, amount);
+	}
+
+	/*
+	* Reads a zero terminated string byte by byte, so the read never
+	* crosses into an unmapped page
+	*/
+	template<typename reader_t>
+	string readName(const reader_t& read, ptr_t rva)
+	{
+		string name;
+		for(size_t i = 0; i < MAX_EXPORT_NAME; ++i)
+		{
+			char c;
+			read(rva + i, &c, 1);
+			if(!c)
+				break;
+			name.push_back(c);
+		}
+
+		return name;
+	}
+
+	/*
+	* Copies an array from an already read block or reads it from the
+	* image if it lies elsewhere
+	*/
+	template<typename reader_t, typename data_t>
+	void readArray(	const reader_t& read,
+							const vector<byte_t>& block,
+							ptr_t blockRva,
+							ptr_t rva,
+							size_t count,
+							vector<data_t>& dest)
+	{
+		dest.resize(count);
+		if(!count)
+			return;
+
+		const size_t size = count * sizeof(data_t);
+		const size_t offset = static_cast<size_t>(rva - blockRva);
+		if(rva >= blockRva && offset <= block.size() && size <= block.size() - offset)
+			memcpy(&dest[0], &block[offset], size);
+		else
+			read(rva, &dest[0], size);
+	}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	/*
+	* Translates addresses relative to the image base into file offsets
+	* using the section table
+	*/
+	class PeFileReader
+	{
+	public:
+
+		PeFileReader(const byte_t* data, size_t size) : data_(data), size_(size)
+		{
+			IMAGE_DOS_HEADER dosHeader;
+			copyFromFile(data_, size_, 0, &dosHeader, sizeof(dosHeader));
+			if(dosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+				throw runtime_error("ExportTable::load() Error : No PE image");
+
+			IMAGE_NT_HEADERS32 ntHeaders;
+			copyFromFile(data_, size_, dosHeader.e_lfanew, &ntHeaders, sizeof(ntHeaders));
+			if(ntHeaders.Signature != IMAGE_NT_SIGNATURE)
+				throw runtime_error("ExportTable::load() Error : Invalid NT headers");
+
+			//SizeOfHeaders is at the same offset in both optional headers
+			headersSize_ = ntHeaders.OptionalHeader.SizeOfHeaders;
+
+			const size_t sectionOffset = dosHeader.e_lfanew +
+													sizeof(DWORD) +
+													sizeof(IMAGE_FILE_HEADER) +
+													ntHeaders.FileHeader.SizeOfOptionalHeader;
+			sections_.resize(ntHeaders.FileHeader.NumberOfSections);
+			if(!sections_.empty())
+			{
+				copyFromFile(	data_,
+									size_,
+									sectionOffset,
+									&sections_[0],
+									sections_.size() * sizeof(IMAGE_SECTION_HEADER));
+			}
+		}
+
+		void operator()(ptr_t rva, void* dest, size_t amount) const
+		{
+			if(rva < headersSize_)
+			{
+				copyFromFile(data_, size_, static_cast<size_t>(rva), dest, amount);
+				return;
+			}
+
+			for(vector<IMAGE_SECTION_HEADER>::const_iterator i = sections_.begin(); i != sections_.end(); ++i)
+			{
+				const ptr_t sectionSize = max<ptr_t>(i->Misc.VirtualSize, i->SizeOfRawData);
+				if(rva >= i->VirtualAddress && rva - i->VirtualAddress < sectionSize)
+				{
+					const size_t offset = static_cast<size_t>(i->PointerToRawData + rva - i->VirtualAddress);
+					copyFromFile(data_, size_, offset, dest, amount);
+					return;
+				}
+			}
+
+			throw runtime_error("ExportTable::load() Error : Address outside of all sections");
+		}
+
+	private:
+
+		const byte_t* data_;
+		size_t size_;
+		dword_t headersSize_;
+		vector<IMAGE_SECTION_HEADER> sections_;
+	};
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	#if defined(SYNTHETIC_IS64BIT)
+		const unsigned char NATIVE_ELF_CLASS = ELFCLASS64;
+	#else
+		const unsigned char NATIVE_ELF_CLASS = ELFCLASS32;
+	#endif
+
+	//Set in a version index for symbols which aren't the default version
+	const ElfW(Half) VERSYM_HIDDEN = 0x8000;
+
+	/*
+	* Translates addresses relative to the image base into file offsets
+	* using the loadable segments
+	*/
+	class ElfFileReader
+	{
+	public:
+
+		ElfFileReader(const byte_t* data, size_t size) : data_(data), size_(size), imageBase_(0)
+		{
+			ElfW(Ehdr) header;
+			copyFromFile(data_, size_, 0, &header, sizeof(header));
+			if(memcmp(header.e_ident, ELFMAG, SELFMAG) || header.e_ident[EI_CLASS] != NATIVE_ELF_CLASS)
+				throw runtime_error("ExportTable::load() Error : No ELF image of the native class");
+
+			segments_.resize(header.e_phnum);
+			if(!segments_.empty())
+			{
+				copyFromFile(	data_,
+									size_,
+									header.e_phoff,
+									&segments_[0],
+									segments_.size() * sizeof(ElfW(Phdr)));
+			}
+
+			for(vector<ElfW(Phdr)>::const_iterator i = segments_.begin(); i != segments_.end(); ++i)
+			{
+				if(i->p_type == PT_LOAD)
+				{
+					imageBase_ = i->p_vaddr - i->p_offset;
+					break;
+				}
+			}
+		}
+
+		void operator()(ptr_t rva, void* dest, size_t amount) const
+		{
+			const ptr_t address = rva + imageBase_;
+			for(vector<ElfW(Phdr)>::const_iterator i = segments_.begin(); i != segments_.end(); ++i)
+			{
+				if(i->p_type == PT_LOAD && address >= i->p_vaddr && address - i->p_vaddr < i->p_filesz)
+				{
+					const size_t offset = static_cast<size_t>(i->p_offset + address - i->p_vaddr);
+					copyFromFile(data_, size_, offset, dest, amount);
+					return;
+				}
+			}
+
+			throw runtime_error("ExportTable::load() Error : Address outside of all segments");
+		}
+
+	private:
+
+		const byte_t* data_;
+		size_t size_;
+		ptr_t imageBase_;
+		vector<ElfW(Phdr)> segments_;
+	};
+
+#endif
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+ExportTable::ExportTable()
+{ }
+
+size_t ExportTable::read(const Process& proc, ptr_t base)
+{
+	clear();
+
+	ImageReader reader = [&proc, base](ptr_t rva, void* dest, size_t size)
+	{
+		proc.rawRead(base + rva, dest, size);
+	};
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	parsePe_(reader);
+#elif defined(SYNTHETIC_ISLINUX)
+	parseElf_(reader, base);
+#endif
+
+	index_();
+	return entries_.size();
+}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+bool ExportTable::load(const wstring& path)
+{
+	clear();
+
+	MappedFile file(path);
+	if(!file.isValid())
+		return false;
+
+	parsePe_(PeFileReader(file.getData(), file.getSize()));
+
+	index_();
+	return true;
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+bool ExportTable::load(const string& path)
+{
+	clear();
+
+	MappedFile file(path);
+	if(!file.isValid())
+		return false;
+
+	parseElf_(ElfFileReader(file.getData(), file.getSize()), 0);
+
+	index_();
+	return true;
+}
+
+#endif
+
+void ExportTable::clear()
+{
+	entries_.clear();
+	rvas_.clear();
+	names_.clear();
+	named_.clear();
+	nameSlots_.clear();
+	forwarders_.clear();
+}
+
+const ExportEntry* ExportTable::findNearest(dword_t rva) const
+{
+	if(rvas_.empty())
+		return NULL;
+
+	//Same search as ModuleTable::findContaining(), aliases resolve to
+	//the last one, which is named if any of them is
+	const dword_t* rvas = &rvas_[0];
+	size_t first = 0;
+	size_t count = rvas_.size();
+	while(count > 1)
+	{
+		size_t half = count / 2;
+		first = (rvas[first + half] <= rva) ? first + half : first;
+		count -= half;
+	}
+
+	return rva < rvas[first] ? NULL : &entries_[first];
+}
+
+const ExportEntry* ExportTable::findByName(const string& name) const
+{
+	if(nameSlots_.empty())
+		return NULL;
+
+	const size_t mask = nameSlots_.size() - 1;
+	for(size_t slot = hashName(name.c_str(), name.size()) & mask; nameSlots_[slot]; slot = (slot + 1) & mask)
+	{
+		const ExportEntry& entry = named_[nameSlots_[slot] - 1];
+		if(!strcmp(&names_[entry.name], name.c_str()))
+			return &entry;
+	}
+
+	return NULL;
+}
+
+const ExportEntry* ExportTable::findByOrdinal(dword_t ordinal) const
+{
+	for(vector<ExportEntry>::const_iterator i = entries_.begin(); i != entries_.end(); ++i)
+	{
+		if(i->ordinal == ordinal)
+			return &*i;
+	}
+
+	return NULL;
+}
+
+bool ExportTable::getForwarder(const string& name, string& dest) const
+{
+	unordered_map<string, string>::const_iterator i = forwarders_.find(name);
+	if(i == forwarders_.end())
+		return false;
+
+	dest = i->second;
+	return true;
+}
+
+const char* ExportTable::getName(const ExportEntry& entry) const
+{
+	if(entry.name == NO_NAME)
+		return NULL;
+
+	return &names_[entry.name];
+}
+
+const vector<ExportEntry>& ExportTable::getEntries() const
+{
+	return entries_;
+}
+
+size_t ExportTable::size() const
+{
+	return entries_.size();
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+void ExportTable::parsePe_(const ImageReader& read)
+{
+	IMAGE_DOS_HEADER dosHeader;
+	read(0, &dosHeader, sizeof(dosHeader));
+	if(dosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+		throw runtime_error("ExportTable::parsePe_() Error : No PE image at base address");
+
+	//Both header versions agree up to the optional header's magic
+	IMAGE_NT_HEADERS64 ntHeaders;
+	read(dosHeader.e_lfanew, &ntHeaders, sizeof(ntHeaders));
+	if(ntHeaders.Signature != IMAGE_NT_SIGNATURE)
+		throw runtime_error("ExportTable::parsePe_() Error : Invalid NT headers");
+
+	IMAGE_DATA_DIRECTORY dataDirectory;
+	if(ntHeaders.OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+	{
+		if(ntHeaders.OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_EXPORT)
+			return;
+		dataDirectory = ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+	}
+	else if(ntHeaders.OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+	{
+		const IMAGE_NT_HEADERS32& ntHeaders32 = reinterpret_cast<const IMAGE_NT_HEADERS32&>(ntHeaders);
+		if(ntHeaders32.OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_EXPORT)
+			return;
+		dataDirectory = ntHeaders32.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+	}
+	else
+		throw runtime_error("ExportTable::parsePe_() Error : Unknown optional header");
+
+	if(dataDirectory.Size < sizeof(IMAGE_EXPORT_DIRECTORY))
+		return;
+
+	//Linkers put the arrays and names right behind the directory, so
+	//usually this is the only read
+	vector<byte_t> directory(dataDirectory.Size);
+	read(dataDirectory.VirtualAddress, &directory[0], directory.size());
+
+	IMAGE_EXPORT_DIRECTORY exportDirectory;
+	memcpy(&exportDirectory, &directory[0], sizeof(exportDirectory));
+	if(	exportDirectory.NumberOfFunctions > MAX_EXPORTS ||
+			exportDirectory.NumberOfNames > MAX_EXPORTS)
+		throw runtime_error("ExportTable::parsePe_() Error : Corrupted export directory");
+
+	vector<dword_t> functions;
+	vector<dword_t> nameRvas;
+	vector<word_t> nameOrdinals;
+	readArray(	read, directory, dataDirectory.VirtualAddress,
+					exportDirectory.AddressOfFunctions,
+					exportDirectory.NumberOfFunctions,
+					functions);
+	readArray(	read, directory, dataDirectory.VirtualAddress,
+					exportDirectory.AddressOfNames,
+					exportDirectory.NumberOfNames,
+					nameRvas);
+	readArray(	read, directory, dataDirectory.VirtualAddress,
+					exportDirectory.AddressOfNameOrdinals,
+					exportDirectory.NumberOfNames,
+					nameOrdinals);
+
+	//Strings inside the directory are taken from the block
+	const byte_t* directoryEnd = &directory[0] + directory.size();
+	auto getString = [&](dword_t rva) -> string
+	{
+		const size_t offset = rva - dataDirectory.VirtualAddress;
+		if(rva < dataDirectory.VirtualAddress || offset >= directory.size())
+			return readName(read, rva);
+
+		const byte_t* str = &directory[offset];
+		return string(str, find(str, directoryEnd, byte_t(0)));
+	};
+
+	//Names of every function, the first one is used for the sorted list
+	vector<dword_t> nameIndices(functions.size(), NO_NAME);
+	for(size_t i = 0; i < nameOrdinals.size(); ++i)
+	{
+		const word_t index = nameOrdinals[i];
+		if(index >= functions.size() || !functions[index])
+			continue;
+
+		//Forwarders point into the directory
+		const dword_t rva = functions[index];
+		if(rva - dataDirectory.VirtualAddress < dataDirectory.Size)
+			forwarders_.insert(make_pair(getString(nameRvas[i]), getString(rva)));
+		else if(nameIndices[index] == NO_NAME)
+			nameIndices[index] = static_cast<dword_t>(i);
+		else
+		{
+			const string name = getString(nameRvas[i]);
+			add_(rva, exportDirectory.Base + index, name.c_str(), name.size(), true);
+		}
+	}
+
+	entries_.reserve(functions.size());
+	named_.reserve(nameRvas.size());
+	for(size_t i = 0; i < functions.size(); ++i)
+	{
+		const dword_t rva = functions[i];
+		if(!rva || rva - dataDirectory.VirtualAddress < dataDirectory.Size)
+			continue;
+
+		const dword_t ordinal = exportDirectory.Base + static_cast<dword_t>(i);
+		if(nameIndices[i] == NO_NAME)
+			add_(rva, ordinal, NULL, 0, false);
+		else
+		{
+			const string name = getString(nameRvas[nameIndices[i]]);
+			add_(rva, ordinal, name.c_str(), name.size(), true);
+		}
+	}
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+void ExportTable::parseElf_(const ImageReader& read, ptr_t base)
+{
+	ElfW(Ehdr) header;
+	read(0, &header, sizeof(header));
+	if(memcmp(header.e_ident, ELFMAG, SELFMAG) || header.e_ident[EI_CLASS] != NATIVE_ELF_CLASS)
+		throw runtime_error("ExportTable::parseElf_() Error : No ELF image of the native class");
+
+	//Program headers are part of the first segment, which starts at the
+	//beginning of the file
+	vector<ElfW(Phdr)> segments(header.e_phnum);
+	if(!segments.empty())
+		read(header.e_phoff, &segments[0], segments.size() * sizeof(ElfW(Phdr)));
+
+	ptr_t imageBase = 0;
+	const ElfW(Phdr)* dynamicSegment = NULL;
+	bool foundLoad = false;
+	for(vector<ElfW(Phdr)>::const_iterator i = segments.begin(); i != segments.end(); ++i)
+	{
+		if(i->p_type == PT_LOAD && !foundLoad)
+		{
+			imageBase = i->p_vaddr - i->p_offset;
+			foundLoad = true;
+		}
+		else if(i->p_type == PT_DYNAMIC)
+			dynamicSegment = &*i;
+	}
+
+	if(!dynamicSegment)
+		return;
+
+	vector<ElfW(Dyn)> dynamic(dynamicSegment->p_memsz / sizeof(ElfW(Dyn)));
+	if(dynamic.empty())
+		return;
+	read(dynamicSegment->p_vaddr - imageBase, &dynamic[0], dynamic.size() * sizeof(ElfW(Dyn)));
+
+	//The loader relocates some pointers of shared objects in place
+	const bool relocated = base && header.e_type == ET_DYN;
+	auto toRva = [&](ptr_t address) -> ptr_t
+	{
+		return (relocated && address >= base) ? address - base : address - imageBase;
+	};
+
+	ptr_t symbolTable = 0;
+	ptr_t stringTable = 0;
+	ptr_t gnuHash = 0;
+	ptr_t hash = 0;
+	ptr_t versions = 0;
+	size_t stringTableSize = 0;
+	for(vector<ElfW(Dyn)>::const_iterator i = dynamic.begin(); i != dynamic.end() && i->d_tag != DT_NULL; ++i)
+	{
+		switch(i->d_tag)
+		{
+		case DT_SYMTAB:	symbolTable = toRva(i->d_un.d_ptr);	break;
+		case DT_STRTAB:	stringTable = toRva(i->d_un.d_ptr);	break;
+		case DT_STRSZ:		stringTableSize = i->d_un.d_val;		break;
+		case DT_GNU_HASH:	gnuHash = toRva(i->d_un.d_ptr);		break;
+		case DT_HASH:		hash = toRva(i->d_un.d_ptr);			break;
+		case DT_VERSYM:	versions = toRva(i->d_un.d_ptr);		break;
+		}
+	}
+
+	if(!symbolTable || !stringTable || !stringTableSize || stringTableSize > MAX_STRING_TABLE)
+		return;
+
+	//The dynamic section doesn't store the number of symbols, the hash
+	//tables cover all of them
+	size_t symbolCount = 0;
+	if(gnuHash)
+	{
+		dword_t gnuHeader[4];
+		read(gnuHash, gnuHeader, sizeof(gnuHeader));
+
+		const dword_t bucketCount = gnuHeader[0];
+		const dword_t symbolOffset = gnuHeader[1];
+		const dword_t bloomSize = gnuHeader[2];
+		if(bucketCount > MAX_EXPORTS || bloomSize > MAX_EXPORTS)
+			throw runtime_error("ExportTable::parseElf_() Error : Corrupted GNU hash table");
+
+		vector<dword_t> buckets(bucketCount);
+		const ptr_t bucketsRva = gnuHash + sizeof(gnuHeader) + bloomSize * sizeof(ElfW(Addr));
+		if(!buckets.empty())
+			read(bucketsRva, &buckets[0], buckets.size() * sizeof(dword_t));
+
+		//Chains of the last bucket end at the last symbol
+		dword_t last = buckets.empty() ? 0 : *max_element(buckets.begin(), buckets.end());
+		if(last < symbolOffset)
+			symbolCount = symbolOffset;
+		else
+		{
+			const ptr_t chainRva = bucketsRva + buckets.size() * sizeof(dword_t);
+			for(;;)
+			{
+				dword_t chain;
+				read(chainRva + (last - symbolOffset) * sizeof(dword_t), &chain, sizeof(chain));
+				if((chain & 1) || last >= MAX_EXPORTS)
+					break;
+				++last;
+			}
+
+			symbolCount = last + 1;
+		}
+	}
+	else if(hash)
+	{
+		dword_t hashHeader[2];
+		read(hash, hashHeader, sizeof(hashHeader));
+		symbolCount = hashHeader[1];
+	}
+
+	if(symbolCount > MAX_EXPORTS)
+		throw runtime_error("ExportTable::parseElf_() Error : Corrupted hash table");
+	if(symbolCount < 2)
+		return;
+
+	vector<ElfW(Sym)> symbols(symbolCount);
+	read(symbolTable, &symbols[0], symbols.size() * sizeof(ElfW(Sym)));
+
+	vector<char> strings(stringTableSize);
+	read(stringTable, &strings[0], strings.size());
+
+	vector<ElfW(Half)> versionIndices;
+	if(versions)
+	{
+		versionIndices.resize(symbolCount);
+		read(versions, &versionIndices[0], versionIndices.size() * sizeof(ElfW(Half)));
+	}
+
+	//The last byte of a string table is always zero
+	strings.back() = '\0';
+
+	entries_.reserve(symbolCount);
+	named_.reserve(symbolCount);
+	names_.reserve(strings.size());
+	for(size_t i = 1; i < symbols.size(); ++i)
+	{
+		const ElfW(Sym)& symbol = symbols[i];
+		const unsigned char type = ELF64_ST_TYPE(symbol.st_info);
+		const unsigned char binding = ELF64_ST_BIND(symbol.st_info);
+
+		if(symbol.st_shndx == SHN_UNDEF || symbol.st_shndx == SHN_ABS)
+			continue;
+		if(binding != STB_GLOBAL && binding != STB_WEAK && binding != STB_GNU_UNIQUE)
+			continue;
+		if(type != STT_FUNC && type != STT_OBJECT && type != STT_GNU_IFUNC)
+			continue;
+		if(!symbol.st_name || symbol.st_name >= strings.size())
+			continue;
+
+		const char* name = &strings[symbol.st_name];
+		const bool isDefault = versionIndices.empty() || !(versionIndices[i] & VERSYM_HIDDEN);
+		add_(	static_cast<dword_t>(symbol.st_value - imageBase),
+				static_cast<dword_t>(i),
+				name,
+				strlen(name),
+				isDefault);
+	}
+}
+
+#endif
+
+void ExportTable::add_(dword_t rva, dword_t ordinal, const char* name, size_t length, bool indexed)
+{
+	ExportEntry entry;
+	entry.rva = rva;
+	entry.ordinal = ordinal;
+	entry.name = NO_NAME;
+
+	if(length)
+	{
+		entry.name = static_cast<dword_t>(names_.size());
+		names_.insert(names_.end(), name, name + length);
+		names_.push_back('\0');
+
+		if(indexed)
+			named_.push_back(entry);
+	}
+
+	entries_.push_back(entry);
+}
+
+void ExportTable::index_()
+{
+	sort(entries_.begin(), entries_.end(), compareEntry);
+
+	rvas_.reserve(entries_.size());
+	for(vector<ExportEntry>::iterator i = entries_.begin(); i != entries_.end(); ++i)
+		rvas_.push_back(i->rva);
+
+	if(named_.empty())
+		return;
+
+	//At most half full, so probe sequences stay short
+	size_t slotCount = 1;
+	while(slotCount < named_.size() * 2)
+		slotCount *= 2;
+
+	nameSlots_.assign(slotCount, 0);
+	const size_t mask = slotCount - 1;
+	for(size_t i = 0; i < named_.size(); ++i)
+	{
+		const char* name = &names_[named_[i].name];
+		size_t slot = hashName(name, strlen(name)) & mask;
+
+		//Names which are already indexed keep their first export
+		bool duplicate = false;
+		for(; nameSlots_[slot]; slot = (slot + 1) & mask)
+		{
+			if(!strcmp(&names_[named_[nameSlots_[slot] - 1].name], name))
+			{
+				duplicate = true;
+				break;
+			}
+		}
+
+		if(!duplicate)
+			nameSlots_[slot] = static_cast<dword_t>(i + 1);
+	}
+}
+
+/******************
+******* EOF *******
+******************/
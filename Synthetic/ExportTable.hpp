@@ -0,0 +1,228 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_EXPORTTABLE_HPP
+#define SYNTHETIC_PROCESS_EXPORTTABLE_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A single export of a module
+	*/
+	struct ExportEntry
+	{
+		/**
+		* Address of the export relative to the module's base
+		*/
+		dword_t rva;
+
+		/**
+		* The export's ordinal, the symbol index for ELF images
+		*/
+		dword_t ordinal;
+
+		/**
+		* Offset of the name in the table's name pool or
+		* ExportTable::NO_NAME for exports by ordinal only
+		*/
+		dword_t name;
+	};
+
+	/**
+	* The exports of a module sorted by address and indexed by name.\n
+	* Windows builds parse the PE export directory, Linux builds the dynamic
+	* symbol table of ELF images of their own word size, sized by the GNU
+	* hash table or DT_HASH. Both are read from the target's memory or from
+	* a memory mapped file, the module is never loaded into this process.\n
+	* All names are kept in one pool and the entries are plain values.
+	* Forwarded exports have no code in the module, they are only
+	* available through getForwarder().\n
+	* Non-default ELF symbol versions are left out of the name index and
+	* IFUNC symbols resolve to their resolver.\n
+	*/
+	class ExportTable
+	{
+	public:
+
+		static const dword_t NO_NAME = 0xFFFFFFFF;
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty table.
+		*/
+		ExportTable();
+
+		/**
+		* Reads the exports of a module mapped in a process.
+		* @param proc The process the module is loaded in.
+		* @param base The module's base address.
+		* @return size_t Number of exports read.
+		*/
+		size_t read(const Process& proc, ptr_t base);
+
+		/**
+		* Reads the exports from a module's file.
+		* @param path Path of the file.
+		* @return bool false if the file couldn't be opened, invalid images
+		* throw.
+		*/
+	#if defined(SYNTHETIC_ISWINDOWS)
+		bool load(const std::wstring& path);
+	#elif defined(SYNTHETIC_ISLINUX)
+		bool load(const std::string& path);
+	#endif
+
+		/**
+		* Removes all exports.
+		*/
+		void clear();
+
+		/**
+		* Searches the export an address belongs to, which is the last
+		* export starting at or below it.
+		* @param rva The address relative to the module's base.
+		* @return const ExportEntry* The export or NULL if the address is
+		* below all exports.
+		*/
+		const ExportEntry* findNearest(dword_t rva) const;
+
+		/**
+		* Searches an export by its name.
+		* @param name The export's name.
+		* @return const ExportEntry* The export or NULL if there is none or
+		* it is forwarded.
+		*/
+		const ExportEntry* findByName(const std::string& name) const;
+
+		/**
+		* Searches an export by its ordinal.
+		* @param ordinal The export's ordinal.
+		* @return const ExportEntry* The export or NULL.
+		*/
+		const ExportEntry* findByOrdinal(dword_t ordinal) const;
+
+		/**
+		* Retrieves where a forwarded export points to.
+		* @param name The export's name.
+		* @param dest Reference to a string receiving the forwarder like
+		* NTDLL.RtlAllocateHeap or NTDLL.#12.
+		* @return bool false if the export isn't forwarded.
+		*/
+		bool getForwarder(const std::string& name, std::string& dest) const;
+
+		/**
+		* @param entry An entry of this table.
+		* @return const char* The export's name or NULL if it is only
+		* exported by ordinal.
+		*/
+		const char* getName(const ExportEntry& entry) const;
+
+		/**
+		* @return const std::vector<ExportEntry>& All exports sorted by
+		* their address.
+		*/
+		const std::vector<ExportEntry>& getEntries() const;
+
+		/**
+		* @return size_t Number of exports.
+		*/
+		size_t size() const;
+
+	private:
+
+		/*
+		* Reads size bytes from the image at an address relative to its base
+		*/
+		typedef std::function<void (ptr_t rva, void* dest, size_t size)> ImageReader;
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+		/*
+		* Parses the export directory of a PE image
+		*/
+		void parsePe_(const ImageReader& read);
+	#elif defined(SYNTHETIC_ISLINUX)
+		/*
+		* Parses the dynamic symbols of an ELF image, base is the load
+		* address if the dynamic section may have been relocated by the
+		* loader, otherwise 0
+		*/
+		void parseElf_(const ImageReader& read, ptr_t base);
+	#endif
+
+		/*
+		* Appends an export, indexed decides whether it's found by name
+		*/
+		void add_(dword_t rva, dword_t ordinal, const char* name, size_t length, bool indexed);
+
+		/*
+		* Sorts the exports and builds the name index after parsing
+		*/
+		void index_();
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<ExportEntry> entries_;
+		std::vector<dword_t> rvas_;
+		std::vector<char> names_;
+
+		//Exports found by name and an open addressing index into them,
+		//slots hold index + 1. Avoids a node and a key copy per export.
+		std::vector<ExportEntry> named_;
+		std::vector<dword_t> nameSlots_;
+
+		std::unordered_map<std::string, std::string> forwarders_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_EXPORTTABLE_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,551 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//POSIX header files:
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "GroupScanner.hpp"
+#include "ScanKernels.hpp"
+
+using namespace std;
+using namespace Synthetic;
+using namespace Synthetic::Kernels;
+
+namespace
+{
+	//Memory scanned per block, groups may overlap into the next one
+	const size_t BLOCK_SIZE = 0x100000;
+
+	//Memory sampled to choose the anchor, in pieces spread over the ranges
+	const size_t SAMPLE_SIZE = 0x100000;
+	const size_t SAMPLE_PIECES = 16;
+
+	/*
+	* A block of a range, groups starting in it belong to it
+	*/
+	struct Block
+	{
+		ptr_t address;
+		size_t size;
+
+		//End of the range, groups may not exceed it
+		ptr_t limit;
+	};
+
+	/*
+	* Everything the threads of a scan share
+	*/
+	struct Job
+	{
+		const Process* proc;
+		std::vector<Matcher> matchers;
+		std::vector<size_t> sizes;
+		std::vector<size_t> distances;
+		std::vector<size_t> alignments;
+		size_t anchor;
+		size_t span;
+
+		//Bytes from the start of the first value to the end of the last
+		//one at least
+		size_t extent;
+
+		std::vector<Block> blocks;
+
+		//Index of the next block to scan
+	#if defined(SYNTHETIC_ISWINDOWS)
+		volatile LONG next;
+	#elif defined(SYNTHETIC_ISLINUX)
+		volatile long next;
+	#endif
+	};
+
+	/*
+	* A thread of a scan with its own results
+	*/
+	struct Worker
+	{
+		Job* job;
+		std::vector<ptr_t> results;
+	};
+
+	/*
+	* Memory of a block read into a buffer
+	*/
+	struct Buffer
+	{
+		const Job* job;
+		const byte_t* data;
+		ptr_t address;
+		ptr_t end;
+
+		//Groups starting here are reported
+		ptr_t first;
+		ptr_t last;
+	};
+
+	size_t takeBlock(Job& job)
+	{
+	#if defined(SYNTHETIC_ISWINDOWS)
+		return static_cast<size_t>(InterlockedIncrement(&job.next) - 1);
+	#elif defined(SYNTHETIC_ISLINUX)
+		return static_cast<size_t>(__sync_fetch_and_add(&job.next, 1));
+	#endif
+	}
+
+	size_t getProcessorCount()
+	{
+	#if defined(SYNTHETIC_ISWINDOWS)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors;
+	#elif defined(SYNTHETIC_ISLINUX)
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		return (count > 0) ? static_cast<size_t>(count) : 1;
+	#endif
+	}
+
+	/*
+	* Calls visit for every position of a value in [low, high] which
+	* matches, stops when it returns true
+	*/
+	template<class visitor_t>
+	bool visitMatches(const Buffer& buffer, size_t index, ptr_t low, ptr_t high, visitor_t& visit)
+	{
+		const Job& job = *buffer.job;
+		const size_t alignment = job.alignments[index];
+		if(buffer.end - buffer.address < job.sizes[index])
+			return false;
+
+		low = max(low, buffer.address);
+		high = min(high, buffer.end - job.sizes[index]);
+
+		low = (low + alignment - 1) / alignment * alignment;
+		if(low > high)
+			return false;
+
+		const size_t count = (high - low) / alignment + 1;
+		for(size_t i = 0; i < count; i += WORD_BITS)
+		{
+			const ptr_t position = low + i * alignment;
+			qword_t bits = job.matchers[index].run(	buffer.data + (position - buffer.address),
+																	min(WORD_BITS, count - i),
+																	alignment);
+			for(; bits; bits &= bits - 1)
+			{
+				if(visit(index, position + lowestBit(bits) * alignment))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	/*
+	* Collects the positions visited
+	*/
+	struct Collect
+	{
+		std::vector<ptr_t>& dest;
+
+		Collect(std::vector<ptr_t>& dest) : dest(dest)
+		{ }
+
+		bool operator()(size_t, ptr_t position)
+		{
+			dest.push_back(position);
+			return false;
+		}
+
+	private:
+		Collect& operator=(const Collect&);
+	};
+
+	/*
+	* Collects the matches of a value in windows around the sorted
+	* positions of its neighbour, [position + low, position + high] or
+	* [position - high, position - low] going backward. Overlapping
+	* windows are merged, so every position is matched once and dest
+	* ends up sorted.
+	*/
+	void matchAround(	const Buffer& buffer,
+							size_t index,
+							const std::vector<ptr_t>& positions,
+							size_t low,
+							size_t high,
+							bool backward,
+							std::vector<ptr_t>& dest)
+	{
+		dest.clear();
+		Collect collect(dest);
+
+		ptr_t windowLow = 0;
+		ptr_t windowHigh = 0;
+		bool open = false;
+		for(std::vector<ptr_t>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+		{
+			if(backward && *i - buffer.address < low)
+				continue;
+
+			const ptr_t from = backward ? ((*i - buffer.address > high) ? *i - high : buffer.address) : *i + low;
+			const ptr_t to = backward ? *i - low : *i + high;
+			if(open && from <= windowHigh + 1)
+			{
+				windowHigh = max(windowHigh, to);
+				continue;
+			}
+
+			if(open)
+				visitMatches(buffer, index, windowLow, windowHigh, collect);
+
+			windowLow = from;
+			windowHigh = to;
+			open = true;
+		}
+
+		if(open)
+			visitMatches(buffer, index, windowLow, windowHigh, collect);
+	}
+
+	/*
+	* Keeps the sorted positions which have a successor in
+	* [position + low, position + high]
+	*/
+	void keepFollowed(	std::vector<ptr_t>& positions,
+								const std::vector<ptr_t>& successors,
+								size_t low,
+								size_t high)
+	{
+		std::vector<ptr_t>::const_iterator next = successors.begin();
+		std::vector<ptr_t>::iterator kept = positions.begin();
+		for(std::vector<ptr_t>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+		{
+			while(next != successors.end() && *next < *i + low)
+				++next;
+
+			if(next != successors.end() && *next <= *i + high)
+				*kept++ = *i;
+		}
+
+		positions.erase(kept, positions.end());
+	}
+
+	/*
+	* Collects the first values of the groups in a buffer. Only the anchor
+	* is searched in the whole buffer. The values behind it are searched
+	* around the matches of their predecessor, then chains which don't
+	* reach the last value are dropped, then the values in front of the
+	* anchor are searched around the remaining matches of their successor.
+	* Every value is matched at most once per position, whatever the
+	* number of chains.
+	*/
+	void findGroups(const Buffer& buffer, std::vector<std::vector<ptr_t> >& matches, std::vector<ptr_t>& dest)
+	{
+		const Job& job = *buffer.job;
+		const size_t count = job.matchers.size();
+		const size_t anchor = job.anchor;
+
+		matches.resize(count);
+		matches[anchor].clear();
+		Collect collect(matches[anchor]);
+		visitMatches(buffer, anchor, buffer.address, buffer.end, collect);
+
+		for(size_t i = anchor + 1; i < count; ++i)
+			matchAround(buffer, i, matches[i - 1], job.sizes[i - 1], job.distances[i], false, matches[i]);
+
+		for(size_t i = count - 1; i > anchor; --i)
+			keepFollowed(matches[i - 1], matches[i], job.sizes[i - 1], job.distances[i]);
+
+		for(size_t i = anchor; i > 0; --i)
+			matchAround(buffer, i - 1, matches[i], job.sizes[i - 1], job.distances[i], true, matches[i - 1]);
+
+		const std::vector<ptr_t>& first = matches[0];
+		for(std::vector<ptr_t>::const_iterator i = first.begin(); i != first.end(); ++i)
+		{
+			if(*i >= buffer.first && *i < buffer.last)
+				dest.push_back(*i);
+		}
+	}
+
+	/*
+	* Scans blocks until none is left
+	*/
+	void work(Worker& worker)
+	{
+		Job& job = *worker.job;
+		std::vector<byte_t> data(BLOCK_SIZE + job.span);
+		std::vector<std::vector<ptr_t> > matches;
+
+		for(size_t index = takeBlock(job); index < job.blocks.size(); index = takeBlock(job))
+		{
+			const Block& block = job.blocks[index];
+
+			//Unreadable blocks are skipped, reads stopping early are scanned
+			//as far as they got
+			size_t amount;
+			if(job.proc->tryRead(block.address, &data[0], min<size_t>(block.size + job.span, block.limit - block.address), amount) && !amount)
+				continue;
+
+			Buffer buffer = { &job, &data[0], block.address, block.address + amount, block.address, block.address + block.size };
+
+			//Groups are only searched around matches of the anchor
+			findGroups(buffer, matches, worker.results);
+		}
+	}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	DWORD WINAPI runWorker(LPVOID parameter)
+#elif defined(SYNTHETIC_ISLINUX)
+	void* runWorker(void* parameter)
+#endif
+	{
+		work(*static_cast<Worker*>(parameter));
+		return 0;
+	}
+}
+
+/**************************************************************************
+***************************************************************************
+********************************* ValueGroup ******************************
+***************************************************************************
+**************************************************************************/
+
+ValueGroup::ValueGroup() : span_(0)
+{ }
+
+void ValueGroup::add(ValueType type, const ValueMatch& match, size_t distance)
+{
+	if(values_.empty())
+	{
+		values_.push_back(GroupValue(type, match, 0));
+		span_ = getValueSize(type);
+		return;
+	}
+
+	const size_t previous = getValueSize(values_.back().type);
+	if(distance < previous)
+		throw invalid_argument("ValueGroup::add() Error : The value would overlap the previous one");
+
+	//The furthest end is the one of the last value starting as far as possible
+	span_ += distance - previous + getValueSize(type);
+	values_.push_back(GroupValue(type, match, distance));
+}
+
+size_t ValueGroup::size() const
+{
+	return values_.size();
+}
+
+const GroupValue& ValueGroup::operator[](size_t index) const
+{
+	return values_[index];
+}
+
+size_t ValueGroup::getSpan() const
+{
+	return span_;
+}
+
+/**************************************************************************
+***************************************************************************
+******************************** GroupScanner *****************************
+***************************************************************************
+**************************************************************************/
+
+GroupScanner::GroupScanner(const Process& proc, size_t alignment) :	proc_(proc),
+																							alignment_(alignment),
+																							residency_(RESIDENCY_ANY),
+																							threadCount_(0)
+{ }
+
+void GroupScanner::setResidency(Residency residency)
+{
+	residency_ = residency;
+}
+
+void GroupScanner::setThreadCount(size_t count)
+{
+	threadCount_ = count;
+}
+
+size_t GroupScanner::findAll(	const ValueGroup& group,
+										const RegionMap& regions,
+										int protection,
+										vector<ptr_t>& dest) const
+{
+	vector<MemoryRange> ranges;
+	regions.getRanges(protection, residency_, ranges);
+
+	return scan_(group, ranges, dest);
+}
+
+size_t GroupScanner::findAll(	const ValueGroup& group,
+										const RegionMap& regions,
+										ptr_t address,
+										size_t size,
+										vector<ptr_t>& dest) const
+{
+	vector<MemoryRange> ranges;
+	regions.getRanges(address, size, PROTECTION_READ, residency_, ranges);
+
+	return scan_(group, ranges, dest);
+}
+
+size_t GroupScanner::scan_(	const ValueGroup& group,
+										const vector<MemoryRange>& ranges,
+										vector<ptr_t>& dest) const
+{
+	if(!group.size())
+		throw invalid_argument("GroupScanner::scan_() Error : The group is empty");
+
+	Job job;
+	job.proc = &proc_;
+	job.span = group.getSpan();
+	job.extent = 0;
+	job.next = 0;
+	for(size_t i = 0; i < group.size(); ++i)
+	{
+		job.matchers.push_back(Matcher(group[i].type, group[i].match));
+		job.sizes.push_back(getValueSize(group[i].type));
+		job.distances.push_back(group[i].distance);
+		job.alignments.push_back(alignment_ ? alignment_ : job.sizes.back());
+		job.extent += job.sizes.back();
+
+		//A value no number of its type matches can't be found
+		if(!job.matchers.back().isMatching())
+			return 0;
+	}
+
+	for(vector<MemoryRange>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+	{
+		const ptr_t limit = i->address + i->size;
+		//Groups packed closer than the span still fit at the end
+		for(ptr_t address = i->address; address + job.extent <= limit; address += BLOCK_SIZE)
+		{
+			Block block = { address, min<size_t>(BLOCK_SIZE, limit - address), limit };
+			job.blocks.push_back(block);
+		}
+	}
+
+	if(job.blocks.empty())
+		return 0;
+
+	job.anchor = chooseAnchor_(group, ranges);
+
+	const size_t threads = min(threadCount_ ? threadCount_ : getProcessorCount(), job.blocks.size());
+	vector<Worker> workers(threads);
+	for(vector<Worker>::iterator i = workers.begin(); i != workers.end(); ++i)
+		i->job = &job;
+
+	//The calling thread works too, threads failing to start just leave
+	//more blocks to the others
+#if defined(SYNTHETIC_ISWINDOWS)
+	vector<HANDLE> handles;
+	for(size_t i = 1; i < threads; ++i)
+	{
+		HANDLE handle = CreateThread(NULL, 0, runWorker, &workers[i], 0, NULL);
+		if(handle)
+			handles.push_back(handle);
+	}
+
+	work(workers[0]);
+
+	for(vector<HANDLE>::iterator i = handles.begin(); i != handles.end(); ++i)
+	{
+		WaitForSingleObject(*i, INFINITE);
+		CloseHandle(*i);
+	}
+#elif defined(SYNTHETIC_ISLINUX)
+	vector<pthread_t> handles;
+	for(size_t i = 1; i < threads; ++i)
+	{
+		pthread_t handle;
+		if(!pthread_create(&handle, NULL, runWorker, &workers[i]))
+			handles.push_back(handle);
+	}
+
+	work(workers[0]);
+
+	for(vector<pthread_t>::iterator i = handles.begin(); i != handles.end(); ++i)
+		pthread_join(*i, NULL);
+#endif
+
+	//Blocks don't share starts, each worker's results only need merging
+	const size_t count = dest.size();
+	for(vector<Worker>::const_iterator i = workers.begin(); i != workers.end(); ++i)
+		dest.insert(dest.end(), i->results.begin(), i->results.end());
+
+	sort(dest.begin() + count, dest.end());
+	return dest.size() - count;
+}
+
+size_t GroupScanner::chooseAnchor_(	const ValueGroup& group,
+												const vector<MemoryRange>& ranges) const
+{
+	vector<Matcher> matchers;
+	for(size_t i = 0; i < group.size(); ++i)
+		matchers.push_back(Matcher(group[i].type, group[i].match));
+
+	vector<size_t> matches(group.size(), 0);
+	vector<byte_t> data(SAMPLE_SIZE / SAMPLE_PIECES);
+
+	const size_t step = max<size_t>(ranges.size() / SAMPLE_PIECES, 1);
+	for(size_t range = 0; range < ranges.size(); range += step)
+	{
+		const MemoryRange& piece = ranges[range];
+
+		size_t amount;
+		if(proc_.tryRead(piece.address, &data[0], min(piece.size, data.size()), amount) && !amount)
+			continue;
+
+		for(size_t i = 0; i < group.size(); ++i)
+		{
+			const size_t size = getValueSize(group[i].type);
+			const size_t alignment = alignment_ ? alignment_ : size;
+
+			const ptr_t first = (piece.address + alignment - 1) / alignment * alignment;
+			const size_t offset = static_cast<size_t>(first - piece.address);
+			if(offset + size > amount)
+				continue;
+
+			const size_t count = (amount - offset - size) / alignment + 1;
+			for(size_t j = 0; j < count; j += WORD_BITS)
+				matches[i] += countBits(matchers[i].run(&data[offset + j * alignment], min(WORD_BITS, count - j), alignment));
+		}
+	}
+
+	return min_element(matches.begin(), matches.end()) - matches.begin();
+}
+
+/******************
+******* EOF *******
+******************/
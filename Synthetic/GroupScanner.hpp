@@ -0,0 +1,226 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_GROUPSCANNER_HPP
+#define SYNTHETIC_PROCESS_GROUPSCANNER_HPP
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "RegionMap.hpp"
+#include "Types.hpp"
+#include "ValueScanner.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A value of a ValueGroup
+	*/
+	struct GroupValue
+	{
+		GroupValue(ValueType type, const ValueMatch& match, size_t distance)
+			: type(type), match(match), distance(distance)
+		{ }
+
+		ValueType type;
+		ValueMatch match;
+
+		//How many bytes after the previous value this one starts at most
+		size_t distance;
+	};
+
+	/**
+	* Values occurring close to each other in a fixed order, like the
+	* members of a structure.\n
+	*/
+	class ValueGroup
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty group.
+		*/
+		ValueGroup();
+
+		/**
+		* Appends a value, it has to start behind the end of the previous
+		* one.
+		* @param type Type of the value.
+		* @param match The values matching.
+		* @param distance (optional) How many bytes after the start of the
+		* previous value this one starts at most. Ignored for the first
+		* value.
+		*/
+		void add(ValueType type, const ValueMatch& match, size_t distance = 0);
+
+		/**
+		* @return size_t Number of values.
+		*/
+		size_t size() const;
+
+		/**
+		* @param index Index of the value.
+		* @return const GroupValue& The value.
+		*/
+		const GroupValue& operator[](size_t index) const;
+
+		/**
+		* @return size_t Bytes from the start of the first value to the end
+		* of the last one at most.
+		*/
+		size_t getSpan() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<GroupValue> values_;
+		size_t span_;
+	};
+
+	/**
+	* Searches where all values of a ValueGroup occur together.\n
+	* A sample of the memory decides which value is the rarest, only that
+	* one is searched with the SSE2 match kernels. The other values are
+	* checked around its matches in the same buffer, so a group costs about
+	* as much as a single value scan.\n
+	* Regions are split into blocks which are scanned by several threads.
+	* Linux builds have to link pthread.\n
+	*/
+	class GroupScanner
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param proc The process to scan. Has to be valid the whole
+		* lifetime.
+		* @param alignment (optional) Alignment of the values' addresses,
+		* 0 for the size of each value.
+		*/
+		GroupScanner(const Process& proc, size_t alignment = 0);
+
+		/**
+		* Sets which pages scans read, RESIDENCY_ANY by default. Groups
+		* running into a skipped page aren't found.
+		* @param residency Which pages to read.
+		*/
+		void setResidency(Residency residency);
+
+		/**
+		* Sets how many threads scan, one per processor by default.
+		* @param count The number of threads, 0 for one per processor.
+		*/
+		void setThreadCount(size_t count);
+
+		/**
+		* Searches all occurrences of a group in the process' memory.
+		* @param group The group, has to have at least one value.
+		* @param regions The regions of the process.
+		* @param protection MemoryProtection flags a region needs to have
+		* all of.
+		* @param dest Reference to a vector the addresses of the first
+		* values are appended to, in ascending order.
+		* @return size_t Number of occurrences.
+		*/
+		size_t findAll(	const ValueGroup& group,
+								const RegionMap& regions,
+								int protection,
+								std::vector<ptr_t>& dest) const;
+
+		/**
+		* Searches all occurrences of a group in a range.
+		* @param group The group, has to have at least one value.
+		* @param regions The regions of the process.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param dest Reference to a vector the addresses of the first
+		* values are appended to, in ascending order.
+		* @return size_t Number of occurrences.
+		*/
+		size_t findAll(	const ValueGroup& group,
+								const RegionMap& regions,
+								ptr_t address,
+								size_t size,
+								std::vector<ptr_t>& dest) const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Scans the ranges with the worker threads
+		*/
+		size_t scan_(	const ValueGroup& group,
+							const std::vector<MemoryRange>& ranges,
+							std::vector<ptr_t>& dest) const;
+
+		/*
+		* Index of the value matching least often in a sample of the ranges
+		*/
+		size_t chooseAnchor_(	const ValueGroup& group,
+										const std::vector<MemoryRange>& ranges) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		size_t alignment_;
+		Residency residency_;
+		size_t threadCount_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_GROUPSCANNER_HPP
+
+/******************
+******* EOF *******
+******************/
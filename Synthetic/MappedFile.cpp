@@ -0,0 +1,172 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+//Windows header files:
+#include <Windows.h>
+
+//Synthetic header files:
+#include "SmartType.hpp"
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+//Synthetic header files:
+#include "MappedFile.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+MappedFile::MappedFile() : data_(NULL), size_(0)
+{ }
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::isValid() const
+{
+	return data_ != NULL;
+}
+
+const byte_t* MappedFile::getData() const
+{
+	return data_;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size_;
+}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+MappedFile::MappedFile(const wstring& path) : data_(NULL), size_(0)
+{
+	open(path);
+}
+
+bool MappedFile::open(const wstring& path)
+{
+	close();
+
+	SmartHandle file = CreateFileW(	path.c_str(),
+												GENERIC_READ,
+												FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+												NULL,
+												OPEN_EXISTING,
+												FILE_ATTRIBUTE_NORMAL,
+												NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		//Not a handle to close
+		file.get() = NULL;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size) || !size.QuadPart)
+		return false;
+
+	//The view keeps the file mapped after both handles are closed
+	SmartHandle mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mapping)
+		return false;
+
+	data_ = static_cast<const byte_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if(!data_)
+		return false;
+
+	size_ = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data_)
+		UnmapViewOfFile(data_);
+
+	data_ = NULL;
+	size_ = 0;
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+MappedFile::MappedFile(const string& path) : data_(NULL), size_(0)
+{
+	open(path);
+}
+
+bool MappedFile::open(const string& path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return false;
+
+	//The mapping stays valid after the descriptor is closed
+	struct stat info;
+	if(!fstat(fd, &info) && info.st_size > 0)
+	{
+		void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED)
+		{
+			data_ = static_cast<const byte_t*>(data);
+			size_ = info.st_size;
+		}
+	}
+
+	::close(fd);
+	return data_ != NULL;
+}
+
+void MappedFile::close()
+{
+	if(data_)
+		munmap(const_cast<byte_t*>(data_), size_);
+
+	data_ = NULL;
+	size_ = 0;
+}
+
+#endif
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,129 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_MAPPEDFILE_HPP
+#define SYNTHETIC_PROCESS_MAPPEDFILE_HPP
+
+//C++ Header Files:
+#include <string>
+
+//Synthetic Header Files:
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* Read-only view of a whole file.\n
+	* Files which can't be opened or are empty give an invalid view
+	* instead of throwing, callers usually have a fallback for them.\n
+	*/
+	class MappedFile
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an invalid view.
+		*/
+		MappedFile();
+
+		/**
+		* Optional constructor.
+		* Calls open().
+		* @param path Path of the file.
+		*/
+	#if defined(SYNTHETIC_ISWINDOWS)
+		MappedFile(const std::wstring& path);
+	#elif defined(SYNTHETIC_ISLINUX)
+		MappedFile(const std::string& path);
+	#endif
+
+		/**
+		* Destructor.
+		* Calls close().
+		*/
+		~MappedFile();
+
+		/**
+		* Maps a file, a previously mapped file is closed.
+		* @param path Path of the file.
+		* @return bool false if the file couldn't be mapped.
+		*/
+	#if defined(SYNTHETIC_ISWINDOWS)
+		bool open(const std::wstring& path);
+	#elif defined(SYNTHETIC_ISLINUX)
+		bool open(const std::string& path);
+	#endif
+
+		/**
+		* Unmaps the file.
+		*/
+		void close();
+
+		/**
+		* @return bool true if a file is mapped.
+		*/
+		bool isValid() const;
+
+		/**
+		* @return const byte_t* The file's contents or NULL.
+		*/
+		const byte_t* getData() const;
+
+		/**
+		* @return size_t Size of the file.
+		*/
+		size_t getSize() const;
+
+	private:
+
+		/*
+		* Disallow copying
+		*/
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const byte_t* data_;
+		size_t size_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_MAPPEDFILE_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -18,6 +18,21 @@
 	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
 */
 
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <elf.h>
+#include <link.h>
+
+#endif
+
+//C++ Header Files:
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
 //Synthetic Header Files:
 #include "Module.hpp"
 
@@ -30,14 +45,16 @@ using namespace Synthetic;
 ***********************************************************************
 **********************************************************************/
 
+Module::Module()
+{ }
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
 Module::Module(const MODULEENTRY32W& mod)
 {
 	read(mod);
 }
 
-Module::Module()
-{ }
-
 void Module::read(const MODULEENTRY32W& mod)
 {
 	baseAddress_ = reinterpret_cast<ptr_t>(mod.modBaseAddr);
@@ -47,6 +64,8 @@ void Module::read(const MODULEENTRY32W& mod)
 	isManuallyMapped_ = false;
 }
 
+#endif
+
 ptr_t Module::getBaseAddress() const
 {
 	return baseAddress_;
@@ -72,6 +91,128 @@ bool Module::isManuallyMapped() const
 	return isManuallyMapped_;
 }
 
+#if defined(SYNTHETIC_ISWINDOWS)
+
+size_t Module::readSections(const Process& proc)
+{
+	sections_.clear();
+
+	const IMAGE_DOS_HEADER dosHeader = proc.readMemory<IMAGE_DOS_HEADER>(baseAddress_);
+	if(dosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+		throw runtime_error("Module::readSections() Error : No PE image at base address");
+
+	//Only the file header is needed to find the section table
+	IMAGE_NT_HEADERS32 ntHeaders;
+	proc.rawRead(baseAddress_ + dosHeader.e_lfanew, &ntHeaders, sizeof(ntHeaders));
+	if(ntHeaders.Signature != IMAGE_NT_SIGNATURE)
+		throw runtime_error("Module::readSections() Error : Invalid NT headers");
+
+	vector<IMAGE_SECTION_HEADER> headers(ntHeaders.FileHeader.NumberOfSections);
+	if(headers.empty())
+		return 0;
+
+	const ptr_t sectionTable =	baseAddress_ +
+										dosHeader.e_lfanew +
+										sizeof(DWORD) +
+										sizeof(IMAGE_FILE_HEADER) +
+										ntHeaders.FileHeader.SizeOfOptionalHeader;
+	proc.rawRead(sectionTable, &headers[0], headers.size() * sizeof(IMAGE_SECTION_HEADER));
+
+	sections_.reserve(headers.size());
+	for(vector<IMAGE_SECTION_HEADER>::const_iterator i = headers.begin(); i != headers.end(); ++i)
+	{
+		ModuleSection section;
+
+		//Names of exactly 8 characters aren't terminated
+		const char* name = reinterpret_cast<const char*>(i->Name);
+		section.name.assign(name, find(name, name + IMAGE_SIZEOF_SHORT_NAME, '\0'));
+
+		section.address = baseAddress_ + i->VirtualAddress;
+		section.size = i->Misc.VirtualSize ? i->Misc.VirtualSize : i->SizeOfRawData;
+
+		section.protection = PROTECTION_NONE;
+		if(i->Characteristics & IMAGE_SCN_MEM_READ)
+			section.protection |= PROTECTION_READ;
+		if(i->Characteristics & IMAGE_SCN_MEM_WRITE)
+			section.protection |= PROTECTION_WRITE;
+		if(i->Characteristics & IMAGE_SCN_MEM_EXECUTE)
+			section.protection |= PROTECTION_EXECUTE;
+
+		sections_.push_back(section);
+	}
+
+	return sections_.size();
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+size_t Module::readSections(const Process& proc)
+{
+	sections_.clear();
+
+	const ElfW(Ehdr) header = proc.readMemory<ElfW(Ehdr)>(baseAddress_);
+	if(memcmp(header.e_ident, ELFMAG, SELFMAG))
+		throw runtime_error("Module::readSections() Error : No ELF image at base address");
+
+	vector<ElfW(Phdr)> segments(header.e_phnum);
+	if(segments.empty())
+		return 0;
+	proc.rawRead(baseAddress_ + header.e_phoff, &segments[0], segments.size() * sizeof(ElfW(Phdr)));
+
+	//Addresses are relative to the first segment, which maps the headers
+	ptr_t imageBase = 0;
+	bool foundLoad = false;
+	for(vector<ElfW(Phdr)>::const_iterator i = segments.begin(); i != segments.end(); ++i)
+	{
+		if(i->p_type != PT_LOAD)
+			continue;
+
+		if(!foundLoad)
+		{
+			imageBase = i->p_vaddr - i->p_offset;
+			foundLoad = true;
+		}
+
+		ModuleSection section;
+		section.address = baseAddress_ + i->p_vaddr - imageBase;
+		section.size = i->p_memsz;
+
+		section.protection = PROTECTION_NONE;
+		if(i->p_flags & PF_R)
+			section.protection |= PROTECTION_READ;
+		if(i->p_flags & PF_W)
+			section.protection |= PROTECTION_WRITE;
+		if(i->p_flags & PF_X)
+			section.protection |= PROTECTION_EXECUTE;
+
+		section.name += (i->p_flags & PF_R) ? 'r' : '-';
+		section.name += (i->p_flags & PF_W) ? 'w' : '-';
+		section.name += (i->p_flags & PF_X) ? 'x' : '-';
+
+		sections_.push_back(section);
+	}
+
+	return sections_.size();
+}
+
+#endif
+
+const vector<ModuleSection>& Module::sections() const
+{
+	return sections_;
+}
+
+const ModuleSection* Module::findSection(const string& name) const
+{
+	for(vector<ModuleSection>::const_iterator i = sections_.begin(); i != sections_.end(); ++i)
+	{
+		if(i->name == name)
+			return &*i;
+	}
+
+	return NULL;
+}
+
 /******************
 ******* EOF *******
 ******************/
\ No newline at end of file
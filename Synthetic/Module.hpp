@@ -27,21 +27,46 @@
 
 //C++ Header files:
 #include <string>
+#include <vector>
 
 //Synthetic Header files:
+#include "System.hpp"
 #include "SysObjectIterator.hpp"
+#include "Process.hpp"
 #include "Types.hpp"
 
 namespace Synthetic
 {
 	/**
-	* Class representing a Windows thread
+	* A section of a loaded module
+	*/
+	struct ModuleSection
+	{
+		std::string name;
+		ptr_t address;
+		size_t size;
+
+		/**
+		* Combination of MemoryProtection flags
+		*/
+		int protection;
+	};
+
+	/**
+	* Class representing a module loaded in a process\n
+	* On Linux the module's base is the start of its first mapping and
+	* sections are the loadable segments, named by their protection like
+	* r-x. Paths are widened byte by byte, like process names.\n
 	*/
 	class Module
 	{
 		//ModuleManager needs to access private data when module is manually mapped
 		friend class ModuleManager;
 
+		//ModuleTable and ModuleWatcher build modules from the loader's list
+		friend class ModuleTable;
+		friend class ModuleWatcher;
+
 	public:
 
 		typedef ModuleIterator iterator;
@@ -57,6 +82,8 @@ namespace Synthetic
 		*/
 		Module();
 
+	#if defined(SYNTHETIC_ISWINDOWS)
+
 		/**
 		* Optional constructor.
 		* Calls read().
@@ -70,6 +97,8 @@ namespace Synthetic
 		*/
 		void read(const MODULEENTRY32W& mod);
 
+	#endif
+
 		/**
 		* Returns the address the module was loaded.
 		* @return ptr_t The modules loadaddress.
@@ -107,6 +136,29 @@ namespace Synthetic
 		* @return bool true if module was loaded, false otherwise
 		*/
 		bool isLoaded() const;
+
+		/**
+		* Parses the module's section headers or program headers.
+		* ModuleTable and ModuleWatcher do this for every module they find.
+		* @param proc The process the module is loaded in.
+		* @return size_t Number of sections.
+		*/
+		size_t readSections(const Process& proc);
+
+		/**
+		* Returns the sections found by readSections().
+		* @return const std::vector<ModuleSection>& The sections ordered by
+		* address, empty if they weren't read.
+		*/
+		const std::vector<ModuleSection>& sections() const;
+
+		/**
+		* Searches a section by its name.
+		* @param name The section's name like .text.
+		* @return const ModuleSection* The first section of that name or
+		* NULL.
+		*/
+		const ModuleSection* findSection(const std::string& name) const;
 	
 	private:
 
@@ -120,6 +172,7 @@ namespace Synthetic
 		size_t size_;
 		std::wstring moduleName_;
 		std::wstring modulePath_;
+		std::vector<ModuleSection> sections_;
 
 		bool isManuallyMapped_;
 	};
@@ -18,27 +18,90 @@
 	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
 */
 
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <dlfcn.h>
+#endif
+
 //C++ header files:
 #include <string>
 #include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
 
 //Synthetic header Files:
 #include "ModuleManager.hpp"
-#include "Allocator.hpp"
-#include "WinException.hpp"
-#include "ThreadManager.hpp"
-#include "SmartType.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "Allocator.hpp"
+	#include "WinException.hpp"
+	#include "ThreadManager.hpp"
+	#include "RemoteExecutor.hpp"
+	#include "SmartType.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "ModuleWatcher.hpp"
+	#include "RemoteSyscall.hpp"
+#endif
 
 using namespace std;
 using namespace Synthetic;
 
+namespace
+{
+	//Forwarder chains longer than this are treated as cycles
+	const size_t MAX_FORWARDER_DEPTH = 8;
+
+#if defined(SYNTHETIC_ISLINUX)
+	/*
+	* Paths read from the target are widened byte by byte, bytes above
+	* 0x7F turn into negative characters and are narrowed back as they
+	* were. Characters of paths given by the user are encoded as UTF-8.
+	*/
+	string narrowPath(const wstring& path)
+	{
+		string narrow;
+		narrow.reserve(path.length());
+		for(size_t i = 0; i < path.length(); ++i)
+		{
+			const long c = static_cast<long>(path[i]);
+			if(c < 0x80)
+			{
+				narrow += static_cast<char>(c);
+			}
+			else if(c < 0x800)
+			{
+				narrow += static_cast<char>(0xC0 | (c >> 6));
+				narrow += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else if(c < 0x10000)
+			{
+				narrow += static_cast<char>(0xE0 | (c >> 12));
+				narrow += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				narrow += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else
+			{
+				narrow += static_cast<char>(0xF0 | (c >> 18));
+				narrow += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+				narrow += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				narrow += static_cast<char>(0x80 | (c & 0x3F));
+			}
+		}
+
+		return narrow;
+	}
+#endif
+}
+
 /**********************************************************************
 ***********************************************************************
 ************************ PUBLIC MEMBER FUNCTIONS **********************
 ***********************************************************************
 **********************************************************************/
 
-ModuleManager::ModuleManager(Process& proc) : proc_(proc)
+ModuleManager::ModuleManager(Process& proc) : proc_(proc), cache_(NULL)
 { }
 
 const vector<Module>& ModuleManager::getManuallyMappedList() const
@@ -46,24 +109,45 @@ const vector<Module>& ModuleManager::getManuallyMappedList() const
 	return manuallyMappedModules_;
 }
 
-Module ModuleManager::getModuleByName(wstring moduleName) const
+Process& ModuleManager::getProcess() const
 {
-	//Convert given name to lowercase
-	transform(	moduleName.begin(), moduleName.end(),
-					moduleName.begin(), towlower);
+	return proc_;
+}
 
-	//Iterate modulelist
-	for(Module::iterator it(proc_.getId()); it != Module::iterator(); ++it)
-	{
-		wstring curName(it->szModule);
+bool ModuleManager::refreshModules() const
+{
+	return refresh_();
+}
 
-		//Convert  to lowercase
-		transform(	curName.begin(), curName.end(),
-						curName.begin(), towlower);
+const ModuleTable& ModuleManager::getModuleTable() const
+{
+	return table_;
+}
 
-		if(curName == moduleName)
-			return Module(*it);
-	}
+const Module* ModuleManager::findModuleContaining(ptr_t address) const
+{
+	return table_.findContaining(address);
+}
+
+size_t ModuleManager::getAllModules(vector<Module>& dest) const
+{
+	refresh_();
+
+	const vector<Module>& modules = table_.getModules();
+	dest.insert(dest.end(), modules.begin(), modules.end());
+
+	return modules.size();
+}
+
+Module ModuleManager::getModuleByName(wstring moduleName) const
+{
+	//Only a miss is worth asking the target
+	const Module* found = table_.findByName(moduleName);
+	if(!found && refresh_())
+		found = table_.findByName(moduleName);
+
+	if(found)
+		return *found;
 
 	//Return invalid module in case nothing got found
 	Module fail;
@@ -73,22 +157,13 @@ Module ModuleManager::getModuleByName(wstring moduleName) const
 
 Module ModuleManager::getModuleByPath(wstring modulePath) const
 {
-	//Convert given path to lowercase
-	transform(	modulePath.begin(), modulePath.end(),
-					modulePath.begin(), towlower);
-
-	//Iterate modulelist
-	for(Module::iterator it(proc_.getId()); it != Module::iterator(); ++it)
-	{
-		wstring curPath(it->szExePath);
-
-		//Convert  to lowercase
-		transform(	curPath.begin(), curPath.end(),
-						curPath.begin(), towlower);
+	//Only a miss is worth asking the target
+	const Module* found = table_.findByPath(modulePath);
+	if(!found && refresh_())
+		found = table_.findByPath(modulePath);
 
-		if(curPath == modulePath)
-			return Module(*it);
-	}
+	if(found)
+		return *found;
 
 	//Return invalid module in case nothing got found
 	Module fail;
@@ -98,6 +173,7 @@ Module ModuleManager::getModuleByPath(wstring modulePath) const
 
 Module ModuleManager::injectModule(const wstring& dllPath) const
 {
+#if defined(SYNTHETIC_ISWINDOWS)
 	//Write path into targets memory
 	ScopedAllocator allocator(proc_);
 	ptr_t mem = allocator.allocate<wchar_t>(dllPath.length() + 1);
@@ -115,6 +191,58 @@ Module ModuleManager::injectModule(const wstring& dllPath) const
 	}
 
 	return getModuleByPath(dllPath);
+#elif defined(SYNTHETIC_ISLINUX)
+	const ptr_t openAddress = findLoaderExport_("dlopen", "__libc_dlopen_mode");
+	const ptr_t errorAddress = findLoaderExport_("dlerror", NULL);
+	if(!openAddress)
+	{
+		throw runtime_error(	"ModuleManager::injectModule() Error : "\
+									"dlopen() not found in remote process");
+	}
+
+	const string path = narrowPath(dllPath);
+
+	//Everything happens within one stop, the path lives on the stack
+	RemoteSyscall calls(proc_);
+	calls.stop();
+
+	const ptr_t pathAddress = calls.pushData(path.c_str(), path.length() + 1);
+	const ptr_t handle = static_cast<ptr_t>(calls.call(openAddress, pathAddress, RTLD_LAZY));
+
+	string error;
+	if(!handle && errorAddress)
+	{
+		//The message may end close to the end of its mapping, a failing
+		//read mustn't hide the dlopen() failure
+		const ptr_t message = static_cast<ptr_t>(calls.call(errorAddress));
+		char text[0x200];
+		size_t amount = 0;
+		if(message)
+			proc_.tryRead(message, text, sizeof(text) - 1, amount);
+
+		text[amount] = '\0';
+		if(text[0])
+			error = ": " + string(text);
+	}
+
+	calls.resume();
+
+	if(!handle)
+	{
+		throw runtime_error(	"ModuleManager::injectModule() Error : "\
+									"dlopen() in remote process failed" + error);
+	}
+
+	//The handle is the module's link_map entry, no need to walk the list
+	Module mod;
+	if(!ModuleWatcher(proc_).readEntry(handle, mod))
+	{
+		throw runtime_error(	"ModuleManager::injectModule() Error : "\
+									"Loaded module can't be read");
+	}
+
+	return mod;
+#endif
 }
 
 void ModuleManager::ejectModule(Module& mod)
@@ -123,6 +251,7 @@ void ModuleManager::ejectModule(Module& mod)
 	if(!mod.getBaseAddress())
 		return;
 
+#if defined(SYNTHETIC_ISWINDOWS)
 	//Fetch kernel32.dll
 	Module kernel32 = getModuleByName(L"kernel32.dll");
 
@@ -133,6 +262,42 @@ void ModuleManager::ejectModule(Module& mod)
 		throw std::runtime_error(	"Process::eject() Error : "\
 											"FreeLibrary() in remote process failed");
 	}
+#elif defined(SYNTHETIC_ISLINUX)
+	const ptr_t openAddress = findLoaderExport_("dlopen", "__libc_dlopen_mode");
+	const ptr_t closeAddress = findLoaderExport_("dlclose", "__libc_dlclose");
+	if(!openAddress || !closeAddress)
+	{
+		throw runtime_error(	"ModuleManager::ejectModule() Error : "\
+									"dlclose() not found in remote process");
+	}
+
+	const string path = narrowPath(mod.getPath());
+
+	RemoteSyscall calls(proc_);
+	calls.stop();
+
+	//With RTLD_NOLOAD dlopen() only looks up the handle, the reference it
+	//adds is dropped along with the one of the module
+	const ptr_t pathAddress = calls.pushData(path.c_str(), path.length() + 1);
+	const ptr_t handle = static_cast<ptr_t>(calls.call(openAddress, pathAddress, RTLD_LAZY | RTLD_NOLOAD));
+	int ec = -1;
+	if(handle)
+	{
+		calls.call(closeAddress, handle);
+		ec = static_cast<int>(calls.call(closeAddress, handle));
+	}
+
+	calls.resume();
+
+	if(ec)
+	{
+		throw runtime_error(	"ModuleManager::ejectModule() Error : "\
+									"dlclose() in remote process failed");
+	}
+#endif
+
+	//The table must not return the module anymore
+	refresh_();
 
 	//Invalidate module
 	mod.baseAddress_ = 0;
@@ -149,6 +314,7 @@ dword_t ModuleManager::callModuleExport(	const Module& mod,
 	//Fetch export address
 	ptr_t exportAddress = getModuleExportAddress(mod, exportName);
 
+#if defined(SYNTHETIC_ISWINDOWS)
 	//Create a thread
 	ThreadManager threads(proc_);
 	Thread thread = threads.createThread(	exportAddress,
@@ -156,38 +322,226 @@ dword_t ModuleManager::callModuleExport(	const Module& mod,
 														false,
 														INFINITE);
 	return thread.getExitCode();
+#elif defined(SYNTHETIC_ISLINUX)
+	//Called by a stopped thread of the target
+	RemoteSyscall calls(proc_);
+	return static_cast<dword_t>(calls.call(exportAddress, param));
+#endif
 }
 
+#if defined(SYNTHETIC_ISWINDOWS)
+
+qword_t ModuleManager::callModuleExport(	RemoteExecutor& executor,
+														const Module& mod,
+														const string& exportName,
+														ptr_t param) const
+{
+	return executor.call(getModuleExportAddress(mod, exportName), param);
+}
+
+#endif
+
 ptr_t ModuleManager::getModuleExportAddress(	const Module& mod,
 																const string& exportName) const
 {
-	//Load module as data for local read
-	SmartModule module = LoadLibraryExW(	mod.getPath().c_str(),
-														NULL,
-														DONT_RESOLVE_DLL_REFERENCES);
+	ptr_t exportAddress = findExport_(mod, exportName, 0);
+	if(!exportAddress)
+	{
+		throw runtime_error(	"ModuleManager::getModuleExportAddress() Error : "\
+									"Export " + exportName + " not found");
+	}
+
+	return exportAddress;
+}
+
+size_t ModuleManager::resolveExports(	const Module& mod,
+													const vector<string>& exportNames,
+													vector<ptr_t>& dest) const
+{
+	size_t found = 0;
+
+	dest.reserve(dest.size() + exportNames.size());
+	for(vector<string>::const_iterator i = exportNames.begin(); i != exportNames.end(); ++i)
+	{
+		ptr_t exportAddress = findExport_(mod, *i, 0);
+		if(exportAddress)
+			++found;
+
+		dest.push_back(exportAddress);
+	}
+
+	return found;
+}
+
+const ExportTable& ModuleManager::getExportTable(const Module& mod) const
+{
+	unordered_map<ptr_t, ExportTable>::iterator i = exports_.find(mod.getBaseAddress());
+	if(i != exports_.end())
+		return i->second;
+
+	ExportTable& table = exports_[mod.getBaseAddress()];
+	try
+	{
+		//Manually mapped modules and deleted files leave only the image
+	#if defined(SYNTHETIC_ISWINDOWS)
+		if(mod.getPath().empty() || !table.load(mod.getPath()))
+	#elif defined(SYNTHETIC_ISLINUX)
+		if(mod.getPath().empty() || !table.load(narrowPath(mod.getPath())))
+	#endif
+			table.read(proc_, mod.getBaseAddress());
+	}
+	catch(...)
+	{
+		exports_.erase(mod.getBaseAddress());
+		throw;
+	}
+
+	return table;
+}
+
+void ModuleManager::setSymbolCache(SymbolCache* cache)
+{
+	cache_ = cache;
+}
+
+qword_t ModuleManager::getModuleIdentity(const Module& mod) const
+{
+	unordered_map<ptr_t, qword_t>::const_iterator i = identities_.find(mod.getBaseAddress());
+	if(i != identities_.end())
+		return i->second;
+
+	const qword_t identity = SymbolCache::identify(proc_, mod.getBaseAddress());
+	identities_[mod.getBaseAddress()] = identity;
+	return identity;
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+bool ModuleManager::refresh_() const
+{
+	if(!table_.refresh(proc_))
+		return false;
 
-	if(!module)
+	for(unordered_map<ptr_t, ExportTable>::iterator i = exports_.begin(); i != exports_.end();)
 	{
-		throw WinException(	"Module::getExportAddress()",
-									"LoadLibraryExW()",
-									GetLastError());
+		const Module* mod = table_.findContaining(i->first);
+		if(mod && mod->getBaseAddress() == i->first)
+			++i;
+		else
+			i = exports_.erase(i);
 	}
 
-	//Retrieve exported address
-	FARPROC exportAddressTemp = GetProcAddress(module, exportName.c_str());
-	ptr_t exportAddress = reinterpret_cast<ptr_t>(exportAddressTemp);
-	if (!exportAddress)
+	//Another module may be loaded at the same base later
+	for(unordered_map<ptr_t, qword_t>::iterator i = identities_.begin(); i != identities_.end();)
 	{
-		throw WinException(	"Module::getExportAddress()",
-									"GetProcAddress()",
-									GetLastError());
+		const Module* mod = table_.findContaining(i->first);
+		if(mod && mod->getBaseAddress() == i->first)
+			++i;
+		else
+			i = identities_.erase(i);
 	}
 
-	//Calculate offset, add it to the module address and return
-	ptr_t offset = exportAddress - reinterpret_cast<ptr_t>(module.get());
-	return mod.getBaseAddress() + offset;
+	return true;
 }
 
+ptr_t ModuleManager::findExport_(const Module& mod, const string& exportName, size_t depth) const
+{
+	//Images with destroyed headers can't be identified, they just
+	//aren't cached
+	qword_t identity = 0;
+	bool cached = false;
+	if(cache_)
+	{
+		try
+		{
+			identity = getModuleIdentity(mod);
+			cached = true;
+		}
+		catch(const exception&)
+		{ }
+	}
+
+	qword_t rva;
+	if(cached && cache_->lookup(identity, CACHE_EXPORT, exportName, rva))
+		return mod.getBaseAddress() + static_cast<ptr_t>(rva);
+
+	const ExportTable& exports = getExportTable(mod);
+
+	//Forwarded exports depend on other modules and aren't cached
+	const ExportEntry* entry = exports.findByName(exportName);
+	if(entry)
+	{
+		if(cached)
+			cache_->store(identity, CACHE_EXPORT, exportName, entry->rva);
+		return mod.getBaseAddress() + entry->rva;
+	}
+
+	//Forwarders look like NTDLL.RtlAllocateHeap or NTDLL.#12
+	string forwarder;
+	if(!exports.getForwarder(exportName, forwarder) || depth >= MAX_FORWARDER_DEPTH)
+		return 0;
+
+	const size_t dot = forwarder.find_last_of('.');
+	if(dot == string::npos)
+		return 0;
+
+	const wstring moduleName = wstring(forwarder.begin(), forwarder.begin() + dot) + L".dll";
+	const string targetName = forwarder.substr(dot + 1);
+
+	const Module* target = table_.findByName(moduleName);
+	if(!target && refresh_())
+		target = table_.findByName(moduleName);
+	if(!target)
+		return 0;
+
+	if(!targetName.empty() && targetName[0] == '#')
+	{
+		const ExportEntry* byOrdinal = getExportTable(*target).findByOrdinal(
+			static_cast<dword_t>(strtoul(targetName.c_str() + 1, NULL, 10)));
+		return byOrdinal ? target->getBaseAddress() + byOrdinal->rva : 0;
+	}
+
+	return findExport_(*target, targetName, depth + 1);
+}
+
+#if defined(SYNTHETIC_ISLINUX)
+
+ptr_t ModuleManager::findLoaderExport_(const char* name, const char* fallback) const
+{
+	if(!table_.size())
+		refresh_();
+
+	//glibc exports dlopen from libc since 2.34 and from libdl before,
+	//musl from its combined libc and dynamic linker
+	static const wchar_t* const loaders[] = { L"libc.so", L"libdl.so", L"libc.musl", L"ld-musl" };
+
+	const char* const names[] = { name, fallback };
+	for(size_t i = 0; i < sizeof(names) / sizeof(names[0]) && names[i]; ++i)
+	{
+		const vector<Module>& modules = table_.getModules();
+		for(vector<Module>::const_iterator mod = modules.begin(); mod != modules.end(); ++mod)
+		{
+			for(size_t j = 0; j < sizeof(loaders) / sizeof(loaders[0]); ++j)
+			{
+				if(mod->getName().compare(0, wcslen(loaders[j]), loaders[j]))
+					continue;
+
+				const ptr_t address = findExport_(*mod, names[i], 0);
+				if(address)
+					return address;
+			}
+		}
+	}
+
+	return 0;
+}
+
+#endif
+
 /******************
 ******* EOF *******
 ******************/
\ No newline at end of file
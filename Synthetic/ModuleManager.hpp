@@ -28,11 +28,30 @@
 //Synthetic Header Files:
 #include "Process.hpp"
 #include "Module.hpp"
+#include "ModuleTable.hpp"
+#include "ExportTable.hpp"
+#include "SymbolCache.hpp"
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 namespace Synthetic
 {
+	class RemoteExecutor;
+
 	/**
 	* Auxiliary class to offering access to a process' modules.\n
+	* Lookups are served from a ModuleTable which is only refreshed if a
+	* module can't be found, so modules unloaded by the target may be
+	* returned until refreshModules() is called.\n
+	* Exports are parsed once per module from its file, or from the
+	* target's memory if it has none, and cached until the module is
+	* unloaded. With a SymbolCache attached, export addresses are taken
+	* from it before any table is parsed.\n
+	* On Linux modules are injected and ejected by calling the target's own
+	* dlopen() and dlclose() from a thread stopped with ptrace.\n
 	* Becomes invalid as soon as Process reference becomes invalid.n
 	*/
 	class ModuleManager
@@ -66,6 +85,34 @@ namespace Synthetic
 		*/
 		const std::vector<Module>& getManuallyMappedList() const;
 
+		/**
+		* @return Process& The process which modules are managed.
+		*/
+		Process& getProcess() const;
+
+		/**
+		* Brings the cached module table up to date.
+		* @return bool true if modules were loaded or unloaded.
+		*/
+		bool refreshModules() const;
+
+		/**
+		* Gives direct access to the cached module table for repeated
+		* lookups. It isn't refreshed by this call.
+		* @return const ModuleTable& A read-only reference to the table.
+		*/
+		const ModuleTable& getModuleTable() const;
+
+		/**
+		* Searches the module an address belongs to in the cached module
+		* table. Doesn't refresh the table, call refreshModules() after
+		* modules were loaded.
+		* @param address The address.
+		* @return const Module* The module or NULL. Stays valid until the
+		* table is refreshed.
+		*/
+		const Module* findModuleContaining(ptr_t address) const;
+
 		/**
 		* Attempts to return a module by its name.
 		* @param moduleName The modules name.
@@ -84,6 +131,8 @@ namespace Synthetic
 
 		/**
 		* Injects a module into the process.
+		* On Linux the path is passed to dlopen() as is and the module is
+		* read from the returned handle.
 		* @param dllPath The modules path.
 		* @return Module The injected module.
 		*/
@@ -97,6 +146,7 @@ namespace Synthetic
 
 		/**
 		* Calls a loaded modules export.
+		* On Linux it's called by a stopped thread, see RemoteSyscall::call().
 		* @param mod The module which has the export.
 		* @param exportName The name of the export to be called.
 		* @param param A pointer to be passed to the export.
@@ -106,8 +156,25 @@ namespace Synthetic
 											const std::string& exportName,
 											ptr_t param) const;
 
+	#if defined(SYNTHETIC_ISWINDOWS)
+		/**
+		* Calls a loaded modules export on the executor's worker thread
+		* instead of creating a new thread.
+		* @param executor The executor running in this process.
+		* @param mod The module which has the export.
+		* @param exportName The name of the export to be called.
+		* @param param A pointer to be passed to the export.
+		* @return qword_t The exports return value.
+		*/
+		qword_t callModuleExport(	RemoteExecutor& executor,
+											const Module& mod,
+											const std::string& exportName,
+											ptr_t param) const;
+	#endif
+
 		/**
 		* Retrieve an exports address.
+		* Forwarded exports are followed into modules loaded in the target.
 		* @param mod Module which should be queried.
 		* @param exportName Name of the export to search for.
 		* @return ptr_t Address of the found export.
@@ -115,9 +182,71 @@ namespace Synthetic
 		ptr_t getModuleExportAddress(	const Module& mod,
 														const std::string& exportName) const;
 
+		/**
+		* Retrieves the addresses of many exports of a module at once.
+		* @param mod Module which should be queried.
+		* @param exportNames Names of the exports to search for.
+		* @param dest Reference to a vector the addresses are appended to in
+		* the order of exportNames, 0 for exports which weren't found.
+		* @return size_t Number of exports found.
+		*/
+		size_t resolveExports(	const Module& mod,
+										const std::vector<std::string>& exportNames,
+										std::vector<ptr_t>& dest) const;
+
+		/**
+		* Returns the cached export table of a module, parses it on first
+		* use.
+		* @param mod The module.
+		* @return const ExportTable& A read-only reference to the table,
+		* valid until the module is unloaded.
+		*/
+		const ExportTable& getExportTable(const Module& mod) const;
+
+		/**
+		* Attaches a persistent cache consulted before exports are parsed.
+		* Resolved exports are stored into it, writing it is up to the
+		* caller.
+		* @param cache The cache or NULL to detach it. Has to be valid
+		* while it's attached.
+		*/
+		void setSymbolCache(SymbolCache* cache);
+
+		/**
+		* Returns the identity a module has in a SymbolCache, it's computed
+		* once per loaded module.
+		* @param mod The module.
+		* @return qword_t The identity.
+		*/
+		qword_t getModuleIdentity(const Module& mod) const;
 
 	private:
 
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Refreshes the module table and drops export tables of unloaded
+		* modules
+		*/
+		bool refresh_() const;
+
+		/*
+		* Looks up an export following forwarders, 0 if it can't be found
+		*/
+		ptr_t findExport_(const Module& mod, const std::string& exportName, size_t depth) const;
+
+	#if defined(SYNTHETIC_ISLINUX)
+		/*
+		* Finds a function of the dynamic linker's interface, or its
+		* fallback if it's missing. 0 if neither is exported.
+		*/
+		ptr_t findLoaderExport_(const char* name, const char* fallback) const;
+	#endif
+
 		/**********************************************************************
 		***********************************************************************
 		*********************** PRIVATE MEMBER VARIABLES **********************
@@ -126,6 +255,13 @@ namespace Synthetic
 
 		std::vector<Module> manuallyMappedModules_;
 		Process& proc_;
+		mutable ModuleTable table_;
+
+		//Export tables and identities by module base
+		mutable std::unordered_map<ptr_t, ExportTable> exports_;
+		mutable std::unordered_map<ptr_t, qword_t> identities_;
+
+		SymbolCache* cache_;
 	};
 
 }
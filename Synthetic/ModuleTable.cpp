@@ -0,0 +1,336 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <Psapi.h>
+
+	#pragma comment(lib, "Psapi.lib")
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <cwctype>
+
+//Synthetic header files:
+#include "ModuleTable.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Initial size of the module handle buffer
+	const size_t INITIAL_MODULE_COUNT = 256;
+
+	//Long enough for paths with the \\?\ prefix
+	const size_t MAX_MODULE_PATH = 0x8000;
+
+	//Read at once from a module's base, the NT headers follow the DOS
+	//header closely
+	const size_t HEADER_READ_SIZE = 0x400;
+#endif
+
+	/*
+	* Orders module indices by base address
+	*/
+	struct CompareBase
+	{
+		const vector<Module>& modules;
+
+		CompareBase(const vector<Module>& mods) : modules(mods)
+		{ }
+
+		bool operator()(size_t lhs, size_t rhs) const
+		{
+			return modules[lhs].getBaseAddress() < modules[rhs].getBaseAddress();
+		}
+	};
+}
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+wstring ModuleTable::foldCase(const wstring& str)
+{
+	wstring folded(str);
+	for(wstring::iterator i = folded.begin(); i != folded.end(); ++i)
+		*i = towlower(*i);
+
+	return folded;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+ModuleTable::ModuleTable()
+{ }
+
+bool ModuleTable::refresh(const Process& proc)
+{
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Fetch only the bases, that's one walk of the loader's list without
+	//reading any strings
+	if(buffer_.empty())
+		buffer_.resize(INITIAL_MODULE_COUNT);
+
+	DWORD needed;
+	for(;;)
+	{
+		DWORD bufferSize = static_cast<DWORD>(buffer_.size() * sizeof(HMODULE));
+		BOOL ec = EnumProcessModulesEx(	proc.getHandle(),
+														&buffer_[0],
+														bufferSize,
+														&needed,
+														LIST_MODULES_DEFAULT);
+		if(!ec)
+		{
+			throw WinException(	"ModuleTable::refresh()",
+										"EnumProcessModulesEx()",
+										GetLastError());
+		}
+
+		if(needed <= bufferSize)
+			break;
+
+		buffer_.resize(needed / sizeof(HMODULE));
+	}
+
+	const size_t count = needed / sizeof(HMODULE);
+
+	//Another module can be loaded at the base of an unloaded one, the
+	//headers tell them apart
+	stampBuffer_.resize(count);
+	for(size_t i = 0; i < count; ++i)
+		stampBuffer_[i] = readStamp_(proc, buffer_[i]);
+
+	if(	count == handles_.size() &&
+		equal(handles_.begin(), handles_.end(), buffer_.begin()) &&
+		equal(stamps_.begin(), stamps_.end(), stampBuffer_.begin()))
+	{
+		return false;
+	}
+
+	unordered_map<ptr_t, qword_t> previous;
+	for(size_t i = 0; i < handles_.size(); ++i)
+		previous[reinterpret_cast<ptr_t>(handles_[i])] = stamps_[i];
+
+	//Keep what is known already, only new modules are read
+	vector<Module> modules;
+	modules.reserve(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		const ptr_t base = reinterpret_cast<ptr_t>(buffer_[i]);
+		const Module* known = findContaining(base);
+		unordered_map<ptr_t, qword_t>::const_iterator stamp = previous.find(base);
+		if(	known && known->getBaseAddress() == base &&
+			stamp != previous.end() && stamp->second == stampBuffer_[i])
+		{
+			modules.push_back(*known);
+			continue;
+		}
+
+		Module mod;
+		if(readModule_(proc, buffer_[i], mod))
+			modules.push_back(mod);
+	}
+
+	modules_.swap(modules);
+	handles_.assign(buffer_.begin(), buffer_.begin() + count);
+	stamps_.assign(stampBuffer_.begin(), stampBuffer_.end());
+#elif defined(SYNTHETIC_ISLINUX)
+	//The watcher keeps the entries it has seen, only new ones are read
+	if(!watcher_ || &watcher_->getProcess() != &proc)
+		watcher_.reset(new ModuleWatcher(proc));
+
+	vector<ModuleEvent> events;
+	if(!watcher_->poll(events))
+		return false;
+
+	modules_ = watcher_->getModules();
+#endif
+
+	index_();
+	return true;
+}
+
+void ModuleTable::clear()
+{
+	modules_.clear();
+#if defined(SYNTHETIC_ISWINDOWS)
+	handles_.clear();
+	stamps_.clear();
+#elif defined(SYNTHETIC_ISLINUX)
+	watcher_.reset();
+#endif
+	index_();
+}
+
+const Module* ModuleTable::findByName(const wstring& name) const
+{
+	unordered_map<wstring, size_t>::const_iterator found = byName_.find(foldCase(name));
+	return found != byName_.end() ? &modules_[found->second] : NULL;
+}
+
+const Module* ModuleTable::findByPath(const wstring& path) const
+{
+	unordered_map<wstring, size_t>::const_iterator found = byPath_.find(foldCase(path));
+	return found != byPath_.end() ? &modules_[found->second] : NULL;
+}
+
+const Module* ModuleTable::findContaining(ptr_t address) const
+{
+	if(bases_.empty())
+		return NULL;
+
+	//Last module starting at or below the address, the conditional
+	//compiles to a cmov
+	const ptr_t* bases = &bases_[0];
+	size_t first = 0;
+	size_t count = bases_.size();
+	while(count > 1)
+	{
+		size_t half = count / 2;
+		first = (bases[first + half] <= address) ? first + half : first;
+		count -= half;
+	}
+
+	if(address < bases[first] || address >= ends_[first])
+		return NULL;
+
+	return &modules_[byBase_[first]];
+}
+
+const vector<Module>& ModuleTable::getModules() const
+{
+	return modules_;
+}
+
+size_t ModuleTable::size() const
+{
+	return modules_.size();
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+bool ModuleTable::readModule_(const Process& proc, HMODULE handle, Module& dest) const
+{
+	MODULEINFO info;
+	if(!GetModuleInformation(proc.getHandle(), handle, &info, sizeof(info)))
+		return false;
+
+	vector<wchar_t> path(MAX_MODULE_PATH);
+	DWORD length = GetModuleFileNameExW(	proc.getHandle(),
+														handle,
+														&path[0],
+														static_cast<DWORD>(path.size()));
+	if(!length)
+		return false;
+
+	dest.baseAddress_ = reinterpret_cast<ptr_t>(info.lpBaseOfDll);
+	dest.size_ = info.SizeOfImage;
+	dest.modulePath_.assign(&path[0], length);
+	dest.isManuallyMapped_ = false;
+
+	//The name is the last part of the path, no need to ask the target
+	size_t separator = dest.modulePath_.find_last_of(L"\\/");
+	dest.moduleName_ = separator == wstring::npos ?	dest.modulePath_ :
+																	dest.modulePath_.substr(separator + 1);
+
+	//Images with destroyed headers are still listed, just without sections
+	try
+	{
+		dest.readSections(proc);
+	}
+	catch(const exception&)
+	{ }
+
+	return true;
+}
+
+qword_t ModuleTable::readStamp_(const Process& proc, HMODULE handle) const
+{
+	byte_t header[HEADER_READ_SIZE];
+	size_t amount = 0;
+	proc.tryRead(reinterpret_cast<ptr_t>(handle), header, sizeof(header), amount);
+	if(amount < sizeof(IMAGE_DOS_HEADER))
+		return 0;
+
+	//Timestamp and image size are at the same offsets for 32 and 64 bit
+	//images
+	const dword_t ntOffset = reinterpret_cast<const IMAGE_DOS_HEADER*>(header)->e_lfanew;
+	if(ntOffset > amount || amount - ntOffset < sizeof(IMAGE_NT_HEADERS32))
+		return 0;
+
+	const IMAGE_NT_HEADERS32* nt = reinterpret_cast<const IMAGE_NT_HEADERS32*>(header + ntOffset);
+	return (static_cast<qword_t>(nt->FileHeader.TimeDateStamp) << 32) | nt->OptionalHeader.SizeOfImage;
+}
+
+#endif
+
+void ModuleTable::index_()
+{
+	byName_.clear();
+	byPath_.clear();
+	byBase_.clear();
+	bases_.clear();
+	ends_.clear();
+
+	//insert() keeps existing keys, so the first loaded module wins
+	for(size_t i = 0; i < modules_.size(); ++i)
+	{
+		byName_.insert(make_pair(foldCase(modules_[i].getName()), i));
+		byPath_.insert(make_pair(foldCase(modules_[i].getPath()), i));
+		byBase_.push_back(i);
+	}
+
+	sort(byBase_.begin(), byBase_.end(), CompareBase(modules_));
+
+	bases_.reserve(byBase_.size());
+	ends_.reserve(byBase_.size());
+	for(vector<size_t>::iterator i = byBase_.begin(); i != byBase_.end(); ++i)
+	{
+		bases_.push_back(modules_[*i].getBaseAddress());
+		ends_.push_back(modules_[*i].getBaseAddress() + modules_[*i].getSize());
+	}
+}
+
+/******************
+******* EOF *******
+******************/
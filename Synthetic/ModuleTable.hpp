@@ -0,0 +1,201 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_MODULETABLE_HPP
+#define SYNTHETIC_PROCESS_MODULETABLE_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows Header Files:
+	#include <Windows.h>
+#endif
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Module.hpp"
+#include "Types.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	#include "ModuleWatcher.hpp"
+#endif
+
+namespace Synthetic
+{
+	/**
+	* Cached list of a process' modules.\n
+	* Names and paths are indexed case-insensitively, so lookups don't
+	* depend on the number of modules. refresh() only fetches the modules'
+	* base addresses and the timestamp and size from their headers, name,
+	* path, size and sections are only read for modules which weren't known
+	* before.\n
+	* If more modules share a name, lookups return the first loaded one.\n
+	* On Linux the dynamic linker's list is walked by a ModuleWatcher.\n
+	*/
+	class ModuleTable
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Converts a name or path to the form used as key.
+		* @param str The string.
+		* @return std::wstring The lowercase string.
+		*/
+		static std::wstring foldCase(const std::wstring& str);
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty table.
+		*/
+		ModuleTable();
+
+		/**
+		* Brings the table up to date.
+		* @param proc The process the modules belong to.
+		* @return bool true if the set of modules changed.
+		*/
+		bool refresh(const Process& proc);
+
+		/**
+		* Removes all modules, the next refresh reads everything again.
+		*/
+		void clear();
+
+		/**
+		* Searches a module by its name.
+		* @param name Case-insensitive module name.
+		* @return const Module* The module or NULL if it isn't in the table.
+		*/
+		const Module* findByName(const std::wstring& name) const;
+
+		/**
+		* Searches a module by its path.
+		* @param path Case-insensitive module path.
+		* @return const Module* The module or NULL if it isn't in the table.
+		*/
+		const Module* findByPath(const std::wstring& path) const;
+
+		/**
+		* Searches the module an address belongs to.
+		* Doesn't branch on the data, so it stays fast for random addresses.
+		* @param address The address.
+		* @return const Module* The module or NULL if the address is outside
+		* of all modules.
+		*/
+		const Module* findContaining(ptr_t address) const;
+
+		/**
+		* @return const std::vector<Module>& All modules in load order.
+		*/
+		const std::vector<Module>& getModules() const;
+
+		/**
+		* @return size_t Number of modules.
+		*/
+		size_t size() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+		/*
+		* Reads name, path and size of a module, false if it was unloaded
+		* meanwhile
+		*/
+		bool readModule_(const Process& proc, HMODULE handle, Module& dest) const;
+
+		/*
+		* Reads timestamp and image size from a module's headers, they tell
+		* modules loaded at the same base apart. Zero if unreadable
+		*/
+		qword_t readStamp_(const Process& proc, HMODULE handle) const;
+	#endif
+
+		/*
+		* Rebuilds the indices after modules_ changed
+		*/
+		void index_();
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Modules in load order and their bases as last returned by the loader
+		std::vector<Module> modules_;
+	#if defined(SYNTHETIC_ISWINDOWS)
+		std::vector<HMODULE> handles_;
+		std::vector<qword_t> stamps_;
+	#endif
+
+		//Indices into modules_
+		std::unordered_map<std::wstring, size_t> byName_;
+		std::unordered_map<std::wstring, size_t> byPath_;
+
+		//Module ranges sorted by base, kept apart so the search only
+		//touches the bases
+		std::vector<ptr_t> bases_;
+		std::vector<ptr_t> ends_;
+		std::vector<size_t> byBase_;
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+		std::vector<HMODULE> buffer_;
+		std::vector<qword_t> stampBuffer_;
+	#elif defined(SYNTHETIC_ISLINUX)
+		//Shared by copies, they're refreshed for the same process
+		std::shared_ptr<ModuleWatcher> watcher_;
+	#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_MODULETABLE_HPP
+
+/******************
+******* EOF *******
+******************/
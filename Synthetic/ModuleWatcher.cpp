@@ -0,0 +1,552 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+//Windows header files:
+#include <Windows.h>
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <elf.h>
+#include <link.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+#endif
+
+//C++ header files:
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+//Synthetic header files:
+#include "ModuleWatcher.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Longer loader lists are treated as corrupted or cyclic
+	const size_t MAX_MODULES = 0x4000;
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	//Offsets into PEB, PEB_LDR_DATA and LDR_DATA_TABLE_ENTRY in pointers
+	//or bytes, for the architecture Synthetic is compiled for
+	#if defined(SYNTHETIC_ISX64)
+		const size_t PEB_LDR_OFFSET = 0x18;
+		const size_t LDR_LOAD_ORDER_OFFSET = 0x10;
+	#else
+		const size_t PEB_LDR_OFFSET = 0x0C;
+		const size_t LDR_LOAD_ORDER_OFFSET = 0x0C;
+	#endif
+
+	const size_t ENTRY_DLL_BASE = 6;
+	const size_t ENTRY_SIZE_OF_IMAGE = 8;
+	const size_t ENTRY_FULL_DLL_NAME = 9;
+	const size_t ENTRY_FIELDS = 11;
+
+	/*
+	* Layout of ProcessBasicInformation
+	*/
+	struct BasicInformation
+	{
+		LONG_PTR exitStatus;
+		PVOID pebBaseAddress;
+		ULONG_PTR affinityMask;
+		LONG_PTR basePriority;
+		ULONG_PTR uniqueProcessId;
+		ULONG_PTR inheritedFromUniqueProcessId;
+	};
+
+	typedef LONG (__stdcall *NtQueryInformationProcess_t)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	const size_t PAGE_MASK = 0xFFF;
+
+	/*
+	* Reads a whole file from /proc, which reports no size
+	*/
+	bool readProcFile(const string& path, string& dest)
+	{
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd == -1)
+			return false;
+
+		char buffer[0x1000];
+		ssize_t length;
+		while((length = read(fd, buffer, sizeof(buffer))) > 0)
+			dest.append(buffer, length);
+
+		close(fd);
+		return true;
+	}
+
+	/*
+	* Returns /proc/<pid>/<entry>
+	*/
+	string procPath(pid_t pid, const char* entry)
+	{
+		ostringstream path;
+		path << "/proc/" << pid << '/' << entry;
+		return path.str();
+	}
+
+	/*
+	* Reads an entry of the process' auxiliary vector, 0 if it's missing
+	*/
+	ptr_t readAuxiliaryValue(pid_t pid, ptr_t type)
+	{
+		string auxv;
+		if(!readProcFile(procPath(pid, "auxv"), auxv))
+			return 0;
+
+		const ElfW(auxv_t)* entries = reinterpret_cast<const ElfW(auxv_t)*>(auxv.data());
+		const size_t count = auxv.size() / sizeof(ElfW(auxv_t));
+		for(size_t i = 0; i < count && entries[i].a_type != AT_NULL; ++i)
+		{
+			if(entries[i].a_type == type)
+				return entries[i].a_un.a_val;
+		}
+
+		return 0;
+	}
+
+	/*
+	* Reads a zero terminated string from the target
+	*/
+	string readString(const Process& proc, ptr_t address)
+	{
+		string result;
+		char buffer[0x100];
+
+		//Reads stop at the end of a mapping, what was read up to there
+		//still counts
+		while(result.size() < 0x1000)
+		{
+			size_t amount = 0;
+			proc.tryRead(address + result.size(), buffer, sizeof(buffer), amount);
+			if(!amount)
+				break;
+
+			const char* end = static_cast<const char*>(memchr(buffer, '\0', amount));
+			if(end)
+				return result.append(buffer, end - buffer);
+
+			result.append(buffer, amount);
+		}
+
+		return result;
+	}
+
+	/*
+	* Fills name and path of a module from a path
+	*/
+	void assignPath(const string& path, wstring& modulePath, wstring& moduleName)
+	{
+		modulePath.assign(path.begin(), path.end());
+
+		size_t separator = modulePath.find_last_of(L'/');
+		moduleName = separator == wstring::npos ? modulePath : modulePath.substr(separator + 1);
+	}
+
+#endif
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+ModuleWatcher::ModuleWatcher(const Process& proc)
+	:	proc_(proc),
+		listHead_(0),
+		usingLoaderList_(true)
+{ }
+
+size_t ModuleWatcher::poll(vector<ModuleEvent>& dest)
+{
+	vector<Entry> entries;
+	vector<Module> current;
+
+	if(walkLoaderList_(entries))
+	{
+		usingLoaderList_ = true;
+
+		//Entries seen before keep their module, names aren't read again
+		unordered_map<ptr_t, size_t> known;
+		for(size_t i = 0; i < entries_.size(); ++i)
+			known[entries_[i].address] = i;
+
+		vector<Entry> currentEntries;
+		current.reserve(entries.size());
+		currentEntries.reserve(entries.size());
+		for(vector<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+		{
+			unordered_map<ptr_t, size_t>::const_iterator found = known.find(i->address);
+			if(found != known.end() && entries_[found->second].base == i->base)
+				current.push_back(modules_[found->second]);
+			else
+			{
+				Module mod;
+				if(!readEntry(i->address, mod))
+					continue;
+				current.push_back(mod);
+			}
+
+			currentEntries.push_back(*i);
+		}
+
+		entries_.swap(currentEntries);
+		return update_(current, dest);
+	}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//The loader isn't initialized yet in processes created suspended
+	return 0;
+#elif defined(SYNTHETIC_ISLINUX)
+	usingLoaderList_ = false;
+	entries_.clear();
+
+	readMaps_(current);
+	return update_(current, dest);
+#endif
+}
+
+const vector<Module>& ModuleWatcher::getModules() const
+{
+	return modules_;
+}
+
+bool ModuleWatcher::isUsingLoaderList() const
+{
+	return usingLoaderList_;
+}
+
+const Process& ModuleWatcher::getProcess() const
+{
+	return proc_;
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+bool ModuleWatcher::walkLoaderList_(vector<Entry>& dest)
+{
+	if(!listHead_)
+	{
+		static NtQueryInformationProcess_t queryInformation =
+			reinterpret_cast<NtQueryInformationProcess_t>(GetProcAddress(	GetModuleHandleW(L"ntdll.dll"),
+																									"NtQueryInformationProcess"));
+		if(!queryInformation)
+		{
+			throw WinException(	"ModuleWatcher::walkLoaderList_()",
+										"GetProcAddress()",
+										GetLastError());
+		}
+
+		BasicInformation information;
+		LONG status = queryInformation(proc_.getHandle(), 0, &information, sizeof(information), NULL);
+		if(status < 0)
+		{
+			throw runtime_error(	"ModuleWatcher::walkLoaderList_() Error : "\
+										"NtQueryInformationProcess() failed");
+		}
+
+		const ptr_t peb = reinterpret_cast<ptr_t>(information.pebBaseAddress);
+		const ptr_t loaderData = proc_.readMemory<ptr_t>(peb + PEB_LDR_OFFSET);
+		if(!loaderData)
+			return false;
+
+		listHead_ = loaderData + LDR_LOAD_ORDER_OFFSET;
+	}
+
+	//One read per entry, the link is its first field
+	ptr_t fields[ENTRY_DLL_BASE + 1];
+	ptr_t link = proc_.readMemory<ptr_t>(listHead_);
+	while(link != listHead_)
+	{
+		if(!link || dest.size() >= MAX_MODULES)
+			throw runtime_error("ModuleWatcher::walkLoaderList_() Error : Corrupted loader list");
+
+		proc_.rawRead(link, fields, sizeof(fields));
+
+		Entry entry;
+		entry.address = link;
+		entry.base = fields[ENTRY_DLL_BASE];
+		dest.push_back(entry);
+
+		link = fields[0];
+	}
+
+	return true;
+}
+
+bool ModuleWatcher::readEntry(ptr_t entry, Module& dest) const
+{
+	ptr_t fields[ENTRY_FIELDS];
+	proc_.rawRead(entry, fields, sizeof(fields));
+
+	//FullDllName is a UNICODE_STRING, length in bytes and buffer
+	const size_t length = static_cast<size_t>(fields[ENTRY_FULL_DLL_NAME] & 0xFFFF) / sizeof(wchar_t);
+	const ptr_t buffer = fields[ENTRY_FULL_DLL_NAME + 1];
+	const ptr_t base = fields[ENTRY_DLL_BASE];
+	if(!base || !length || !buffer)
+		return false;
+
+	vector<wchar_t> path(length);
+	proc_.rawRead(buffer, &path[0], length * sizeof(wchar_t));
+
+	dest.baseAddress_ = base;
+	dest.size_ = static_cast<size_t>(fields[ENTRY_SIZE_OF_IMAGE] & 0xFFFFFFFF);
+	dest.modulePath_.assign(path.begin(), path.end());
+	dest.isManuallyMapped_ = false;
+
+	size_t separator = dest.modulePath_.find_last_of(L"\\/");
+	dest.moduleName_ = separator == wstring::npos ?	dest.modulePath_ :
+																	dest.modulePath_.substr(separator + 1);
+
+	//Images with destroyed headers are still reported, just without sections
+	try
+	{
+		dest.readSections(proc_);
+	}
+	catch(const exception&)
+	{ }
+
+	return true;
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+bool ModuleWatcher::walkLoaderList_(vector<Entry>& dest)
+{
+	if(!listHead_)
+		listHead_ = findDebugStructure_();
+	if(!listHead_)
+		return false;
+
+	const r_debug debug = proc_.readMemory<r_debug>(listHead_);
+	if(!debug.r_version || !debug.r_map)
+		return false;
+
+	//The list is being changed, report the previous state until it's done
+	if(debug.r_state != r_debug::RT_CONSISTENT)
+	{
+		dest = entries_;
+		return true;
+	}
+
+	ptr_t link = reinterpret_cast<ptr_t>(debug.r_map);
+	while(link)
+	{
+		if(dest.size() >= MAX_MODULES)
+			throw runtime_error("ModuleWatcher::walkLoaderList_() Error : Corrupted link_map list");
+
+		const link_map entry = proc_.readMemory<link_map>(link);
+
+		Entry known;
+		known.address = link;
+		known.base = entry.l_addr;
+		dest.push_back(known);
+
+		link = reinterpret_cast<ptr_t>(entry.l_next);
+	}
+
+	return true;
+}
+
+bool ModuleWatcher::readEntry(ptr_t entry, Module& dest) const
+{
+	const link_map map = proc_.readMemory<link_map>(entry);
+	string path = map.l_name ? readString(proc_, reinterpret_cast<ptr_t>(map.l_name)) : string();
+
+	//Shared objects are linked at 0, so the bias is their base. The main
+	//executable has no name and is found through its program headers.
+	ptr_t base = map.l_addr;
+	if(path.empty())
+	{
+		const ptr_t programHeaders = readAuxiliaryValue(proc_.getId(), AT_PHDR);
+		if(!programHeaders)
+			return false;
+
+		base = programHeaders & ~PAGE_MASK;
+
+		char target[0x1000];
+		ssize_t length = readlink(procPath(proc_.getId(), "exe").c_str(), target, sizeof(target));
+		if(length > 0)
+			path.assign(target, length);
+	}
+
+	dest.baseAddress_ = base;
+	dest.size_ = 0;
+	dest.isManuallyMapped_ = false;
+	assignPath(path, dest.modulePath_, dest.moduleName_);
+
+	//Entries without a valid image, like a preloaded but unmapped
+	//object, aren't modules
+	try
+	{
+		if(!dest.readSections(proc_))
+			return false;
+	}
+	catch(const exception&)
+	{
+		return false;
+	}
+
+	const ModuleSection& last = dest.sections_.back();
+	dest.size_ = ((last.address + last.size + PAGE_MASK) & ~PAGE_MASK) - base;
+	return true;
+}
+
+ptr_t ModuleWatcher::findDebugStructure_() const
+{
+	const ptr_t programHeaders = readAuxiliaryValue(proc_.getId(), AT_PHDR);
+	const ptr_t headerCount = readAuxiliaryValue(proc_.getId(), AT_PHNUM);
+	if(!programHeaders || !headerCount)
+		return 0;
+
+	vector<ElfW(Phdr)> segments(headerCount);
+	proc_.rawRead(programHeaders, &segments[0], segments.size() * sizeof(ElfW(Phdr)));
+
+	//PIE executables are relocated, PT_PHDR tells by how much
+	ptr_t bias = 0;
+	const ElfW(Phdr)* dynamicSegment = NULL;
+	for(vector<ElfW(Phdr)>::const_iterator i = segments.begin(); i != segments.end(); ++i)
+	{
+		if(i->p_type == PT_PHDR)
+			bias = programHeaders - i->p_vaddr;
+		else if(i->p_type == PT_DYNAMIC)
+			dynamicSegment = &*i;
+	}
+
+	//Static executables have no dynamic linker
+	if(!dynamicSegment)
+		return 0;
+
+	vector<ElfW(Dyn)> dynamic(dynamicSegment->p_memsz / sizeof(ElfW(Dyn)));
+	if(dynamic.empty())
+		return 0;
+	proc_.rawRead(bias + dynamicSegment->p_vaddr, &dynamic[0], dynamic.size() * sizeof(ElfW(Dyn)));
+
+	//DT_DEBUG is filled by the dynamic linker when it starts
+	for(vector<ElfW(Dyn)>::const_iterator i = dynamic.begin(); i != dynamic.end() && i->d_tag != DT_NULL; ++i)
+	{
+		if(i->d_tag == DT_DEBUG)
+			return i->d_un.d_ptr;
+	}
+
+	return 0;
+}
+
+void ModuleWatcher::readMaps_(vector<Module>& dest) const
+{
+	//Modules seen before keep their sections
+	unordered_map<ptr_t, size_t> known;
+	for(size_t i = 0; i < modules_.size(); ++i)
+		known[modules_[i].getBaseAddress()] = i;
+
+	for(ModuleIterator it(proc_.getId()); it != ModuleIterator(); ++it)
+	{
+		Module mod;
+		mod.baseAddress_ = it->baseAddress;
+		mod.size_ = it->size;
+		mod.isManuallyMapped_ = false;
+		assignPath(it->path, mod.modulePath_, mod.moduleName_);
+
+		unordered_map<ptr_t, size_t>::const_iterator found = known.find(mod.baseAddress_);
+		if(found != known.end() && modules_[found->second].modulePath_ == mod.modulePath_)
+			mod.sections_ = modules_[found->second].sections_;
+		else
+		{
+			//Files mapped as data aren't images
+			try
+			{
+				mod.readSections(proc_);
+			}
+			catch(const exception&)
+			{
+				continue;
+			}
+		}
+
+		dest.push_back(mod);
+	}
+}
+
+#endif
+
+size_t ModuleWatcher::update_(vector<Module>& current, vector<ModuleEvent>& dest)
+{
+	const size_t first = dest.size();
+
+	unordered_map<ptr_t, size_t> byBase;
+	for(size_t i = 0; i < current.size(); ++i)
+		byBase[current[i].getBaseAddress()] = i;
+
+	unordered_map<ptr_t, size_t> previous;
+	for(size_t i = 0; i < modules_.size(); ++i)
+	{
+		previous[modules_[i].getBaseAddress()] = i;
+
+		unordered_map<ptr_t, size_t>::const_iterator found = byBase.find(modules_[i].getBaseAddress());
+		if(found == byBase.end() || current[found->second].getPath() != modules_[i].getPath())
+		{
+			ModuleEvent event;
+			event.type = MODULE_UNLOADED;
+			event.module = modules_[i];
+			dest.push_back(event);
+		}
+	}
+
+	for(vector<Module>::const_iterator i = current.begin(); i != current.end(); ++i)
+	{
+		unordered_map<ptr_t, size_t>::const_iterator found = previous.find(i->getBaseAddress());
+		if(found == previous.end() || modules_[found->second].getPath() != i->getPath())
+		{
+			ModuleEvent event;
+			event.type = MODULE_LOADED;
+			event.module = *i;
+			dest.push_back(event);
+		}
+	}
+
+	modules_.swap(current);
+	return dest.size() - first;
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,184 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_MODULEWATCHER_HPP
+#define SYNTHETIC_PROCESS_MODULEWATCHER_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Module.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* What happened to a module
+	*/
+	enum ModuleEventType
+	{
+		MODULE_LOADED,
+		MODULE_UNLOADED
+	};
+
+	/**
+	* A module which was loaded or unloaded between two polls
+	*/
+	struct ModuleEvent
+	{
+		ModuleEventType type;
+		Module module;
+	};
+
+	/**
+	* Reports modules loaded and unloaded by a process.\n
+	* Each poll walks the loader's own list, reading one entry per module.
+	* Names, paths and sections are only read for modules which weren't
+	* known before. On Windows that's the PEB loader list, on Linux the
+	* dynamic linker's r_debug link_map list. Linux targets without one,
+	* like static executables, fall back to diffing /proc/pid/maps.\n
+	* The first poll reports all modules as loaded. A module replaced by
+	* another one at the same base between two polls is reported as
+	* unloaded and loaded.\n
+	*/
+	class ModuleWatcher
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param proc The process to watch. Has to be valid the whole
+		* lifetime.
+		*/
+		ModuleWatcher(const Process& proc);
+
+		/**
+		* Checks for loaded and unloaded modules.
+		* @param dest Reference to a vector the events are appended to,
+		* unloads first.
+		* @return size_t Number of events.
+		*/
+		size_t poll(std::vector<ModuleEvent>& dest);
+
+		/**
+		* @return const std::vector<Module>& The modules known after the
+		* last poll in load order.
+		*/
+		const std::vector<Module>& getModules() const;
+
+		/**
+		* @return bool true if the loader's list is used, false if the
+		* Linux fallback diffs the memory maps.
+		*/
+		bool isUsingLoaderList() const;
+
+		/**
+		* @return const Process& The watched process.
+		*/
+		const Process& getProcess() const;
+
+		/**
+		* Reads a module from its loader list entry, without walking the
+		* list. On Linux the handle returned by dlopen() is such an entry.
+		* @param entry Address of the LDR_DATA_TABLE_ENTRY or link_map.
+		* @param dest Reference to the module to fill.
+		* @return bool false if the entry doesn't describe a loaded image.
+		*/
+		bool readEntry(ptr_t entry, Module& dest) const;
+
+	private:
+
+		/*
+		* A loader list entry as seen by the last poll
+		*/
+		struct Entry
+		{
+			ptr_t address;
+			ptr_t base;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Walks the loader list, returns false if it isn't available
+		*/
+		bool walkLoaderList_(std::vector<Entry>& dest);
+
+	#if defined(SYNTHETIC_ISLINUX)
+		/*
+		* Finds the dynamic linker's r_debug, 0 if there is none (yet)
+		*/
+		ptr_t findDebugStructure_() const;
+
+		/*
+		* Lists the file backed images in /proc/pid/maps
+		*/
+		void readMaps_(std::vector<Module>& dest) const;
+	#endif
+
+		/*
+		* Replaces the known modules and reports the difference
+		*/
+		size_t update_(std::vector<Module>& current, std::vector<ModuleEvent>& dest);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+
+		//Known modules in load order and their loader list entries
+		std::vector<Module> modules_;
+		std::vector<Entry> entries_;
+
+		//Head of the loader list, 0 if it wasn't found yet
+		ptr_t listHead_;
+		bool usingLoaderList_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_MODULEWATCHER_HPP
+
+/******************
+******* EOF *******
+******************/
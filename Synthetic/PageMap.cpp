@@ -0,0 +1,237 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+
+//C++ header files:
+#include <algorithm>
+
+//Synthetic header files:
+#include "PageMap.hpp"
+#include "PosixException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Entries read at once, 32 KB cover 16 MB of memory
+	const size_t BLOCK_ENTRIES = 0x1000;
+
+	/*
+	* Appends a range, merges it with the last one added by the same call
+	*/
+	void appendRange(vector<MemoryRange>& dest, size_t firstRange, ptr_t begin, ptr_t end)
+	{
+		if(	dest.size() > firstRange &&
+			dest.back().address + dest.back().size == begin)
+		{
+			dest.back().size += static_cast<size_t>(end - begin);
+		}
+		else
+		{
+			MemoryRange range = { begin, static_cast<size_t>(end - begin) };
+			dest.push_back(range);
+		}
+	}
+}
+
+const qword_t PageMap::SOFT_DIRTY;
+const qword_t PageMap::EXCLUSIVE;
+const qword_t PageMap::FILE_SHARED;
+const qword_t PageMap::SWAPPED;
+const qword_t PageMap::PRESENT;
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+PageMap::PageMap(const Process& proc) : pageSize_(sysconf(_SC_PAGESIZE))
+{
+	char path[32];
+	sprintf(path, "/proc/%d/pagemap", static_cast<int>(proc.getId()));
+
+	descriptor_ = open(path, O_RDONLY | O_CLOEXEC);
+	if(descriptor_ == -1)
+		throw PosixException("PageMap::PageMap()", "open()", errno);
+}
+
+PageMap::~PageMap()
+{
+	close(descriptor_);
+}
+
+size_t PageMap::getPageSize() const
+{
+	return pageSize_;
+}
+
+size_t PageMap::read(ptr_t address, size_t count, vector<qword_t>& dest) const
+{
+	dest.resize(count);
+	if(!count)
+		return 0;
+
+	const off_t offset = static_cast<off_t>(address / pageSize_) * sizeof(qword_t);
+	ssize_t length = pread(descriptor_, &dest[0], count * sizeof(qword_t), offset);
+	if(length == -1)
+		throw PosixException("PageMap::read()", "pread()", errno);
+
+	dest.resize(length / sizeof(qword_t));
+	return dest.size();
+}
+
+size_t PageMap::getRanges(	ptr_t address,
+									size_t size,
+									qword_t flags,
+									vector<MemoryRange>& dest) const
+{
+	return collect_(address, size, flags, dest, 0, false, NULL);
+}
+
+size_t PageMap::getResidentRanges(	ptr_t address,
+												size_t size,
+												vector<MemoryRange>& resident,
+												vector<MemoryRange>& deferred,
+												bool untouched) const
+{
+	return collect_(address, size, PRESENT, resident, SWAPPED, untouched, &deferred);
+}
+
+void PageMap::joinDeferred(	vector<MemoryRange>& resident,
+										size_t firstResident,
+										vector<MemoryRange>& deferred)
+{
+	vector<MemoryRange> kept;
+	vector<MemoryRange> joined;
+
+	//Walk both in address order, runs of touching ranges containing a
+	//deferred one are deferred as a whole
+	size_t r = firstResident;
+	size_t d = 0;
+	while(r < resident.size() || d < deferred.size())
+	{
+		const size_t runFirst = kept.size();
+		MemoryRange run = { 0, 0 };
+		bool isDeferred = false;
+
+		for(;;)
+		{
+			const bool fromResident =	r < resident.size() &&
+												(d == deferred.size() || resident[r].address < deferred[d].address);
+			if(!fromResident && d == deferred.size())
+				break;
+
+			const MemoryRange& next = fromResident ? resident[r] : deferred[d];
+			if(run.size && next.address != run.address + run.size)
+				break;
+
+			if(!run.size)
+				run.address = next.address;
+
+			run.size += next.size;
+			if(fromResident)
+			{
+				kept.push_back(next);
+				++r;
+			}
+			else
+			{
+				isDeferred = true;
+				++d;
+			}
+		}
+
+		if(isDeferred)
+		{
+			kept.resize(runFirst);
+			joined.push_back(run);
+		}
+	}
+
+	resident.resize(firstResident);
+	resident.insert(resident.end(), kept.begin(), kept.end());
+	deferred.swap(joined);
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+size_t PageMap::collect_(	ptr_t address,
+									size_t size,
+									qword_t flags,
+									vector<MemoryRange>& dest,
+									qword_t otherFlags,
+									bool otherUntouched,
+									vector<MemoryRange>* other) const
+{
+	if(!size)
+		return 0;
+
+	const ptr_t end = address + size;
+	const ptr_t firstPage = address & ~static_cast<ptr_t>(pageSize_ - 1);
+	const size_t firstRange = dest.size();
+	const size_t firstOther = other ? other->size() : 0;
+
+	size_t found = 0;
+	for(ptr_t block = firstPage; block < end; block += BLOCK_ENTRIES * pageSize_)
+	{
+		const size_t pages = static_cast<size_t>(min<ptr_t>(BLOCK_ENTRIES, (end - block + pageSize_ - 1) / pageSize_));
+		if(!read(block, pages, buffer_))
+			break;
+
+		for(size_t i = 0; i < buffer_.size(); ++i)
+		{
+			const ptr_t begin = max(block + i * pageSize_, address);
+			const ptr_t stop = min(block + (i + 1) * pageSize_, end);
+			if(buffer_[i] & flags)
+			{
+				appendRange(dest, firstRange, begin, stop);
+				found += stop - begin;
+			}
+			else if(other && (otherUntouched || (buffer_[i] & otherFlags)))
+				appendRange(*other, firstOther, begin, stop);
+		}
+
+		if(buffer_.size() < pages)
+			break;
+	}
+
+	return found;
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,197 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_PAGEMAP_HPP
+#define SYNTHETIC_PROCESS_PAGEMAP_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "RegionMap.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* Reads the state of a process' pages from /proc/pid/pagemap.\n
+	* Every page has a 64 bit entry, they are read in large blocks so
+	* checking gigabytes of memory costs a few megabytes of reads. The
+	* physical frame numbers are zero without CAP_SYS_ADMIN, the flags
+	* are always filled.\n
+	*/
+	class PageMap
+	{
+	public:
+
+		//Flags of an entry
+
+		//Written since the soft-dirty bits were cleared
+		static const qword_t SOFT_DIRTY = 1ULL << 55;
+
+		//Mapped by this process only
+		static const qword_t EXCLUSIVE = 1ULL << 56;
+
+		//File mapping or shared anonymous memory
+		static const qword_t FILE_SHARED = 1ULL << 61;
+
+		//In swap
+		static const qword_t SWAPPED = 1ULL << 62;
+
+		//In physical memory
+		static const qword_t PRESENT = 1ULL << 63;
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Opens the pagemap of the process.
+		* @param proc The process. Has to be valid the whole lifetime.
+		*/
+		PageMap(const Process& proc);
+
+		/**
+		* Destructor.
+		*/
+		~PageMap();
+
+		/**
+		* @return size_t Size of a page.
+		*/
+		size_t getPageSize() const;
+
+		/**
+		* Reads the entries of consecutive pages.
+		* @param address Address inside the first page.
+		* @param count Number of pages.
+		* @param dest Reference to a vector receiving the entries.
+		* @return size_t Number of entries read.
+		*/
+		size_t read(ptr_t address, size_t count, std::vector<qword_t>& dest) const;
+
+		/**
+		* Searches the pages of a range which have any of some flags.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param flags The flags, like PRESENT | SWAPPED.
+		* @param dest Reference to a vector the pages are appended to,
+		* merged where they touch and cut to the range.
+		* @return size_t Number of bytes found.
+		*/
+		size_t getRanges(	ptr_t address,
+									size_t size,
+									qword_t flags,
+									std::vector<MemoryRange>& dest) const;
+
+		/**
+		* Splits a range into the pages in physical memory and those whose
+		* reading is deferred in one pass. Pages in swap are deferred,
+		* pages never touched only if desired. Untouched pages of anonymous
+		* memory are zero, those of file mappings hold the file's content.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param resident Reference to a vector the resident pages are
+		* appended to.
+		* @param deferred Reference to a vector the deferred pages are
+		* appended to.
+		* @param untouched (optional) Whether untouched pages are deferred
+		* instead of left out.
+		* @return size_t Number of resident bytes.
+		*/
+		size_t getResidentRanges(	ptr_t address,
+											size_t size,
+											std::vector<MemoryRange>& resident,
+											std::vector<MemoryRange>& deferred,
+											bool untouched = false) const;
+
+		/**
+		* Moves resident ranges touching deferred ones into them, so data
+		* crossing the boundary of both is read in one piece.
+		* @param resident Sorted resident ranges.
+		* @param firstResident Index of the first resident range to join.
+		* @param deferred Sorted deferred ranges.
+		*/
+		static void joinDeferred(	std::vector<MemoryRange>& resident,
+											size_t firstResident,
+											std::vector<MemoryRange>& deferred);
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Not copyable
+		*/
+		PageMap(const PageMap&);
+		PageMap& operator=(const PageMap&);
+
+		/*
+		* Appends pages with any of flags to dest and, if given, pages with
+		* any of otherFlags or, if otherUntouched is set, any other pages to
+		* other
+		*/
+		size_t collect_(	ptr_t address,
+								size_t size,
+								qword_t flags,
+								std::vector<MemoryRange>& dest,
+								qword_t otherFlags,
+								bool otherUntouched,
+								std::vector<MemoryRange>* other) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		int descriptor_;
+		size_t pageSize_;
+
+		//Entries of one block in collect_()
+		mutable std::vector<qword_t> buffer_;
+	};
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+#endif //SYNTHETIC_PROCESS_PAGEMAP_HPP
+
+/******************
+******* EOF *******
+******************/
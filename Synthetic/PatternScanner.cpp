@@ -0,0 +1,742 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "PatternScanner.hpp"
+#include "PageMap.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Bytes read at once, matches may overlap into the next block
+	const size_t BLOCK_SIZE = 0x10000;
+
+	//Digits of the SymbolCache keys
+	const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+	/*
+	* Key of a module scan in a SymbolCache, the bytes and masks in hex
+	* followed by the protection
+	*/
+	string getCacheKey(const Pattern& pattern, int protection)
+	{
+		const vector<byte_t>& bytes = pattern.getBytes();
+		const vector<byte_t>& mask = pattern.getMask();
+
+		string key;
+		key.reserve(pattern.size() * 4 + 8);
+		for(size_t i = 0; i < bytes.size(); ++i)
+		{
+			key += HEX_DIGITS[bytes[i] >> 4];
+			key += HEX_DIGITS[bytes[i] & 0xF];
+		}
+
+		key += ':';
+		for(size_t i = 0; i < mask.size(); ++i)
+		{
+			key += HEX_DIGITS[mask[i] >> 4];
+			key += HEX_DIGITS[mask[i] & 0xF];
+		}
+
+		ostringstream suffix;
+		suffix << ':' << protection;
+		return key + suffix.str();
+	}
+
+	/*
+	* Value of a hex digit or -1
+	*/
+	int hexValue(char c)
+	{
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	//Keys of a PatternSet table
+	const size_t KEYS = 0x10000;
+
+	//Bytes hashed to the keys of the first table
+	const size_t WORD_BYTES = 4;
+
+	/*
+	* How common a byte is in code and data, padding and zeros most of
+	* all, then prefixes and opcodes of frequent x86 instructions
+	*/
+	unsigned int getCommonness(byte_t value)
+	{
+		switch(value)
+		{
+		case 0x00:
+		case 0xFF:
+		case 0xCC:
+			return 3;
+		case 0x48:
+		case 0x4C:
+		case 0x89:
+		case 0x8B:
+		case 0x0F:
+		case 0xE8:
+		case 0x24:
+		case 0x83:
+		case 0x8D:
+		case 0x90:
+		case 0xC3:
+		case 0x01:
+		case 0x44:
+		case 0x85:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	/*
+	* Key of the bytes at a position, four bytes are hashed, two are the
+	* key themselves
+	*/
+	unsigned int getKey(const byte_t* data, size_t width)
+	{
+		if(width == 2)
+			return data[0] | data[1] << 8;
+
+		dword_t word;
+		memcpy(&word, data, sizeof(word));
+		return (word * 2654435761U) >> 16;
+	}
+
+	/*
+	* Fixed bytes of a pattern to look it up by, rare bytes first, then
+	* keys few patterns share. Returns the pattern's size if it has no
+	* width fixed bytes in a row
+	*/
+	size_t chooseAnchor(const Pattern& pattern, size_t width, const vector<unsigned int>& counts)
+	{
+		const vector<byte_t>& bytes = pattern.getBytes();
+		const vector<byte_t>& mask = pattern.getMask();
+
+		size_t anchor = pattern.size();
+		qword_t best = ~0ULL;
+		for(size_t i = 0; i + width <= pattern.size(); ++i)
+		{
+			unsigned int commonness = 0;
+			size_t fixed = 0;
+			while(fixed < width && mask[i + fixed])
+				commonness += getCommonness(bytes[i + fixed++]);
+
+			if(fixed < width)
+				continue;
+
+			const qword_t score = static_cast<qword_t>(commonness) << 32 | counts[getKey(&bytes[i], width)];
+			if(score < best)
+			{
+				best = score;
+				anchor = i;
+			}
+		}
+
+		return anchor;
+	}
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+Pattern::Pattern(const string& pattern)
+{
+	istringstream stream(pattern);
+	string token;
+	while(stream >> token)
+	{
+		if(token == "?" || token == "??")
+		{
+			bytes_.push_back(0);
+			mask_.push_back(0);
+			continue;
+		}
+
+		const int high = token.size() == 2 ? hexValue(token[0]) : -1;
+		const int low = token.size() == 2 ? hexValue(token[1]) : -1;
+		if(high < 0 || low < 0)
+			throw runtime_error("Pattern::Pattern() Error : Invalid byte " + token);
+
+		bytes_.push_back(static_cast<byte_t>(high << 4 | low));
+		mask_.push_back(0xFF);
+	}
+
+	prepare_();
+}
+
+Pattern::Pattern(const char* bytes, const string& mask)
+{
+	bytes_.reserve(mask.size());
+	mask_.reserve(mask.size());
+	for(size_t i = 0; i < mask.size(); ++i)
+	{
+		const bool wildcard = mask[i] == '?';
+		bytes_.push_back(wildcard ? 0 : static_cast<byte_t>(bytes[i]));
+		mask_.push_back(wildcard ? 0 : 0xFF);
+	}
+
+	prepare_();
+}
+
+bool Pattern::matches(const byte_t* data) const
+{
+	for(size_t i = 0; i < bytes_.size(); ++i)
+	{
+		if((data[i] & mask_[i]) != bytes_[i])
+			return false;
+	}
+
+	return true;
+}
+
+size_t Pattern::size() const
+{
+	return bytes_.size();
+}
+
+size_t Pattern::getAnchor() const
+{
+	return anchor_;
+}
+
+const vector<byte_t>& Pattern::getBytes() const
+{
+	return bytes_;
+}
+
+const vector<byte_t>& Pattern::getMask() const
+{
+	return mask_;
+}
+
+PatternSet::Table::Table() :	counts(KEYS, 0),
+										used(KEYS / 64, 0)
+{ }
+
+PatternSet::PatternSet() :	shortest_(0),
+									longest_(0),
+									compiled_(false)
+{ }
+
+size_t PatternSet::add(const Pattern& pattern)
+{
+	const vector<byte_t>& bytes = pattern.getBytes();
+	const vector<byte_t>& mask = pattern.getMask();
+
+	Entry entry;
+	entry.pattern = patterns_.size();
+	entry.size = pattern.size();
+
+	byte_t head[8] = { 0 };
+	byte_t headMask[8] = { 0 };
+	for(size_t i = 0; i < pattern.size() && i < 8; ++i)
+	{
+		head[i] = bytes[i];
+		headMask[i] = mask[i];
+	}
+
+	memcpy(&entry.head, head, sizeof(head));
+	memcpy(&entry.headMask, headMask, sizeof(headMask));
+
+	size_t anchor = chooseAnchor(pattern, WORD_BYTES, words_.counts);
+	const bool hashed = anchor != pattern.size();
+	if(hashed)
+	{
+		entry.offset = anchor;
+		file_(words_, entry, getKey(&bytes[anchor], WORD_BYTES));
+	}
+	else
+	{
+		anchor = chooseAnchor(pattern, 2, pairs_.counts);
+		if(anchor != pattern.size())
+		{
+			entry.offset = anchor;
+			file_(pairs_, entry, getKey(&bytes[anchor], 2));
+		}
+		else
+		{
+			//Patterns without two neighbouring fixed bytes are filed under
+			//every key starting with their anchor byte
+			anchor = pattern.getAnchor();
+			entry.offset = anchor;
+			for(unsigned int next = 0; next < 0x100; ++next)
+				file_(pairs_, entry, bytes[anchor] | next << 8);
+		}
+	}
+
+	shortest_ = patterns_.empty() ? pattern.size() : min(shortest_, pattern.size());
+	longest_ = max(longest_, pattern.size());
+
+	patterns_.push_back(pattern);
+	anchors_.push_back(anchor);
+	hashed_.push_back(hashed);
+	keys_.push_back(hashed ? getKey(&bytes[anchor], WORD_BYTES) : bytes[anchor] | (anchor + 1 < pattern.size() ? bytes[anchor + 1] << 8 : 0));
+	compiled_ = false;
+
+	return entry.pattern;
+}
+
+size_t PatternSet::size() const
+{
+	return patterns_.size();
+}
+
+const Pattern& PatternSet::operator[](size_t index) const
+{
+	return patterns_[index];
+}
+
+PatternScanner::PatternScanner(const Process& proc) :	proc_(proc),
+																			residency_(RESIDENCY_ANY),
+																			cache_(NULL)
+{ }
+
+void PatternScanner::setResidency(Residency residency)
+{
+	residency_ = residency;
+}
+
+void PatternScanner::setSymbolCache(SymbolCache* cache)
+{
+	cache_ = cache;
+}
+
+ptr_t PatternScanner::find(const Pattern& pattern, ptr_t start, size_t size) const
+{
+	vector<ptr_t> found;
+	scan_(pattern, start, size, found, true);
+
+	return found.empty() ? 0 : found.front();
+}
+
+ptr_t PatternScanner::find(const Pattern& pattern, const ModuleSection& section) const
+{
+	return find(pattern, section.address, section.size);
+}
+
+ptr_t PatternScanner::find(const Pattern& pattern, const Module& mod, int protection) const
+{
+	//Images with destroyed headers can't be identified, they just
+	//aren't cached
+	qword_t identity = 0;
+	bool cached = false;
+	if(cache_)
+	{
+		try
+		{
+			identity = SymbolCache::identify(proc_, mod.getBaseAddress());
+			cached = true;
+		}
+		catch(const exception&)
+		{ }
+	}
+
+	const string key = cached ? getCacheKey(pattern, protection) : string();
+
+	//Data patterns may have moved, the hit is checked before it's used
+	qword_t rva;
+	if(cached && cache_->lookup(identity, CACHE_SIGNATURE, key, rva) && rva + pattern.size() <= mod.getSize())
+	{
+		const ptr_t address = mod.getBaseAddress() + static_cast<ptr_t>(rva);
+
+		size_t amount;
+		buffer_.resize(max(buffer_.size(), pattern.size()));
+		if(!proc_.tryRead(address, &buffer_[0], pattern.size(), amount) && pattern.matches(&buffer_[0]))
+			return address;
+	}
+
+	vector<ModuleSection> ranges;
+	getRanges_(mod, protection, ranges);
+
+	vector<ptr_t> found;
+	for(vector<ModuleSection>::const_iterator i = ranges.begin(); i != ranges.end() && found.empty(); ++i)
+		scan_(pattern, i->address, i->size, found, true);
+
+	if(found.empty())
+		return 0;
+
+	if(cached)
+		cache_->store(identity, CACHE_SIGNATURE, key, found.front() - mod.getBaseAddress());
+
+	return found.front();
+}
+
+size_t PatternScanner::findAll(	const Pattern& pattern,
+											ptr_t start,
+											size_t size,
+											vector<ptr_t>& dest) const
+{
+	return scan_(pattern, start, size, dest, false);
+}
+
+size_t PatternScanner::findAll(	const Pattern& pattern,
+											const Module& mod,
+											int protection,
+											vector<ptr_t>& dest) const
+{
+	vector<ModuleSection> ranges;
+	getRanges_(mod, protection, ranges);
+
+	size_t found = 0;
+	for(vector<ModuleSection>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+		found += scan_(pattern, i->address, i->size, dest, false);
+
+	return found;
+}
+
+size_t PatternScanner::findAll(	const PatternSet& set,
+											ptr_t start,
+											size_t size,
+											vector<vector<ptr_t> >& dest) const
+{
+	set.getCosts_(costs_);
+	return scanSet_(set, start, size, dest);
+}
+
+size_t PatternScanner::findAll(	const PatternSet& set,
+											const Module& mod,
+											int protection,
+											vector<vector<ptr_t> >& dest) const
+{
+	vector<ModuleSection> ranges;
+	getRanges_(mod, protection, ranges);
+
+	set.getCosts_(costs_);
+
+	size_t found = 0;
+	for(vector<ModuleSection>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+		found += scanSet_(set, i->address, i->size, dest);
+
+	return found;
+}
+
+const vector<PatternCost>& PatternScanner::getCosts() const
+{
+	return costs_;
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+void Pattern::prepare_()
+{
+	anchor_ = 0;
+	while(anchor_ < mask_.size() && !mask_[anchor_])
+		++anchor_;
+
+	if(anchor_ == mask_.size())
+		throw runtime_error("Pattern::Pattern() Error : Pattern has no fixed byte");
+}
+
+void PatternSet::file_(Table& table, Entry entry, unsigned int key)
+{
+	entry.key = key;
+	table.entries.push_back(entry);
+	++table.counts[key];
+	table.used[key / 64] |= 1ULL << (key % 64);
+}
+
+void PatternSet::compile_() const
+{
+	Table* tables[] = { &words_, &pairs_ };
+	for(size_t i = 0; i < 2; ++i)
+	{
+		Table& table = *tables[i];
+		table.buckets.assign(KEYS + 1, 0);
+		for(size_t key = 0; key < KEYS; ++key)
+			table.buckets[key + 1] = table.buckets[key] + table.counts[key];
+
+		//Counting sort, the counts are known already
+		vector<unsigned int> next(table.buckets.begin(), table.buckets.end() - 1);
+		vector<Entry> sorted(table.entries.size());
+		for(vector<Entry>::const_iterator j = table.entries.begin(); j != table.entries.end(); ++j)
+			sorted[next[j->key]++] = *j;
+
+		table.entries.swap(sorted);
+	}
+
+	compiled_ = true;
+}
+
+void PatternSet::getCosts_(vector<PatternCost>& dest) const
+{
+	dest.resize(patterns_.size());
+	for(size_t i = 0; i < patterns_.size(); ++i)
+	{
+		dest[i].anchor = anchors_[i];
+		dest[i].shared = (hashed_[i] ? words_ : pairs_).counts[keys_[i]];
+		dest[i].candidates = 0;
+		dest[i].matches = 0;
+	}
+}
+
+size_t PatternScanner::scan_(	const Pattern& pattern,
+										ptr_t start,
+										size_t size,
+										vector<ptr_t>& dest,
+										bool firstOnly) const
+{
+	vector<MemoryRange> ranges;
+	getScanRanges_(start, size, ranges);
+
+	size_t found = 0;
+	for(vector<MemoryRange>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+	{
+		found += scanRange_(pattern, i->address, i->size, dest, firstOnly);
+		if(firstOnly && found)
+			break;
+	}
+
+	return found;
+}
+
+size_t PatternScanner::scanRange_(	const Pattern& pattern,
+												ptr_t start,
+												size_t size,
+												vector<ptr_t>& dest,
+												bool firstOnly) const
+{
+	if(size < pattern.size())
+		return 0;
+
+	const size_t overlap = pattern.size() - 1;
+	const size_t anchor = pattern.getAnchor();
+	const byte_t anchorByte = pattern.getBytes()[anchor];
+
+	buffer_.resize(BLOCK_SIZE + overlap);
+
+	size_t found = 0;
+	for(size_t offset = 0; offset + pattern.size() <= size; offset += BLOCK_SIZE)
+	{
+		//Unreadable blocks are skipped, reads stopping early are scanned
+		//as far as they got
+		size_t amount;
+		if(proc_.tryRead(start + offset, &buffer_[0], min<size_t>(BLOCK_SIZE + overlap, size - offset), amount) && !amount)
+			continue;
+
+		if(amount < pattern.size())
+			continue;
+
+		//Only positions where the anchor byte matches are compared
+		const byte_t* data = &buffer_[0];
+		const byte_t* position = data + anchor;
+		const byte_t* end = data + amount - pattern.size() + anchor + 1;
+		while(position < end)
+		{
+			position = static_cast<const byte_t*>(memchr(position, anchorByte, end - position));
+			if(!position)
+				break;
+
+			const byte_t* candidate = position - anchor;
+			if(pattern.matches(candidate))
+			{
+				dest.push_back(start + offset + (candidate - data));
+				++found;
+				if(firstOnly)
+					return found;
+			}
+
+			++position;
+		}
+	}
+
+	return found;
+}
+
+size_t PatternScanner::scanSet_(	const PatternSet& set,
+											ptr_t start,
+											size_t size,
+											vector<vector<ptr_t> >& dest) const
+{
+	if(dest.size() < set.size())
+		dest.resize(set.size());
+
+	if(!set.size())
+		return 0;
+
+	if(!set.compiled_)
+		set.compile_();
+
+	vector<MemoryRange> ranges;
+	getScanRanges_(start, size, ranges);
+
+	//Keys and heads of the last positions reach up to 8 bytes behind the
+	//data, those are zeroed
+	const size_t overlap = set.longest_ - 1;
+	buffer_.resize(BLOCK_SIZE + overlap + 8);
+
+	const qword_t* words = &set.words_.used[0];
+	const qword_t* pairs = set.pairs_.entries.empty() ? NULL : &set.pairs_.used[0];
+
+	size_t found = 0;
+	for(vector<MemoryRange>::const_iterator range = ranges.begin(); range != ranges.end(); ++range)
+	{
+		for(size_t offset = 0; offset + set.shortest_ <= range->size; offset += BLOCK_SIZE)
+		{
+			//Unreadable blocks are skipped, reads stopping early are scanned
+			//as far as they got
+			const ptr_t address = range->address + offset;
+			size_t amount;
+			if(proc_.tryRead(address, &buffer_[0], min<size_t>(BLOCK_SIZE + overlap, range->size - offset), amount) && !amount)
+				continue;
+
+			const byte_t* data = &buffer_[0];
+			memset(&buffer_[amount], 0, 8);
+
+			//Every position is looked up once, matches starting in the
+			//overlap belong to the next block
+			const size_t owned = min(BLOCK_SIZE, amount);
+			for(size_t position = 0; position < amount; ++position)
+			{
+				unsigned int key = getKey(data + position, WORD_BYTES);
+				if(words[key / 64] >> (key % 64) & 1)
+					found += matchBucket_(set, set.words_, key, data, position, owned, amount, address, dest);
+
+				if(!pairs)
+					continue;
+
+				key = getKey(data + position, 2);
+				if(pairs[key / 64] >> (key % 64) & 1)
+					found += matchBucket_(set, set.pairs_, key, data, position, owned, amount, address, dest);
+			}
+		}
+	}
+
+	return found;
+}
+
+size_t PatternScanner::matchBucket_(	const PatternSet& set,
+												const PatternSet::Table& table,
+												unsigned int key,
+												const byte_t* data,
+												size_t position,
+												size_t owned,
+												size_t amount,
+												ptr_t address,
+												vector<vector<ptr_t> >& dest) const
+{
+	size_t found = 0;
+	for(unsigned int i = table.buckets[key]; i < table.buckets[key + 1]; ++i)
+	{
+		const PatternSet::Entry& entry = table.entries[i];
+		if(position < entry.offset)
+			continue;
+
+		const size_t candidate = position - entry.offset;
+		if(candidate >= owned || candidate + entry.size > amount)
+			continue;
+
+		PatternCost& cost = costs_[entry.pattern];
+		++cost.candidates;
+
+		qword_t head;
+		memcpy(&head, data + candidate, sizeof(head));
+		if((head & entry.headMask) != entry.head)
+			continue;
+
+		if(set.patterns_[entry.pattern].matches(data + candidate))
+		{
+			dest[entry.pattern].push_back(address + candidate);
+			++cost.matches;
+			++found;
+		}
+	}
+
+	return found;
+}
+
+void PatternScanner::getScanRanges_(ptr_t start, size_t size, vector<MemoryRange>& dest) const
+{
+#if defined(SYNTHETIC_ISLINUX)
+	if(residency_ != RESIDENCY_ANY)
+	{
+		if(!pageMap_)
+			pageMap_.reset(new PageMap(proc_));
+
+		//Ranges may cover several regions, untouched pages are only known
+		//to be zero in anonymous ones, so they are all deferred
+		const size_t firstRange = dest.size();
+		vector<MemoryRange> deferred;
+		pageMap_->getResidentRanges(start, size, dest, deferred, residency_ == RESIDENCY_DEFERRED);
+		if(residency_ == RESIDENCY_DEFERRED)
+		{
+			PageMap::joinDeferred(dest, firstRange, deferred);
+			dest.insert(dest.end(), deferred.begin(), deferred.end());
+		}
+
+		return;
+	}
+#endif
+
+	MemoryRange range = { start, size };
+	dest.push_back(range);
+}
+
+void PatternScanner::getRanges_(	const Module& mod,
+											int protection,
+											vector<ModuleSection>& dest) const
+{
+	if(protection == PROTECTION_NONE)
+	{
+		ModuleSection image;
+		image.address = mod.getBaseAddress();
+		image.size = mod.getSize();
+		image.protection = PROTECTION_NONE;
+		dest.push_back(image);
+		return;
+	}
+
+	if(mod.sections().empty())
+		throw runtime_error("PatternScanner::getRanges_() Error : Sections of the module weren't read");
+
+	const vector<ModuleSection>& sections = mod.sections();
+	for(vector<ModuleSection>::const_iterator i = sections.begin(); i != sections.end(); ++i)
+	{
+		if((i->protection & protection) == protection)
+			dest.push_back(*i);
+	}
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,488 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_PATTERNSCANNER_HPP
+#define SYNTHETIC_PROCESS_PATTERNSCANNER_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <memory>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Module.hpp"
+#include "RegionMap.hpp"
+#include "SymbolCache.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A byte pattern with wildcards
+	*/
+	class Pattern
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructor.
+		* Parses a pattern like "48 8B 05 ?? ?? ?? ?? C3", single ? are
+		* wildcards too.
+		* @param pattern The pattern.
+		*/
+		Pattern(const std::string& pattern);
+
+		/**
+		* Constructor.
+		* Takes a pattern in code style.
+		* @param bytes The bytes, wildcards may have any value.
+		* @param mask One character per byte, ? for wildcards and x for
+		* bytes which have to match.
+		*/
+		Pattern(const char* bytes, const std::string& mask);
+
+		/**
+		* Checks the pattern against memory.
+		* @param data Pointer to at least size() bytes.
+		* @return bool true if all non-wildcard bytes match.
+		*/
+		bool matches(const byte_t* data) const;
+
+		/**
+		* @return size_t Length of the pattern in bytes.
+		*/
+		size_t size() const;
+
+		/**
+		* @return size_t Index of the first byte which isn't a wildcard,
+		* scans search for it first.
+		*/
+		size_t getAnchor() const;
+
+		/**
+		* @return const std::vector<byte_t>& The bytes, wildcards are 0.
+		*/
+		const std::vector<byte_t>& getBytes() const;
+
+		/**
+		* @return const std::vector<byte_t>& 0xFF for bytes which have to
+		* match, 0 for wildcards.
+		*/
+		const std::vector<byte_t>& getMask() const;
+
+	private:
+
+		/*
+		* Finds the anchor and validates the pattern
+		*/
+		void prepare_();
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<byte_t> bytes_;
+		std::vector<byte_t> mask_;
+		size_t anchor_;
+	};
+
+	/**
+	* What a pattern of a PatternSet cost the last scan
+	*/
+	struct PatternCost
+	{
+		//Offset of the bytes the pattern is looked up by
+		size_t anchor;
+
+		//Patterns looked up by the same key, including this one
+		size_t shared;
+
+		//Positions the pattern was compared at
+		qword_t candidates;
+
+		qword_t matches;
+	};
+
+	/**
+	* Patterns searched together, like the signatures of a target.\n
+	* Every pattern is filed under a hash of four neighbouring fixed bytes,
+	* chosen to avoid bytes which are common in code and keys other
+	* patterns already use. Patterns without four of them are filed under
+	* two bytes. Scans look up every position once and only compare the
+	* patterns filed under its key.\n
+	*/
+	class PatternSet
+	{
+		friend class PatternScanner;
+
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty set.
+		*/
+		PatternSet();
+
+		/**
+		* Adds a pattern.
+		* @param pattern The pattern.
+		* @return size_t Index of the pattern.
+		*/
+		size_t add(const Pattern& pattern);
+
+		/**
+		* @return size_t Number of patterns.
+		*/
+		size_t size() const;
+
+		/**
+		* @param index Index of the pattern.
+		* @return const Pattern& The pattern.
+		*/
+		const Pattern& operator[](size_t index) const;
+
+	private:
+
+		/*
+		* A pattern filed under a key, found at offset
+		*/
+		struct Entry
+		{
+			unsigned int key;
+			size_t pattern;
+			size_t offset;
+			size_t size;
+
+			//The first 8 bytes of the pattern, to drop most candidates
+			//without comparing the pattern
+			qword_t head;
+			qword_t headMask;
+		};
+
+		/*
+		* Entries by key
+		*/
+		struct Table
+		{
+			Table();
+
+			std::vector<Entry> entries;
+
+			//Entries per key, entries of key k start at buckets[k] once
+			//compiled
+			std::vector<unsigned int> counts;
+			std::vector<unsigned int> buckets;
+
+			//One bit per key with entries
+			std::vector<qword_t> used;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Files an entry under a key
+		*/
+		void file_(Table& table, Entry entry, unsigned int key);
+
+		/*
+		* Sorts the entries of both tables into buckets by key
+		*/
+		void compile_() const;
+
+		/*
+		* Costs of all patterns before a scan
+		*/
+		void getCosts_(std::vector<PatternCost>& dest) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<Pattern> patterns_;
+		std::vector<size_t> anchors_;
+
+		//Keyed by a hash of four bytes and by two bytes
+		mutable Table words_;
+		mutable Table pairs_;
+
+		//Whether each pattern is keyed by four bytes, and its key
+		std::vector<bool> hashed_;
+		std::vector<unsigned int> keys_;
+
+		size_t shortest_;
+		size_t longest_;
+		mutable bool compiled_;
+	};
+
+	/**
+	* Searches byte patterns in a process' memory.\n
+	* Memory is read in large blocks and searched locally. Blocks which
+	* can't be read are skipped.\n
+	* Module scans can be restricted to sections by protection, so code
+	* patterns don't get matched in resources and data.\n
+	* A PatternSet is searched in one pass over the memory, whatever the
+	* number of patterns.\n
+	* With a SymbolCache attached, first matches in modules are cached by
+	* the module's identity.\n
+	*/
+	class PatternScanner
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param proc The process to scan. Has to be valid the whole
+		* lifetime.
+		*/
+		PatternScanner(const Process& proc);
+
+		/**
+		* Sets which pages scans read, RESIDENCY_ANY by default. Skipping
+		* pages which aren't resident keeps scans from growing the process'
+		* memory usage. Matches running into a skipped page aren't found.
+		* @param residency Which pages to read. With RESIDENCY_DEFERRED
+		* find() prefers matches in resident memory.
+		*/
+		void setResidency(Residency residency);
+
+		/**
+		* Attaches a persistent cache consulted by find() for modules. A
+		* cached match is used as long as the pattern still matches there,
+		* new matches are stored into it, writing it is up to the caller.
+		* @param cache The cache or NULL to detach it. Has to be valid
+		* while it's attached.
+		*/
+		void setSymbolCache(SymbolCache* cache);
+
+		/**
+		* Searches the first match in a range.
+		* @param pattern The pattern.
+		* @param start Start of the range.
+		* @param size Size of the range.
+		* @return ptr_t Address of the match or 0.
+		*/
+		ptr_t find(const Pattern& pattern, ptr_t start, size_t size) const;
+
+		/**
+		* Searches the first match in a section.
+		* @param pattern The pattern.
+		* @param section The section.
+		* @return ptr_t Address of the match or 0.
+		*/
+		ptr_t find(const Pattern& pattern, const ModuleSection& section) const;
+
+		/**
+		* Searches the first match in a module's sections.
+		* @param pattern The pattern.
+		* @param mod The module, its sections have to be read.
+		* @param protection MemoryProtection flags a section needs to have
+		* all of, PROTECTION_NONE scans the whole image.
+		* @return ptr_t Address of the match or 0.
+		*/
+		ptr_t find(const Pattern& pattern, const Module& mod, int protection) const;
+
+		/**
+		* Searches all matches in a range.
+		* @param pattern The pattern.
+		* @param start Start of the range.
+		* @param size Size of the range.
+		* @param dest Reference to a vector the addresses are appended to.
+		* @return size_t Number of matches.
+		*/
+		size_t findAll(	const Pattern& pattern,
+								ptr_t start,
+								size_t size,
+								std::vector<ptr_t>& dest) const;
+
+		/**
+		* Searches all matches in a module's sections.
+		* @param pattern The pattern.
+		* @param mod The module, its sections have to be read.
+		* @param protection MemoryProtection flags a section needs to have
+		* all of, PROTECTION_NONE scans the whole image.
+		* @param dest Reference to a vector the addresses are appended to.
+		* @return size_t Number of matches.
+		*/
+		size_t findAll(	const Pattern& pattern,
+								const Module& mod,
+								int protection,
+								std::vector<ptr_t>& dest) const;
+
+		/**
+		* Searches all matches of a set of patterns in a range, reading it
+		* once.
+		* @param set The patterns.
+		* @param start Start of the range.
+		* @param size Size of the range.
+		* @param dest Reference to a vector receiving a vector of addresses
+		* per pattern, in the order of the set.
+		* @return size_t Number of matches of all patterns.
+		*/
+		size_t findAll(	const PatternSet& set,
+								ptr_t start,
+								size_t size,
+								std::vector<std::vector<ptr_t> >& dest) const;
+
+		/**
+		* Searches all matches of a set of patterns in a module's sections,
+		* reading them once.
+		* @param set The patterns.
+		* @param mod The module, its sections have to be read.
+		* @param protection MemoryProtection flags a section needs to have
+		* all of, PROTECTION_NONE scans the whole image.
+		* @param dest Reference to a vector receiving a vector of addresses
+		* per pattern, in the order of the set.
+		* @return size_t Number of matches of all patterns.
+		*/
+		size_t findAll(	const PatternSet& set,
+								const Module& mod,
+								int protection,
+								std::vector<std::vector<ptr_t> >& dest) const;
+
+		/**
+		* Reports what each pattern of a set cost the last set scan. Patterns
+		* with many candidates and few matches are worth making longer or
+		* more specific.
+		* @return const std::vector<PatternCost>& A cost per pattern, in the
+		* order of the set.
+		*/
+		const std::vector<PatternCost>& getCosts() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Scans the pages of a range the residency asks for
+		*/
+		size_t scan_(	const Pattern& pattern,
+							ptr_t start,
+							size_t size,
+							std::vector<ptr_t>& dest,
+							bool firstOnly) const;
+
+		/*
+		* Scans a range, appends matches to dest
+		*/
+		size_t scanRange_(	const Pattern& pattern,
+							ptr_t start,
+							size_t size,
+							std::vector<ptr_t>& dest,
+							bool firstOnly) const;
+
+		/*
+		* Scans the pages of a range the residency asks for with all
+		* patterns of a set
+		*/
+		size_t scanSet_(	const PatternSet& set,
+								ptr_t start,
+								size_t size,
+								std::vector<std::vector<ptr_t> >& dest) const;
+
+		/*
+		* Compares the patterns filed under a key at a position
+		*/
+		size_t matchBucket_(	const PatternSet& set,
+									const PatternSet::Table& table,
+									unsigned int key,
+									const byte_t* data,
+									size_t position,
+									size_t owned,
+									size_t amount,
+									ptr_t address,
+									std::vector<std::vector<ptr_t> >& dest) const;
+
+		/*
+		* Splits a range into the pages the residency asks for
+		*/
+		void getScanRanges_(ptr_t start, size_t size, std::vector<MemoryRange>& dest) const;
+
+		/*
+		* Collects the ranges of a module to scan
+		*/
+		void getRanges_(	const Module& mod,
+								int protection,
+								std::vector<ModuleSection>& dest) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+
+		//Reused read buffer
+		mutable std::vector<byte_t> buffer_;
+
+		//Costs of the last set scan
+		mutable std::vector<PatternCost> costs_;
+
+		Residency residency_;
+		SymbolCache* cache_;
+
+	#if defined(SYNTHETIC_ISLINUX)
+		//Opened by the first scan which cares about residency
+		mutable std::shared_ptr<PageMap> pageMap_;
+	#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_PATTERNSCANNER_HPP
+
+/******************
+******* EOF *******
+******************/
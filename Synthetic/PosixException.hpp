@@ -0,0 +1,119 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_POSIXEXCEPTION_HPP
+#define SYNTHETIC_POSIXEXCEPTION_HPP
+
+//C Header Files:
+#include <string.h>
+
+//C++ Header Files:
+#include <string>
+#include <exception>
+#include <sstream>
+
+namespace Synthetic {
+
+/**
+* Counterpart of WinException for failed POSIX/Linux calls
+*/
+class PosixException : public std::exception
+{
+public:
+
+	/**
+	*Constructor
+	*Prepares error information, the message is only formatted by what()
+	*@param causedIn Where did the error happen?
+	*@param failedName Which system call failed?
+	*@param errorCode What does errno say?
+	*/
+	PosixException(	const std::string& causedIn,
+							const std::string& failedName,
+							int errorCode) :	causedIn_(causedIn),
+													failedName_(failedName),
+													errorCode_(errorCode)
+	{ }
+
+	~PosixException() throw()
+	{ }
+
+	/**
+	*@return A formatted error message
+	*/
+	const char* what() const throw()
+	{
+		if(!formattedError_.empty())
+			return formattedError_.c_str();
+
+		//Format a meaningfull error message
+		std::stringstream errorMessage;
+		errorMessage << causedIn_ << " Error : " << failedName_ <<
+		" failed with errorcode " << errorCode_ << "(" <<
+		strerror(errorCode_) << ")";
+
+		formattedError_.assign(errorMessage.str());
+		return formattedError_.c_str();
+	}
+
+	/**
+	*@return Where did the error happen?
+	*/
+	const std::string& causedIn() const
+	{
+		return causedIn_;
+	}
+
+	/**
+	*@return Which system call failed?
+	*/
+	const std::string& failedName() const
+	{
+		return failedName_;
+	}
+
+	/**
+	*@return What does errno say?
+	*/
+	int errorCode() const
+	{
+		return errorCode_;
+	}
+
+protected:
+
+	//Formatted by the first call to what()
+	mutable std::string formattedError_;
+	std::string causedIn_;
+	std::string failedName_;
+	int errorCode_;
+};
+
+} //End namespace Synthetic
+
+#endif //SYNTHETIC_POSIXEXCEPTION_HPP
+
+/******************
+******* EOF *******
+******************/
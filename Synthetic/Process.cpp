@@ -24,9 +24,11 @@
 
 //C++ header files:
 #include <algorithm>
+#include <cwctype>
 
 //Synthetic Header files:
 #include "Process.hpp"
+#include "ProcessTable.hpp"
 #include "SysObjectIterator.hpp"
 #include "SmartType.hpp"
 #include "Auxiliary.hpp"
@@ -34,6 +36,8 @@
 using namespace std;
 using namespace Synthetic;
 
+const errorcode_t Process::PARTIAL_TRANSFER_;
+
 /**********************************************************************
 ***********************************************************************
 ************************* PUBLIC FREE FUNCTIONS ***********************
@@ -74,23 +78,23 @@ pid_t Process::getProcessByName(wstring processName)
 					processName.begin(),
 					towlower);
 
-	//Iterate the complete process-list
-	pid_t id = 0;
-	for_each(ProcessIterator(0), ProcessIterator(), [&](PROCESSENTRY32W cur)
+	//Iterate the process-list until the first match
+	wstring currentProcess;
+	for(ProcessIterator it(0); it != ProcessIterator(); ++it)
 	{
 		//Convert current name to lowercase
-		wstring curName(cur.szExeFile);
-		transform(	curName.begin(),
-						curName.end(),
-						curName.begin(),
-						tolower);
+		currentProcess.assign(it->szExeFile);
+		transform(	currentProcess.begin(),
+						currentProcess.end(),
+						currentProcess.begin(),
+						towlower);
 
 		//Compare
-		if(curName == processName)
-			id = cur.th32ProcessID;
-	});
+		if(currentProcess == processName)
+			return it->th32ProcessID;
+	}
 
-	return id;
+	return 0;
 }
 
 pid_t Process::getProcessByWindowHandle(HWND windowHandle)
@@ -146,6 +150,12 @@ size_t Process::getProcessList(std::vector<pid_t>& dest)
 	return dest.size() - previousSize;
 }
 
+pid_t Process::waitForProcess(const wstring& processName, dword_t timeout)
+{
+	ProcessTable table;
+	return table.waitForProcess(processName, timeout);
+}
+
 /**********************************************************************
 ***********************************************************************
 ************************ PUBLIC MEMBER FUNCTIONS **********************
@@ -253,6 +263,19 @@ pid_t Process::createProcessAndOpen(	const wstring& applicationName,
 	return id_;
 }
 
+bool Process::waitForExit(dword_t timeout) const
+{
+	dword_t result = WaitForSingleObject(handle_, timeout);
+	if(result == WAIT_FAILED)
+	{
+		throw WinException(	"Process::waitForExit()",
+									"WaitForSingleObject()",
+									GetLastError());
+	}
+
+	return result == WAIT_OBJECT_0;
+}
+
 void Process::open(pid_t pid)
 {
 	close();
@@ -264,6 +287,7 @@ void Process::open(pid_t pid)
 									PROCESS_VM_WRITE				|
 									PROCESS_SUSPEND_RESUME		|
 									PROCESS_TERMINATE				|
+									PROCESS_DUP_HANDLE			|
 									SYNCHRONIZE;
 
 	handle_ = OpenProcess(desiredAccess, false, pid);
@@ -344,6 +368,230 @@ void Process::addDebugPrivileges_() const
 	}
 }
 
+#elif defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+
+//C++ header files:
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+//Synthetic Header files:
+#include "Process.hpp"
+#include "ProcessTable.hpp"
+#include "ExitMonitor.hpp"
+#include "PosixException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+const errorcode_t Process::PARTIAL_TRANSFER_;
+
+namespace
+{
+	/*
+	* Appends the PIDs of processes with a name to dest, compared like
+	* ProcessTable does. Stops at the first match if desired.
+	*/
+	size_t findProcesses(const wstring& processName, vector<pid_t>& dest, bool firstOnly)
+	{
+		ProcDirectory directory;
+		if(!directory.open(AT_FDCWD, "/proc"))
+			throw PosixException("Process::getProcessListByName()", "openat()", ENOENT);
+
+		const wstring wanted = ProcessTable::foldCase(processName);
+		const size_t previousSize = dest.size();
+
+		ProcEntry entry;
+		while(pid_t pid = directory.next())
+		{
+			//Processes may exit while iterating
+			if(!(readProcEntry(directory.getDescriptor(), pid, PROC_NAME, entry) & PROC_NAME))
+				continue;
+
+			const string name = readProcessName(directory.getDescriptor(), pid, entry.name);
+			if(ProcessTable::foldCase(wstring(name.begin(), name.end())) != wanted)
+				continue;
+
+			dest.push_back(pid);
+			if(firstOnly)
+				break;
+		}
+
+		return dest.size() - previousSize;
+	}
+}
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+pid_t Process::getProcessByName(wstring processName)
+{
+	vector<pid_t> processes;
+	findProcesses(processName, processes, true);
+
+	return processes.empty() ? 0 : processes.front();
+}
+
+pid_t Process::getCurrentProcess()
+{
+	return getpid();
+}
+
+size_t Process::getProcessListByName(wstring processName, vector<pid_t>& dest)
+{
+	return findProcesses(processName, dest, false);
+}
+
+size_t Process::getProcessList(vector<pid_t>& dest)
+{
+	size_t previousSize = dest.size();
+
+	for(ProcessIterator it(0); it != ProcessIterator(); ++it)
+		dest.push_back(it->id);
+
+	return dest.size() - previousSize;
+}
+
+pid_t Process::waitForProcess(const wstring& processName, dword_t timeout)
+{
+	ProcessTable table;
+	return table.waitForProcess(processName, timeout);
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+Process::Process() : id_(0)
+{ }
+
+Process::Process(pid_t pid) : id_(0)
+{
+	open(pid);
+}
+
+Process::Process(const Process& proc) : id_(proc.id_)
+{ }
+
+Process::~Process()
+{
+	close();
+}
+
+ptr_t Process::operator[](ptr_t address) const
+{
+	return readMemory<ptr_t>(address);
+}
+
+pid_t Process::getId() const
+{
+	return id_;
+}
+
+bool Process::waitForExit(dword_t timeout) const
+{
+	ExitMonitor monitor;
+	monitor.add(id_);
+
+	vector<pid_t> exited;
+	return monitor.wait(exited, timeout) != 0;
+}
+
+void Process::open(pid_t pid)
+{
+	close();
+
+	//There is no handle, just make sure the process exists
+	if(kill(pid, 0) == -1 && errno != EPERM)
+		throw PosixException("Process::open()", "kill()", errno);
+
+	id_ = pid;
+}
+
+void Process::close()
+{
+	id_ = 0;
+}
+
+void Process::terminate(dword_t)
+{
+	if(kill(id_, SIGKILL) == -1)
+		throw PosixException("Process::terminate()", "kill()", errno);
+
+	close();
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+errorcode_t Process::readBytes_(ptr_t source, void* dest, size_t amount, size_t& bytesRead) const
+{
+	iovec local = { dest, amount };
+	iovec remote = { reinterpret_cast<void*>(source), amount };
+
+	ssize_t transferred = process_vm_readv(id_, &local, 1, &remote, 1, 0);
+	if(transferred == -1)
+	{
+		bytesRead = 0;
+		return errno;
+	}
+
+	//Reads stopping at an unreadable page fail like ReadProcessMemory()
+	bytesRead = transferred;
+	return (bytesRead < amount) ? PARTIAL_TRANSFER_ : 0;
+}
+
+errorcode_t Process::writeBytes_(ptr_t dest, const void* source, size_t amount, size_t& bytesWritten) const
+{
+	iovec local = { const_cast<void*>(source), amount };
+	iovec remote = { reinterpret_cast<void*>(dest), amount };
+
+	bytesWritten = 0;
+	ssize_t transferred = process_vm_writev(id_, &local, 1, &remote, 1, 0);
+	if(transferred != -1)
+	{
+		bytesWritten = transferred;
+		return (bytesWritten < amount) ? PARTIAL_TRANSFER_ : 0;
+	}
+
+	//Read-only pages like code can only be written through the mem file
+	if(errno != EFAULT)
+		return errno;
+
+	char path[32];
+	sprintf(path, "/proc/%d/mem", static_cast<int>(id_));
+
+	int fd = ::open(path, O_WRONLY | O_CLOEXEC);
+	if(fd == -1)
+		return errno;
+
+	transferred = pwrite(fd, source, amount, static_cast<off_t>(dest));
+	int error = errno;
+	::close(fd);
+
+	if(transferred == -1)
+		return error;
+
+	bytesWritten = transferred;
+	return (bytesWritten < amount) ? PARTIAL_TRANSFER_ : 0;
+}
+
 #endif //defined(SYNTHETIC_ISWINDOWS)
 
 /******************
@@ -25,8 +25,16 @@
 #ifndef SYNTHETIC_PROCESS_PROCESS_HPP
 #define SYNTHETIC_PROCESS_PROCESS_HPP
 
-//Windows Header Files:
-#include <windows.h>
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows Header Files:
+	#include <windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//C Header Files:
+	#include <errno.h>
+#endif
 
 //C++ Header Files:
 #include <string>
@@ -36,6 +44,12 @@
 #include "Types.hpp"
 #include "SysObjectIterator.hpp"
 
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
 namespace Synthetic
 {
 	//Enumerations
@@ -48,11 +62,26 @@ namespace Synthetic
 		STDCALL_CONVENTION,
 		CDECL_CONVENTION,
 		THISCALL_CONVENTION,
-		GCCTHISCALL_CONVENTION
+		GCCTHISCALL_CONVENTION,
+		WIN64_CONVENTION,			//Microsoft x64 ABI
+		SYSV_CONVENTION			//System V AMD64 ABI
 	};
 
 	/**
-	* Interface to a Windows process
+	* Access rights of remote memory, can be combined
+	*/
+	enum MemoryProtection
+	{
+		PROTECTION_NONE		= 0,
+		PROTECTION_READ		= 1,
+		PROTECTION_WRITE		= 2,
+		PROTECTION_EXECUTE	= 4
+	};
+
+	/**
+	* Interface to a Windows or Linux process\n
+	* On Linux memory is accessed through process_vm_readv/writev, which
+	* needs the same permissions as ptrace.\n
 	*/
 	class Process
 	{
@@ -66,6 +95,8 @@ namespace Synthetic
 		***********************************************************************
 		**********************************************************************/
 
+		#if defined(SYNTHETIC_ISWINDOWS)
+
 		/**
 		*Retrieves the PID of the process the currently active window
 		*is associated to
@@ -81,10 +112,14 @@ namespace Synthetic
 		*/
 		static pid_t getProcessByWindowName(const std::wstring& windowName);
 
+		#endif
+
 		/**
 		*Retrieves the PID of the first found process with a given name
 		*Note that all other processes with same name will be ignored
 		*If you don't like that behaviour, use getProcessListByName()
+		*Every call walks all processes, use a ProcessTable for repeated
+		*lookups
 		*@param processName Case-insensitive process name
 		*@return The found process' PID
 		*/
@@ -95,7 +130,9 @@ namespace Synthetic
 		*@param windowHandle A WinAPI window handle
 		*@return A found process' PID or zero in case of error
 		*/
+		#if defined(SYNTHETIC_ISWINDOWS)
 		static pid_t getProcessByWindowHandle(HWND windowHandle);
+		#endif
 
 		/**
 		*Retrieves the PID of the current process
@@ -119,6 +156,18 @@ namespace Synthetic
 		*/
 		static size_t getProcessList(std::vector<pid_t>& dest);
 
+		/**
+		*Waits until a process with a given name is running
+		*Use ProcessTable::waitForProcess() to wait for several processes
+		*one after another, the table is only built once then
+		*@param processName Case-insensitive process name, see
+		*ProcessTable::waitForProcess()
+		*@param timeout (optional) Time to wait in milliseconds
+		*@return The found process' PID, zero if the time ran out
+		*/
+		static pid_t waitForProcess(	const std::wstring& processName,
+												dword_t timeout = TIMEOUT_INFINITE);
+
 		/**********************************************************************
 		***********************************************************************
 		************************ PUBLIC MEMBER FUNCTIONS **********************
@@ -160,6 +209,8 @@ namespace Synthetic
 		*/
 		ptr_t operator[](ptr_t address) const;
 
+		#if defined(SYNTHETIC_ISWINDOWS)
+
 		/**
 		* Retrieves the low level processhandle for use in WinAPI functions.
 		* Note that the handle becomes invalid when the destructor/close() is
@@ -170,12 +221,16 @@ namespace Synthetic
 		*/
 		HANDLE getHandle() const;
 
+		#endif
+
 		/**
 		* Retrieves the PID.
 		* @return pid_t The attached process' PID.
 		*/
 		pid_t getId() const;
 
+		#if defined(SYNTHETIC_ISWINDOWS)
+
 		/**
 		* Creates a new process and opens it.
 		* @param applicationName The name of the executeable to be executed.
@@ -200,6 +255,16 @@ namespace Synthetic
 													bool suspended = false,
 													dword_t waitingTime = 0);
 
+		#endif
+
+		/**
+		* Waits until the attached process exits. Use an ExitMonitor to wait
+		* for many processes.
+		* @param timeout (optional) Time to wait in milliseconds.
+		* @return bool true if the process exited, false if the time ran out.
+		*/
+		bool waitForExit(dword_t timeout = TIMEOUT_INFINITE) const;
+
 		/**
 		* Opens a process by a PID.
 		* If a process is already opened, it will get closed and 
@@ -216,10 +281,42 @@ namespace Synthetic
 		/**
 		* Terminates the attached process and calls close().
 		* @param exitCode (optional) An integer value which will be returned as
-		* exit code by the process. If ignored, zero will be returned.
+		* exit code by the process. If ignored, zero will be returned. Linux
+		* processes are killed by SIGKILL, exitCode is ignored there.
 		*/
 		void terminate(dword_t exitCode = 0);
 
+		/**
+		* Reads data from an address without throwing, for loops expecting
+		* to hit unreadable memory.
+		* @param source The data's address.
+		* @param dest Pointer to a buffer for read data.
+		* @param amount Amount of bytes to read.
+		* @param bytesRead Reference receiving the amount of read bytes,
+		* which may be set on failure as well.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		template<typename data_t>
+		errorcode_t tryRead(	const ptr_t source,
+									data_t* dest,
+									const size_t amount,
+									size_t& bytesRead) const
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			SIZE_T transferred = 0;
+			int ec = ::ReadProcessMemory(	handle_,
+													reinterpret_cast<const void*>(source),
+													static_cast<void*>(dest),
+													amount,
+													&transferred);
+			bytesRead = transferred;
+
+			return ec ? 0 : GetLastError();
+		#elif defined(SYNTHETIC_ISLINUX)
+			return readBytes_(source, dest, amount, bytesRead);
+		#endif
+		}
+
 		/**
 		* Reads data from an address.
 		* @param source The data's address.
@@ -232,23 +329,42 @@ namespace Synthetic
 								data_t* dest,
 								const size_t amount) const
 		{
-			SIZE_T bytesRead;
-			int ec = ::ReadProcessMemory(	handle_,
-													reinterpret_cast<const void*>(source),
-													static_cast<void*>(dest),
-													amount,
-													&bytesRead);
-			if(!ec)
+			size_t bytesRead;
+			errorcode_t error = tryRead(source, dest, amount, bytesRead);
+			if(error)
 			{
-				const dword_t error = GetLastError();
+			#if defined(SYNTHETIC_ISWINDOWS)
 				throw WinException(	"Process::rawRead<>()",
 											"ReadProcessMemory()",
-											error);				
+											error);
+			#elif defined(SYNTHETIC_ISLINUX)
+				throw PosixException(	"Process::rawRead<>()",
+												"process_vm_readv()",
+												error);
+			#endif
 			}
 
 			return bytesRead;
 		}
 
+		/**
+		* Reads data from an address without throwing.
+		* @param address The data's address.
+		* @param dest Reference to the variable receiving the data.
+		* @return errorcode_t Zero if all of it was read, the error
+		* otherwise.
+		*/
+		template <typename data_t>
+		errorcode_t tryReadMemory(ptr_t address, data_t& dest) const
+		{
+			size_t bytesRead;
+			errorcode_t error = tryRead(address, &dest, sizeof(data_t), bytesRead);
+			if(!error && bytesRead != sizeof(data_t))
+				error = PARTIAL_TRANSFER_;
+
+			return error;
+		}
+
 		/**
 		* Reads data from an address.
 		* @param address The data's address.
@@ -285,6 +401,36 @@ namespace Synthetic
 			return dest.length();
 		}
 
+		/**
+		* Writes data to an address without throwing.
+		* @param dest The address the data will be written to.
+		* @param source The data which has to be written.
+		* @param amount The amount of bytes to write.
+		* @param bytesWritten Reference receiving the amount of written
+		* bytes, which may be set on failure as well.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		template<typename data_t>
+		errorcode_t tryWrite(	const ptr_t dest,
+										const data_t* source,
+										const size_t amount,
+										size_t& bytesWritten) const
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			SIZE_T transferred = 0;
+			int ec = ::WriteProcessMemory(	handle_,
+														reinterpret_cast<void*>(dest),
+														static_cast<const void*>(source),
+														amount,
+														&transferred);
+			bytesWritten = transferred;
+
+			return ec ? 0 : GetLastError();
+		#elif defined(SYNTHETIC_ISLINUX)
+			return writeBytes_(dest, source, amount, bytesWritten);
+		#endif
+		}
+
 		/**
 		* Writes data to an address.
 		* @param dest The address the data will be written to.
@@ -297,23 +443,42 @@ namespace Synthetic
 								const data_t* source,
 								const size_t amount) const
 		{
-			SIZE_T bytesWritten;
-			int ec = ::WriteProcessMemory(	handle_,
-														reinterpret_cast<void*>(dest),
-														static_cast<const void*>(source),
-														amount,
-														&bytesWritten);
-			if(!ec)
+			size_t bytesWritten;
+			errorcode_t error = tryWrite(dest, source, amount, bytesWritten);
+			if(error)
 			{
-				const dword_t error = GetLastError();
+			#if defined(SYNTHETIC_ISWINDOWS)
 				throw WinException(	"Process::rawWrite<>()",
 											"WriteProcessMemory()",
-											error);				
+											error);
+			#elif defined(SYNTHETIC_ISLINUX)
+				throw PosixException(	"Process::rawWrite<>()",
+												"process_vm_writev()",
+												error);
+			#endif
 			}
 
 			return bytesWritten;
 		}
 
+		/**
+		* Writes data to an address without throwing.
+		* @param dest The address the data will be written to.
+		* @param value The data which has to be written.
+		* @return errorcode_t Zero if all of it was written, the error
+		* otherwise.
+		*/
+		template <typename data_t>
+		errorcode_t tryWriteMemory(const ptr_t dest, const data_t& value) const
+		{
+			size_t bytesWritten;
+			errorcode_t error = tryWrite(dest, &value, sizeof(value), bytesWritten);
+			if(!error && bytesWritten != sizeof(value))
+				error = PARTIAL_TRANSFER_;
+
+			return error;
+		}
+
 		/**
 		* Writes data to an address.
 		* @param dest The address the data will be written to.
@@ -324,7 +489,7 @@ namespace Synthetic
 		size_t writeMemory(	const ptr_t dest,
 									const data_t& value) const
 		{
-			return rawWrite(address, &value, sizeof(value));
+			return rawWrite(dest, &value, sizeof(value));
 		}
 
 		/**
@@ -352,18 +517,41 @@ namespace Synthetic
 		***********************************************************************
 		**********************************************************************/
 
+		#if defined(SYNTHETIC_ISWINDOWS)
+
 		/*
 		* Sets permissions for the current process to debug other processes
 		*/
 		void addDebugPrivileges_() const;
 
+		#elif defined(SYNTHETIC_ISLINUX)
+
+		/*
+		* Untyped memory access, falls back to /proc/<pid>/mem for pages
+		* process_vm_writev refuses to write
+		*/
+		errorcode_t readBytes_(ptr_t source, void* dest, size_t amount, size_t& bytesRead) const;
+		errorcode_t writeBytes_(ptr_t dest, const void* source, size_t amount, size_t& bytesWritten) const;
+
+		#endif
+
 		/**********************************************************************
 		***********************************************************************
 		*********************** PRIVATE MEMBER VARIABLES **********************
 		***********************************************************************
 		**********************************************************************/
 
-		handle_t		handle_;
+		//Reported for partial transfers
+		#if defined(SYNTHETIC_ISWINDOWS)
+			static const errorcode_t PARTIAL_TRANSFER_ = ERROR_PARTIAL_COPY;
+		#elif defined(SYNTHETIC_ISLINUX)
+			static const errorcode_t PARTIAL_TRANSFER_ = EFAULT;
+		#endif
+
+		#if defined(SYNTHETIC_ISWINDOWS)
+			handle_t		handle_;
+		#endif
+
 		pid_t	id_;
 	};
 }
@@ -0,0 +1,312 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <Windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <fcntl.h>
+	#include <time.h>
+	#include <errno.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <stdexcept>
+#include <cwctype>
+#include <cstring>
+
+//Synthetic header files:
+#include "ProcessTable.hpp"
+#include "SysObjectIterator.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Bounds of the interval waitForProcess() refreshes at
+	const dword_t MIN_WAIT_INTERVAL = 1;
+	const dword_t MAX_WAIT_INTERVAL = 32;
+
+	//The interval is at least this multiple of a refresh' duration
+	const dword_t MIN_IDLE_FACTOR = 50;
+
+#if defined(SYNTHETIC_ISLINUX)
+	//Time in milliseconds names of new processes are read again, forked
+	//processes usually exec within it
+	const dword_t NAME_SETTLE_TIME = 1000;
+#endif
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	dword_t getMilliseconds()
+	{
+		return GetTickCount();
+	}
+
+	void sleepMilliseconds(dword_t duration)
+	{
+		Sleep(duration);
+	}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	dword_t getMilliseconds()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<dword_t>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+	}
+
+	void sleepMilliseconds(dword_t duration)
+	{
+		timespec time = { duration / 1000, (duration % 1000) * 1000000L };
+		while(nanosleep(&time, &time) == -1 && errno == EINTR);
+	}
+
+#endif
+}
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+wstring ProcessTable::foldCase(const wstring& str)
+{
+	wstring folded(str);
+	for(wstring::iterator i = folded.begin(); i != folded.end(); ++i)
+		*i = towlower(*i);
+
+	return folded;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+ProcessTable::ProcessTable() : generation_(0)
+{ }
+
+bool ProcessTable::refresh()
+{
+	const dword_t generation = ++generation_;
+	bool changed = false;
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//The snapshot contains the names anyway, comparing them catches
+	//reused PIDs
+	for(ProcessIterator it(0); it != ProcessIterator(); ++it)
+	{
+		unordered_map<pid_t, Entry>::iterator known = processes_.find(it->th32ProcessID);
+		if(known != processes_.end() && known->second.rawName.compare(it->szExeFile) == 0)
+		{
+			known->second.generation = generation;
+			continue;
+		}
+
+		if(known != processes_.end())
+		{
+			unindex_(it->th32ProcessID, known->second.name);
+			processes_.erase(known);
+		}
+
+		insert_(it->th32ProcessID, it->szExeFile);
+		changed = true;
+	}
+#elif defined(SYNTHETIC_ISLINUX)
+	if(!directory_.open(AT_FDCWD, "/proc"))
+		throw PosixException("ProcessTable::refresh()", "openat()", ENOENT);
+
+	//Only the directory is read, comm only for new processes
+	const dword_t now = getMilliseconds();
+	ProcEntry entry;
+	while(pid_t pid = directory_.next())
+	{
+		unordered_map<pid_t, Entry>::iterator known = processes_.find(pid);
+		if(known != processes_.end())
+		{
+			known->second.generation = generation;
+			if(now - known->second.firstSeen >= NAME_SETTLE_TIME)
+				continue;
+		}
+
+		//Processes may exit meanwhile, the next refresh won't list them
+		if(!(readProcEntry(directory_.getDescriptor(), pid, PROC_NAME, entry) & PROC_NAME))
+			continue;
+
+		const string fullName = readProcessName(directory_.getDescriptor(), pid, entry.name);
+		wstring name(fullName.begin(), fullName.end());
+		dword_t firstSeen = now;
+		if(known != processes_.end())
+		{
+			if(foldCase(name) == known->second.name)
+				continue;
+
+			//Renamed, usually by exec
+			firstSeen = known->second.firstSeen;
+			unindex_(pid, known->second.name);
+			processes_.erase(known);
+		}
+
+		insert_(pid, name);
+		processes_[pid].firstSeen = firstSeen;
+		changed = true;
+	}
+
+	directory_.close();
+#endif
+
+	//Everything not seen by this refresh has exited
+	for(unordered_map<pid_t, Entry>::iterator i = processes_.begin(); i != processes_.end();)
+	{
+		if(i->second.generation == generation)
+		{
+			++i;
+			continue;
+		}
+
+		unindex_(i->first, i->second.name);
+		i = processes_.erase(i);
+		changed = true;
+	}
+
+	return changed;
+}
+
+void ProcessTable::clear()
+{
+	processes_.clear();
+	byName_.clear();
+}
+
+pid_t ProcessTable::findByName(const wstring& name) const
+{
+	unordered_map<wstring, vector<pid_t> >::const_iterator found = byName_.find(foldCase(name));
+	return found != byName_.end() ? found->second.front() : 0;
+}
+
+size_t ProcessTable::findAllByName(const wstring& name, vector<pid_t>& dest) const
+{
+	unordered_map<wstring, vector<pid_t> >::const_iterator found = byName_.find(foldCase(name));
+	if(found == byName_.end())
+		return 0;
+
+	dest.insert(dest.end(), found->second.begin(), found->second.end());
+	return found->second.size();
+}
+
+pid_t ProcessTable::waitForProcess(const wstring& name, dword_t timeout)
+{
+	//Names are file names, anything else would be waited for forever
+#if defined(SYNTHETIC_ISWINDOWS)
+	if(name.empty() || name.find_first_of(L"\\/") != wstring::npos)
+#elif defined(SYNTHETIC_ISLINUX)
+	if(name.empty() || name.find(L'/') != wstring::npos)
+#endif
+	{
+		throw invalid_argument(	"ProcessTable::waitForProcess() Error : "\
+										"The name is no file name");
+	}
+
+	const dword_t start = getMilliseconds();
+	dword_t interval = MIN_WAIT_INTERVAL;
+
+	for(;;)
+	{
+		const dword_t refreshStart = getMilliseconds();
+		bool changed = refresh();
+		const dword_t refreshTime = getMilliseconds() - refreshStart;
+
+		if(pid_t pid = findByName(name))
+			return pid;
+
+		dword_t elapsed = getMilliseconds() - start;
+		if(timeout != TIMEOUT_INFINITE && elapsed >= timeout)
+			return 0;
+
+		//Processes tend to start in bursts, launchers start servers, so
+		//look again soon after a change. Long refreshes (many processes)
+		//stretch the interval to keep the CPU usage low.
+		interval = changed ? MIN_WAIT_INTERVAL : min(interval * 2, MAX_WAIT_INTERVAL);
+		interval = max(interval, refreshTime * MIN_IDLE_FACTOR);
+
+		if(timeout != TIMEOUT_INFINITE)
+			interval = min(interval, timeout - elapsed);
+
+		sleepMilliseconds(interval);
+	}
+}
+
+bool ProcessTable::contains(pid_t pid) const
+{
+	return processes_.find(pid) != processes_.end();
+}
+
+size_t ProcessTable::size() const
+{
+	return processes_.size();
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+void ProcessTable::insert_(pid_t pid, const wstring& rawName)
+{
+	Entry& entry = processes_[pid];
+	entry.name = foldCase(rawName);
+#if defined(SYNTHETIC_ISWINDOWS)
+	entry.rawName = rawName;
+#endif
+	entry.generation = generation_;
+
+	byName_[entry.name].push_back(pid);
+}
+
+void ProcessTable::unindex_(pid_t pid, const wstring& name)
+{
+	unordered_map<wstring, vector<pid_t> >::iterator found = byName_.find(name);
+	if(found == byName_.end())
+		return;
+
+	vector<pid_t>& pids = found->second;
+	pids.erase(remove(pids.begin(), pids.end(), pid), pids.end());
+	if(pids.empty())
+		byName_.erase(found);
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,199 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_PROCESSTABLE_HPP
+#define SYNTHETIC_PROCESS_PROCESSTABLE_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Types.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	#include "ProcfsIterator.hpp"
+#endif
+
+namespace Synthetic
+{
+	/**
+	* Cached list of the running processes indexed by name.\n
+	* Names are case-folded, so lookups by name don't depend on the
+	* number of processes. refresh() only lists the PIDs, names are only
+	* read and folded for PIDs which weren't known before.\n
+	* On Linux names are read from /proc/pid/comm, names cut to 15 bytes
+	* there are completed by readProcessName(). They are read again
+	* during a process' first second, which covers the exec following a
+	* fork. Later renames and PIDs reused between two refreshes keep the
+	* old name there. On Windows the name is compared, since the snapshot
+	* contains it.\n
+	*/
+	class ProcessTable
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Converts a name to the form used as key.
+		* @param str The string.
+		* @return std::wstring The lowercase string.
+		*/
+		static std::wstring foldCase(const std::wstring& str);
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty table.
+		*/
+		ProcessTable();
+
+		/**
+		* Brings the table up to date.
+		* @return bool true if processes were started or exited.
+		*/
+		bool refresh();
+
+		/**
+		* Removes all processes, the next refresh reads everything again.
+		*/
+		void clear();
+
+		/**
+		* Searches a process by its name.
+		* @param name Case-insensitive process name.
+		* @return pid_t The PID of the first found process with the name, 0
+		* if there is none.
+		*/
+		pid_t findByName(const std::wstring& name) const;
+
+		/**
+		* Searches all processes with a name.
+		* @param name Case-insensitive process name.
+		* @param dest Reference to a vector the PIDs are appended to.
+		* @return size_t Number of found processes.
+		*/
+		size_t findAllByName(const std::wstring& name, std::vector<pid_t>& dest) const;
+
+		/**
+		* Refreshes the table until a process with a name shows up.
+		* Refreshes follow each other closely after processes started or
+		* exited and back off while nothing changes, but never take more
+		* than a small share of the time.\n
+		* On Linux, processes with names longer than 15 bytes whose
+		* executable and command line both can't be read or don't contain
+		* the name are only known by the first 15 bytes, see
+		* readProcessName().
+		* @param name Case-insensitive process name, a file name without
+		* path. Empty names and paths throw std::invalid_argument.
+		* @param timeout (optional) Time to wait in milliseconds.
+		* @return pid_t The PID of the first found process with the name, 0
+		* if the time ran out.
+		*/
+		pid_t waitForProcess(const std::wstring& name, dword_t timeout = TIMEOUT_INFINITE);
+
+		/**
+		* Checks if a process was running at the last refresh.
+		* @param pid The process' PID.
+		* @return bool true if it's in the table.
+		*/
+		bool contains(pid_t pid) const;
+
+		/**
+		* @return size_t Number of processes.
+		*/
+		size_t size() const;
+
+	private:
+
+		/*
+		* A known process
+		*/
+		struct Entry
+		{
+			std::wstring name;
+		#if defined(SYNTHETIC_ISWINDOWS)
+			std::wstring rawName;
+		#elif defined(SYNTHETIC_ISLINUX)
+			dword_t firstSeen;
+		#endif
+			dword_t generation;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Adds a process which wasn't known before
+		*/
+		void insert_(pid_t pid, const std::wstring& rawName);
+
+		/*
+		* Removes a process from the name index
+		*/
+		void unindex_(pid_t pid, const std::wstring& name);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Processes by PID, and PIDs by folded name in the order they were
+		//found
+		std::unordered_map<pid_t, Entry> processes_;
+		std::unordered_map<std::wstring, std::vector<pid_t> > byName_;
+
+		//Incremented per refresh, processes not seen by it have exited
+		dword_t generation_;
+
+	#if defined(SYNTHETIC_ISLINUX)
+		ProcDirectory directory_;
+	#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_PROCESSTABLE_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,646 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+
+//Synthetic header files:
+#include "ProcfsIterator.hpp"
+#include "PosixException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Holds a few hundred directory entries, /proc is read in a handful
+	//of calls
+	const size_t DIRECTORY_BUFFER_SIZE = 0x8000;
+
+	//Initial size of the maps buffer, it grows for large processes
+	const size_t MAPS_BUFFER_SIZE = 0x10000;
+
+	//Long enough for stat, and for status up to the Uid line
+	const size_t FILE_BUFFER_SIZE = 0x400;
+
+	//Fields of stat after the state, up to rss
+	const size_t STAT_FIELDS = 21;
+
+	//comm holds TASK_COMM_LEN - 1 bytes, names this long may be cut
+	const size_t COMM_LENGTH = 15;
+
+	//Appended to the target of exe links whose file was deleted
+	const char DELETED_SUFFIX[] = " (deleted)";
+
+	/*
+	* Layout of the records returned by getdents64
+	*/
+	struct Dirent64
+	{
+		qword_t inode;
+		qword_t offset;
+		unsigned short length;
+		unsigned char type;
+		char name[1];
+	};
+
+	/*
+	* A line of /proc/pid/maps
+	*/
+	struct Mapping
+	{
+		qword_t begin;
+		qword_t end;
+		qword_t offset;
+		const char* path;
+		size_t pathLength;
+	};
+
+	/*
+	* Reads a small file relative to a directory, -1 if it can't be read
+	*/
+	ssize_t readFile(int directory, const char* path, char* buffer, size_t size)
+	{
+		int fd = openat(directory, path, O_RDONLY | O_CLOEXEC);
+		if(fd == -1)
+			return -1;
+
+		ssize_t length = read(fd, buffer, size - 1);
+		close(fd);
+
+		if(length >= 0)
+			buffer[length] = '\0';
+
+		return length;
+	}
+
+	/*
+	* Parses the numbers following the name in /proc/pid/stat
+	*/
+	bool parseStat(const char* stat, ProcEntry& dest)
+	{
+		//The name may contain anything, the last parenthesis ends it
+		const char* current = strrchr(stat, ')');
+		if(!current || !current[1] || !current[2])
+			return false;
+
+		dest.state = current[2];
+		current += 3;
+
+		qword_t values[STAT_FIELDS];
+		for(size_t i = 0; i < STAT_FIELDS; ++i)
+		{
+			char* end;
+			values[i] = strtoull(current, &end, 10);
+			if(end == current)
+				return false;
+
+			current = end;
+		}
+
+		dest.parentProcessId = static_cast<pid_t>(values[0]);
+		dest.userTime = values[10];
+		dest.kernelTime = values[11];
+		dest.threadCount = static_cast<dword_t>(values[16]);
+		dest.startTime = values[18];
+		dest.virtualSize = values[19];
+		dest.residentPages = values[20];
+
+		return true;
+	}
+
+	/*
+	* Parses the line of the maps at position and moves past it, false at
+	* the end
+	*/
+	bool parseMapping(const vector<char>& maps, size_t& position, Mapping& dest)
+	{
+		while(position < maps.size())
+		{
+			const char* line = &maps[position];
+			const char* end = static_cast<const char*>(memchr(line, '\n', maps.size() - position));
+			if(!end)
+				end = &maps[0] + maps.size();
+
+			position = (end - &maps[0]) + 1;
+
+			//begin-end perms offset dev inode path
+			char* current;
+			dest.begin = strtoull(line, &current, 16);
+			if(*current != '-')
+				continue;
+
+			dest.end = strtoull(current + 1, &current, 16);
+			current = strchr(current, ' ');
+			if(!current || current >= end)
+				continue;
+
+			current = strchr(current + 1, ' ');
+			if(!current || current >= end)
+				continue;
+
+			dest.offset = strtoull(current + 1, &current, 16);
+
+			//Skip dev and inode, the path follows after padding
+			for(int field = 0; field < 2 && current && current < end; ++field)
+				current = strchr(current + 1, ' ');
+
+			if(!current || current >= end)
+			{
+				dest.path = end;
+				dest.pathLength = 0;
+				return true;
+			}
+
+			while(current < end && *current == ' ')
+				++current;
+
+			dest.path = current;
+			dest.pathLength = end - current;
+			return true;
+		}
+
+		return false;
+	}
+
+	/*
+	* Files and the vdso are images, other pseudo paths and anonymous
+	* memory aren't
+	*/
+	bool isImage(const Mapping& mapping)
+	{
+		if(!mapping.pathLength)
+			return false;
+
+		return mapping.path[0] == '/' || (	mapping.pathLength == 6 &&
+														!memcmp(mapping.path, "[vdso]", 6));
+	}
+}
+
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+int Synthetic::readProcEntry(int directory, pid_t id, int fields, ProcEntry& dest)
+{
+	dest.id = id;
+	dest.fields = 0;
+
+	char path[32];
+	char buffer[FILE_BUFFER_SIZE];
+
+	if(fields & PROC_NAME)
+	{
+		sprintf(path, "%d/comm", static_cast<int>(id));
+
+		ssize_t length = readFile(directory, path, buffer, sizeof(buffer));
+		if(length > 0)
+		{
+			//Strip the trailing newline
+			if(buffer[length - 1] == '\n')
+				--length;
+
+			length = min<ssize_t>(length, sizeof(dest.name) - 1);
+			memcpy(dest.name, buffer, length);
+			dest.name[length] = '\0';
+
+			dest.fields |= PROC_NAME;
+		}
+	}
+
+	if(fields & PROC_STAT)
+	{
+		sprintf(path, "%d/stat", static_cast<int>(id));
+
+		if(readFile(directory, path, buffer, sizeof(buffer)) > 0 && parseStat(buffer, dest))
+			dest.fields |= PROC_STAT;
+	}
+
+	if(fields & PROC_STATUS)
+	{
+		sprintf(path, "%d/status", static_cast<int>(id));
+
+		if(readFile(directory, path, buffer, sizeof(buffer)) > 0)
+		{
+			const char* uid = strstr(buffer, "\nUid:");
+			if(uid)
+			{
+				dest.userId = static_cast<uid_t>(strtoul(uid + 5, NULL, 10));
+				dest.fields |= PROC_STATUS;
+			}
+		}
+	}
+
+	return dest.fields;
+}
+
+string Synthetic::readProcessName(int directory, pid_t id, const char* comm)
+{
+	const size_t length = strlen(comm);
+	if(length < COMM_LENGTH)
+		return comm;
+
+	char path[32];
+	char buffer[PATH_MAX];
+
+	sprintf(path, "%d/exe", static_cast<int>(id));
+	ssize_t size = readlinkat(directory, path, buffer, sizeof(buffer) - 1);
+	if(size > 0)
+	{
+		buffer[size] = '\0';
+
+		const size_t suffix = sizeof(DELETED_SUFFIX) - 1;
+		if(static_cast<size_t>(size) > suffix && strcmp(buffer + size - suffix, DELETED_SUFFIX) == 0)
+			buffer[size - suffix] = '\0';
+
+		const char* slash = strrchr(buffer, '/');
+		const char* name = slash ? slash + 1 : buffer;
+		if(strncmp(name, comm, length) == 0)
+			return name;
+	}
+
+	//Scripts are named after the script, which is one of the arguments,
+	//the interpreter is the executable
+	sprintf(path, "%d/cmdline", static_cast<int>(id));
+	size = readFile(directory, path, buffer, sizeof(buffer));
+	for(const char* argument = buffer; size > 0 && argument < buffer + size; argument += strlen(argument) + 1)
+	{
+		const char* slash = strrchr(argument, '/');
+		const char* name = slash ? slash + 1 : argument;
+		if(strncmp(name, comm, length) == 0)
+			return name;
+	}
+
+	return comm;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+ProcDirectory::ProcDirectory() : descriptor_(-1), position_(0), size_(0)
+{ }
+
+ProcDirectory::ProcDirectory(const ProcDirectory& directory) : descriptor_(-1)
+{
+	*this = directory;
+}
+
+ProcDirectory& ProcDirectory::operator=(const ProcDirectory& directory)
+{
+	if(this == &directory)
+		return *this;
+
+	close();
+
+	if(directory.descriptor_ != -1)
+	{
+		descriptor_ = fcntl(directory.descriptor_, F_DUPFD_CLOEXEC, 0);
+		if(descriptor_ == -1)
+			throw PosixException("ProcDirectory::operator=()", "fcntl()", errno);
+	}
+
+	buffer_ = directory.buffer_;
+	position_ = directory.position_;
+	size_ = directory.size_;
+
+	return *this;
+}
+
+ProcDirectory::~ProcDirectory()
+{
+	close();
+}
+
+bool ProcDirectory::open(int parent, const char* path)
+{
+	close();
+
+	descriptor_ = openat(parent, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(descriptor_ == -1)
+	{
+		//The process exited
+		if(errno == ENOENT || errno == ESRCH)
+			return false;
+
+		throw PosixException("ProcDirectory::open()", "openat()", errno);
+	}
+
+	buffer_.resize(DIRECTORY_BUFFER_SIZE);
+	return true;
+}
+
+void ProcDirectory::close()
+{
+	if(descriptor_ != -1)
+	{
+		::close(descriptor_);
+		descriptor_ = -1;
+	}
+
+	position_ = 0;
+	size_ = 0;
+}
+
+int ProcDirectory::getDescriptor() const
+{
+	return descriptor_;
+}
+
+pid_t ProcDirectory::next()
+{
+	if(descriptor_ == -1)
+		return 0;
+
+	for(;;)
+	{
+		if(position_ >= size_)
+		{
+			long length = syscall(SYS_getdents64, descriptor_, &buffer_[0], buffer_.size());
+			if(length == -1)
+			{
+				//Task directories vanish with their process
+				if(errno == ENOENT)
+					return 0;
+
+				throw PosixException("ProcDirectory::next()", "getdents64()", errno);
+			}
+
+			if(!length)
+				return 0;
+
+			position_ = 0;
+			size_ = static_cast<size_t>(length);
+		}
+
+		const Dirent64* entry = reinterpret_cast<const Dirent64*>(&buffer_[position_]);
+		position_ += entry->length;
+
+		//Everything but the numeric entries is skipped while converting
+		pid_t id = 0;
+		for(const char* digit = entry->name; *digit; ++digit)
+		{
+			if(*digit < '0' || *digit > '9')
+			{
+				id = 0;
+				break;
+			}
+
+			id = id * 10 + (*digit - '0');
+		}
+
+		if(id)
+			return id;
+	}
+}
+
+bool ProcessBackend::first(pid_t pid, int fields)
+{
+	errorcode_t error;
+	bool found = tryFirst(pid, fields, error);
+	if(error)
+		throw PosixException("SysObjectIterator::SysObjectIterator()", "openat()", error);
+
+	return found;
+}
+
+bool ProcessBackend::tryFirst(pid_t, int fields, errorcode_t& error)
+{
+	fields_ = fields;
+
+	error = processes_.open(AT_FDCWD, "/proc") ? 0 : ENOENT;
+	return !error && next();
+}
+
+bool ProcessBackend::next()
+{
+	pid_t pid = processes_.next();
+	if(!pid)
+		return false;
+
+	entry_.processId = pid;
+	readProcEntry(processes_.getDescriptor(), pid, fields_, entry_);
+	return true;
+}
+
+const ProcEntry& ProcessBackend::get() const
+{
+	return entry_;
+}
+
+bool ThreadBackend::first(pid_t pid, int fields)
+{
+	errorcode_t error;
+	bool found = tryFirst(pid, fields, error);
+	if(error)
+		throw PosixException("SysObjectIterator::SysObjectIterator()", "openat()", error);
+
+	return found;
+}
+
+bool ThreadBackend::tryFirst(pid_t pid, int fields, errorcode_t& error)
+{
+	fields_ = fields;
+	allProcesses_ = !pid;
+	error = 0;
+
+	if(allProcesses_)
+	{
+		threads_.close();
+		if(!processes_.open(AT_FDCWD, "/proc"))
+			error = ENOENT;
+	}
+	else
+	{
+		char path[32];
+		sprintf(path, "/proc/%d/task", static_cast<int>(pid));
+
+		if(!threads_.open(AT_FDCWD, path))
+			error = ESRCH;
+
+		entry_.processId = pid;
+	}
+
+	return !error && next();
+}
+
+bool ThreadBackend::next()
+{
+	for(;;)
+	{
+		pid_t tid = threads_.next();
+		if(tid)
+		{
+			readProcEntry(threads_.getDescriptor(), tid, fields_, entry_);
+			return true;
+		}
+
+		if(!allProcesses_ || !nextProcess_())
+			return false;
+	}
+}
+
+const ProcEntry& ThreadBackend::get() const
+{
+	return entry_;
+}
+
+bool MapsBackend::first(pid_t pid, int fields)
+{
+	errorcode_t error;
+	bool found = tryFirst(pid, fields, error);
+	if(error)
+		throw PosixException("SysObjectIterator::SysObjectIterator()", "open()", error);
+
+	return found;
+}
+
+bool MapsBackend::tryFirst(pid_t pid, int, errorcode_t& error)
+{
+	char path[32];
+	if(pid)
+		sprintf(path, "/proc/%d/maps", static_cast<int>(pid));
+	else
+		strcpy(path, "/proc/self/maps");
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	error = (fd == -1) ? errno : 0;
+	if(error)
+		return false;
+
+	//The size isn't known before, the buffer is kept for later walks
+	if(maps_.size() < MAPS_BUFFER_SIZE)
+		maps_.resize(MAPS_BUFFER_SIZE);
+
+	size_t size = 0;
+	for(;;)
+	{
+		if(size == maps_.size())
+			maps_.resize(maps_.size() * 2);
+
+		ssize_t length = read(fd, &maps_[size], maps_.size() - size);
+		if(length == -1)
+		{
+			error = errno;
+			close(fd);
+			return false;
+		}
+
+		if(!length)
+			break;
+
+		size += length;
+	}
+
+	close(fd);
+
+	maps_.resize(size);
+	position_ = 0;
+	entry_.processId = pid;
+
+	return next();
+}
+
+bool MapsBackend::next()
+{
+	Mapping mapping;
+	while(parseMapping(maps_, position_, mapping))
+	{
+		if(mapping.offset || !isImage(mapping))
+			continue;
+
+		const size_t length = min<size_t>(mapping.pathLength, sizeof(entry_.path) - 1);
+		memcpy(entry_.path, mapping.path, length);
+		entry_.path[length] = '\0';
+
+		const char* separator = static_cast<const char*>(memrchr(entry_.path, '/', length));
+		entry_.nameOffset = separator ? separator - entry_.path + 1 : 0;
+
+		entry_.baseAddress = static_cast<ptr_t>(mapping.begin);
+		entry_.size = static_cast<size_t>(mapping.end - mapping.begin);
+
+		//Following mappings of the same file belong to the image
+		Mapping following;
+		size_t position = position_;
+		while(	parseMapping(maps_, position, following) &&
+					following.pathLength == mapping.pathLength &&
+					!memcmp(following.path, mapping.path, mapping.pathLength))
+		{
+			entry_.size = static_cast<size_t>(following.end - mapping.begin);
+			position_ = position;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+const ModuleEntry& MapsBackend::get() const
+{
+	return entry_;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+bool ThreadBackend::nextProcess_()
+{
+	char path[32];
+	while(pid_t pid = processes_.next())
+	{
+		sprintf(path, "%d/task", static_cast<int>(pid));
+		if(threads_.open(processes_.getDescriptor(), path))
+		{
+			entry_.processId = pid;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+/******************
+******* EOF *******
+******************/
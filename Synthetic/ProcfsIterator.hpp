@@ -0,0 +1,350 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCFSITERATOR_HPP
+#define SYNTHETIC_PROCFSITERATOR_HPP
+
+//Synthetic header files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <sys/types.h>
+#include <limits.h>
+
+//C++ header files:
+#include <string>
+#include <vector>
+
+//Synthetic header files:
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* Per-entry files read by ProcessIterator and ThreadIterator
+	*/
+	enum ProcEntryField
+	{
+		PROC_NAME		= 1,	//comm
+		PROC_STAT		= 2,	//stat
+		PROC_STATUS		= 4		//status
+	};
+
+	/**
+	* A process or thread found in /proc.\n
+	* Only the fields of the files asked for are filled, fields tells
+	* which of them could be read. Entries exiting while being iterated
+	* are still returned, without the fields which couldn't be read.\n
+	*/
+	struct ProcEntry
+	{
+		pid_t id;
+		pid_t processId;
+		int fields;
+
+		//PROC_NAME
+		char name[16];
+
+		//PROC_STAT, times are in clock ticks
+		char state;
+		pid_t parentProcessId;
+		qword_t userTime;
+		qword_t kernelTime;
+		dword_t threadCount;
+		qword_t startTime;
+		qword_t virtualSize;
+		qword_t residentPages;
+
+		//PROC_STATUS
+		uid_t userId;
+	};
+
+	/**
+	* An image mapped into a process, a run of mappings of the same file
+	* starting at offset 0
+	*/
+	struct ModuleEntry
+	{
+		pid_t processId;
+		ptr_t baseAddress;
+		size_t size;
+
+		//The name starts at path + nameOffset
+		char path[PATH_MAX];
+		size_t nameOffset;
+	};
+
+	/**
+	* Reads the files of a process or thread asked for.
+	* @param directory Descriptor of the directory containing the entry,
+	* /proc or a task directory.
+	* @param id The process or thread id.
+	* @param fields ProcEntryField flags of files to read.
+	* @param dest Reference to the entry to fill.
+	* @return int The ProcEntryField flags of the files which were read.
+	*/
+	int readProcEntry(int directory, pid_t id, int fields, ProcEntry& dest);
+
+	/**
+	* Reads a process' name without the 15 byte limit of comm.\n
+	* A cut name is completed from the executable's name or, for scripts
+	* and executables we can't look at, from the command line. The name
+	* found there has to start with comm, otherwise comm is returned.\n
+	* @param directory Descriptor of /proc.
+	* @param id The process' PID.
+	* @param comm The name read from comm (PROC_NAME).
+	* @return std::string The name.
+	*/
+	std::string readProcessName(int directory, pid_t id, const char* comm);
+
+	/**
+	* Reads the numeric entries of a /proc directory with getdents64 into
+	* a buffer which is reused for the whole walk.\n
+	* Copies share the position like duplicated handles do.\n
+	*/
+	class ProcDirectory
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		*/
+		ProcDirectory();
+
+		/**
+		* Copyconstructor duplicating the descriptor.
+		* @param directory ProcDirectory to copy.
+		*/
+		ProcDirectory(const ProcDirectory& directory);
+
+		/**
+		* Assignment operator duplicating the descriptor.
+		* @param directory ProcDirectory to copy.
+		* @return ProcDirectory& This directory.
+		*/
+		ProcDirectory& operator=(const ProcDirectory& directory);
+
+		/**
+		* Destructor.
+		*/
+		~ProcDirectory();
+
+		/**
+		* Opens a directory.
+		* @param parent Descriptor path is relative to or AT_FDCWD.
+		* @param path The directory's path.
+		* @return bool false if it doesn't exist (anymore).
+		*/
+		bool open(int parent, const char* path);
+
+		/**
+		* Closes the directory.
+		*/
+		void close();
+
+		/**
+		* @return int The directory's descriptor, -1 if it isn't open.
+		*/
+		int getDescriptor() const;
+
+		/**
+		* Reads the next numeric entry.
+		* @return pid_t The entry's number, 0 if there are no more.
+		*/
+		pid_t next();
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		int descriptor_;
+
+		std::vector<char> buffer_;
+		size_t position_;
+		size_t size_;
+	};
+
+	/**
+	* SysObjectIterator backend listing the processes in /proc
+	*/
+	class ProcessBackend
+	{
+	public:
+
+		typedef ProcEntry entry_type;
+
+		/**
+		* Opens /proc and reads its first process.
+		* @param pid Unused, all processes are listed.
+		* @param fields ProcEntryField flags of files to read per process.
+		* @return bool false if there are no processes.
+		*/
+		bool first(pid_t pid, int fields);
+
+		/**
+		* Like first(), but returns errors instead of throwing them.
+		* @param pid See first().
+		* @param fields See first().
+		* @param error Reference receiving the errno value, zero on success.
+		* @return bool false if there are no processes or on error.
+		*/
+		bool tryFirst(pid_t pid, int fields, errorcode_t& error);
+
+		/**
+		* Reads the next process.
+		* @return bool false if there are no more processes.
+		*/
+		bool next();
+
+		/**
+		* @return const ProcEntry& The current process.
+		*/
+		const ProcEntry& get() const;
+
+	private:
+		ProcDirectory processes_;
+		ProcEntry entry_;
+		int fields_;
+	};
+
+	/**
+	* SysObjectIterator backend listing the threads in /proc/pid/task, or
+	* the threads of all processes
+	*/
+	class ThreadBackend
+	{
+	public:
+
+		typedef ProcEntry entry_type;
+
+		/**
+		* Opens the task directory and reads its first thread.
+		* @param pid The process whose threads are listed, zero for all
+		* threads on the system.
+		* @param fields ProcEntryField flags of files to read per thread.
+		* @return bool false if there are no threads.
+		*/
+		bool first(pid_t pid, int fields);
+
+		/**
+		* Like first(), but returns errors instead of throwing them.
+		* @param pid See first().
+		* @param fields See first().
+		* @param error Reference receiving the errno value, zero on success.
+		* @return bool false if there are no threads or on error.
+		*/
+		bool tryFirst(pid_t pid, int fields, errorcode_t& error);
+
+		/**
+		* Reads the next thread.
+		* @return bool false if there are no more threads.
+		*/
+		bool next();
+
+		/**
+		* @return const ProcEntry& The current thread.
+		*/
+		const ProcEntry& get() const;
+
+	private:
+
+		/*
+		* Opens the task directory of the next process
+		*/
+		bool nextProcess_();
+
+		ProcDirectory processes_;
+		ProcDirectory threads_;
+		ProcEntry entry_;
+		int fields_;
+		bool allProcesses_;
+	};
+
+	/**
+	* SysObjectIterator backend listing the images in /proc/pid/maps.
+	* Only files and the vdso are listed, anonymous memory isn't.
+	*/
+	class MapsBackend
+	{
+	public:
+
+		typedef ModuleEntry entry_type;
+
+		/**
+		* Reads the maps and finds the first image.
+		* @param pid The process, zero for the calling process.
+		* @param fields Unused.
+		* @return bool false if there are no images.
+		*/
+		bool first(pid_t pid, int fields);
+
+		/**
+		* Like first(), but returns errors instead of throwing them.
+		* @param pid See first().
+		* @param fields See first().
+		* @param error Reference receiving the errno value, zero on success.
+		* @return bool false if there are no images or on error.
+		*/
+		bool tryFirst(pid_t pid, int fields, errorcode_t& error);
+
+		/**
+		* Finds the next image.
+		* @return bool false if there are no more images.
+		*/
+		bool next();
+
+		/**
+		* @return const ModuleEntry& The current image.
+		*/
+		const ModuleEntry& get() const;
+
+	private:
+		std::vector<char> maps_;
+		size_t position_;
+		ModuleEntry entry_;
+	};
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+#endif //SYNTHETIC_PROCFSITERATOR_HPP
+
+/******************
+******* EOF *******
+******************/
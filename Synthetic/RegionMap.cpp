@@ -0,0 +1,471 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//Synthetic header files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <Windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <unistd.h>
+	#include <errno.h>
+	#include <stdio.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+
+//Synthetic header files:
+#include "RegionMap.hpp"
+#include "PageMap.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	//ReadProcessMemory() doesn't tell reliably how far it got, failing
+	//reads have to be split to find the page at fault
+	const bool REPORTS_FAULT = false;
+
+	/*
+	* MemoryProtection flags of a page protection
+	*/
+	int toProtection(DWORD protect)
+	{
+		switch(protect & 0xFF)
+		{
+		case PAGE_READONLY:
+			return PROTECTION_READ;
+		case PAGE_READWRITE:
+		case PAGE_WRITECOPY:
+			return PROTECTION_READ | PROTECTION_WRITE;
+		case PAGE_EXECUTE:
+			return PROTECTION_EXECUTE;
+		case PAGE_EXECUTE_READ:
+			return PROTECTION_READ | PROTECTION_EXECUTE;
+		case PAGE_EXECUTE_READWRITE:
+		case PAGE_EXECUTE_WRITECOPY:
+			return PROTECTION_READ | PROTECTION_WRITE | PROTECTION_EXECUTE;
+		default:
+			return PROTECTION_NONE;
+		}
+	}
+
+	/*
+	* Whether a read failed because of the memory rather than the process
+	*/
+	bool isFault(errorcode_t error)
+	{
+		return error == ERROR_PARTIAL_COPY || error == ERROR_NOACCESS;
+	}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	//process_vm_readv() stops right before the first page it can't read
+	const bool REPORTS_FAULT = true;
+
+	bool isFault(errorcode_t error)
+	{
+		return error == EFAULT;
+	}
+
+#endif
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+RegionMap::RegionMap(const Process& proc) : proc_(proc)
+{
+#if defined(SYNTHETIC_ISWINDOWS)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	pageSize_ = info.dwPageSize;
+#elif defined(SYNTHETIC_ISLINUX)
+	pageSize_ = sysconf(_SC_PAGESIZE);
+#endif
+
+	refresh();
+}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+void RegionMap::refresh()
+{
+	regions_.clear();
+	badPages_.clear();
+
+	MEMORY_BASIC_INFORMATION info;
+	ptr_t address = 0;
+	while(VirtualQueryEx(	proc_.getHandle(),
+									reinterpret_cast<const void*>(address),
+									&info,
+									sizeof(info)) == sizeof(info))
+	{
+		if(info.State == MEM_COMMIT)
+		{
+			MemoryRegion region;
+			region.address = reinterpret_cast<ptr_t>(info.BaseAddress);
+			region.size = info.RegionSize;
+			region.protection = toProtection(info.Protect);
+			region.type =	(info.Type == MEM_IMAGE) ? REGION_IMAGE :
+								(info.Type == MEM_MAPPED) ? REGION_MAPPED : REGION_PRIVATE;
+			region.guarded = (info.Protect & PAGE_GUARD) != 0;
+			regions_.push_back(region);
+		}
+
+		const ptr_t next = reinterpret_cast<ptr_t>(info.BaseAddress) + info.RegionSize;
+		if(next <= address)
+			break;
+
+		address = next;
+	}
+
+	if(regions_.empty())
+		throw WinException("RegionMap::refresh()", "VirtualQueryEx()", GetLastError());
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+void RegionMap::refresh()
+{
+	regions_.clear();
+	badPages_.clear();
+
+	char path[32];
+	sprintf(path, "/proc/%d/maps", static_cast<int>(proc_.getId()));
+
+	FILE* maps = fopen(path, "r");
+	if(!maps)
+		throw PosixException("RegionMap::refresh()", "fopen()", errno);
+
+	//begin-end perms offset dev inode path
+	char line[512];
+	while(fgets(line, sizeof(line), maps))
+	{
+		const size_t length = strlen(line);
+		const bool complete = length && line[length - 1] == '\n';
+
+		unsigned long long begin, end;
+		char perms[5];
+		int pathStart = 0;
+		if(sscanf(line, "%llx-%llx %4s %*s %*s %*s %n", &begin, &end, perms, &pathStart) >= 3)
+		{
+			MemoryRegion region;
+			region.address = static_cast<ptr_t>(begin);
+			region.size = static_cast<size_t>(end - begin);
+			region.protection =	(perms[0] == 'r' ? PROTECTION_READ : 0) |
+										(perms[1] == 'w' ? PROTECTION_WRITE : 0) |
+										(perms[2] == 'x' ? PROTECTION_EXECUTE : 0);
+
+			//Files are images, pseudo paths like [heap] and anonymous
+			//memory are private unless shared
+			const char* name = line + pathStart;
+			if(pathStart && *name == '/')
+				region.type = REGION_IMAGE;
+			else
+				region.type = (perms[3] == 's') ? REGION_MAPPED : REGION_PRIVATE;
+
+			region.guarded = false;
+			regions_.push_back(region);
+		}
+
+		//Skip the rest of paths too long for the buffer
+		while(!complete && fgets(line, sizeof(line), maps))
+		{
+			const size_t rest = strlen(line);
+			if(rest && line[rest - 1] == '\n')
+				break;
+		}
+	}
+
+	fclose(maps);
+}
+
+#endif
+
+const vector<MemoryRegion>& RegionMap::regions() const
+{
+	return regions_;
+}
+
+const MemoryRegion* RegionMap::find(ptr_t address) const
+{
+	const size_t first = upperBound_(address);
+	if(!first)
+		return NULL;
+
+	const MemoryRegion& region = regions_[first - 1];
+	return (address - region.address < region.size) ? &region : NULL;
+}
+
+size_t RegionMap::getPageSize() const
+{
+	return pageSize_;
+}
+
+size_t RegionMap::getRanges(	ptr_t address,
+										size_t size,
+										int protection,
+										Residency residency,
+										vector<MemoryRange>& dest) const
+{
+	const ptr_t end = (address + size < address) ? ~static_cast<ptr_t>(0) : address + size;
+	const size_t firstRange = dest.size();
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	residency = RESIDENCY_ANY;
+#elif defined(SYNTHETIC_ISLINUX)
+	if(residency != RESIDENCY_ANY && !pageMap_)
+		pageMap_.reset(new PageMap(proc_));
+#endif
+
+	vector<MemoryRange> deferred;
+	size_t found = 0;
+	for(size_t i = firstRegion_(address); i < regions_.size() && regions_[i].address < end; ++i)
+	{
+		const MemoryRegion& region = regions_[i];
+		if(!isReadable_(region) || (region.protection & protection) != protection)
+			continue;
+
+		const ptr_t begin = max(region.address, address);
+		const ptr_t stop = min(region.address + region.size, end);
+
+	#if defined(SYNTHETIC_ISLINUX)
+		if(residency == RESIDENCY_RESIDENT)
+		{
+			found += pageMap_->getRanges(begin, stop - begin, PageMap::PRESENT, dest);
+			continue;
+		}
+		else if(residency == RESIDENCY_DEFERRED)
+		{
+			//Only untouched anonymous pages are known to be zero, sizes are
+			//summed once resident and deferred ranges are joined
+			pageMap_->getResidentRanges(begin, stop - begin, dest, deferred, region.type != REGION_PRIVATE);
+			continue;
+		}
+	#endif
+
+		//Touching regions are merged
+		if(	dest.size() > firstRange &&
+			dest.back().address + dest.back().size == begin)
+		{
+			dest.back().size += static_cast<size_t>(stop - begin);
+		}
+		else
+		{
+			MemoryRange range = { begin, static_cast<size_t>(stop - begin) };
+			dest.push_back(range);
+		}
+
+		found += stop - begin;
+	}
+
+#if defined(SYNTHETIC_ISLINUX)
+	if(residency == RESIDENCY_DEFERRED)
+	{
+		PageMap::joinDeferred(dest, firstRange, deferred);
+		dest.insert(dest.end(), deferred.begin(), deferred.end());
+
+		for(size_t i = firstRange; i < dest.size(); ++i)
+			found += dest[i].size;
+	}
+#endif
+
+	return found;
+}
+
+size_t RegionMap::getRanges(	int protection,
+										Residency residency,
+										vector<MemoryRange>& dest) const
+{
+	return getRanges(0, ~static_cast<size_t>(0), protection, residency, dest);
+}
+
+size_t RegionMap::readAvailable(	ptr_t address,
+											void* dest,
+											size_t size,
+											vector<MemoryRange>& ranges) const
+{
+	const ptr_t end = (address + size < address) ? ~static_cast<ptr_t>(0) : address + size;
+	const size_t firstRange = ranges.size();
+
+	size_t index = firstRegion_(address);
+
+	size_t bytesRead = 0;
+	while(index < regions_.size() && regions_[index].address < end)
+	{
+		if(!isReadable_(regions_[index]))
+		{
+			++index;
+			continue;
+		}
+
+		//Touching readable regions are read as one run
+		const ptr_t runBegin = max(regions_[index].address, address);
+		ptr_t runEnd = regions_[index].address + regions_[index].size;
+		while(	++index < regions_.size() &&
+					regions_[index].address == runEnd &&
+					runEnd < end &&
+					isReadable_(regions_[index]))
+		{
+			runEnd += regions_[index].size;
+		}
+
+		bytesRead += readRun_(	runBegin,
+										min(runEnd, end),
+										address,
+										static_cast<byte_t*>(dest),
+										ranges,
+										firstRange);
+	}
+
+	return bytesRead;
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+bool RegionMap::isReadable_(const MemoryRegion& region)
+{
+	return (region.protection & PROTECTION_READ) && !region.guarded;
+}
+
+size_t RegionMap::upperBound_(ptr_t address) const
+{
+	size_t first = 0;
+	size_t count = regions_.size();
+	while(count)
+	{
+		const size_t step = count / 2;
+		if(regions_[first + step].address <= address)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+
+	return first;
+}
+
+size_t RegionMap::firstRegion_(ptr_t address) const
+{
+	size_t index = upperBound_(address);
+	if(index && address - regions_[index - 1].address < regions_[index - 1].size)
+		--index;
+
+	return index;
+}
+
+size_t RegionMap::readRun_(	ptr_t begin,
+										ptr_t end,
+										ptr_t base,
+										byte_t* dest,
+										vector<MemoryRange>& ranges,
+										size_t firstRange) const
+{
+	size_t bytesRead = 0;
+	while(begin < end)
+	{
+		const ptr_t page = begin & ~static_cast<ptr_t>(pageSize_ - 1);
+
+		//Read up to the next bad page
+		set<ptr_t>::const_iterator bad = badPages_.lower_bound(page);
+		if(bad != badPages_.end() && *bad == page)
+		{
+			begin = page + pageSize_;
+			continue;
+		}
+
+		const ptr_t stop = (bad != badPages_.end() && *bad < end) ? *bad : end;
+
+		size_t amount;
+		errorcode_t error = proc_.tryRead(begin, dest + (begin - base), stop - begin, amount);
+		if(error && !isFault(error))
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			throw WinException("RegionMap::readAvailable()", "ReadProcessMemory()", error);
+		#elif defined(SYNTHETIC_ISLINUX)
+			throw PosixException("RegionMap::readAvailable()", "process_vm_readv()", error);
+		#endif
+		}
+
+		if(amount)
+		{
+			if(	ranges.size() > firstRange &&
+				ranges.back().address + ranges.back().size == begin)
+			{
+				ranges.back().size += amount;
+			}
+			else
+			{
+				MemoryRange range = { begin, amount };
+				ranges.push_back(range);
+			}
+
+			bytesRead += amount;
+			begin += amount;
+		}
+
+		if(begin == stop)
+			continue;
+
+		//The read failed somewhere in the pages left
+		const ptr_t failed = begin & ~static_cast<ptr_t>(pageSize_ - 1);
+		const size_t pages = static_cast<size_t>((stop - failed + pageSize_ - 1) / pageSize_);
+		if(REPORTS_FAULT || pages == 1)
+		{
+			badPages_.insert(failed);
+			begin = failed + pageSize_;
+			continue;
+		}
+
+		//Lower half first so the ranges stay sorted
+		const ptr_t middle = failed + (pages / 2) * pageSize_;
+		bytesRead += readRun_(begin, middle, base, dest, ranges, firstRange);
+		begin = middle;
+	}
+
+	return bytesRead;
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,250 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_REGIONMAP_HPP
+#define SYNTHETIC_PROCESS_REGIONMAP_HPP
+
+//C++ Header Files:
+#include <set>
+#include <vector>
+#include <memory>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	class PageMap;
+
+	//Enumerations
+
+	/**
+	* What a region of memory is backed by
+	*/
+	enum RegionType
+	{
+		REGION_PRIVATE,		//Anonymous memory, heaps and stacks
+		REGION_MAPPED,			//Mapped files and shared memory
+		REGION_IMAGE			//Executables, on Linux every file mapping
+	};
+
+	/**
+	* Which pages region enumeration and scans cover.\n
+	* Reading a page the process never touched or which is in swap makes
+	* it resident, growing the process' memory usage. Residency is read
+	* from /proc/pid/pagemap, on Windows every page counts as resident.\n
+	*/
+	enum Residency
+	{
+		RESIDENCY_ANY,			//Every page
+		RESIDENCY_RESIDENT,	//Pages in physical memory only
+		RESIDENCY_DEFERRED	//Resident pages, then the others after them
+	};
+
+	//Structures
+
+	/**
+	* A region of committed memory with the same attributes
+	*/
+	struct MemoryRegion
+	{
+		ptr_t address;
+		size_t size;
+		int protection;		//MemoryProtection flags
+		RegionType type;
+		bool guarded;			//Windows guard pages, never read
+	};
+
+	/**
+	* A range of memory which could be read
+	*/
+	struct MemoryRange
+	{
+		ptr_t address;
+		size_t size;
+	};
+
+	/**
+	* The committed regions of a process' memory.\n
+	* Reads through the map are split at the boundaries of unreadable
+	* regions up front, so every run of readable memory costs one read.
+	* Pages which fail although their region is readable (the process
+	* changed its memory since the last refresh) are remembered and not
+	* read again until the next refresh.\n
+	*/
+	class RegionMap
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Reads the regions of the process.
+		* @param proc The process. Has to be valid the whole lifetime.
+		*/
+		RegionMap(const Process& proc);
+
+		/**
+		* Reads the regions again and forgets pages which failed.
+		*/
+		void refresh();
+
+		/**
+		* @return const std::vector<MemoryRegion>& The regions sorted by
+		* address.
+		*/
+		const std::vector<MemoryRegion>& regions() const;
+
+		/**
+		* Searches the region containing an address.
+		* @param address The address.
+		* @return const MemoryRegion* The region or NULL if the address
+		* isn't committed.
+		*/
+		const MemoryRegion* find(ptr_t address) const;
+
+		/**
+		* @return size_t Size of a page.
+		*/
+		size_t getPageSize() const;
+
+		/**
+		* Collects the readable memory of a range.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param protection MemoryProtection flags a region needs to have
+		* all of.
+		* @param residency Which pages to include.
+		* @param dest Reference to a vector the ranges are appended to,
+		* sorted by address. With RESIDENCY_DEFERRED the ranges in swap or,
+		* except for anonymous memory, never touched follow the resident
+		* ones, sorted on their own. Resident pages touching them are
+		* deferred along with them, so nothing crossing both is split.
+		* @return size_t Number of bytes collected.
+		*/
+		size_t getRanges(	ptr_t address,
+									size_t size,
+									int protection,
+									Residency residency,
+									std::vector<MemoryRange>& dest) const;
+
+		/**
+		* Collects the readable memory of the whole process.
+		* @param protection MemoryProtection flags a region needs to have
+		* all of.
+		* @param residency Which pages to include.
+		* @param dest Reference to a vector the ranges are appended to.
+		* @return size_t Number of bytes collected.
+		*/
+		size_t getRanges(	int protection,
+									Residency residency,
+									std::vector<MemoryRange>& dest) const;
+
+		/**
+		* Reads as much of a range as possible.\n
+		* Bytes which couldn't be read are left untouched in dest.
+		* @param address Start of the range.
+		* @param dest Pointer to a buffer of at least size bytes.
+		* @param size Size of the range.
+		* @param ranges Reference to a vector the read ranges are appended to,
+		* sorted by address and merged where they touch.
+		* @return size_t Number of bytes read.
+		*/
+		size_t readAvailable(	ptr_t address,
+										void* dest,
+										size_t size,
+										std::vector<MemoryRange>& ranges) const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Not copyable
+		*/
+		RegionMap(const RegionMap&);
+		RegionMap& operator=(const RegionMap&);
+
+		/*
+		* Whether a region is worth reading at all
+		*/
+		static bool isReadable_(const MemoryRegion& region);
+
+		/*
+		* Index of the first region starting behind an address
+		*/
+		size_t upperBound_(ptr_t address) const;
+
+		/*
+		* Index of the first region ending behind an address
+		*/
+		size_t firstRegion_(ptr_t address) const;
+
+		/*
+		* Reads a range of readable regions around the known bad pages.
+		* Failing reads are split until the page at fault is found.
+		*/
+		size_t readRun_(	ptr_t begin,
+								ptr_t end,
+								ptr_t base,
+								byte_t* dest,
+								std::vector<MemoryRange>& ranges,
+								size_t firstRange) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		std::vector<MemoryRegion> regions_;
+		size_t pageSize_;
+
+		//Pages which failed to be read since the last refresh
+		mutable std::set<ptr_t> badPages_;
+
+	#if defined(SYNTHETIC_ISLINUX)
+		//Opened by the first residency query
+		mutable std::shared_ptr<PageMap> pageMap_;
+	#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_REGIONMAP_HPP
+
+/******************
+******* EOF *******
+******************/
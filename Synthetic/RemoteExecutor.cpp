@@ -0,0 +1,427 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "RemoteExecutor.hpp"
+#include "ModuleManager.hpp"
+#include "ThreadManager.hpp"
+#include "Auxiliary.hpp"
+#include "WinException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+const size_t RemoteExecutor::MAX_BATCH;
+
+namespace
+{
+	//Layout of the worker's memory, all mailbox fields are qwords so both
+	//worker versions share it. The code comes first, the mailbox follows.
+	const size_t CODE_SIZE = 0x80;
+	const size_t MAILBOX_REQUESTEVENT = 0;
+	const size_t MAILBOX_DONEEVENT = 1;
+	const size_t MAILBOX_WAITFUNCTION = 2;
+	const size_t MAILBOX_SETEVENTFUNCTION = 3;
+	const size_t MAILBOX_COUNT = 4;
+	const size_t MAILBOX_QUIT = 5;
+	const size_t MAILBOX_CALLS = 6;
+
+	//Each call slot holds function, param and result
+	const size_t CALL_FIELDS = 3;
+
+	//Time the worker gets to return when stopping
+	const dword_t STOP_TIMEOUT = 5000;
+
+	/*
+	* Worker loop, receives the mailbox as thread parameter:
+	*	for(;;)
+	*	{
+	*		WaitForSingleObject(requestEvent, INFINITE);
+	*		if(quit) return 0;
+	*		for(i = 0; i < count; ++i)
+	*			calls[i].result = calls[i].function(calls[i].param);
+	*		SetEvent(doneEvent);
+	*	}
+	*/
+	#if defined(SYNTHETIC_ISX64)
+	const byte_t workerCode[] =
+	{
+		0x53,									//push rbx
+		0x56,									//push rsi
+		0x57,									//push rdi
+		0x48, 0x83, 0xEC, 0x20,					//sub rsp, 0x20
+		0x48, 0x89, 0xCB,						//mov rbx, rcx
+		0x48, 0x8B, 0x0B,						//mov rcx, qword ptr [rbx]
+		0xBA, 0xFF, 0xFF, 0xFF, 0xFF,			//mov edx, 0xffffffff
+		0xFF, 0x53, 0x10,						//call qword ptr [rbx+0x10]
+		0x48, 0x83, 0x7B, 0x28, 0x00,			//cmp qword ptr [rbx+0x28], 0x0
+		0x75, 0x28,								//jne 0x44 (return)
+		0x31, 0xF6,								//xor esi, esi
+		0x48, 0x8D, 0x7B, 0x30,					//lea rdi, [rbx+0x30]
+		0x48, 0x3B, 0x73, 0x20,					//cmp rsi, qword ptr [rbx+0x20]
+		0x73, 0x13,								//jae 0x3B (signal)
+		0x48, 0x8B, 0x4F, 0x08,					//mov rcx, qword ptr [rdi+0x8]
+		0xFF, 0x17,								//call qword ptr [rdi]
+		0x48, 0x89, 0x47, 0x10,					//mov qword ptr [rdi+0x10], rax
+		0x48, 0x83, 0xC7, 0x18,					//add rdi, 0x18
+		0x48, 0xFF, 0xC6,						//inc rsi
+		0xEB, 0xE7,								//jmp 0x22 (next call)
+		0x48, 0x8B, 0x4B, 0x08,					//mov rcx, qword ptr [rbx+0x8]
+		0xFF, 0x53, 0x18,						//call qword ptr [rbx+0x18]
+		0xEB, 0xC6,								//jmp 0x0A (wait)
+		0x31, 0xC0,								//xor eax, eax
+		0x48, 0x83, 0xC4, 0x20,					//add rsp, 0x20
+		0x5F,									//pop rdi
+		0x5E,									//pop rsi
+		0x5B,									//pop rbx
+		0xC3,									//ret
+	};
+	#else
+	//esp is restored after each call, so stdcall and cdecl work both
+	const byte_t workerCode[] =
+	{
+		0x53,									//push ebx
+		0x56,									//push esi
+		0x57,									//push edi
+		0x55,									//push ebp
+		0x8B, 0x5C, 0x24, 0x14,					//mov ebx, dword ptr [esp+0x14]
+		0x6A, 0xFF,								//push 0xffffffff
+		0xFF, 0x33,								//push dword ptr [ebx]
+		0xFF, 0x53, 0x10,						//call dword ptr [ebx+0x10]
+		0x83, 0x7B, 0x28, 0x00,					//cmp dword ptr [ebx+0x28], 0x0
+		0x75, 0x27,								//jne 0x3C (return)
+		0x31, 0xF6,								//xor esi, esi
+		0x8D, 0x7B, 0x30,						//lea edi, [ebx+0x30]
+		0x3B, 0x73, 0x20,						//cmp esi, dword ptr [ebx+0x20]
+		0x73, 0x15,								//jae 0x34 (signal)
+		0x89, 0xE5,								//mov ebp, esp
+		0xFF, 0x77, 0x08,						//push dword ptr [edi+0x8]
+		0xFF, 0x17,								//call dword ptr [edi]
+		0x89, 0xEC,								//mov esp, ebp
+		0x89, 0x47, 0x10,						//mov dword ptr [edi+0x10], eax
+		0x89, 0x57, 0x14,						//mov dword ptr [edi+0x14], edx
+		0x83, 0xC7, 0x18,						//add edi, 0x18
+		0x46,									//inc esi
+		0xEB, 0xE6,								//jmp 0x1A (next call)
+		0xFF, 0x73, 0x08,						//push dword ptr [ebx+0x8]
+		0xFF, 0x53, 0x18,						//call dword ptr [ebx+0x18]
+		0xEB, 0xCC,								//jmp 0x08 (wait)
+		0x31, 0xC0,								//xor eax, eax
+		0x5D,									//pop ebp
+		0x5F,									//pop edi
+		0x5E,									//pop esi
+		0x5B,									//pop ebx
+		0xC2, 0x04, 0x00,						//ret 0x4
+	};
+	#endif
+
+	/*
+	* Duplicates a local handle into another process
+	*/
+	HANDLE duplicateHandleRemote(HANDLE process, HANDLE source)
+	{
+		HANDLE dest;
+		BOOL ec = DuplicateHandle(	GetCurrentProcess(),
+											source,
+											process,
+											&dest,
+											0,
+											FALSE,
+											DUPLICATE_SAME_ACCESS);
+		if(!ec)
+		{
+			DWORD errorCode = GetLastError();
+			throw WinException(	"duplicateHandleRemote()",
+										"DuplicateHandle()",
+										errorCode);
+		}
+
+		return dest;
+	}
+
+	/*
+	* Closes a handle owned by another process
+	*/
+	void closeHandleRemote(HANDLE process, HANDLE& handle)
+	{
+		if(!handle)
+			return;
+
+		DuplicateHandle(	process,
+								handle,
+								NULL,
+								NULL,
+								0,
+								FALSE,
+								DUPLICATE_CLOSE_SOURCE);
+		handle = NULL;
+	}
+}
+
+RemoteExecutor::RemoteExecutor(Process& proc) :	proc_(proc),
+																allocator_(proc),
+																memory_(0),
+																remoteRequestEvent_(NULL),
+																remoteDoneEvent_(NULL)
+{
+	try
+	{
+		start_();
+	}
+	catch(...)
+	{
+		release_(worker_.isValid());
+		throw;
+	}
+}
+
+RemoteExecutor::~RemoteExecutor()
+{
+	try
+	{
+		stop();
+	}
+	catch(...)
+	{ }
+}
+
+qword_t RemoteExecutor::call(ptr_t function, ptr_t param)
+{
+	queue(function, param);
+
+	vector<qword_t> results;
+	flush(results);
+
+	return results.back();
+}
+
+void RemoteExecutor::queue(ptr_t function, ptr_t param)
+{
+	RemoteCall call;
+	call.function = function;
+	call.param = param;
+
+	queue_.push_back(call);
+}
+
+size_t RemoteExecutor::getQueueSize() const
+{
+	return queue_.size();
+}
+
+size_t RemoteExecutor::flush(vector<qword_t>& results)
+{
+	//Take the queue first, it must not be executed twice if a call fails
+	vector<RemoteCall> calls;
+	calls.swap(queue_);
+
+	return execute(calls, results);
+}
+
+size_t RemoteExecutor::execute(	const vector<RemoteCall>& calls,
+											vector<qword_t>& results)
+{
+	if(!isRunning())
+	{
+		throw runtime_error(	"RemoteExecutor::execute() Error : "\
+									"Worker thread is not running");
+	}
+
+	results.reserve(results.size() + calls.size());
+	for(size_t i = 0; i < calls.size(); i += MAX_BATCH)
+	{
+		executeBatch_(	&calls[i],
+							min<size_t>(MAX_BATCH, calls.size() - i),
+							results);
+	}
+
+	return calls.size();
+}
+
+void RemoteExecutor::stop()
+{
+	queue_.clear();
+	if(!isRunning())
+		return;
+
+	//Ask the worker to return unless it is gone already
+	bool exited = WaitForSingleObject(worker_, 0) == WAIT_OBJECT_0;
+	if(!exited)
+	{
+		const qword_t quit = 1;
+		proc_.rawWrite(	memory_ + CODE_SIZE + MAILBOX_QUIT * sizeof(qword_t),
+								&quit,
+								sizeof(quit));
+
+		if(!SetEvent(requestEvent_))
+		{
+			throw WinException(	"RemoteExecutor::stop()",
+										"SetEvent()",
+										GetLastError());
+		}
+
+		exited = WaitForSingleObject(worker_, STOP_TIMEOUT) == WAIT_OBJECT_0;
+	}
+
+	release_(exited);
+}
+
+bool RemoteExecutor::isRunning() const
+{
+	return worker_.isValid();
+}
+
+Process& RemoteExecutor::getProcess() const
+{
+	return proc_;
+}
+
+void RemoteExecutor::start_()
+{
+	//The worker only needs these two, resolve them in the target
+	ModuleManager modules(proc_);
+	Module kernel32 = modules.getModuleByName(L"kernel32.dll");
+	if(!kernel32.getBaseAddress())
+	{
+		throw runtime_error(	"RemoteExecutor::RemoteExecutor() Error : "\
+									"kernel32.dll is not loaded in remote process");
+	}
+
+	ptr_t waitFunction = modules.getModuleExportAddress(	kernel32,
+																			"WaitForSingleObject");
+	ptr_t setEventFunction = modules.getModuleExportAddress(	kernel32,
+																				"SetEvent");
+
+	//Auto-reset events, so no side has to reset them
+	requestEvent_ = CreateEventW(NULL, FALSE, FALSE, NULL);
+	doneEvent_ = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if(!requestEvent_ || !doneEvent_)
+	{
+		throw WinException(	"RemoteExecutor::RemoteExecutor()",
+									"CreateEventW()",
+									GetLastError());
+	}
+
+	remoteRequestEvent_ = duplicateHandleRemote(proc_.getHandle(), requestEvent_);
+	remoteDoneEvent_ = duplicateHandleRemote(proc_.getHandle(), doneEvent_);
+
+	//Code and mailbox header go into the target with one write
+	const size_t imageSize = CODE_SIZE / sizeof(qword_t) + MAILBOX_CALLS;
+	vector<qword_t> image(imageSize, 0);
+	memcpy(&image[0], workerCode, sizeof(workerCode));
+
+	qword_t* mailbox = &image[CODE_SIZE / sizeof(qword_t)];
+	mailbox[MAILBOX_REQUESTEVENT] = reinterpret_cast<ptr_t>(remoteRequestEvent_);
+	mailbox[MAILBOX_DONEEVENT] = reinterpret_cast<ptr_t>(remoteDoneEvent_);
+	mailbox[MAILBOX_WAITFUNCTION] = waitFunction;
+	mailbox[MAILBOX_SETEVENTFUNCTION] = setEventFunction;
+
+	memory_ = allocator_.allocate<qword_t>(imageSize + MAX_BATCH * CALL_FIELDS);
+	proc_.rawWrite(memory_, &image[0], image.size() * sizeof(qword_t));
+
+	//Start the worker, it blocks on the request event right away
+	ThreadManager threads(proc_);
+	Thread worker = threads.createThread(memory_, memory_ + CODE_SIZE);
+	worker_ = Aux::duplicateHandleLocal(worker.getHandle());
+}
+
+void RemoteExecutor::release_(bool workerExited)
+{
+	worker_.close();
+	closeHandleRemote(proc_.getHandle(), remoteRequestEvent_);
+	closeHandleRemote(proc_.getHandle(), remoteDoneEvent_);
+	requestEvent_.close();
+	doneEvent_.close();
+
+	//A worker which didn't return might still run inside the memory,
+	//leaking it is better than crashing the target
+	if(memory_ && workerExited)
+	{
+		try
+		{
+			allocator_.deallocate(memory_);
+		}
+		catch(...)
+		{ }
+	}
+
+	memory_ = 0;
+}
+
+void RemoteExecutor::executeBatch_(	const RemoteCall* calls,
+												size_t count,
+												vector<qword_t>& results)
+{
+	//Count, quit flag and calls are contiguous, post them with one write
+	const size_t callsIndex = MAILBOX_CALLS - MAILBOX_COUNT;
+	transfer_.assign(callsIndex + count * CALL_FIELDS, 0);
+	transfer_[0] = count;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		qword_t* slot = &transfer_[callsIndex + i * CALL_FIELDS];
+		slot[0] = calls[i].function;
+		slot[1] = calls[i].param;
+	}
+
+	proc_.rawWrite(	memory_ + CODE_SIZE + MAILBOX_COUNT * sizeof(qword_t),
+							&transfer_[0],
+							transfer_.size() * sizeof(qword_t));
+
+	if(!SetEvent(requestEvent_))
+	{
+		throw WinException(	"RemoteExecutor::execute()",
+									"SetEvent()",
+									GetLastError());
+	}
+
+	//Watch the worker too, a crashed or killed worker never signals
+	HANDLE objects[2] = { doneEvent_, worker_ };
+	DWORD ec = WaitForMultipleObjects(2, objects, FALSE, INFINITE);
+	if(ec == WAIT_OBJECT_0 + 1)
+	{
+		release_(true);
+		throw runtime_error(	"RemoteExecutor::execute() Error : "\
+									"Worker thread terminated");
+	}
+	else if(ec != WAIT_OBJECT_0)
+	{
+		throw WinException(	"RemoteExecutor::execute()",
+									"WaitForMultipleObjects()",
+									GetLastError());
+	}
+
+	//Results are interleaved with the calls, fetch the whole block
+	proc_.rawRead(	memory_ + CODE_SIZE + MAILBOX_CALLS * sizeof(qword_t),
+						&transfer_[callsIndex],
+						count * CALL_FIELDS * sizeof(qword_t));
+
+	for(size_t i = 0; i < count; ++i)
+		results.push_back(transfer_[callsIndex + i * CALL_FIELDS + 2]);
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,204 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_REMOTEEXECUTOR_HPP
+#define SYNTHETIC_PROCESS_REMOTEEXECUTOR_HPP
+
+//Windows Header Files:
+#include <Windows.h>
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Allocator.hpp"
+#include "SmartType.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A call to be executed by a RemoteExecutor.\n
+	* The function receives param as its only argument, just like a
+	* thread procedure.\n
+	*/
+	struct RemoteCall
+	{
+		ptr_t function;
+		ptr_t param;
+	};
+
+	/**
+	* Executes functions inside a remote process on one long-lived worker
+	* thread instead of creating a new thread per call.\n
+	* The worker waits on a mailbox in the target's memory and executes all
+	* calls posted to it in order. A batch of calls costs one write, one
+	* event round trip and one read, no matter how many calls it contains.\n
+	* Return values are full 64-bit values, on 32-bit targets the upper
+	* half is EDX and only meaningful for functions returning 64-bit values.\n
+	* Becomes invalid as soon as Process reference becomes invalid.\n
+	*/
+	class RemoteExecutor
+	{
+	public:
+
+		/**
+		* Maximum number of calls executed per mailbox round trip,
+		* larger batches are split.
+		*/
+		static const size_t MAX_BATCH = 256;
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructor.
+		* Sets up the mailbox and starts the worker thread in the target.
+		* @param proc A reference to a process object. Has to be valid the
+		* whole lifetime and needs to be opened with PROCESS_DUP_HANDLE.
+		*/
+		explicit RemoteExecutor(Process& proc);
+
+		/**
+		* Destructor.
+		* Calls stop().
+		*/
+		~RemoteExecutor();
+
+		/**
+		* Executes a single call and waits for its result.
+		* Calls queued before are executed first.
+		* @param function Address of the function in the target.
+		* @param param (optional) Value passed to the function.
+		* @return qword_t The function's return value.
+		*/
+		qword_t call(ptr_t function, ptr_t param = 0);
+
+		/**
+		* Queues a call without executing it.
+		* @param function Address of the function in the target.
+		* @param param (optional) Value passed to the function.
+		*/
+		void queue(ptr_t function, ptr_t param = 0);
+
+		/**
+		* Returns the number of queued calls.
+		* @return size_t Number of calls waiting for flush().
+		*/
+		size_t getQueueSize() const;
+
+		/**
+		* Executes all queued calls in order and empties the queue.
+		* @param results Reference to a vector receiving one return value
+		* per call.
+		* @return size_t Number of executed calls.
+		*/
+		size_t flush(std::vector<qword_t>& results);
+
+		/**
+		* Executes a batch of calls in order.
+		* @param calls The calls to execute.
+		* @param results Reference to a vector receiving one return value
+		* per call.
+		* @return size_t Number of executed calls.
+		*/
+		size_t execute(	const std::vector<RemoteCall>& calls,
+								std::vector<qword_t>& results);
+
+		/**
+		* Stops the worker thread and releases its memory.
+		* Queued calls are discarded.
+		*/
+		void stop();
+
+		/**
+		* Checks if the worker thread is running.
+		* @return bool true if calls can be executed.
+		*/
+		bool isRunning() const;
+
+		/**
+		* @return Process& The process the worker runs in.
+		*/
+		Process& getProcess() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Not copyable, there is only one worker
+		RemoteExecutor(const RemoteExecutor&);
+		RemoteExecutor& operator=(const RemoteExecutor&);
+
+		/*
+		* Writes code and mailbox into the target and starts the worker
+		*/
+		void start_();
+
+		/*
+		* Closes all handles and frees the memory if the worker has exited
+		*/
+		void release_(bool workerExited);
+
+		/*
+		* Posts up to MAX_BATCH calls to the mailbox and collects the results
+		*/
+		void executeBatch_(	const RemoteCall* calls,
+									size_t count,
+									std::vector<qword_t>& results);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		Process& proc_;
+		DefaultAllocator allocator_;
+		ptr_t memory_;
+
+		SmartHandle requestEvent_;
+		SmartHandle doneEvent_;
+		SmartHandle worker_;
+		HANDLE remoteRequestEvent_;
+		HANDLE remoteDoneEvent_;
+
+		std::vector<RemoteCall> queue_;
+		std::vector<qword_t> transfer_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_REMOTEEXECUTOR_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,207 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//Synthetic header files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	//C header files:
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+
+//Synthetic header files:
+#include "RemoteFunction.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//The arena grows in whole pages
+	const size_t ARENA_GRANULARITY = 0x1000;
+
+	//Result slot first, argument data after it, the thunk last
+	const size_t DATA_OFFSET = 0x10;
+
+#if defined(SYNTHETIC_ISLINUX)
+	//mmap takes the offset in pages on 32 bit, it's zero anyway
+	#if defined(SYS_mmap2)
+		const long MMAP_NUMBER = SYS_mmap2;
+	#else
+		const long MMAP_NUMBER = SYS_mmap;
+	#endif
+#endif
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+RemoteFunction::RemoteFunction(	RemoteExecutor& executor,
+											ptr_t address,
+											CallingConvention convention) :	executor_(executor),
+																						allocator_(executor.getProcess()),
+																						arena_(0),
+																						arenaSize_(0),
+																						address_(address),
+																						convention_(convention)
+{ }
+#elif defined(SYNTHETIC_ISLINUX)
+RemoteFunction::RemoteFunction(	RemoteSyscall& executor,
+											ptr_t address,
+											CallingConvention convention) :	executor_(executor),
+																						arena_(0),
+																						arenaSize_(0),
+																						address_(address),
+																						convention_(convention)
+{ }
+#endif
+
+RemoteFunction::~RemoteFunction()
+{
+	if(arena_)
+	{
+		try
+		{
+		#if defined(SYNTHETIC_ISWINDOWS)
+			allocator_.deallocate(arena_);
+		#elif defined(SYNTHETIC_ISLINUX)
+			executor_.execute(SYS_munmap, arena_, arenaSize_);
+		#endif
+		}
+		catch(...)
+		{ }
+	}
+}
+
+CallResult RemoteFunction::invoke(const CallArguments& args, ResultType resultType)
+{
+	const vector<byte_t>& data = args.getData();
+	const size_t codeOffset = DATA_OFFSET + data.size();
+
+	image_.assign(codeOffset, 0);
+	if(!data.empty())
+		memcpy(&image_[DATA_OFFSET], &data[0], data.size());
+
+	CallThunk::generate(	convention_,
+								address_,
+								args,
+								arena_ + DATA_OFFSET,
+								arena_,
+								resultType,
+								image_);
+
+	//The thunk's size doesn't depend on the addresses baked into it,
+	//so it only has to be generated again if the arena moved
+	if(reserve_(image_.size()))
+	{
+		image_.resize(codeOffset);
+		CallThunk::generate(	convention_,
+									address_,
+									args,
+									arena_ + DATA_OFFSET,
+									arena_,
+									resultType,
+									image_);
+	}
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	Process& proc = executor_.getProcess();
+#elif defined(SYNTHETIC_ISLINUX)
+	const Process& proc = executor_.getProcess();
+#endif
+	proc.rawWrite(arena_, &image_[0], image_.size());
+
+	executor_.call(arena_ + codeOffset, arena_);
+
+	CallResult result;
+	proc.rawRead(arena_, &result, sizeof(result));
+
+	return result;
+}
+
+ptr_t RemoteFunction::getAddress() const
+{
+	return address_;
+}
+
+CallingConvention RemoteFunction::getConvention() const
+{
+	return convention_;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+bool RemoteFunction::reserve_(size_t size)
+{
+	if(size <= arenaSize_)
+		return false;
+
+	size_t newSize = max<size_t>(arenaSize_ * 2, size);
+	newSize = (newSize + ARENA_GRANULARITY - 1) & ~(ARENA_GRANULARITY - 1);
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	ptr_t newArena = allocator_.allocate<byte_t>(newSize);
+	if(arena_)
+		allocator_.deallocate(arena_);
+#elif defined(SYNTHETIC_ISLINUX)
+	//Mapped by the executor's thread itself, an Allocator would stop it
+	//a second time
+	const qword_t mapped = executor_.execute(	MMAP_NUMBER,
+															0,
+															newSize,
+															PROT_READ | PROT_WRITE | PROT_EXEC,
+															MAP_PRIVATE | MAP_ANONYMOUS,
+															static_cast<ptr_t>(-1),
+															0);
+
+	const int error = RemoteSyscall::getError(mapped);
+	if(error)
+		throw PosixException("RemoteFunction::reserve_()", "mmap()", error);
+
+	ptr_t newArena = static_cast<ptr_t>(mapped);
+	if(arena_)
+		executor_.execute(SYS_munmap, arena_, arenaSize_);
+#endif
+
+	arena_ = newArena;
+	arenaSize_ = newSize;
+	return true;
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,193 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_REMOTEFUNCTION_HPP
+#define SYNTHETIC_PROCESS_REMOTEFUNCTION_HPP
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "CallThunk.hpp"
+#include "Types.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "RemoteExecutor.hpp"
+	#include "Allocator.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "RemoteSyscall.hpp"
+#endif
+
+namespace Synthetic
+{
+	/**
+	* Calling convention of the platform's C functions
+	*/
+	#if defined(SYNTHETIC_ISWINDOWS) && defined(SYNTHETIC_ISX64)
+		const CallingConvention NATIVE_CONVENTION = WIN64_CONVENTION;
+	#elif defined(SYNTHETIC_ISWINDOWS)
+		const CallingConvention NATIVE_CONVENTION = STDCALL_CONVENTION;
+	#elif defined(SYNTHETIC_ISX64)
+		const CallingConvention NATIVE_CONVENTION = SYSV_CONVENTION;
+	#else
+		const CallingConvention NATIVE_CONVENTION = CDECL_CONVENTION;
+	#endif
+
+	/**
+	* A function inside a remote process which can be called with any
+	* number of typed arguments.\n
+	* Each call writes thunk, result slot and argument data into one arena
+	* with a single write, runs the thunk and reads back the result. On
+	* Windows the thunk runs on the executor's worker, on Linux on the
+	* thread hijacked by a RemoteSyscall, with the restrictions of
+	* RemoteSyscall::call().\n
+	* Becomes invalid as soon as the executor becomes invalid.\n
+	*/
+	class RemoteFunction
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+		/**
+		* Constructor.
+		* @param executor The executor which runs the calls. Has to be valid
+		* the whole lifetime.
+		* @param address Address of the function in the target.
+		* @param convention (optional) The function's calling convention.
+		*/
+		RemoteFunction(	RemoteExecutor& executor,
+								ptr_t address,
+								CallingConvention convention = NATIVE_CONVENTION);
+#elif defined(SYNTHETIC_ISLINUX)
+		/**
+		* Constructor.
+		* @param executor The RemoteSyscall whose thread runs the calls. Has
+		* to be valid the whole lifetime. If it's stopped, calls share its
+		* stop.
+		* @param address Address of the function in the target.
+		* @param convention (optional) The function's calling convention.
+		*/
+		RemoteFunction(	RemoteSyscall& executor,
+								ptr_t address,
+								CallingConvention convention = NATIVE_CONVENTION);
+#endif
+
+		/**
+		* Destructor.
+		* Frees the arena.
+		*/
+		~RemoteFunction();
+
+		/**
+		* Calls the function.
+		* @param args The arguments.
+		* @param resultType (optional) Register holding the return value.
+		* @return CallResult The raw return registers.
+		*/
+		CallResult invoke(	const CallArguments& args,
+									ResultType resultType = RESULT_INTEGER);
+
+		/**
+		* Calls the function and converts its return value.
+		* @param args The arguments.
+		* @return result_t The return value.
+		*/
+		template<typename result_t>
+		result_t call(const CallArguments& args)
+		{
+			CallResult result = invoke(args, CallThunk::getResultType<result_t>());
+			return CallThunk::convertResult<result_t>(result);
+		}
+
+		/**
+		* Calls the function without arguments and converts its return value.
+		* @return result_t The return value.
+		*/
+		template<typename result_t>
+		result_t call()
+		{
+			return call<result_t>(CallArguments());
+		}
+
+		/**
+		* @return ptr_t Address of the function in the target.
+		*/
+		ptr_t getAddress() const;
+
+		/**
+		* @return CallingConvention The function's calling convention.
+		*/
+		CallingConvention getConvention() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Not copyable, the arena is owned
+		RemoteFunction(const RemoteFunction&);
+		RemoteFunction& operator=(const RemoteFunction&);
+
+		/*
+		* Makes sure the arena can hold size bytes, returns true if it moved
+		*/
+		bool reserve_(size_t size);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+		RemoteExecutor& executor_;
+		DefaultAllocator allocator_;
+#elif defined(SYNTHETIC_ISLINUX)
+		RemoteSyscall& executor_;
+#endif
+		ptr_t arena_;
+		size_t arenaSize_;
+
+		ptr_t address_;
+		CallingConvention convention_;
+
+		std::vector<byte_t> image_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_REMOTEFUNCTION_HPP
+
+/******************
+******* EOF *******
+******************/
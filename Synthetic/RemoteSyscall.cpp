@@ -0,0 +1,576 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <elf.h>
+#include <signal.h>
+#include <errno.h>
+
+//C++ header files:
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "RemoteSyscall.hpp"
+#include "PosixException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//The instruction entering the kernel
+	#if defined(SYNTHETIC_ISX64)
+		const byte_t syscallInstruction[] = { 0x0F, 0x05 };	//syscall
+	#else
+		const byte_t syscallInstruction[] = { 0xCD, 0x80 };	//int 0x80
+	#endif
+
+	//Executable mappings are searched in blocks of this size
+	const size_t SEARCH_BLOCK_SIZE = 0x10000;
+
+	//Errors are returned as -1 to -4095
+	const long MAX_ERRNO = 4095;
+
+	//Called functions return here, the fault tells they're done
+	const ptr_t RETURN_ADDRESS = 0;
+
+	//Leaf functions may use this much below the stack pointer
+	#if defined(SYNTHETIC_ISX64)
+		const ptr_t RED_ZONE_SIZE = 128;
+	#else
+		const ptr_t RED_ZONE_SIZE = 0;
+	#endif
+
+	const ptr_t STACK_ALIGNMENT = 16;
+
+	//Large enough for the XSAVE area of current processors
+	const size_t MAX_EXTENDED_STATE_SIZE = 0x4000;
+
+	struct Mapping
+	{
+		ptr_t begin;
+		ptr_t end;
+	};
+}
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+int RemoteSyscall::getError(qword_t result)
+{
+	long value = static_cast<long>(static_cast<ptr_t>(result));
+
+	return (value < 0 && value >= -MAX_ERRNO) ? static_cast<int>(-value) : 0;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+RemoteSyscall::RemoteSyscall(const Process& proc, tid_t thread) :	proc_(proc),
+																						thread_(thread),
+																						stopped_(false),
+																						pendingSignal_(0),
+																						extendedStateType_(0),
+																						stackTop_(0),
+																						syscallAddress_(0)
+{
+	if(!thread_)
+		thread_ = proc_.getId();
+
+	memset(&savedRegisters_, 0, sizeof(savedRegisters_));
+}
+
+RemoteSyscall::~RemoteSyscall()
+{
+	try
+	{
+		resume();
+	}
+	catch(...)
+	{ }
+}
+
+void RemoteSyscall::stop()
+{
+	if(stopped_)
+		return;
+
+	//Seizing doesn't send SIGSTOP, nothing of it is visible to the target
+	if(ptrace(PTRACE_SEIZE, thread_, 0, 0) == -1)
+		throw PosixException("RemoteSyscall::stop()", "ptrace(PTRACE_SEIZE)", errno);
+
+	stopped_ = true;
+	pendingSignal_ = 0;
+
+	try
+	{
+		if(ptrace(PTRACE_INTERRUPT, thread_, 0, 0) == -1)
+			throw PosixException("RemoteSyscall::stop()", "ptrace(PTRACE_INTERRUPT)", errno);
+
+		wait_();
+
+		if(ptrace(PTRACE_GETREGS, thread_, 0, &savedRegisters_) == -1)
+			throw PosixException("RemoteSyscall::stop()", "ptrace(PTRACE_GETREGS)", errno);
+
+		extendedStateType_ = 0;
+		#if defined(SYNTHETIC_ISX64)
+			stackTop_ = savedRegisters_.rsp - RED_ZONE_SIZE;
+		#else
+			stackTop_ = savedRegisters_.esp - RED_ZONE_SIZE;
+		#endif
+	}
+	catch(...)
+	{
+		if(stopped_)
+		{
+			ptrace(PTRACE_DETACH, thread_, 0, pendingSignal_);
+			stopped_ = false;
+		}
+
+		throw;
+	}
+}
+
+void RemoteSyscall::resume()
+{
+	if(!stopped_)
+		return;
+
+	stopped_ = false;
+
+	if(extendedStateType_)
+	{
+		iovec state = { &savedExtendedState_[0], savedExtendedState_.size() };
+		if(ptrace(PTRACE_SETREGSET, thread_, extendedStateType_, &state) == -1)
+		{
+			int error = errno;
+			ptrace(PTRACE_SETREGS, thread_, 0, &savedRegisters_);
+			ptrace(PTRACE_DETACH, thread_, 0, pendingSignal_);
+			throw PosixException("RemoteSyscall::resume()", "ptrace(PTRACE_SETREGSET)", error);
+		}
+	}
+
+	//Restoring everything, including orig_rax, lets an interrupted system
+	//call restart like after any other signal
+	if(ptrace(PTRACE_SETREGS, thread_, 0, &savedRegisters_) == -1)
+	{
+		int error = errno;
+		ptrace(PTRACE_DETACH, thread_, 0, pendingSignal_);
+		throw PosixException("RemoteSyscall::resume()", "ptrace(PTRACE_SETREGS)", error);
+	}
+
+	if(ptrace(PTRACE_DETACH, thread_, 0, pendingSignal_) == -1)
+		throw PosixException("RemoteSyscall::resume()", "ptrace(PTRACE_DETACH)", errno);
+}
+
+bool RemoteSyscall::isStopped() const
+{
+	return stopped_;
+}
+
+const Process& RemoteSyscall::getProcess() const
+{
+	return proc_;
+}
+
+qword_t RemoteSyscall::execute(	long number,
+											ptr_t a0,
+											ptr_t a1,
+											ptr_t a2,
+											ptr_t a3,
+											ptr_t a4,
+											ptr_t a5)
+{
+	SyscallRequest request = { number, { a0, a1, a2, a3, a4, a5 } };
+
+	vector<SyscallRequest> requests(1, request);
+	vector<qword_t> results;
+	execute(requests, results);
+
+	return results.front();
+}
+
+size_t RemoteSyscall::execute(	const vector<SyscallRequest>& requests,
+											vector<qword_t>& results)
+{
+	//Look for the instruction first, nothing to undo if there is none.
+	//Function calls don't need it.
+	if(!syscallAddress_)
+		syscallAddress_ = findSyscallInstruction_();
+
+	//Calls made while stopped by the caller share that stop
+	const bool wasStopped = stopped_;
+	if(!wasStopped)
+		stop();
+
+	try
+	{
+		results.reserve(results.size() + requests.size());
+		for(vector<SyscallRequest>::const_iterator i = requests.begin();
+			i != requests.end();
+			++i)
+		{
+			results.push_back(step_(*i));
+		}
+	}
+	catch(...)
+	{
+		if(!wasStopped)
+		{
+			try
+			{
+				resume();
+			}
+			catch(...)
+			{ }
+		}
+
+		throw;
+	}
+
+	if(!wasStopped)
+		resume();
+
+	return requests.size();
+}
+
+qword_t RemoteSyscall::call(	ptr_t function,
+										ptr_t a0,
+										ptr_t a1,
+										ptr_t a2,
+										ptr_t a3,
+										ptr_t a4,
+										ptr_t a5)
+{
+	const bool wasStopped = stopped_;
+	if(!wasStopped)
+		stop();
+
+	qword_t result;
+	try
+	{
+		saveExtendedState_();
+
+		user_regs_struct registers = savedRegisters_;
+
+		//The return address is pushed like a call instruction would, the
+		//stack is aligned at the call
+		#if defined(SYNTHETIC_ISX64)
+			ptr_t stack = (stackTop_ & ~(STACK_ALIGNMENT - 1)) - sizeof(ptr_t);
+			proc_.writeMemory<ptr_t>(stack, RETURN_ADDRESS);
+
+			registers.rip = function;
+			registers.rsp = stack;
+			registers.rax = 0;
+			registers.orig_rax = -1;
+			registers.rdi = a0;
+			registers.rsi = a1;
+			registers.rdx = a2;
+			registers.rcx = a3;
+			registers.r8 = a4;
+			registers.r9 = a5;
+		#else
+			const ptr_t frame[] = { RETURN_ADDRESS, a0, a1, a2, a3, a4, a5 };
+			ptr_t stack = ((stackTop_ - sizeof(frame) + sizeof(ptr_t)) & ~(STACK_ALIGNMENT - 1)) - sizeof(ptr_t);
+			proc_.rawWrite(stack, frame, sizeof(frame));
+
+			registers.eip = function;
+			registers.esp = stack;
+			registers.orig_eax = -1;
+		#endif
+
+		if(ptrace(PTRACE_SETREGS, thread_, 0, &registers) == -1)
+			throw PosixException("RemoteSyscall::call()", "ptrace(PTRACE_SETREGS)", errno);
+
+		//Run until the function returns, signals arriving meanwhile are
+		//handed over on resume
+		for(;;)
+		{
+			const int pendingSignal = pendingSignal_;
+
+			if(ptrace(PTRACE_CONT, thread_, 0, 0) == -1)
+				throw PosixException("RemoteSyscall::call()", "ptrace(PTRACE_CONT)", errno);
+
+			const int status = wait_();
+			if((status >> 16) != 0)
+				continue;
+
+			const int signal = WSTOPSIG(status);
+			if(signal != SIGSEGV && signal != SIGBUS && signal != SIGILL && signal != SIGFPE)
+				continue;
+
+			//A fault is never handed over, the thread continues where it
+			//was stopped
+			pendingSignal_ = pendingSignal;
+
+			if(ptrace(PTRACE_GETREGS, thread_, 0, &registers) == -1)
+				throw PosixException("RemoteSyscall::call()", "ptrace(PTRACE_GETREGS)", errno);
+
+			#if defined(SYNTHETIC_ISX64)
+				if(signal != SIGSEGV || registers.rip != RETURN_ADDRESS)
+					throw runtime_error("RemoteSyscall::call() Error : Function crashed");
+
+				result = registers.rax;
+			#else
+				if(signal != SIGSEGV || registers.eip != RETURN_ADDRESS)
+					throw runtime_error("RemoteSyscall::call() Error : Function crashed");
+
+				result = static_cast<ptr_t>(registers.eax);
+			#endif
+
+			break;
+		}
+	}
+	catch(...)
+	{
+		if(!wasStopped)
+		{
+			try
+			{
+				resume();
+			}
+			catch(...)
+			{ }
+		}
+
+		throw;
+	}
+
+	if(!wasStopped)
+		resume();
+
+	return result;
+}
+
+ptr_t RemoteSyscall::pushData(const void* data, size_t size)
+{
+	if(!stopped_)
+		throw runtime_error("RemoteSyscall::pushData() Error : Thread isn't stopped");
+
+	const ptr_t address = (stackTop_ - size) & ~(STACK_ALIGNMENT - 1);
+	proc_.rawWrite(address, static_cast<const byte_t*>(data), size);
+
+	stackTop_ = address;
+	return address;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+ptr_t RemoteSyscall::findSyscallInstruction_() const
+{
+	char path[32];
+	sprintf(path, "/proc/%d/maps", static_cast<int>(proc_.getId()));
+
+	FILE* maps = fopen(path, "r");
+	if(!maps)
+		throw PosixException("RemoteSyscall::execute()", "fopen()", errno);
+
+	//The vdso is small and always there, try it before everything else
+	vector<Mapping> mappings;
+	char line[512];
+	while(fgets(line, sizeof(line), maps))
+	{
+		unsigned long begin, end;
+		char permissions[5];
+		if(sscanf(line, "%lx-%lx %4s", &begin, &end, permissions) != 3)
+			continue;
+
+		if(permissions[0] != 'r' || permissions[2] != 'x')
+			continue;
+
+		Mapping mapping = { begin, end };
+		if(strstr(line, "[vdso]"))
+			mappings.insert(mappings.begin(), mapping);
+		else
+			mappings.push_back(mapping);
+	}
+
+	fclose(maps);
+
+	vector<byte_t> block(SEARCH_BLOCK_SIZE);
+	for(vector<Mapping>::iterator i = mappings.begin(); i != mappings.end(); ++i)
+	{
+		for(ptr_t address = i->begin; address < i->end; address += block.size() - 1)
+		{
+			size_t size = min<size_t>(block.size(), i->end - address);
+
+			try
+			{
+				proc_.rawRead(address, &block[0], size);
+			}
+			catch(const PosixException&)
+			{
+				break;
+			}
+
+			//Blocks overlap by one byte, so no instruction is missed
+			const byte_t* data = &block[0];
+			const byte_t* found = search(	data,
+													data + size,
+													syscallInstruction,
+													syscallInstruction + sizeof(syscallInstruction));
+
+			if(found != data + size)
+				return address + (found - data);
+		}
+	}
+
+	throw runtime_error(	"RemoteSyscall::execute() Error : "\
+								"No syscall instruction found in remote process");
+}
+
+qword_t RemoteSyscall::step_(const SyscallRequest& request)
+{
+	user_regs_struct registers = savedRegisters_;
+
+	//orig_ax = -1 keeps the kernel from treating the step as a restart of
+	//whatever call the thread was interrupted in
+	#if defined(SYNTHETIC_ISX64)
+		registers.rip = syscallAddress_;
+		registers.rax = request.number;
+		registers.orig_rax = -1;
+		registers.rdi = request.args[0];
+		registers.rsi = request.args[1];
+		registers.rdx = request.args[2];
+		registers.r10 = request.args[3];
+		registers.r8 = request.args[4];
+		registers.r9 = request.args[5];
+	#else
+		registers.eip = syscallAddress_;
+		registers.eax = request.number;
+		registers.orig_eax = -1;
+		registers.ebx = request.args[0];
+		registers.ecx = request.args[1];
+		registers.edx = request.args[2];
+		registers.esi = request.args[3];
+		registers.edi = request.args[4];
+		registers.ebp = request.args[5];
+	#endif
+
+	if(ptrace(PTRACE_SETREGS, thread_, 0, &registers) == -1)
+		throw PosixException("RemoteSyscall::execute()", "ptrace(PTRACE_SETREGS)", errno);
+
+	//Other stops may come first, repeat until the instruction was executed
+	ptr_t ip;
+	do
+	{
+		if(ptrace(PTRACE_SINGLESTEP, thread_, 0, 0) == -1)
+			throw PosixException("RemoteSyscall::execute()", "ptrace(PTRACE_SINGLESTEP)", errno);
+
+		wait_();
+
+		if(ptrace(PTRACE_GETREGS, thread_, 0, &registers) == -1)
+			throw PosixException("RemoteSyscall::execute()", "ptrace(PTRACE_GETREGS)", errno);
+
+		#if defined(SYNTHETIC_ISX64)
+			ip = registers.rip;
+		#else
+			ip = registers.eip;
+		#endif
+	} while(ip == syscallAddress_);
+
+	#if defined(SYNTHETIC_ISX64)
+		return registers.rax;
+	#else
+		return static_cast<ptr_t>(registers.eax);
+	#endif
+}
+
+void RemoteSyscall::saveExtendedState_()
+{
+	if(extendedStateType_)
+		return;
+
+	//XSAVE covers the vector registers, kernels or processors without it
+	//still provide the FXSAVE area
+	savedExtendedState_.resize(MAX_EXTENDED_STATE_SIZE);
+
+	iovec state = { &savedExtendedState_[0], savedExtendedState_.size() };
+	int type = NT_X86_XSTATE;
+	if(ptrace(PTRACE_GETREGSET, thread_, type, &state) == -1)
+	{
+		type = NT_PRFPREG;
+		state.iov_len = savedExtendedState_.size();
+		if(ptrace(PTRACE_GETREGSET, thread_, type, &state) == -1)
+			throw PosixException("RemoteSyscall::call()", "ptrace(PTRACE_GETREGSET)", errno);
+	}
+
+	savedExtendedState_.resize(state.iov_len);
+	extendedStateType_ = type;
+}
+
+int RemoteSyscall::wait_()
+{
+	for(;;)
+	{
+		int status;
+		if(waitpid(thread_, &status, __WALL) == -1)
+		{
+			if(errno == EINTR)
+				continue;
+
+			throw PosixException("RemoteSyscall::wait_()", "waitpid()", errno);
+		}
+
+		if(WIFEXITED(status) || WIFSIGNALED(status))
+		{
+			stopped_ = false;
+			throw runtime_error(	"RemoteSyscall::wait_() Error : "\
+										"Thread exited while being stopped");
+		}
+
+		if(!WIFSTOPPED(status))
+			continue;
+
+		//A signal-delivery-stop, the signal is suppressed by continuing
+		//without it. Hand it over again when resuming.
+		int signal = WSTOPSIG(status);
+		if((status >> 16) == 0 && signal != SIGTRAP)
+			pendingSignal_ = signal;
+
+		return status;
+	}
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+/******************
+******* EOF *******
+******************/
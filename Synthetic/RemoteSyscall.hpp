@@ -0,0 +1,243 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_REMOTESYSCALL_HPP
+#define SYNTHETIC_PROCESS_REMOTESYSCALL_HPP
+
+//Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISLINUX)
+
+//C Header Files:
+#include <sys/user.h>
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A system call to be executed by RemoteSyscall
+	*/
+	struct SyscallRequest
+	{
+		long number;
+		ptr_t args[6];
+	};
+
+	/**
+	* Executes system calls inside a Linux process.\n
+	* A thread of the target gets stopped with ptrace, its registers are
+	* pointed at a syscall instruction found in the target's code and it
+	* is single-stepped once per call. Afterwards the original registers
+	* are restored exactly and the thread continues as if nothing
+	* happened.\n
+	* Stopping and restoring is the expensive part, so calls should be
+	* submitted in batches.\n
+	* Functions of the target can be called the same way. The thread runs
+	* until the function returns to an invalid address, the resulting
+	* fault is swallowed. Since the thread is interrupted anywhere, the
+	* function must not depend on locks the thread might hold.\n
+	* Becomes invalid as soon as Process reference becomes invalid.\n
+	*/
+	class RemoteSyscall
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Checks whether a raw system call result is an error.
+		* @param result The value returned in the accumulator.
+		* @return int The errno value or zero on success.
+		*/
+		static int getError(qword_t result);
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructor.
+		* @param proc A reference to a process object. Has to be valid the
+		* whole lifetime.
+		* @param thread (optional) The thread to hijack, the main thread
+		* if zero.
+		*/
+		explicit RemoteSyscall(const Process& proc, tid_t thread = 0);
+
+		/**
+		* Destructor.
+		* Resumes the thread if it is still stopped.
+		*/
+		~RemoteSyscall();
+
+		/**
+		* Stops the thread and saves its registers.
+		* Calls executed while stopped share this stop.
+		*/
+		void stop();
+
+		/**
+		* Restores the saved registers and lets the thread continue.
+		*/
+		void resume();
+
+		/**
+		* Checks if the thread is stopped by this object.
+		* @return bool true if stopped.
+		*/
+		bool isStopped() const;
+
+		/**
+		* @return const Process& The process the thread belongs to.
+		*/
+		const Process& getProcess() const;
+
+		/**
+		* Executes a single system call, stopping the thread only for this
+		* call if it isn't stopped already.
+		* @param number The system call number.
+		* @param a0-a5 (optional) The arguments.
+		* @return qword_t The raw result, see getError().
+		*/
+		qword_t execute(	long number,
+								ptr_t a0 = 0,
+								ptr_t a1 = 0,
+								ptr_t a2 = 0,
+								ptr_t a3 = 0,
+								ptr_t a4 = 0,
+								ptr_t a5 = 0);
+
+		/**
+		* Executes a batch of system calls in order within one stop.
+		* @param requests The calls.
+		* @param results Reference to a vector receiving one raw result
+		* per call.
+		* @return size_t Number of executed calls.
+		*/
+		size_t execute(	const std::vector<SyscallRequest>& requests,
+								std::vector<qword_t>& results);
+
+		/**
+		* Calls a function of the target with the C calling convention,
+		* stopping the thread only for this call if it isn't stopped
+		* already. Floating point and vector registers are restored on
+		* resume.
+		* @param function The function's address.
+		* @param a0-a5 (optional) The arguments.
+		* @return qword_t The function's return value.
+		*/
+		qword_t call(	ptr_t function,
+							ptr_t a0 = 0,
+							ptr_t a1 = 0,
+							ptr_t a2 = 0,
+							ptr_t a3 = 0,
+							ptr_t a4 = 0,
+							ptr_t a5 = 0);
+
+		/**
+		* Copies data onto the stopped thread's stack, below the area in
+		* use. Calls can take it as argument, it's discarded on resume.
+		* @param data The data.
+		* @param size Size of the data in bytes.
+		* @return ptr_t The copy's address in the target.
+		*/
+		ptr_t pushData(const void* data, size_t size);
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Not copyable, a thread can only be stopped once
+		RemoteSyscall(const RemoteSyscall&);
+		RemoteSyscall& operator=(const RemoteSyscall&);
+
+		/*
+		* Searches the vdso and the executable mappings for a syscall
+		* instruction
+		*/
+		ptr_t findSyscallInstruction_() const;
+
+		/*
+		* Single-steps one call from the syscall instruction
+		*/
+		qword_t step_(const SyscallRequest& request);
+
+		/*
+		* Saves the floating point and vector registers once per stop
+		*/
+		void saveExtendedState_();
+
+		/*
+		* Waits for the next stop, remembers signals which would get lost
+		*/
+		int wait_();
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		tid_t thread_;
+
+		bool stopped_;
+		int pendingSignal_;
+		user_regs_struct savedRegisters_;
+
+		//Only saved if a function is called, system calls keep them
+		std::vector<byte_t> savedExtendedState_;
+		int extendedStateType_;
+
+		//Lowest stack address in use by the thread or pushed data
+		ptr_t stackTop_;
+
+		ptr_t syscallAddress_;
+	};
+}
+
+#endif //defined(SYNTHETIC_ISLINUX)
+
+#endif //SYNTHETIC_PROCESS_REMOTESYSCALL_HPP
+
+/******************
+******* EOF *******
+******************/
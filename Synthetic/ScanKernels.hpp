@@ -0,0 +1,593 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_SCANKERNELS_HPP
+#define SYNTHETIC_PROCESS_SCANKERNELS_HPP
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_HASSSE2)
+	//SSE2 intrinsics:
+	#include <emmintrin.h>
+#endif
+
+//C++ Header Files:
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+//Synthetic Header Files:
+#include "Types.hpp"
+#include "ValueScanner.hpp"
+
+/*
+* Comparison kernels shared by the scanners, not part of the interface
+*/
+namespace Synthetic
+{
+namespace Kernels
+{
+	//Results per bitmap word
+	const size_t WORD_BITS = 64;
+
+	inline size_t getValueSize(ValueType type)
+	{
+		switch(type)
+		{
+		case VALUE_INT8:
+		case VALUE_UINT8:
+			return 1;
+		case VALUE_INT16:
+		case VALUE_UINT16:
+			return 2;
+		case VALUE_INT32:
+		case VALUE_UINT32:
+		case VALUE_FLOAT:
+			return 4;
+		default:
+			return 8;
+		}
+	}
+
+	/*
+	* Number of set bits
+	*/
+	inline size_t countBits(qword_t bits)
+	{
+		bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+		bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+		bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return static_cast<size_t>((bits * 0x0101010101010101ULL) >> 56);
+	}
+
+	/*
+	* Index of the lowest set bit
+	*/
+	inline size_t lowestBit(qword_t bits)
+	{
+		return countBits((bits & (0 - bits)) - 1);
+	}
+
+	/*
+	* Word with the lowest count bits set
+	*/
+	inline qword_t lowBits(size_t count)
+	{
+		return (count >= WORD_BITS) ? ~0ULL : (1ULL << count) - 1;
+	}
+
+	/*
+	* SSE2 operations on the lanes of a type, masks have one bit per lane
+	*/
+	template<class value_t>
+	struct Vector
+	{
+		static const bool AVAILABLE = false;
+	};
+
+#if defined(SYNTHETIC_HASSSE2)
+
+	//Unsigned compares flip the sign bits and compare signed
+	template<>
+	struct Vector<signed char>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 16;
+		typedef __m128i vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static vector_t splat(signed char value)			{ return _mm_set1_epi8(value); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_epi8(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_epi8(a, b); }
+		static int equal(vector_t a, vector_t b)			{ return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)); }
+		static int greater(vector_t a, vector_t b)		{ return _mm_movemask_epi8(_mm_cmpgt_epi8(a, b)); }
+	};
+
+	template<>
+	struct Vector<unsigned char> : Vector<signed char>
+	{
+		static vector_t splat(unsigned char value)		{ return _mm_set1_epi8(static_cast<char>(value)); }
+
+		static int greater(vector_t a, vector_t b)
+		{
+			const vector_t sign = _mm_set1_epi8(static_cast<char>(0x80));
+			return Vector<signed char>::greater(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+		}
+	};
+
+	//16 bit masks are packed to bytes for _mm_movemask_epi8()
+	template<>
+	struct Vector<short>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 8;
+		typedef __m128i vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static vector_t splat(short value)					{ return _mm_set1_epi16(value); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_epi16(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_epi16(a, b); }
+		static int toMask(vector_t mask)						{ return _mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128())); }
+		static int equal(vector_t a, vector_t b)			{ return toMask(_mm_cmpeq_epi16(a, b)); }
+		static int greater(vector_t a, vector_t b)		{ return toMask(_mm_cmpgt_epi16(a, b)); }
+	};
+
+	template<>
+	struct Vector<unsigned short> : Vector<short>
+	{
+		static vector_t splat(unsigned short value)		{ return _mm_set1_epi16(static_cast<short>(value)); }
+
+		static int greater(vector_t a, vector_t b)
+		{
+			const vector_t sign = _mm_set1_epi16(static_cast<short>(0x8000));
+			return Vector<short>::greater(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+		}
+	};
+
+	template<>
+	struct Vector<int>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 4;
+		typedef __m128i vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static vector_t splat(int value)						{ return _mm_set1_epi32(value); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_epi32(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_epi32(a, b); }
+		static int toMask(vector_t mask)						{ return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+		static int equal(vector_t a, vector_t b)			{ return toMask(_mm_cmpeq_epi32(a, b)); }
+		static int greater(vector_t a, vector_t b)		{ return toMask(_mm_cmpgt_epi32(a, b)); }
+	};
+
+	template<>
+	struct Vector<unsigned int> : Vector<int>
+	{
+		static vector_t splat(unsigned int value)			{ return _mm_set1_epi32(static_cast<int>(value)); }
+
+		static int greater(vector_t a, vector_t b)
+		{
+			const vector_t sign = _mm_set1_epi32(static_cast<int>(0x80000000));
+			return Vector<int>::greater(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+		}
+	};
+
+	//SSE2 can't compare 64 bit integers by size, only equality is
+	//vectorized by combining the 32 bit halves
+	template<>
+	struct Vector<long long>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 2;
+		typedef __m128i vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static vector_t splat(long long value)				{ return _mm_set_epi32(	static_cast<int>(value >> 32), static_cast<int>(value),
+																										static_cast<int>(value >> 32), static_cast<int>(value)); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_epi64(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_epi64(a, b); }
+
+		static int equal(vector_t a, vector_t b)
+		{
+			const vector_t halves = _mm_cmpeq_epi32(a, b);
+			const vector_t swapped = _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1));
+			return _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(halves, swapped)));
+		}
+
+		static int greater(vector_t a, vector_t b)
+		{
+			long long left[2], right[2];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(left), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(right), b);
+			return (left[0] > right[0]) | (left[1] > right[1]) << 1;
+		}
+	};
+
+	template<>
+	struct Vector<unsigned long long> : Vector<long long>
+	{
+		static vector_t splat(unsigned long long value)	{ return Vector<long long>::splat(static_cast<long long>(value)); }
+
+		static int greater(vector_t a, vector_t b)
+		{
+			unsigned long long left[2], right[2];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(left), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(right), b);
+			return (left[0] > right[0]) | (left[1] > right[1]) << 1;
+		}
+	};
+
+	template<>
+	struct Vector<float>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 4;
+		typedef __m128 vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_ps(reinterpret_cast<const float*>(p)); }
+		static vector_t splat(float value)					{ return _mm_set1_ps(value); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_ps(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_ps(a, b); }
+		static int equal(vector_t a, vector_t b)			{ return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+		static int greater(vector_t a, vector_t b)		{ return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+	};
+
+	template<>
+	struct Vector<double>
+	{
+		static const bool AVAILABLE = true;
+		static const size_t LANES = 2;
+		typedef __m128d vector_t;
+
+		static vector_t load(const byte_t* p)				{ return _mm_loadu_pd(reinterpret_cast<const double*>(p)); }
+		static vector_t splat(double value)					{ return _mm_set1_pd(value); }
+		static vector_t add(vector_t a, vector_t b)		{ return _mm_add_pd(a, b); }
+		static vector_t sub(vector_t a, vector_t b)		{ return _mm_sub_pd(a, b); }
+		static int equal(vector_t a, vector_t b)			{ return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+		static int greater(vector_t a, vector_t b)		{ return _mm_movemask_pd(_mm_cmpgt_pd(a, b)); }
+	};
+
+	/*
+	* Lanes of a vector matching, lower and upper are included
+	*/
+	template<class value_t, bool exact>
+	int matchesVector(	const byte_t* data,
+								typename Vector<value_t>::vector_t lower,
+								typename Vector<value_t>::vector_t upper)
+	{
+		typedef Vector<value_t> lanes;
+		const typename lanes::vector_t x = lanes::load(data);
+		if(exact)
+			return lanes::equal(x, lower);
+
+		return ~(lanes::greater(lower, x) | lanes::greater(x, upper)) & ((1 << lanes::LANES) - 1);
+	}
+
+	//Floating point ranges need ordered compares so NaN never matches
+	template<>
+	inline int matchesVector<float, false>(const byte_t* data, __m128 lower, __m128 upper)
+	{
+		const __m128 x = _mm_loadu_ps(reinterpret_cast<const float*>(data));
+		return _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(x, lower), _mm_cmple_ps(x, upper)));
+	}
+
+	template<>
+	inline int matchesVector<double, false>(const byte_t* data, __m128d lower, __m128d upper)
+	{
+		const __m128d x = _mm_loadu_pd(reinterpret_cast<const double*>(data));
+		return _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(x, lower), _mm_cmple_pd(x, upper)));
+	}
+
+#endif
+
+	/*
+	* Matches up to 64 values against a range, bit i is set if value i
+	* matches
+	*/
+	template<class value_t, bool exact, bool vectorized = Vector<value_t>::AVAILABLE>
+	struct MatchKernel
+	{
+		static qword_t run(	const byte_t* data,
+									size_t count,
+									size_t stride,
+									value_t lower,
+									value_t upper)
+		{
+			qword_t result = 0;
+			for(size_t i = 0; i < count; ++i)
+			{
+				value_t x;
+				memcpy(&x, data + i * stride, sizeof(value_t));
+				if(exact ? x == lower : (x >= lower && x <= upper))
+					result |= 1ULL << i;
+			}
+
+			return result;
+		}
+	};
+
+#if defined(SYNTHETIC_HASSSE2)
+
+	template<class value_t, bool exact>
+	struct MatchKernel<value_t, exact, true>
+	{
+		static qword_t run(	const byte_t* data,
+									size_t count,
+									size_t stride,
+									value_t lower,
+									value_t upper)
+		{
+			if(stride != sizeof(value_t))
+				return MatchKernel<value_t, exact, false>::run(data, count, stride, lower, upper);
+
+			typedef Vector<value_t> lanes;
+			const typename lanes::vector_t lowers = lanes::splat(lower);
+			const typename lanes::vector_t uppers = lanes::splat(upper);
+
+			qword_t result = 0;
+			size_t i = 0;
+			for(; i + lanes::LANES <= count; i += lanes::LANES)
+				result |= static_cast<qword_t>(matchesVector<value_t, exact>(data + i * sizeof(value_t), lowers, uppers)) << i;
+
+			if(i < count)
+				result |= MatchKernel<value_t, exact, false>::run(data + i * sizeof(value_t), count - i, stride, lower, upper) << i;
+
+			return result;
+		}
+	};
+
+#endif
+
+	/*
+	* Range of reals a match stands for, open bounds aren't included
+	*/
+	inline void getRealBounds(	const ValueMatch& match,
+								double& lower,
+								bool& lowerOpen,
+								double& upper,
+								bool& upperOpen)
+	{
+		const double value = match.getValue().getReal();
+		const double step = std::pow(10.0, -std::floor(match.getParameter()));
+
+		lower = upper = value;
+		lowerOpen = upperOpen = false;
+		switch(match.getMode())
+		{
+		case MATCH_TOLERANCE:
+			lower = value - match.getParameter();
+			upper = value + match.getParameter();
+			break;
+		case MATCH_TRUNCATED:
+			//Cutting off digits moves towards zero
+			if(value >= 0)
+			{
+				upper = value + step;
+				upperOpen = true;
+			}
+
+			if(value <= 0)
+			{
+				lower = value - step;
+				lowerOpen = true;
+			}
+			break;
+		case MATCH_ROUNDED:
+			lower = value - step / 2;
+			upper = value + step / 2;
+			upperOpen = true;
+			break;
+		case MATCH_RANGE:
+			upper = match.getMaximum().getReal();
+			break;
+		default:
+			break;
+		}
+	}
+
+	/*
+	* Range of values of the scanned type matching, both included, false
+	* if none does
+	*/
+	template<class value_t>
+	bool getBounds(const ValueMatch& match, value_t& lower, value_t& upper)
+	{
+		typedef typename std::conditional<std::is_signed<value_t>::value, long long, unsigned long long>::type wide_t;
+		const wide_t smallest = (std::numeric_limits<value_t>::min)();
+		const wide_t biggest = (std::numeric_limits<value_t>::max)();
+
+		wide_t low, high;
+		if(match.getMode() == MATCH_EXACT || match.getMode() == MATCH_RANGE)
+		{
+			//Exact for 64 bit values, which a double can't hold
+			low = static_cast<wide_t>(match.getValue().getInteger());
+			high = static_cast<wide_t>((match.getMode() == MATCH_RANGE) ? match.getMaximum().getInteger() : low);
+		}
+		else
+		{
+			double realLow, realHigh;
+			bool lowOpen, highOpen;
+			getRealBounds(match, realLow, lowOpen, realHigh, highOpen);
+
+			realLow = lowOpen ? std::floor(realLow) + 1 : std::ceil(realLow);
+			realHigh = highOpen ? std::ceil(realHigh) - 1 : std::floor(realHigh);
+			if(	realLow > realHigh ||
+				realHigh < static_cast<double>(smallest) ||
+				realLow > static_cast<double>(biggest))
+			{
+				return false;
+			}
+
+			low = (realLow <= static_cast<double>(smallest)) ? smallest : static_cast<wide_t>(realLow);
+			high = (realHigh >= static_cast<double>(biggest)) ? biggest : static_cast<wide_t>(realHigh);
+		}
+
+		if(low > high || high < smallest || low > biggest)
+			return false;
+
+		lower = static_cast<value_t>((std::max)(low, smallest));
+		upper = static_cast<value_t>((std::min)(high, biggest));
+		return true;
+	}
+
+	/*
+	* Floating point bounds move to the next representable value inside
+	* the range
+	*/
+	template<class real_t>
+	bool getRealTypeBounds(const ValueMatch& match, real_t& lower, real_t& upper)
+	{
+		//Exact numbers mean the closest value of the type
+		if(match.getMode() == MATCH_EXACT)
+		{
+			lower = upper = static_cast<real_t>(match.getValue().getReal());
+			return lower == lower;
+		}
+
+		double realLow, realHigh;
+		bool lowOpen, highOpen;
+		getRealBounds(match, realLow, lowOpen, realHigh, highOpen);
+
+		const real_t infinity = std::numeric_limits<real_t>::infinity();
+
+		lower = static_cast<real_t>(realLow);
+		if(lowOpen ? lower <= realLow : lower < realLow)
+			lower = std::nextafter(lower, infinity);
+
+		upper = static_cast<real_t>(realHigh);
+		if(highOpen ? upper >= realHigh : upper > realHigh)
+			upper = std::nextafter(upper, -infinity);
+
+		return lower <= upper;
+	}
+
+	inline bool getBounds(const ValueMatch& match, float& lower, float& upper)
+	{
+		return getRealTypeBounds(match, lower, upper);
+	}
+
+	inline bool getBounds(const ValueMatch& match, double& lower, double& upper)
+	{
+		return getRealTypeBounds(match, lower, upper);
+	}
+
+	/*
+	* A ValueMatch prepared for one type, matches up to 64 values at once
+	*/
+	class Matcher
+	{
+	public:
+
+		Matcher(ValueType type, const ValueMatch& match) : type_(type), matching_(false), exact_(false), lower_(0), upper_(0)
+		{
+			switch(type_)
+			{
+			case VALUE_INT8:		prepare_<signed char>(match); break;
+			case VALUE_UINT8:		prepare_<unsigned char>(match); break;
+			case VALUE_INT16:		prepare_<short>(match); break;
+			case VALUE_UINT16:	prepare_<unsigned short>(match); break;
+			case VALUE_INT32:		prepare_<int>(match); break;
+			case VALUE_UINT32:	prepare_<unsigned int>(match); break;
+			case VALUE_INT64:		prepare_<long long>(match); break;
+			case VALUE_UINT64:	prepare_<unsigned long long>(match); break;
+			case VALUE_FLOAT:		prepare_<float>(match); break;
+			case VALUE_DOUBLE:	prepare_<double>(match); break;
+			}
+		}
+
+		/*
+		* Bit i is set if the value at data + i * stride matches
+		*/
+		qword_t run(const byte_t* data, size_t count, size_t stride) const
+		{
+			if(!matching_)
+				return 0;
+
+			switch(type_)
+			{
+			case VALUE_INT8:		return run_<signed char>(data, count, stride);
+			case VALUE_UINT8:		return run_<unsigned char>(data, count, stride);
+			case VALUE_INT16:		return run_<short>(data, count, stride);
+			case VALUE_UINT16:	return run_<unsigned short>(data, count, stride);
+			case VALUE_INT32:		return run_<int>(data, count, stride);
+			case VALUE_UINT32:	return run_<unsigned int>(data, count, stride);
+			case VALUE_INT64:		return run_<long long>(data, count, stride);
+			case VALUE_UINT64:	return run_<unsigned long long>(data, count, stride);
+			case VALUE_FLOAT:		return run_<float>(data, count, stride);
+			default:					return run_<double>(data, count, stride);
+			}
+		}
+
+		/*
+		* Whether any value of the type matches at all
+		*/
+		bool isMatching() const
+		{
+			return matching_;
+		}
+
+	private:
+
+		template<class value_t>
+		void prepare_(const ValueMatch& match)
+		{
+			value_t lower, upper;
+			matching_ = getBounds(match, lower, upper);
+			if(!matching_)
+				return;
+
+			exact_ = !(lower < upper);
+			memcpy(&lower_, &lower, sizeof(value_t));
+			memcpy(&upper_, &upper, sizeof(value_t));
+		}
+
+		template<class value_t>
+		qword_t run_(const byte_t* data, size_t count, size_t stride) const
+		{
+			value_t lower, upper;
+			memcpy(&lower, &lower_, sizeof(value_t));
+			memcpy(&upper, &upper_, sizeof(value_t));
+			return exact_ ?	MatchKernel<value_t, true>::run(data, count, stride, lower, upper) :
+									MatchKernel<value_t, false>::run(data, count, stride, lower, upper);
+		}
+
+		ValueType type_;
+		bool matching_;
+		bool exact_;
+
+		//The bounds as raw bytes of the type
+		qword_t lower_;
+		qword_t upper_;
+	};
+}
+}
+
+#endif //SYNTHETIC_PROCESS_SCANKERNELS_HPP
+
+/******************
+******* EOF *******
+******************/
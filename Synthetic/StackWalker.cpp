@@ -0,0 +1,651 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+
+//Synthetic header files:
+#include "StackWalker.hpp"
+#include "Module.hpp"
+#include "WinException.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Unwind operation codes, see the x64 exception handling documentation
+	enum UnwindOp
+	{
+		UWOP_PUSH_NONVOL = 0,
+		UWOP_ALLOC_LARGE,
+		UWOP_ALLOC_SMALL,
+		UWOP_SET_FPREG,
+		UWOP_SAVE_NONVOL,
+		UWOP_SAVE_NONVOL_FAR,
+		UWOP_EPILOG,
+		UWOP_SPARE_CODE,
+		UWOP_SAVE_XMM128,
+		UWOP_SAVE_XMM128_FAR,
+		UWOP_PUSH_MACHFRAME
+	};
+
+	const byte_t UNW_FLAG_CHAININFO = 0x4;
+
+	//x64 register numbers as used by the unwind codes
+	const size_t RSP_INDEX = 4;
+	const size_t RBP_INDEX = 5;
+
+	//Size of the blocks stack memory is read in
+	const size_t STACK_BLOCK_SIZE = 0x4000;
+
+	/*
+	* Returns the number of slots an unwind code occupies
+	*/
+	size_t unwindCodeSlots(byte_t op, byte_t opInfo)
+	{
+		switch(op)
+		{
+		case UWOP_ALLOC_LARGE:
+			return opInfo ? 3 : 2;
+
+		case UWOP_SAVE_NONVOL:
+		case UWOP_EPILOG:
+		case UWOP_SAVE_XMM128:
+			return 2;
+
+		case UWOP_SAVE_NONVOL_FAR:
+		case UWOP_SPARE_CODE:
+		case UWOP_SAVE_XMM128_FAR:
+			return 3;
+
+		default:
+			return 1;
+		}
+	}
+
+	/*
+	* Reads an unaligned 16 respectively 32 bit value
+	*/
+	word_t readWord(const byte_t* p)
+	{
+		word_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	dword_t readDword(const byte_t* p)
+	{
+		dword_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+}
+
+/**********************************************************************
+***********************************************************************
+************************ UNWINDTABLE FUNCTIONS ************************
+***********************************************************************
+**********************************************************************/
+
+UnwindTable::UnwindTable(const Process& proc, ptr_t moduleBase)
+	:	proc_(proc), moduleBase_(moduleBase)
+{
+#if defined(SYNTHETIC_ISX64)
+	//A module without readable headers simply gets an empty table, the
+	//walker falls back to frame pointers for it
+	try
+	{
+		IMAGE_DOS_HEADER dosHeader = proc_.readMemory<IMAGE_DOS_HEADER>(moduleBase_);
+		if(dosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+			return;
+
+		IMAGE_NT_HEADERS ntHeaders;
+		ntHeaders = proc_.readMemory<IMAGE_NT_HEADERS>(moduleBase_ + dosHeader.e_lfanew);
+		if(ntHeaders.Signature != IMAGE_NT_SIGNATURE)
+			return;
+
+		const IMAGE_DATA_DIRECTORY& directory =
+			ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXCEPTION];
+		if(!directory.VirtualAddress || directory.Size < sizeof(Function))
+			return;
+
+		//Read the complete function table at once, it is sorted already
+		functions_.resize(directory.Size / sizeof(Function));
+		proc_.rawRead(	moduleBase_ + directory.VirtualAddress,
+							&functions_[0],
+							functions_.size() * sizeof(Function));
+	}
+	catch(const WinException&)
+	{
+		functions_.clear();
+	}
+#endif
+}
+
+ptr_t UnwindTable::getModuleBase() const
+{
+	return moduleBase_;
+}
+
+bool UnwindTable::isEmpty() const
+{
+	return functions_.empty();
+}
+
+const UnwindTable::Function* UnwindTable::findFunction(dword_t rva) const
+{
+	if(functions_.empty())
+		return NULL;
+
+	//Find the last function starting at or before rva
+	size_t first = 0;
+	size_t count = functions_.size();
+	while(count > 1)
+	{
+		size_t half = count / 2;
+		first = (functions_[first + half].begin <= rva) ? first + half : first;
+		count -= half;
+	}
+
+	const Function& func = functions_[first];
+	if(rva < func.begin || rva >= func.end)
+		return NULL;
+
+	return &func;
+}
+
+const byte_t* UnwindTable::getUnwindInfo(dword_t rva)
+{
+	unordered_map<dword_t, size_t>::const_iterator cached = infoOffsets_.find(rva);
+	if(cached != infoOffsets_.end())
+		return &infoPool_[cached->second];
+
+	//Header first to know how many codes follow
+	byte_t header[4];
+	if(proc_.tryReadMemory(moduleBase_ + rva, header))
+		return NULL;
+
+	const size_t codeSlots = (header[2] + 1) & ~1;
+	size_t infoSize = sizeof(header) + codeSlots * sizeof(word_t);
+	if((header[0] >> 3) & UNW_FLAG_CHAININFO)
+		infoSize += sizeof(Function);
+
+	const size_t offset = infoPool_.size();
+	infoPool_.resize(offset + infoSize);
+
+	size_t bytesRead;
+	if(proc_.tryRead(moduleBase_ + rva, &infoPool_[offset], infoSize, bytesRead) || bytesRead != infoSize)
+	{
+		infoPool_.resize(offset);
+		return NULL;
+	}
+
+	infoOffsets_[rva] = offset;
+	return &infoPool_[offset];
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+StackWalker::StackWalker(const Process& proc)
+	:	proc_(proc), stackBlock_(STACK_BLOCK_SIZE), stackBlockBase_(0),
+		stackBlockSize_(0), stackRegionBegin_(0), stackRegionEnd_(0)
+{
+	refreshModules();
+}
+
+void StackWalker::refreshModules()
+{
+	vector<ModuleRange> modules;
+	for(Module::iterator it(proc_.getId()); it != Module::iterator(); ++it)
+	{
+		ModuleRange range;
+		range.begin = reinterpret_cast<ptr_t>(it->modBaseAddr);
+		range.end = range.begin + it->modBaseSize;
+		modules.push_back(range);
+	}
+
+	sort(modules.begin(), modules.end(), [](const ModuleRange& a, const ModuleRange& b)
+	{
+		return a.begin < b.begin;
+	});
+
+	//Keep the tables of modules which are still loaded at the same place
+	vector<ModuleRange>::iterator old = modules_.begin();
+	for(vector<ModuleRange>::iterator it = modules.begin(); it != modules.end(); ++it)
+	{
+		while(old != modules_.end() && old->begin < it->begin)
+			++old;
+
+		if(old != modules_.end() && old->begin == it->begin && old->end == it->end)
+			it->table = old->table;
+	}
+
+	modules_.swap(modules);
+}
+
+size_t StackWalker::walk(	const Thread& thread,
+									vector<StackFrame>& dest,
+									size_t maxFrames)
+{
+	CONTEXT context = thread.getContext(CONTEXT_CONTROL | CONTEXT_INTEGER);
+	return walk(context, dest, maxFrames);
+}
+
+size_t StackWalker::walk(	const CONTEXT& context,
+									vector<StackFrame>& dest,
+									size_t maxFrames)
+{
+	size_t previousSize = dest.size();
+
+	//Stack contents changed since the last walk
+	stackBlockSize_ = 0;
+	stackRegionBegin_ = 0;
+	stackRegionEnd_ = 0;
+
+	Registers regs;
+	memset(&regs, 0, sizeof(regs));
+	regs.interrupted = true;
+
+#if defined(SYNTHETIC_ISX64)
+	regs.ip = context.Rip;
+	regs.gpr[0] = context.Rax;	regs.gpr[1] = context.Rcx;
+	regs.gpr[2] = context.Rdx;	regs.gpr[3] = context.Rbx;
+	regs.gpr[4] = context.Rsp;	regs.gpr[5] = context.Rbp;
+	regs.gpr[6] = context.Rsi;	regs.gpr[7] = context.Rdi;
+	regs.gpr[8] = context.R8;	regs.gpr[9] = context.R9;
+	regs.gpr[10] = context.R10;	regs.gpr[11] = context.R11;
+	regs.gpr[12] = context.R12;	regs.gpr[13] = context.R13;
+	regs.gpr[14] = context.R14;	regs.gpr[15] = context.R15;
+#elif defined(SYNTHETIC_ISX86)
+	regs.ip = context.Eip;
+	regs.gpr[0] = context.Eax;	regs.gpr[1] = context.Ecx;
+	regs.gpr[2] = context.Edx;	regs.gpr[3] = context.Ebx;
+	regs.gpr[4] = context.Esp;	regs.gpr[5] = context.Ebp;
+	regs.gpr[6] = context.Esi;	regs.gpr[7] = context.Edi;
+#endif
+
+	for(size_t i = 0; i < maxFrames && regs.ip; ++i)
+	{
+		StackFrame frame;
+		frame.instructionPointer = regs.ip;
+		frame.stackPointer = regs.gpr[RSP_INDEX];
+		frame.framePointer = regs.gpr[RBP_INDEX];
+
+		const ptr_t previousStack = regs.gpr[RSP_INDEX];
+
+		//Return addresses of calls to noreturn functions lie past the end
+		//of the caller, callers are looked up by the call instruction
+		UnwindTable* table = findTable_(regs.interrupted ? regs.ip : regs.ip - 1);
+		frame.fromUnwindTable = table && !table->isEmpty();
+
+		bool unwound = frame.fromUnwindTable ?
+			unwindByTable_(*table, regs) :
+			unwindByFramePointer_(regs);
+
+		if(!unwound)
+			frame.fromUnwindTable = false;
+
+		dest.push_back(frame);
+
+		//The stack has to grow towards higher addresses while unwinding,
+		//anything else means we lost track
+		if(!unwound || regs.gpr[RSP_INDEX] <= previousStack)
+			break;
+	}
+
+	return dest.size() - previousSize;
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PRIVATE MEMBER FUNCTIONS *********************
+***********************************************************************
+**********************************************************************/
+
+UnwindTable* StackWalker::findTable_(ptr_t address)
+{
+	if(modules_.empty())
+		return NULL;
+
+	//Find the last module starting at or before address
+	size_t first = 0;
+	size_t count = modules_.size();
+	while(count > 1)
+	{
+		size_t half = count / 2;
+		first = (modules_[first + half].begin <= address) ? first + half : first;
+		count -= half;
+	}
+
+	ModuleRange& range = modules_[first];
+	if(address < range.begin || address >= range.end)
+		return NULL;
+
+	if(!range.table)
+		range.table.reset(new UnwindTable(proc_, range.begin));
+
+	return range.table.get();
+}
+
+bool StackWalker::readStack_(ptr_t address, ptr_t& dest)
+{
+	if(	address < stackBlockBase_ ||
+		address + sizeof(ptr_t) > stackBlockBase_ + stackBlockSize_)
+	{
+		//Find out where the stack ends once per walk so block reads never
+		//run into the guard page or unmapped memory
+		if(address < stackRegionBegin_ || address >= stackRegionEnd_)
+		{
+			MEMORY_BASIC_INFORMATION info;
+			if(!VirtualQueryEx(	proc_.getHandle(),
+										reinterpret_cast<const void*>(address),
+										&info,
+										sizeof(info)))
+			{
+				return false;
+			}
+
+			stackRegionBegin_ = reinterpret_cast<ptr_t>(info.BaseAddress);
+			stackRegionEnd_ = stackRegionBegin_ + info.RegionSize;
+		}
+
+		const ptr_t blockBase = address & ~static_cast<ptr_t>(sizeof(ptr_t) - 1);
+		const size_t blockSize = static_cast<size_t>(
+			min<ptr_t>(STACK_BLOCK_SIZE, stackRegionEnd_ - blockBase));
+
+		size_t bytesRead;
+		if(proc_.tryRead(blockBase, &stackBlock_[0], blockSize, bytesRead) || bytesRead != blockSize)
+		{
+			stackBlockSize_ = 0;
+			return false;
+		}
+
+		stackBlockBase_ = blockBase;
+		stackBlockSize_ = blockSize;
+
+		if(address + sizeof(ptr_t) > stackBlockBase_ + stackBlockSize_)
+			return false;
+	}
+
+	memcpy(&dest, &stackBlock_[address - stackBlockBase_], sizeof(ptr_t));
+	return true;
+}
+
+bool StackWalker::unwindByTable_(UnwindTable& table, Registers& regs)
+{
+	ptr_t& rsp = regs.gpr[RSP_INDEX];
+
+	const ptr_t address = regs.interrupted ? regs.ip : regs.ip - 1;
+	const dword_t rva = static_cast<dword_t>(address - table.getModuleBase());
+	const UnwindTable::Function* func = table.findFunction(rva);
+
+	//Leaf functions have no entry, the return address is on top of the stack
+	if(!func)
+	{
+		if(!readStack_(rsp, regs.ip))
+			return false;
+
+		rsp += sizeof(ptr_t);
+		regs.interrupted = false;
+		return true;
+	}
+
+	//Only an interrupted frame can be inside an epilog, for all callers
+	//the unwind codes give the same result
+	const ptr_t funcBegin = table.getModuleBase() + func->begin;
+	const ptr_t funcEnd = table.getModuleBase() + func->end;
+	if(regs.interrupted && unwindEpilog_(regs, funcBegin, funcEnd))
+	{
+		regs.interrupted = false;
+		return true;
+	}
+
+	dword_t prologOffset = rva - func->begin;
+	const byte_t* info = table.getUnwindInfo(func->unwindData);
+	bool machineFrame = false;
+
+	while(info)
+	{
+		const byte_t flags = info[0] >> 3;
+		const byte_t prologSize = info[1];
+		const byte_t codeCount = info[2];
+		const byte_t frameRegister = info[3] & 0x0F;
+		const byte_t frameOffset = info[3] >> 4;
+		const byte_t* codes = info + 4;
+
+		//Establish the frame base the save codes are relative to
+		ptr_t frame = rsp;
+		if(frameRegister)
+		{
+			bool frameSet = prologOffset >= prologSize;
+			for(size_t i = 0; !frameSet && i < codeCount; )
+			{
+				const byte_t op = codes[i * 2 + 1] & 0x0F;
+				frameSet = op == UWOP_SET_FPREG && prologOffset >= codes[i * 2];
+				i += unwindCodeSlots(op, codes[i * 2 + 1] >> 4);
+			}
+
+			if(frameSet)
+				frame = regs.gpr[frameRegister] - frameOffset * 16;
+		}
+
+		for(size_t i = 0; i < codeCount; )
+		{
+			const byte_t codeOffset = codes[i * 2];
+			const byte_t op = codes[i * 2 + 1] & 0x0F;
+			const byte_t opInfo = codes[i * 2 + 1] >> 4;
+			const byte_t* next = codes + (i + 1) * 2;
+			i += unwindCodeSlots(op, opInfo);
+
+			//Skip operations of the prolog which weren't executed yet
+			if(prologOffset < codeOffset)
+				continue;
+
+			switch(op)
+			{
+			case UWOP_PUSH_NONVOL:
+				if(!readStack_(rsp, regs.gpr[opInfo]))
+					return false;
+				rsp += sizeof(ptr_t);
+				break;
+
+			case UWOP_ALLOC_LARGE:
+				rsp += opInfo ? readDword(next) : readWord(next) * 8;
+				break;
+
+			case UWOP_ALLOC_SMALL:
+				rsp += opInfo * 8 + 8;
+				break;
+
+			case UWOP_SET_FPREG:
+				rsp = frame;
+				break;
+
+			case UWOP_SAVE_NONVOL:
+				if(!readStack_(frame + readWord(next) * 8, regs.gpr[opInfo]))
+					return false;
+				break;
+
+			case UWOP_SAVE_NONVOL_FAR:
+				if(!readStack_(frame + readDword(next), regs.gpr[opInfo]))
+					return false;
+				break;
+
+			case UWOP_PUSH_MACHFRAME:
+				//Interrupt or exception frame pushed by the processor
+				if(opInfo)
+					rsp += sizeof(ptr_t);
+
+				if(!readStack_(rsp, regs.ip) || !readStack_(rsp + 24, rsp))
+					return false;
+
+				machineFrame = true;
+				break;
+
+			default:
+				//Nonvolatile XMM registers aren't tracked
+				break;
+			}
+		}
+
+		if(!(flags & UNW_FLAG_CHAININFO))
+			break;
+
+		//Chained information, all of its codes belong to an executed prolog
+		UnwindTable::Function chained;
+		memcpy(&chained, codes + ((codeCount + 1) & ~1) * 2, sizeof(chained));
+		info = table.getUnwindInfo(chained.unwindData);
+		prologOffset = ~static_cast<dword_t>(0);
+	}
+
+	if(!info)
+		return false;
+
+	if(!machineFrame)
+	{
+		if(!readStack_(rsp, regs.ip))
+			return false;
+
+		rsp += sizeof(ptr_t);
+	}
+
+	//A machine frame holds the address of the interrupted instruction
+	regs.interrupted = machineFrame;
+	return true;
+}
+
+bool StackWalker::unwindByFramePointer_(Registers& regs)
+{
+	ptr_t& framePointer = regs.gpr[RBP_INDEX];
+	if(!framePointer)
+		return false;
+
+	const ptr_t frame = framePointer;
+	if(	!readStack_(frame + sizeof(ptr_t), regs.ip) ||
+		!readStack_(frame, framePointer))
+	{
+		return false;
+	}
+
+	regs.gpr[RSP_INDEX] = frame + 2 * sizeof(ptr_t);
+	regs.interrupted = false;
+	return true;
+}
+
+bool StackWalker::unwindEpilog_(	Registers& regs,
+											ptr_t funcBegin,
+											ptr_t funcEnd)
+{
+	//Epilogs are limited to an optional stack adjustment, pops of
+	//nonvolatile registers and a ret or a jmp leaving the function
+	byte_t code[32];
+	size_t bytesRead;
+	if(proc_.tryRead(regs.ip, code, sizeof(code), bytesRead) || bytesRead != sizeof(code))
+		return false;
+
+	Registers state = regs;
+	ptr_t& rsp = state.gpr[RSP_INDEX];
+	size_t i = 0;
+
+	if(code[0] == 0x48 || code[0] == 0x49)
+	{
+		const size_t base = (code[2] & 0x07) + ((code[0] & 0x01) ? 8 : 0);
+
+		if(code[0] == 0x48 && code[1] == 0x83 && code[2] == 0xC4)
+		{
+			//add rsp, imm8
+			rsp += static_cast<signed char>(code[3]);
+			i = 4;
+		}
+		else if(code[0] == 0x48 && code[1] == 0x81 && code[2] == 0xC4)
+		{
+			//add rsp, imm32
+			rsp += static_cast<int32_t>(readDword(code + 3));
+			i = 7;
+		}
+		else if(code[1] == 0x8D && (code[2] & 0xF8) == 0x60 && (code[2] & 0x07) != 4)
+		{
+			//lea rsp, [reg + disp8]
+			rsp = state.gpr[base] + static_cast<signed char>(code[3]);
+			i = 4;
+		}
+		else if(code[1] == 0x8D && (code[2] & 0xF8) == 0xA0 && (code[2] & 0x07) != 4)
+		{
+			//lea rsp, [reg + disp32]
+			rsp = state.gpr[base] + static_cast<int32_t>(readDword(code + 3));
+			i = 7;
+		}
+	}
+
+	for(; i < sizeof(code); ++i)
+	{
+		if((code[i] & 0xF8) == 0x58)
+		{
+			//pop reg
+			if(!readStack_(rsp, state.gpr[code[i] & 0x07]))
+				return false;
+			rsp += sizeof(ptr_t);
+		}
+		else if(code[i] == 0x41 && i + 1 < sizeof(code) && (code[i + 1] & 0xF8) == 0x58)
+		{
+			//pop r8-r15
+			++i;
+			if(!readStack_(rsp, state.gpr[8 + (code[i] & 0x07)]))
+				return false;
+			rsp += sizeof(ptr_t);
+		}
+		else if(code[i] == 0xC3 || (code[i] == 0xF3 && i + 1 < sizeof(code) && code[i + 1] == 0xC3))
+		{
+			//ret, we really are inside an epilog
+			if(!readStack_(rsp, state.ip))
+				return false;
+			rsp += sizeof(ptr_t);
+			regs = state;
+			return true;
+		}
+		else if(code[i] == 0xE9 && i + 5 <= sizeof(code))
+		{
+			//Tail call, only an epilog if it leaves the function
+			const ptr_t target = regs.ip + i + 5 + static_cast<int32_t>(readDword(code + i + 1));
+			if(target >= funcBegin && target < funcEnd)
+				return false;
+
+			if(!readStack_(rsp, state.ip))
+				return false;
+			rsp += sizeof(ptr_t);
+			regs = state;
+			return true;
+		}
+		else
+			return false;
+	}
+
+	return false;
+}
+
+/******************
+******* EOF *******
+******************/
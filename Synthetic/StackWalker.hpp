@@ -0,0 +1,279 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_STACKWALKER_HPP
+#define SYNTHETIC_PROCESS_STACKWALKER_HPP
+
+//Windows Header Files:
+#include <Windows.h>
+
+//C++ Header Files:
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+//Synthetic Header Files:
+#include "System.hpp"
+#include "Types.hpp"
+#include "Process.hpp"
+#include "Thread.hpp"
+
+namespace Synthetic
+{
+	/**
+	* A single frame of a walked call stack
+	*/
+	struct StackFrame
+	{
+		ptr_t instructionPointer;
+		ptr_t stackPointer;
+		ptr_t framePointer;
+
+		/**
+		* true if the caller of this frame was found by the module's unwind
+		* table, false if the frame pointer chain had to be followed
+		*/
+		bool fromUnwindTable;
+	};
+
+	/**
+	* Compact lookup table built from a module's .pdata section.\n
+	* Function entries are read in one go when the table is built, the
+	* unwind information they refer to is read lazily and kept in a
+	* single byte pool.\n
+	* On 32-bit targets there is no .pdata, the table stays empty.\n
+	*/
+	class UnwindTable
+	{
+	public:
+
+		/**
+		* Entry of the function table, mirrors RUNTIME_FUNCTION
+		*/
+		struct Function
+		{
+			dword_t begin;
+			dword_t end;
+			dword_t unwindData;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructor.
+		* Reads the module's headers and its complete function table.
+		* @param proc The process the module is loaded in.
+		* @param moduleBase The module's base address.
+		*/
+		UnwindTable(const Process& proc, ptr_t moduleBase);
+
+		/**
+		* Returns the module's base address.
+		* @return ptr_t The module's base address.
+		*/
+		ptr_t getModuleBase() const;
+
+		/**
+		* Checks if the module has any unwind information at all.
+		* @return bool true if the function table is empty.
+		*/
+		bool isEmpty() const;
+
+		/**
+		* Searches the function covering an address.
+		* @param rva The address relative to the module base.
+		* @return const Function* The function entry or NULL for leaf code.
+		*/
+		const Function* findFunction(dword_t rva) const;
+
+		/**
+		* Returns the raw unwind information at a given RVA.
+		* The information is read from the target on first use only.
+		* @param rva The UNWIND_INFO's address relative to the module base.
+		* @return const byte_t* Pointer to the cached UNWIND_INFO or NULL
+		* if it couldn't be read.
+		*/
+		const byte_t* getUnwindInfo(dword_t rva);
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		ptr_t moduleBase_;
+		std::vector<Function> functions_;
+		std::vector<byte_t> infoPool_;
+		std::unordered_map<dword_t, size_t> infoOffsets_;
+	};
+
+	/**
+	* Walks the call stacks of threads inside a remote process.\n
+	* Frames are unwound by the modules' .pdata information where available,
+	* otherwise the frame pointer chain is followed.\n
+	* Unwind tables are built once per module and kept for the lifetime of
+	* the walker, stack memory is read in blocks.\n
+	* Becomes invalid as soon as Process reference becomes invalid.\n
+	*/
+	class StackWalker
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default Constructor.
+		* Reads the current module list of the process.
+		* @param proc A reference to a process object which threads should be
+		* walked. Has to be valid the whole lifetime.
+		*/
+		explicit StackWalker(const Process& proc);
+
+		/**
+		* Re-reads the module list.
+		* Call this after modules got loaded or unloaded. Unwind tables of
+		* modules which are still loaded are kept.
+		*/
+		void refreshModules();
+
+		/**
+		* Walks the call stack of a thread.
+		* The thread should be suspended, otherwise the result is undefined.
+		* @param thread The thread to walk.
+		* @param dest Reference to a vector to hold all found frames.
+		* @param maxFrames (optional) Maximum number of frames to walk.
+		* @return size_t Number of found frames.
+		*/
+		size_t walk(	const Thread& thread,
+							std::vector<StackFrame>& dest,
+							size_t maxFrames = 256);
+
+		/**
+		* Walks a call stack starting at a given register context.
+		* @param context Context retrieved by Thread::getContext() with at
+		* least CONTEXT_CONTROL and CONTEXT_INTEGER.
+		* @param dest Reference to a vector to hold all found frames.
+		* @param maxFrames (optional) Maximum number of frames to walk.
+		* @return size_t Number of found frames.
+		*/
+		size_t walk(	const CONTEXT& context,
+							std::vector<StackFrame>& dest,
+							size_t maxFrames = 256);
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER TYPES *************************
+		***********************************************************************
+		**********************************************************************/
+
+		typedef std::shared_ptr<UnwindTable> TablePtr;
+
+		struct ModuleRange
+		{
+			ptr_t begin;
+			ptr_t end;
+			TablePtr table;
+		};
+
+		/**
+		* Register state while unwinding, indexed by x64 register number
+		*/
+		struct Registers
+		{
+			ptr_t ip;
+			ptr_t gpr[16];
+
+			//ip is where execution stopped, not a return address
+			bool interrupted;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Returns the unwind table of the module containing an address,
+		* builds it if necessary. Returns NULL if no module contains it.
+		*/
+		UnwindTable* findTable_(ptr_t address);
+
+		/*
+		* Reads a pointer from the stack through the block cache.
+		*/
+		bool readStack_(ptr_t address, ptr_t& dest);
+
+		/*
+		* Unwinds one frame by the module's unwind information. Only
+		* interrupted frames can be inside an epilog.
+		*/
+		bool unwindByTable_(UnwindTable& table, Registers& regs);
+
+		/*
+		* Unwinds one frame by following the frame pointer.
+		*/
+		bool unwindByFramePointer_(Registers& regs);
+
+		/*
+		* Emulates the rest of an epilog if the instruction pointer is inside
+		* one. Returns false if it is not.
+		*/
+		bool unwindEpilog_(Registers& regs, ptr_t funcBegin, ptr_t funcEnd);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		std::vector<ModuleRange> modules_;
+
+		std::vector<byte_t> stackBlock_;
+		ptr_t stackBlockBase_;
+		size_t stackBlockSize_;
+		ptr_t stackRegionBegin_;
+		ptr_t stackRegionEnd_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_STACKWALKER_HPP
+
+/******************
+******* EOF *******
+******************/
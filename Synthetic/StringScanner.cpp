@@ -0,0 +1,309 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+//C++ header files:
+#include <algorithm>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "ScanKernels.hpp"
+#include "StringScanner.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	//Memory read per block, strings may overlap into the next one. Small
+	//enough to stay cached while all needles are searched
+	const size_t BLOCK_SIZE = 0x10000;
+
+	//Set in a byte to make an ASCII letter lower case
+	const byte_t LOWER_CASE = 0x20;
+
+	/*
+	* Code points of a text, UTF-16 wide strings are decoded
+	*/
+	void getCodePoints(const wstring& text, vector<unsigned int>& dest)
+	{
+		for(size_t i = 0; i < text.size(); ++i)
+		{
+			unsigned int point = static_cast<unsigned int>(text[i]);
+			if(sizeof(wchar_t) == 2 && point >= 0xD800 && point < 0xDC00 && i + 1 < text.size())
+			{
+				const unsigned int low = static_cast<unsigned int>(text[i + 1]);
+				if(low >= 0xDC00 && low < 0xE000)
+				{
+					point = 0x10000 + ((point - 0xD800) << 10) + (low - 0xDC00);
+					++i;
+				}
+			}
+
+			dest.push_back(point);
+		}
+	}
+
+	bool isLetter(unsigned int point)
+	{
+		return (point >= 'A' && point <= 'Z') || (point >= 'a' && point <= 'z');
+	}
+
+	void appendByte(vector<byte_t>& bytes, vector<byte_t>& folds, unsigned int value, bool fold)
+	{
+		bytes.push_back(static_cast<byte_t>(value | (fold ? LOWER_CASE : 0)));
+		folds.push_back(fold ? LOWER_CASE : 0);
+	}
+
+	void appendUtf8(vector<byte_t>& bytes, vector<byte_t>& folds, unsigned int point, bool ignoreCase)
+	{
+		if(point < 0x80)
+		{
+			appendByte(bytes, folds, point, ignoreCase && isLetter(point));
+		}
+		else if(point < 0x800)
+		{
+			appendByte(bytes, folds, 0xC0 | (point >> 6), false);
+			appendByte(bytes, folds, 0x80 | (point & 0x3F), false);
+		}
+		else if(point < 0x10000)
+		{
+			appendByte(bytes, folds, 0xE0 | (point >> 12), false);
+			appendByte(bytes, folds, 0x80 | ((point >> 6) & 0x3F), false);
+			appendByte(bytes, folds, 0x80 | (point & 0x3F), false);
+		}
+		else
+		{
+			appendByte(bytes, folds, 0xF0 | (point >> 18), false);
+			appendByte(bytes, folds, 0x80 | ((point >> 12) & 0x3F), false);
+			appendByte(bytes, folds, 0x80 | ((point >> 6) & 0x3F), false);
+			appendByte(bytes, folds, 0x80 | (point & 0x3F), false);
+		}
+	}
+
+	void appendUtf16(vector<byte_t>& bytes, vector<byte_t>& folds, unsigned int point, bool ignoreCase)
+	{
+		if(point >= 0x10000)
+		{
+			appendUtf16(bytes, folds, 0xD800 + ((point - 0x10000) >> 10), false);
+			appendUtf16(bytes, folds, 0xDC00 + ((point - 0x10000) & 0x3FF), false);
+			return;
+		}
+
+		appendByte(bytes, folds, point & 0xFF, ignoreCase && isLetter(point));
+		appendByte(bytes, folds, point >> 8, false);
+	}
+
+	bool isEarlier(const StringMatch& a, const StringMatch& b)
+	{
+		return (a.address != b.address) ? a.address < b.address : a.encoding < b.encoding;
+	}
+}
+
+StringScanner::StringScanner(const Process& proc) :	proc_(proc),
+																		residency_(RESIDENCY_ANY)
+{ }
+
+void StringScanner::setResidency(Residency residency)
+{
+	residency_ = residency;
+}
+
+size_t StringScanner::findAll(	const wstring& text,
+											int encodings,
+											bool ignoreCase,
+											const RegionMap& regions,
+											int protection,
+											vector<StringMatch>& dest) const
+{
+	vector<Needle> needles;
+	getNeedles_(text, encodings, ignoreCase, needles);
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(protection, residency_, ranges);
+
+	return scan_(needles, ranges, dest);
+}
+
+size_t StringScanner::findAll(	const wstring& text,
+											int encodings,
+											bool ignoreCase,
+											const RegionMap& regions,
+											ptr_t address,
+											size_t size,
+											vector<StringMatch>& dest) const
+{
+	vector<Needle> needles;
+	getNeedles_(text, encodings, ignoreCase, needles);
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(address, size, PROTECTION_READ, residency_, ranges);
+
+	return scan_(needles, ranges, dest);
+}
+
+void StringScanner::getNeedles_(	const wstring& text,
+											int encodings,
+											bool ignoreCase,
+											vector<Needle>& dest) const
+{
+	if(text.empty())
+		throw invalid_argument("StringScanner::findAll() Error : The text is empty");
+
+	vector<unsigned int> points;
+	getCodePoints(text, points);
+
+	for(int encoding = ENCODING_UTF8; encoding <= ENCODING_UTF16; encoding <<= 1)
+	{
+		if(!(encodings & encoding))
+			continue;
+
+		Needle needle;
+		needle.encoding = static_cast<StringEncoding>(encoding);
+		for(vector<unsigned int>::const_iterator i = points.begin(); i != points.end(); ++i)
+		{
+			if(encoding == ENCODING_UTF8)
+				appendUtf8(needle.bytes, needle.folds, *i, ignoreCase);
+			else
+				appendUtf16(needle.bytes, needle.folds, *i, ignoreCase);
+		}
+
+		//The high bytes of UTF-16 ASCII are zero and filter nothing
+		needle.last = needle.bytes.size() - 1;
+		while(needle.last && !needle.bytes[needle.last])
+			--needle.last;
+
+		dest.push_back(needle);
+	}
+}
+
+size_t StringScanner::scan_(	const vector<Needle>& needles,
+										const vector<MemoryRange>& ranges,
+										vector<StringMatch>& dest) const
+{
+	if(needles.empty())
+		return 0;
+
+	size_t shortest = needles[0].bytes.size();
+	size_t longest = shortest;
+	for(vector<Needle>::const_iterator i = needles.begin(); i != needles.end(); ++i)
+	{
+		shortest = min(shortest, i->bytes.size());
+		longest = max(longest, i->bytes.size());
+	}
+
+	const size_t overlap = longest - 1;
+	buffer_.resize(BLOCK_SIZE + overlap);
+
+	const size_t count = dest.size();
+	for(vector<MemoryRange>::const_iterator range = ranges.begin(); range != ranges.end(); ++range)
+	{
+		for(size_t offset = 0; offset + shortest <= range->size; offset += BLOCK_SIZE)
+		{
+			//Unreadable blocks are skipped, reads stopping early are scanned
+			//as far as they got
+			const ptr_t address = range->address + offset;
+			size_t amount;
+			if(proc_.tryRead(address, &buffer_[0], min<size_t>(BLOCK_SIZE + overlap, range->size - offset), amount) && !amount)
+				continue;
+
+			//Every block is read once and searched for all needles, starts
+			//in the overlap belong to the next block
+			for(vector<Needle>::const_iterator i = needles.begin(); i != needles.end(); ++i)
+			{
+				if(amount >= i->bytes.size())
+					search_(*i, &buffer_[0], min(BLOCK_SIZE, amount - i->bytes.size() + 1), address, dest);
+			}
+		}
+	}
+
+	sort(dest.begin() + count, dest.end(), isEarlier);
+	return dest.size() - count;
+}
+
+void StringScanner::search_(	const Needle& needle,
+										const byte_t* data,
+										size_t end,
+										ptr_t address,
+										vector<StringMatch>& dest) const
+{
+	const byte_t* bytes = &needle.bytes[0];
+	const byte_t* folds = &needle.folds[0];
+	const size_t length = needle.bytes.size();
+	const size_t last = needle.last;
+
+	StringMatch match;
+	match.encoding = needle.encoding;
+
+	size_t position = 0;
+
+#if defined(SYNTHETIC_HASSSE2)
+	//16 positions at once, only ones where the first and last byte match
+	//are compared completely
+	const __m128i first = _mm_set1_epi8(static_cast<char>(bytes[0]));
+	const __m128i firstFold = _mm_set1_epi8(static_cast<char>(folds[0]));
+	const __m128i lastByte = _mm_set1_epi8(static_cast<char>(bytes[last]));
+	const __m128i lastFold = _mm_set1_epi8(static_cast<char>(folds[last]));
+
+	for(; position + 16 <= end; position += 16)
+	{
+		const __m128i heads = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position)), firstFold);
+		const __m128i tails = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + last)), lastFold);
+		int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(heads, first), _mm_cmpeq_epi8(tails, lastByte)));
+
+		for(; mask; mask &= mask - 1)
+		{
+			const byte_t* candidate = data + position + Kernels::lowestBit(mask);
+
+			size_t i = 1;
+			while(i < length && (candidate[i] | folds[i]) == bytes[i])
+				++i;
+
+			if(i == length)
+			{
+				match.address = address + (candidate - data);
+				dest.push_back(match);
+			}
+		}
+	}
+#endif
+
+	for(; position < end; ++position)
+	{
+		const byte_t* candidate = data + position;
+		if((candidate[last] | folds[last]) != bytes[last])
+			continue;
+
+		size_t i = 0;
+		while(i < length && (candidate[i] | folds[i]) == bytes[i])
+			++i;
+
+		if(i == length)
+		{
+			match.address = address + position;
+			dest.push_back(match);
+		}
+	}
+}
+
+/******************
+******* EOF *******
+******************/
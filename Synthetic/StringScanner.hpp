@@ -0,0 +1,197 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_STRINGSCANNER_HPP
+#define SYNTHETIC_PROCESS_STRINGSCANNER_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "RegionMap.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* Encodings a StringScanner searches, may be combined
+	*/
+	enum StringEncoding
+	{
+		ENCODING_UTF8 = 1,		//ASCII strings are UTF-8 as well
+		ENCODING_UTF16 = 2		//Little endian
+	};
+
+	/**
+	* A string found by a StringScanner
+	*/
+	struct StringMatch
+	{
+		ptr_t address;
+		StringEncoding encoding;
+	};
+
+	/**
+	* Searches strings in a process' memory.\n
+	* The text is encoded once per encoding and every block of memory is
+	* read once and searched for all encodings. Positions are filtered by
+	* comparing their first and last characters 16 at a time with SSE2,
+	* only the few left are compared completely.\n
+	* Ignoring case folds ASCII letters only, other characters have to
+	* match exactly.\n
+	*/
+	class StringScanner
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param proc The process to scan. Has to be valid the whole
+		* lifetime.
+		*/
+		StringScanner(const Process& proc);
+
+		/**
+		* Sets which pages scans read, RESIDENCY_ANY by default. Strings
+		* running into a skipped page aren't found.
+		* @param residency Which pages to read.
+		*/
+		void setResidency(Residency residency);
+
+		/**
+		* Searches all occurrences of a text in the process' memory.
+		* @param text The text, without terminating zero.
+		* @param encodings StringEncoding flags to search.
+		* @param ignoreCase true to fold ASCII letters.
+		* @param regions The regions of the process.
+		* @param protection MemoryProtection flags a region needs to have
+		* all of.
+		* @param dest Reference to a vector the matches are appended to, in
+		* ascending order.
+		* @return size_t Number of matches.
+		*/
+		size_t findAll(	const std::wstring& text,
+								int encodings,
+								bool ignoreCase,
+								const RegionMap& regions,
+								int protection,
+								std::vector<StringMatch>& dest) const;
+
+		/**
+		* Searches all occurrences of a text in a range.
+		* @param text The text, without terminating zero.
+		* @param encodings StringEncoding flags to search.
+		* @param ignoreCase true to fold ASCII letters.
+		* @param regions The regions of the process.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param dest Reference to a vector the matches are appended to, in
+		* ascending order.
+		* @return size_t Number of matches.
+		*/
+		size_t findAll(	const std::wstring& text,
+								int encodings,
+								bool ignoreCase,
+								const RegionMap& regions,
+								ptr_t address,
+								size_t size,
+								std::vector<StringMatch>& dest) const;
+
+	private:
+
+		/*
+		* A text in one encoding, bytes with a fold of 0x20 are ASCII
+		* letters compared in lower case
+		*/
+		struct Needle
+		{
+			std::vector<byte_t> bytes;
+			std::vector<byte_t> folds;
+			StringEncoding encoding;
+
+			//Second byte filtered, the last one which isn't zero
+			size_t last;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Encodes the text for every encoding asked for
+		*/
+		void getNeedles_(	const std::wstring& text,
+								int encodings,
+								bool ignoreCase,
+								std::vector<Needle>& dest) const;
+
+		/*
+		* Scans ranges for all needles, appends matches to dest
+		*/
+		size_t scan_(	const std::vector<Needle>& needles,
+							const std::vector<MemoryRange>& ranges,
+							std::vector<StringMatch>& dest) const;
+
+		/*
+		* Searches a needle at the first end positions of a buffer
+		*/
+		void search_(	const Needle& needle,
+							const byte_t* data,
+							size_t end,
+							ptr_t address,
+							std::vector<StringMatch>& dest) const;
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+
+		//Reused read buffer
+		mutable std::vector<byte_t> buffer_;
+
+		Residency residency_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_STRINGSCANNER_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,502 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+//Windows header files:
+#include <Windows.h>
+
+//Synthetic header files:
+#include "WinException.hpp"
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+//C header files:
+#include <elf.h>
+#include <link.h>
+#include <stdio.h>
+#include <errno.h>
+
+//Synthetic header files:
+#include "PosixException.hpp"
+
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "SymbolCache.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+namespace
+{
+	const char CACHE_MAGIC[8] = {'S', 'Y', 'N', 'C', 'A', 'C', 'H', 'E'};
+	const dword_t CACHE_VERSION = 1;
+
+	/*
+	* Layout of a cache file: header, records sorted by identity, type and
+	* key hash, then the zero terminated keys
+	*/
+	struct FileHeader
+	{
+		char magic[8];
+		dword_t version;
+		dword_t recordCount;
+		qword_t stringsOffset;
+		qword_t stringsSize;
+	};
+
+	struct FileRecord
+	{
+		qword_t identity;
+		qword_t keyHash;
+		qword_t value;
+		dword_t type;
+		dword_t key;
+	};
+
+	/*
+	* 64-bit FNV-1a
+	*/
+	qword_t hashBytes(const void* data, size_t size, qword_t hash = 14695981039346656037ull)
+	{
+		const byte_t* bytes = static_cast<const byte_t*>(data);
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	/*
+	* Combines the parts of a key for the pending index
+	*/
+	qword_t combineKey(qword_t identity, dword_t type, qword_t keyHash)
+	{
+		qword_t hash = hashBytes(&identity, sizeof(identity));
+		hash = hashBytes(&type, sizeof(type), hash);
+		return hashBytes(&keyHash, sizeof(keyHash), hash);
+	}
+
+	/*
+	* Orders records, only the hash part of the key is compared
+	*/
+	template<typename lhs_t, typename rhs_t>
+	bool compareKey(const lhs_t& lhs, const rhs_t& rhs)
+	{
+		if(lhs.identity != rhs.identity)
+			return lhs.identity < rhs.identity;
+		if(lhs.type != rhs.type)
+			return lhs.type < rhs.type;
+		return lhs.keyHash < rhs.keyHash;
+	}
+}
+
+/******************************************************************************
+*******************************************************************************
+*************************** PUBLIC FREE FUNCTIONS *****************************
+*******************************************************************************
+******************************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+qword_t SymbolCache::identify(const Process& proc, ptr_t base)
+{
+	const IMAGE_DOS_HEADER dosHeader = proc.readMemory<IMAGE_DOS_HEADER>(base);
+	if(dosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+		throw runtime_error("SymbolCache::identify() Error : No PE image at base address");
+
+	//The fields used are at the same offsets in both header versions
+	IMAGE_NT_HEADERS32 ntHeaders;
+	proc.rawRead(base + dosHeader.e_lfanew, &ntHeaders, sizeof(ntHeaders));
+	if(ntHeaders.Signature != IMAGE_NT_SIGNATURE)
+		throw runtime_error("SymbolCache::identify() Error : Invalid NT headers");
+
+	const dword_t fields[] =
+	{
+		ntHeaders.FileHeader.Machine,
+		ntHeaders.FileHeader.NumberOfSections,
+		ntHeaders.FileHeader.TimeDateStamp,
+		ntHeaders.OptionalHeader.AddressOfEntryPoint,
+		ntHeaders.OptionalHeader.SizeOfImage,
+		ntHeaders.OptionalHeader.CheckSum
+	};
+
+	return hashBytes(fields, sizeof(fields));
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+qword_t SymbolCache::identify(const Process& proc, ptr_t base)
+{
+	ElfW(Ehdr) header = proc.readMemory<ElfW(Ehdr)>(base);
+	if(memcmp(header.e_ident, ELFMAG, SELFMAG))
+		throw runtime_error("SymbolCache::identify() Error : No ELF image at base address");
+
+	vector<ElfW(Phdr)> segments(header.e_phnum);
+	if(!segments.empty())
+		proc.rawRead(base + header.e_phoff, &segments[0], segments.size() * sizeof(ElfW(Phdr)));
+
+	ptr_t imageBase = 0;
+	for(vector<ElfW(Phdr)>::const_iterator i = segments.begin(); i != segments.end(); ++i)
+	{
+		if(i->p_type == PT_LOAD)
+		{
+			imageBase = i->p_vaddr - i->p_offset;
+			break;
+		}
+	}
+
+	//The build-id note changes with every build
+	for(vector<ElfW(Phdr)>::const_iterator i = segments.begin(); i != segments.end(); ++i)
+	{
+		if(i->p_type != PT_NOTE || !i->p_memsz || i->p_memsz > 0x10000)
+			continue;
+
+		vector<byte_t> notes(i->p_memsz);
+		proc.rawRead(base + i->p_vaddr - imageBase, &notes[0], notes.size());
+
+		size_t offset = 0;
+		while(offset + sizeof(ElfW(Nhdr)) <= notes.size())
+		{
+			ElfW(Nhdr) note;
+			memcpy(&note, &notes[offset], sizeof(note));
+			offset += sizeof(note);
+
+			const size_t nameSize = (note.n_namesz + 3) & ~3;
+			const size_t descSize = (note.n_descsz + 3) & ~3;
+			if(nameSize > notes.size() - offset || descSize > notes.size() - offset - nameSize)
+				break;
+
+			if(	note.n_type == NT_GNU_BUILD_ID &&
+					note.n_namesz == 4 &&
+					!memcmp(&notes[offset], "GNU", 4) &&
+					note.n_descsz)
+			{
+				return hashBytes(&notes[offset + nameSize], note.n_descsz);
+			}
+
+			offset += nameSize + descSize;
+		}
+	}
+
+	//Without build-id the headers still change with most rebuilds
+	qword_t hash = hashBytes(&header, sizeof(header));
+	if(!segments.empty())
+		hash = hashBytes(&segments[0], segments.size() * sizeof(ElfW(Phdr)), hash);
+	return hash;
+}
+
+#endif
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+SymbolCache::SymbolCache()
+{ }
+
+#if defined(SYNTHETIC_ISWINDOWS)
+bool SymbolCache::open(const wstring& path)
+#elif defined(SYNTHETIC_ISLINUX)
+bool SymbolCache::open(const string& path)
+#endif
+{
+	pending_.clear();
+	pendingIndex_.clear();
+
+	path_ = path;
+	return file_.open(path) && validate_();
+}
+
+bool SymbolCache::lookup(	qword_t identity,
+									SymbolCacheType type,
+									const string& key,
+									qword_t& dest) const
+{
+	Value search;
+	search.identity = identity;
+	search.type = type;
+	search.keyHash = hashBytes(key.data(), key.size());
+	search.key = key;
+
+	//Values stored later replace those of the file
+	const Value* pending = lookupPending_(search);
+	if(pending)
+	{
+		dest = pending->value;
+		return true;
+	}
+
+	return lookupFile_(search, dest);
+}
+
+void SymbolCache::store(	qword_t identity,
+									SymbolCacheType type,
+									const string& key,
+									qword_t value)
+{
+	Value entry;
+	entry.identity = identity;
+	entry.type = type;
+	entry.keyHash = hashBytes(key.data(), key.size());
+	entry.key = key;
+	entry.value = value;
+
+	Value* pending = const_cast<Value*>(lookupPending_(entry));
+	if(pending)
+	{
+		pending->value = value;
+		return;
+	}
+
+	pendingIndex_.insert(make_pair(combineKey(identity, type, entry.keyHash), pending_.size()));
+	pending_.push_back(entry);
+}
+
+void SymbolCache::save()
+{
+	if(pending_.empty())
+		return;
+
+	if(path_.empty())
+		throw runtime_error("SymbolCache::save() Error : No cache file opened");
+
+	//Pending values first, so they survive removing duplicates
+	vector<Value> values(pending_);
+	if(file_.isValid())
+	{
+		const FileHeader* header = reinterpret_cast<const FileHeader*>(file_.getData());
+		const FileRecord* records = reinterpret_cast<const FileRecord*>(header + 1);
+		const char* strings = reinterpret_cast<const char*>(file_.getData() + header->stringsOffset);
+
+		values.reserve(values.size() + header->recordCount);
+		for(dword_t i = 0; i < header->recordCount; ++i)
+		{
+			Value value;
+			value.identity = records[i].identity;
+			value.keyHash = records[i].keyHash;
+			value.type = records[i].type;
+			value.key = strings + records[i].key;
+			value.value = records[i].value;
+			values.push_back(value);
+		}
+	}
+
+	stable_sort(values.begin(), values.end(), compareKey<Value, Value>);
+
+	vector<FileRecord> records;
+	vector<char> strings;
+	records.reserve(values.size());
+	for(size_t i = 0; i < values.size(); ++i)
+	{
+		//Equal keys are adjacent, the first one is the newest
+		bool duplicate = false;
+		for(size_t j = i; j > 0 && !compareKey(values[j - 1], values[i]); --j)
+		{
+			if(values[j - 1].key == values[i].key)
+			{
+				duplicate = true;
+				break;
+			}
+		}
+
+		if(duplicate)
+			continue;
+
+		FileRecord record;
+		record.identity = values[i].identity;
+		record.keyHash = values[i].keyHash;
+		record.value = values[i].value;
+		record.type = values[i].type;
+		record.key = static_cast<dword_t>(strings.size());
+		records.push_back(record);
+
+		strings.insert(strings.end(), values[i].key.begin(), values[i].key.end());
+		strings.push_back('\0');
+	}
+
+	FileHeader header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	header.recordCount = static_cast<dword_t>(records.size());
+	header.stringsOffset = sizeof(FileHeader) + records.size() * sizeof(FileRecord);
+	header.stringsSize = strings.size();
+
+	//Written next to the file and moved over it, the mapping has to go
+	//first on Windows
+#if defined(SYNTHETIC_ISWINDOWS)
+	const wstring tempPath = path_ + L".tmp";
+#elif defined(SYNTHETIC_ISLINUX)
+	const string tempPath = path_ + ".tmp";
+#endif
+
+	{
+		ofstream stream(tempPath.c_str(), ios::binary | ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if(!records.empty())
+			stream.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(FileRecord));
+		if(!strings.empty())
+			stream.write(&strings[0], strings.size());
+
+		stream.flush();
+		if(!stream)
+			throw runtime_error("SymbolCache::save() Error : Writing the cache file failed");
+	}
+
+	file_.close();
+
+	//On failure the old file is mapped again, it's still in place
+#if defined(SYNTHETIC_ISWINDOWS)
+	if(!MoveFileExW(tempPath.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		const DWORD error = GetLastError();
+		DeleteFileW(tempPath.c_str());
+		if(file_.open(path_))
+			validate_();
+
+		throw WinException(	"SymbolCache::save()",
+									"MoveFileExW()",
+									error);
+	}
+#elif defined(SYNTHETIC_ISLINUX)
+	if(rename(tempPath.c_str(), path_.c_str()))
+	{
+		const int error = errno;
+		remove(tempPath.c_str());
+		if(file_.open(path_))
+			validate_();
+
+		throw PosixException(	"SymbolCache::save()",
+										"rename()",
+										error);
+	}
+#endif
+
+	pending_.clear();
+	pendingIndex_.clear();
+
+	if(file_.open(path_))
+		validate_();
+}
+
+size_t SymbolCache::getPendingCount() const
+{
+	return pending_.size();
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+bool SymbolCache::validate_()
+{
+	const size_t size = file_.getSize();
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file_.getData());
+
+	bool valid =	size >= sizeof(FileHeader) &&
+						!memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) &&
+						header->version == CACHE_VERSION;
+
+	if(valid)
+	{
+		const qword_t recordsEnd = sizeof(FileHeader) + qword_t(header->recordCount) * sizeof(FileRecord);
+		valid =	header->stringsOffset == recordsEnd &&
+					recordsEnd <= size &&
+					header->stringsSize <= size - recordsEnd &&
+					(!header->stringsSize || file_.getData()[recordsEnd + header->stringsSize - 1] == '\0');
+	}
+
+	if(valid)
+	{
+		//Every key has to lie in the string table
+		const FileRecord* records = reinterpret_cast<const FileRecord*>(header + 1);
+		for(dword_t i = 0; i < header->recordCount && valid; ++i)
+			valid = records[i].key < header->stringsSize;
+	}
+
+	//Outdated or foreign files are replaced on the next save
+	if(!valid)
+		file_.close();
+
+	return valid;
+}
+
+const SymbolCache::Value* SymbolCache::lookupPending_(const Value& key) const
+{
+	typedef unordered_multimap<qword_t, size_t>::const_iterator iterator;
+
+	pair<iterator, iterator> range = pendingIndex_.equal_range(combineKey(key.identity, key.type, key.keyHash));
+	for(iterator i = range.first; i != range.second; ++i)
+	{
+		const Value& value = pending_[i->second];
+		if(	value.identity == key.identity &&
+				value.type == key.type &&
+				value.key == key.key)
+		{
+			return &value;
+		}
+	}
+
+	return NULL;
+}
+
+bool SymbolCache::lookupFile_(const Value& key, qword_t& dest) const
+{
+	if(!file_.isValid())
+		return false;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file_.getData());
+	const FileRecord* first = reinterpret_cast<const FileRecord*>(header + 1);
+	const FileRecord* last = first + header->recordCount;
+	const char* strings = reinterpret_cast<const char*>(file_.getData() + header->stringsOffset);
+
+	for(const FileRecord* i = lower_bound(first, last, key, compareKey<FileRecord, Value>);
+		i != last && !compareKey(key, *i);
+		++i)
+	{
+		if(key.key == strings + i->key)
+		{
+			dest = i->value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/******************
+******* EOF *******
+******************/
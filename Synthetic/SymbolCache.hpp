@@ -0,0 +1,211 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_SYMBOLCACHE_HPP
+#define SYNTHETIC_PROCESS_SYMBOLCACHE_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "MappedFile.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* Kinds of values a SymbolCache holds, each has its own key space
+	*/
+	enum SymbolCacheType
+	{
+		CACHE_EXPORT,			//Export address relative to the module base
+		CACHE_SIGNATURE,		//Pattern scan hit relative to the module base
+		CACHE_OFFSET			//Anything else, like struct member offsets
+	};
+
+	/**
+	* Persistent cache of values found by parsing or scanning modules.\n
+	* Values are keyed by a module identity, their type and a name, so they
+	* stay valid as long as the module's file doesn't change, wherever it
+	* gets loaded.\n
+	* The file is mapped and searched in place, opening it costs nothing
+	* but the mapping. New values are kept in memory until save() merges
+	* them into the file.\n
+	*/
+	class SymbolCache
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Computes the identity of a module loaded in a process.
+		* PE images are identified by timestamp, checksum, image size and
+		* machine, ELF images by their build-id or a hash of their headers
+		* if they don't have one.
+		* @param proc The process the module is loaded in.
+		* @param base The module's base address.
+		* @return qword_t The identity.
+		*/
+		static qword_t identify(const Process& proc, ptr_t base);
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty cache without file.
+		*/
+		SymbolCache();
+
+		/**
+		* Opens a cache file. Missing or invalid files give an empty cache
+		* which is written on save().
+		* @param path Path of the file.
+		* @return bool true if existing values were loaded.
+		*/
+	#if defined(SYNTHETIC_ISWINDOWS)
+		bool open(const std::wstring& path);
+	#elif defined(SYNTHETIC_ISLINUX)
+		bool open(const std::string& path);
+	#endif
+
+		/**
+		* Searches a value.
+		* @param identity The module's identity.
+		* @param type The value's type.
+		* @param key The value's name.
+		* @param dest Reference to a variable receiving the value.
+		* @return bool true if the value was found.
+		*/
+		bool lookup(	qword_t identity,
+							SymbolCacheType type,
+							const std::string& key,
+							qword_t& dest) const;
+
+		/**
+		* Adds or replaces a value, it's written on the next save().
+		* @param identity The module's identity.
+		* @param type The value's type.
+		* @param key The value's name.
+		* @param value The value.
+		*/
+		void store(	qword_t identity,
+						SymbolCacheType type,
+						const std::string& key,
+						qword_t value);
+
+		/**
+		* Writes all values to the file if any were stored. A new file is
+		* renamed over the old one, so concurrent readers see either
+		* version. Windows refuses to replace a file another process has
+		* mapped, save() throws then and the values stay pending for the
+		* next call, lookups keep using the old file.
+		*/
+		void save();
+
+		/**
+		* @return size_t Number of values stored since the last save().
+		*/
+		size_t getPendingCount() const;
+
+	private:
+
+		/*
+		* A value with its key, as kept in memory
+		*/
+		struct Value
+		{
+			qword_t identity;
+			qword_t keyHash;
+			dword_t type;
+			std::string key;
+			qword_t value;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Validates the mapped file, unmaps it if it isn't a cache file
+		*/
+		bool validate_();
+
+		/*
+		* Searches the values stored since the last save
+		*/
+		const Value* lookupPending_(const Value& key) const;
+
+		/*
+		* Searches the mapped file
+		*/
+		bool lookupFile_(const Value& key, qword_t& dest) const;
+
+		/*
+		* Disallow copying
+		*/
+		SymbolCache(const SymbolCache&);
+		SymbolCache& operator=(const SymbolCache&);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+	#if defined(SYNTHETIC_ISWINDOWS)
+		std::wstring path_;
+	#elif defined(SYNTHETIC_ISLINUX)
+		std::string path_;
+	#endif
+
+		MappedFile file_;
+
+		//Values stored since the last save and their index by key hash
+		std::vector<Value> pending_;
+		std::unordered_multimap<qword_t, size_t> pendingIndex_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_SYMBOLCACHE_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,141 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+//C++ header files:
+#include <sstream>
+#include <cstring>
+#include <exception>
+
+//Synthetic header files:
+#include "Symbolizer.hpp"
+
+using namespace std;
+using namespace Synthetic;
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+Symbolizer::Symbolizer(const ModuleManager& modules) : modules_(modules)
+{ }
+
+bool Symbolizer::symbolize(ptr_t address, Symbol& dest)
+{
+	dest.address = address;
+	dest.module = modules_.findModuleContaining(address);
+	dest.moduleOffset = 0;
+	dest.exportEntry = NULL;
+	dest.exportName = NULL;
+	dest.exportOffset = 0;
+
+	if(!dest.module)
+		return false;
+
+	dest.moduleOffset = address - dest.module->getBaseAddress();
+
+	const ExportTable& exports = getExports_(*dest.module);
+	dest.exportEntry = exports.findNearest(static_cast<dword_t>(dest.moduleOffset));
+	if(dest.exportEntry)
+	{
+		dest.exportName = exports.getName(*dest.exportEntry);
+		dest.exportOffset = dest.moduleOffset - dest.exportEntry->rva;
+	}
+
+	return true;
+}
+
+size_t Symbolizer::symbolize(const vector<ptr_t>& addresses, vector<Symbol>& dest)
+{
+	size_t found = 0;
+	size_t offset = dest.size();
+
+	dest.resize(offset + addresses.size());
+	for(size_t i = 0; i < addresses.size(); ++i)
+	{
+		if(symbolize(addresses[i], dest[offset + i]))
+			++found;
+	}
+
+	return found;
+}
+
+wstring Symbolizer::format(const Symbol& symbol) const
+{
+	wostringstream stream;
+	stream << hex << showbase;
+
+	if(!symbol.module)
+	{
+		stream << symbol.address;
+		return stream.str();
+	}
+
+	stream << symbol.module->getName();
+	if(!symbol.exportEntry)
+	{
+		stream << L'+' << symbol.moduleOffset;
+		return stream.str();
+	}
+
+	stream << L'!';
+	if(symbol.exportName)
+		stream << wstring(symbol.exportName, symbol.exportName + strlen(symbol.exportName));
+	else
+		stream << L'#' << dec << symbol.exportEntry->ordinal << hex;
+
+	if(symbol.exportOffset)
+		stream << L'+' << symbol.exportOffset;
+
+	return stream.str();
+}
+
+void Symbolizer::clear()
+{
+	unreadable_.clear();
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+const ExportTable& Symbolizer::getExports_(const Module& mod)
+{
+	if(unreadable_.count(mod.getBaseAddress()))
+		return empty_;
+
+	//A module without readable exports still symbolizes as module+offset
+	try
+	{
+		return modules_.getExportTable(mod);
+	}
+	catch(const exception&)
+	{
+		unreadable_.insert(mod.getBaseAddress());
+		return empty_;
+	}
+}
+
+/******************
+******* EOF *******
+******************/
@@ -0,0 +1,158 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_SYMBOLIZER_HPP
+#define SYNTHETIC_PROCESS_SYMBOLIZER_HPP
+
+//C++ Header Files:
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+//Synthetic Header Files:
+#include "ModuleManager.hpp"
+#include "ExportTable.hpp"
+#include "Module.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	/**
+	* Location of an address in terms of modules and exports
+	*/
+	struct Symbol
+	{
+		ptr_t address;
+
+		/**
+		* The module containing the address or NULL
+		*/
+		const Module* module;
+		ptr_t moduleOffset;
+
+		/**
+		* The nearest export at or below the address or NULL
+		*/
+		const ExportEntry* exportEntry;
+
+		/**
+		* The export's name, NULL if it has none
+		*/
+		const char* exportName;
+		ptr_t exportOffset;
+	};
+
+	/**
+	* Translates addresses to module+offset or export+offset.\n
+	* Modules and their export tables are taken from the ModuleManager's
+	* caches, the symbolizer doesn't refresh them. Symbols point into
+	* these caches and are valid until the modules are refreshed.\n
+	*/
+	class Symbolizer
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param modules The process' modules. Has to be valid the whole
+		* lifetime.
+		*/
+		Symbolizer(const ModuleManager& modules);
+
+		/**
+		* Symbolizes an address.
+		* @param address The address.
+		* @param dest Reference to the symbol to fill.
+		* @return bool true if the address belongs to a module.
+		*/
+		bool symbolize(ptr_t address, Symbol& dest);
+
+		/**
+		* Symbolizes many addresses.
+		* @param addresses The addresses.
+		* @param dest Reference to a vector the symbols are appended to in
+		* the order of addresses.
+		* @return size_t Number of addresses belonging to a module.
+		*/
+		size_t symbolize(const std::vector<ptr_t>& addresses, std::vector<Symbol>& dest);
+
+		/**
+		* Formats a symbol like module.dll!Export+0x1a, module.dll!#12+0x1a
+		* for exports by ordinal, module.dll+0x1234 or just the address.
+		* @param symbol The symbol.
+		* @return std::wstring The formatted symbol.
+		*/
+		std::wstring format(const Symbol& symbol) const;
+
+		/**
+		* Retries reading exports of modules which failed before.
+		*/
+		void clear();
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Returns the module's export table or an empty one if it can't
+		* be read
+		*/
+		const ExportTable& getExports_(const Module& mod);
+
+		/*
+		* Disallow copying
+		*/
+		Symbolizer(const Symbolizer&);
+		Symbolizer& operator=(const Symbolizer&);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const ModuleManager& modules_;
+
+		//Bases of modules without readable exports, so they aren't
+		//retried on every lookup
+		std::unordered_set<ptr_t> unreadable_;
+		ExportTable empty_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_SYMBOLIZER_HPP
+
+/******************
+******* EOF *******
+******************/
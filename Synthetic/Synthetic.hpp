@@ -25,13 +25,41 @@
 #ifndef SYNTHETIC_SYNTHETIC_HPP
 #define SYNTHETIC_SYNTHETIC_HPP
 
+#include "System.hpp"
 #include "Process.hpp"
+#include "ProcessTable.hpp"
+#include "ExitMonitor.hpp"
 #include "ModuleManager.hpp"
-#include "ThreadManager.hpp"
+#include "ModuleTable.hpp"
+#include "ModuleWatcher.hpp"
+#include "ExportTable.hpp"
+#include "Symbolizer.hpp"
+#include "SymbolCache.hpp"
+#include "MappedFile.hpp"
+#include "PatternScanner.hpp"
+#include "ValueScanner.hpp"
+#include "GroupScanner.hpp"
+#include "StringScanner.hpp"
+#include "RegionMap.hpp"
+#include "PageMap.hpp"
+#include "DirtyTracker.hpp"
+#include "ThreadStats.hpp"
 #include "SysObjectIterator.hpp"
+#include "SysObjectSnapshot.hpp"
 #include "Allocator.hpp"
-#include "SmartType.hpp"
-#include "WinException.hpp"
+#include "RemoteSyscall.hpp"
+#include "RemoteFunction.hpp"
 #include "Types.hpp"
 
+//Thread, stack and worker thread support is built on the Win32 debugging API
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "ThreadManager.hpp"
+	#include "StackWalker.hpp"
+	#include "RemoteExecutor.hpp"
+	#include "SmartType.hpp"
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
 #endif //SYNTHETIC_SYNTHETIC_HPP
\ No newline at end of file
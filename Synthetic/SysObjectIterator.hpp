@@ -18,6 +18,7 @@
 	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
 */
 
+
 #if (defined _MSC_VER) && (_MSC_VER >= 1200)
 	#pragma once
 #endif
@@ -25,9 +26,8 @@
 #ifndef SYNTHETIC_SYSOBJECTITERATOR_HPP
 #define SYNTHETIC_SYSOBJECTITERATOR_HPP
 
-//Windows header files:
-#include <Windows.h>
-#include <TlHelp32.h>
+//Synthetic header files:
+#include "System.hpp"
 
 //C++ header files:
 #include <stdexcept>
@@ -35,93 +35,68 @@
 
 //Synthetic header files:
 #include "Types.hpp"
-#include "WinException.hpp"
-#include "Auxiliary.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "TlhelpIterator.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "ProcfsIterator.hpp"
+#endif
 
 namespace Synthetic
 {
 	/**
 	* STL compliant input iterator\n
-	* Template class to wrap iterating the Tlhelp32 API.\n
-	* entry_t			= Type of entry returned by the First/Next functions\n
-	* func_getfirst	= Functionpointer to function retrieving the first entry\n
-	* func_getnext		= Function pointer to function retrieving the next entry\n
-	* flag_spec			= Defines a flag for use in CreateToolhelp32Snapshot()\n
+	* Template class to wrap iterating system objects like processes,
+	* threads and modules.\n
+	* backend_t = Policy doing the actual iteration. It provides the
+	* entry_type typedef, first(pid, fields) and next() returning false
+	* once there are no more entries and get() returning the current
+	* entry. tryFirst(pid, fields, error) is first() returning errors
+	* instead of throwing them. ToolhelpBackend wraps the Tlhelp32 API,
+	* the Linux backends walk /proc.\n
 	*/
-	template<	class entry_t,
-					BOOL (__stdcall *func_getfirst)(HANDLE, entry_t*),
-					BOOL (__stdcall *func_getnext)(HANDLE, entry_t*),
-					unsigned long flag_spec>
+	template<class backend_t>
 	class SysObjectIterator : public std::iterator<	std::input_iterator_tag,
-																	entry_t>
+																	typename backend_t::entry_type>
 	{
 
 	public:
 
+		typedef typename backend_t::entry_type entry_type;
+
 		/**
 		* Simple Constructor allocating data and validating the iterator.
 		* @param pid Specify a process id for which data should be iterated.
 		* Passing zero will iterate all specific resources on the system.
+		* @param fields (optional) Backend specific flags telling which
+		* data to read per entry, like the ProcEntryField flags on Linux.
 		*/
-		SysObjectIterator(pid_t pid)
+		SysObjectIterator(pid_t pid, int fields = 0)
 		{
-			//Get a snapshot
-			entry_.dwSize = sizeof(entry_t);
-			snapshot_ = CreateToolhelp32Snapshot(flag_spec, pid);
-			if(snapshot_ == INVALID_HANDLE_VALUE)
-			{
-				DWORD error = GetLastError();
-				throw WinException(	"SysObjectIterator::SysObjectIterator()",
-											"CreateToolhelp32Snapshot()",
-											error);
-			}
-
-			//Get first entry
-			state_ = func_getfirst(snapshot_, &entry_);
-			if(!state_)
-			{
-				DWORD error = GetLastError();
-				throw WinException(	"SysObjectIterator::SysObjectIterator()",
-											"func_getfirst()",
-											error);
-			}
+			state_ = backend_.first(pid, fields);
 		}
 
 		/**
-		* Hackish constructor to create an invalid iterator.
-		* Constructing it will create an invalid iterator
-		* for use in loops etc.
-		*/
-		SysObjectIterator() : state_(FALSE), snapshot_(0)
-		{ }
-
-		/**
-		* Copyconstructor for deep copy.
-		* @param it SysObjectIterator to copy.
+		* Constructor returning errors instead of throwing them, the
+		* iterator is invalid then.
+		* @param pid Specify a process id for which data should be iterated.
+		* Passing zero will iterate all specific resources on the system.
+		* @param fields Backend specific flags telling which data to read
+		* per entry.
+		* @param error Reference receiving the error, zero on success.
 		*/
-		SysObjectIterator(const SysObjectIterator& it)
+		SysObjectIterator(pid_t pid, int fields, errorcode_t& error)
 		{
-			if(!it.isInValidState())
-			{
-				state_		= FALSE;
-				snapshot_	= 0;
-			}
-			else
-			{
-				state_		= TRUE;
-				snapshot_	= Aux::duplicateHandleLocal(it.snapshot_);
-				entry_		= it.entry_;
-			}
+			state_ = backend_.tryFirst(pid, fields, error);
 		}
 
 		/**
-		* Simple destructor freeing resources.
+		* Hackish constructor to create an invalid iterator.
+		* Constructing it will create an invalid iterator
+		* for use in loops etc.
 		*/
-		~SysObjectIterator()
-		{
-			if(snapshot_ != INVALID_HANDLE_VALUE && snapshot_ != 0)
-				CloseHandle(snapshot_);
-		}
+		SysObjectIterator() : state_(false)
+		{ }
 
 		/**
 		* Checks if the iterator is valid.
@@ -129,7 +104,7 @@ namespace Synthetic
 		*/
 		bool isInValidState() const
 		{
-			return state_ != FALSE;
+			return state_;
 		}
 
 		/**
@@ -154,7 +129,7 @@ namespace Synthetic
 		* Pseudo-dereferencing operator returning the current entry.
 		* @return Current entry.
 		*/
-		const entry_t& operator*() const
+		const entry_type& operator*() const
 		{
 			using namespace std;
 
@@ -165,14 +140,14 @@ namespace Synthetic
 								
 			}
 
-			return entry_;
+			return backend_.get();
 		}
 
 		/**
 		* Pseudo-pointer operator returning a pointer to the current entry.
 		* @return Pointer to current entry.
 		*/
-		const entry_t* operator->() const
+		const entry_type* operator->() const
 		{
 			using namespace std;
 
@@ -183,7 +158,7 @@ namespace Synthetic
 								
 			}
 
-			return &entry_;
+			return &backend_.get();
 		}
 
 		/**
@@ -202,7 +177,7 @@ namespace Synthetic
 								
 			}
 
-			state_ = func_getnext(snapshot_, &entry_);
+			state_ = backend_.next();
 
 			return *this;
 		}
@@ -229,35 +204,43 @@ namespace Synthetic
 		}
 
 	protected:
-		HANDLE snapshot_;
-		entry_t entry_;
-		BOOL state_;
+		backend_t backend_;
+		bool state_;
 	};
 
-	typedef SysObjectIterator<	PROCESSENTRY32W,
-										Process32FirstW,
-										Process32NextW,
-										TH32CS_SNAPPROCESS>	ProcessIterator;
-
-	typedef SysObjectIterator< THREADENTRY32,
-										Thread32First,
-										Thread32Next,
-										TH32CS_SNAPTHREAD>	ThreadIterator;
-
-	typedef SysObjectIterator<	MODULEENTRY32W,
-										Module32FirstW,
-										Module32NextW,
-										TH32CS_SNAPMODULE>	ModuleIterator;
-
-	typedef SysObjectIterator<	HEAPLIST32,
-										Heap32ListFirst,
-										Heap32ListNext,
-										TH32CS_SNAPHEAPLIST>	HeapListIterator;
-									
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	typedef SysObjectIterator<ToolhelpBackend<	PROCESSENTRY32W,
+																Process32FirstW,
+																Process32NextW,
+																TH32CS_SNAPPROCESS> >	ProcessIterator;
+
+	typedef SysObjectIterator<ToolhelpBackend<	THREADENTRY32,
+																Thread32First,
+																Thread32Next,
+																TH32CS_SNAPTHREAD> >		ThreadIterator;
+
+	typedef SysObjectIterator<ToolhelpBackend<	MODULEENTRY32W,
+																Module32FirstW,
+																Module32NextW,
+																TH32CS_SNAPMODULE> >		ModuleIterator;
+
+	typedef SysObjectIterator<ToolhelpBackend<	HEAPLIST32,
+																Heap32ListFirst,
+																Heap32ListNext,
+																TH32CS_SNAPHEAPLIST> >	HeapListIterator;
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	typedef SysObjectIterator<ProcessBackend>	ProcessIterator;
+	typedef SysObjectIterator<ThreadBackend>	ThreadIterator;
+	typedef SysObjectIterator<MapsBackend>		ModuleIterator;
+
+#endif
 }
 
 #endif //SYNTHETIC_SYSOBJECTITERATOR_HPP
 
 /******************
 ******* EOF *******
-******************/
\ No newline at end of file
+******************/
@@ -0,0 +1,301 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_SYSOBJECTSNAPSHOT_HPP
+#define SYNTHETIC_SYSOBJECTSNAPSHOT_HPP
+
+//Synthetic header files:
+#include "System.hpp"
+
+//C++ header files:
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+//Synthetic header files:
+#include "Types.hpp"
+#include "SysObjectIterator.hpp"
+
+namespace Synthetic
+{
+	/*
+	* Ids SysObjectSnapshot sorts and looks up entries by, the PID, TID
+	* or base address
+	*/
+#if defined(SYNTHETIC_ISWINDOWS)
+
+	inline qword_t getEntryId(const PROCESSENTRY32W& entry)
+	{
+		return entry.th32ProcessID;
+	}
+
+	inline qword_t getEntryId(const THREADENTRY32& entry)
+	{
+		return entry.th32ThreadID;
+	}
+
+	inline qword_t getEntryId(const MODULEENTRY32W& entry)
+	{
+		return reinterpret_cast<ptr_t>(entry.modBaseAddr);
+	}
+
+	/*
+	* Toolhelp lists the threads of all processes, whatever PID is passed
+	*/
+	inline bool isEntryOf(const THREADENTRY32& entry, pid_t pid)
+	{
+		return entry.th32OwnerProcessID == pid;
+	}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+	inline qword_t getEntryId(const ProcEntry& entry)
+	{
+		return static_cast<qword_t>(entry.id);
+	}
+
+	inline qword_t getEntryId(const ModuleEntry& entry)
+	{
+		return entry.baseAddress;
+	}
+
+#endif
+
+	template<class entry_t>
+	bool isEntryOf(const entry_t&, pid_t)
+	{
+		return true;
+	}
+
+	/**
+	* Immutable result of a complete SysObjectIterator walk\n
+	* The entries are captured once into a contiguous array sorted by id,
+	* iterators are random access and find() is a binary search. Copies
+	* share the array, so several consumers can work with the same
+	* enumeration, capture() replaces it for this object only.\n
+	* iterator_t = SysObjectIterator to capture with\n
+	*/
+	template<class iterator_t>
+	class SysObjectSnapshot
+	{
+	public:
+
+		typedef typename iterator_t::entry_type entry_type;
+		typedef const entry_type* const_iterator;
+		typedef const_iterator iterator;
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* Creates an empty snapshot.
+		*/
+		SysObjectSnapshot() : entries_(new std::vector<entry_type>())
+		{ }
+
+		/**
+		* Constructor capturing the entries.
+		* @param pid The process whose threads or modules are captured.
+		* Zero captures the threads of all processes and the modules of the
+		* calling process, processes are always captured all.
+		* @param fields (optional) Backend specific flags passed to the
+		* iterator.
+		*/
+		explicit SysObjectSnapshot(pid_t pid, int fields = 0)
+		{
+			capture(pid, fields);
+		}
+
+		/**
+		* Captures the entries again. Copies made before keep the old ones.
+		* @param pid The process whose threads or modules are captured.
+		* Zero captures the threads of all processes and the modules of the
+		* calling process, processes are always captured all.
+		* @param fields (optional) Backend specific flags passed to the
+		* iterator.
+		*/
+		void capture(pid_t pid, int fields = 0)
+		{
+			iterator_t it(pid, fields);
+			capture_(it, pid);
+		}
+
+		/**
+		* Captures the entries again without throwing. The entries stay
+		* unchanged on failure.
+		* @param pid See capture().
+		* @param fields (optional) See capture().
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t tryCapture(pid_t pid, int fields = 0)
+		{
+			errorcode_t error;
+			iterator_t it(pid, fields, error);
+			if(!error)
+				capture_(it, pid);
+
+			return error;
+		}
+
+		/**
+		* @return const_iterator Iterator to the entry with the lowest id.
+		*/
+		const_iterator begin() const
+		{
+			return entries_->empty() ? 0 : &entries_->front();
+		}
+
+		/**
+		* @return const_iterator Iterator behind the last entry.
+		*/
+		const_iterator end() const
+		{
+			return begin() + entries_->size();
+		}
+
+		/**
+		* @return size_t Number of entries.
+		*/
+		size_t size() const
+		{
+			return entries_->size();
+		}
+
+		/**
+		* @return bool true if there are no entries.
+		*/
+		bool empty() const
+		{
+			return entries_->empty();
+		}
+
+		/**
+		* Accesses an entry by its position.
+		* @param index Position of the entry, sorted by id.
+		* @return const entry_type& The entry.
+		*/
+		const entry_type& operator[](size_t index) const
+		{
+			return (*entries_)[index];
+		}
+
+		/**
+		* Accesses an entry by its position with range check.
+		* @param index Position of the entry, sorted by id.
+		* @return const entry_type& The entry.
+		*/
+		const entry_type& at(size_t index) const
+		{
+			using namespace std;
+
+			if(index >= entries_->size())
+			{
+				throw out_of_range(	"SysObjectSnapshot::at() Error : " \
+											"Index out of range");
+			}
+
+			return (*entries_)[index];
+		}
+
+		/**
+		* Searches an entry by its id.
+		* @param id The PID for processes, the TID for threads or the base
+		* address for modules.
+		* @return const_iterator The entry, end() if there is none.
+		*/
+		const_iterator find(qword_t id) const
+		{
+			const_iterator found = std::lower_bound(begin(), end(), id, IdLess());
+			return (found != end() && getEntryId(*found) == id) ? found : end();
+		}
+
+		/**
+		* Checks if there is an entry with an id.
+		* @param id The PID, TID or base address.
+		* @return bool true if there is one.
+		*/
+		bool contains(qword_t id) const
+		{
+			return find(id) != end();
+		}
+
+	private:
+
+		/*
+		* Copies the remaining entries of an iterator
+		*/
+		void capture_(iterator_t& it, pid_t pid)
+		{
+			std::shared_ptr<std::vector<entry_type> > entries(new std::vector<entry_type>());
+			for(; it != iterator_t(); ++it)
+			{
+				if(!pid || isEntryOf(*it, pid))
+					entries->push_back(*it);
+			}
+
+			std::sort(entries->begin(), entries->end(), IdLess());
+			entries_ = entries;
+		}
+
+		/*
+		* Orders entries and ids for sort() and lower_bound()
+		*/
+		struct IdLess
+		{
+			bool operator()(const entry_type& left, const entry_type& right) const
+			{
+				return getEntryId(left) < getEntryId(right);
+			}
+
+			bool operator()(const entry_type& left, qword_t right) const
+			{
+				return getEntryId(left) < right;
+			}
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		//Shared by copies, never modified after capture()
+		std::shared_ptr<const std::vector<entry_type> > entries_;
+	};
+
+	typedef SysObjectSnapshot<ProcessIterator>	ProcessSnapshot;
+	typedef SysObjectSnapshot<ThreadIterator>		ThreadSnapshot;
+	typedef SysObjectSnapshot<ModuleIterator>		ModuleSnapshot;
+}
+
+#endif //SYNTHETIC_SYSOBJECTSNAPSHOT_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -52,6 +52,11 @@
 	#error [Synthetic] Unsupported platform and/or compiler
 #endif
 
+//Every x64 CPU has SSE2, x86 builds need to enable it
+#if defined(SYNTHETIC_ISX64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SYNTHETIC_HASSSE2
+#endif
+
 #endif //SYNTHETIC_PROCESS_SYSTEM_HPP
 
 /******************
@@ -61,6 +61,13 @@ void Thread::open(tid_t id)
 	if(!id)
 		return;
 
+	errorcode_t error = tryOpen(id);
+	if(error)
+		throw WinException("Thread::open()", "OpenThread()", error);
+}
+
+errorcode_t Thread::tryOpen(tid_t id)
+{
 	close();
 
 	//Windows Server 2008 and Windows Vista specific access rights are left
@@ -78,11 +85,10 @@ void Thread::open(tid_t id)
 
 	handle_ = OpenThread(desiredAccess, FALSE, id);
 	if(!handle_)
-	{
-		throw WinException(	"Thread::open()",
-									"OpenThread()",
-									GetLastError());
-	}
+		return GetLastError();
+
+	id_ = id;
+	return 0;
 }
 
 void Thread::close()
@@ -154,58 +160,74 @@ unsigned long Thread::getExitCode()  const
 
 unsigned long Thread::suspend() const
 {
-	DWORD suspendedCount = SuspendThread(getHandle());
-	if(suspendedCount == -1)
-	{
-		throw WinException(	"Thread::suspend()",
-									"SuspendThread()",
-									GetLastError());
-	}
+	unsigned long suspendedCount;
+	errorcode_t error = trySuspend(suspendedCount);
+	if(error)
+		throw WinException("Thread::suspend()", "SuspendThread()", error);
 
 	return suspendedCount;
 }
 
+errorcode_t Thread::trySuspend(unsigned long& previousCount) const
+{
+	DWORD suspendedCount = SuspendThread(getHandle());
+	if(suspendedCount == static_cast<DWORD>(-1))
+		return GetLastError();
+
+	previousCount = suspendedCount;
+	return 0;
+}
+
 unsigned long Thread::resume() const
 {
-	DWORD suspendedCount = ResumeThread(getHandle());
-	if(suspendedCount == -1)
-	{
-		throw WinException(	"Thread::resume()",
-									"ResumeThread()",
-									GetLastError());
-	}
+	unsigned long suspendedCount;
+	errorcode_t error = tryResume(suspendedCount);
+	if(error)
+		throw WinException("Thread::resume()", "ResumeThread()", error);
 
 	return suspendedCount;
 }
 
+errorcode_t Thread::tryResume(unsigned long& previousCount) const
+{
+	DWORD suspendedCount = ResumeThread(getHandle());
+	if(suspendedCount == static_cast<DWORD>(-1))
+		return GetLastError();
+
+	previousCount = suspendedCount;
+	return 0;
+}
+
 CONTEXT Thread::getContext(unsigned long contextFlags) const
 {
 	CONTEXT threadContext;
-	ZeroMemory(&threadContext, sizeof(CONTEXT));
-	threadContext.ContextFlags = contextFlags;
-
-	BOOL ec = GetThreadContext(getHandle(), &threadContext);
-	if(!ec)
-	{
-		throw WinException(	"Thread::getContext()",
-									"GetThreadContext()",
-									GetLastError());
-	}
+	errorcode_t error = tryGetContext(threadContext, contextFlags);
+	if(error)
+		throw WinException("Thread::getContext()", "GetThreadContext()", error);
 
 	return threadContext;
 }
 
+errorcode_t Thread::tryGetContext(CONTEXT& dest, unsigned long contextFlags) const
+{
+	ZeroMemory(&dest, sizeof(CONTEXT));
+	dest.ContextFlags = contextFlags;
+
+	return GetThreadContext(getHandle(), &dest) ? 0 : GetLastError();
+}
+
 void Thread::setContext(CONTEXT& newContext, unsigned long contextFlags) const
+{
+	errorcode_t error = trySetContext(newContext, contextFlags);
+	if(error)
+		throw WinException("Thread::setContext()", "SetThreadContext()", error);
+}
+
+errorcode_t Thread::trySetContext(CONTEXT& newContext, unsigned long contextFlags) const
 {
 	newContext.ContextFlags = contextFlags;
 
-	BOOL ec = SetThreadContext(getHandle(), &newContext);
-	if(!ec)
-	{
-		throw WinException(	"Thread::setContext()",
-									"SetThreadContext()",
-									GetLastError());
-	}
+	return SetThreadContext(getHandle(), &newContext) ? 0 : GetLastError();
 }
 
 void Thread::wait(unsigned long milliSeconds) const
@@ -104,6 +104,14 @@ namespace Synthetic
 		*/
 		void open(tid_t id);
 
+		/**
+		* Opens a thread by a threadid without throwing, threads often exit
+		* between being listed and being opened.
+		* @param id The id of the thread you want to attach.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t tryOpen(tid_t id);
+
 		/**
 		* Closes the current threadhandle
 		*/
@@ -161,6 +169,14 @@ namespace Synthetic
 		*/
 		unsigned long suspend() const;
 
+		/**
+		* Suspends the thread without throwing.
+		* @param previousCount Reference receiving the thread's previous
+		* suspend count.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t trySuspend(unsigned long& previousCount) const;
+
 		/**
 		* Decrements a thread's suspend count. When the suspend count is decremented
 		* to zero, the execution of the thread is resumed.
@@ -168,6 +184,14 @@ namespace Synthetic
 		*/
 		unsigned long resume() const;
 
+		/**
+		* Decrements a thread's suspend count without throwing.
+		* @param previousCount Reference receiving the thread's previous
+		* suspend count.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t tryResume(unsigned long& previousCount) const;
+
 		/**
 		* Retrieves the context of the thread.
 		* @param contextFlags Specifies which portions of the thread's
@@ -176,6 +200,15 @@ namespace Synthetic
 		*/
 		CONTEXT getContext(unsigned long contextFlags) const;
 
+		/**
+		* Retrieves the context of the thread without throwing.
+		* @param dest Reference receiving the context.
+		* @param contextFlags Specifies which portions of the thread's
+		* context are retrieved.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t tryGetContext(CONTEXT& dest, unsigned long contextFlags) const;
+
 		/**
 		* Sets the context for the thread.
 		* @param newContext The context to be set in the thread.
@@ -185,6 +218,16 @@ namespace Synthetic
 		void setContext(	CONTEXT& newContext,
 								unsigned long contextFlags) const;
 
+		/**
+		* Sets the context for the thread without throwing.
+		* @param newContext The context to be set in the thread.
+		* @param unsigned long Specifies which portions of the thread's
+		* context are set.
+		* @return errorcode_t Zero on success, the error otherwise.
+		*/
+		errorcode_t trySetContext(	CONTEXT& newContext,
+											unsigned long contextFlags) const;
+
 		/**
 		* Waits until the thread is in the signaled state or
 		* the time-out interval elapses.
@@ -31,6 +31,13 @@ using namespace Synthetic;
 ***********************************************************************
 **********************************************************************/
 
+size_t ThreadManager::diffStats(	const ThreadStatsSample& previous,
+											const ThreadStatsSample& current,
+											vector<ThreadStatsDelta>& dest)
+{
+	return ThreadStatsReader::diff(previous, current, dest);
+}
+
 ThreadManager::ThreadManager(Process& proc) : proc_(proc)
 { }
 
@@ -78,4 +85,9 @@ Thread ThreadManager::createThread(	ptr_t procedure, ptr_t param,
 		newThread.wait(waitingTime);
 
 	return newThread;
+}
+
+size_t ThreadManager::sampleStats(ThreadStatsSample& dest) const
+{
+	return statsReader_.read(proc_, dest);
 }
\ No newline at end of file
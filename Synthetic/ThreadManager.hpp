@@ -31,6 +31,7 @@
 //Synthetic header Files:
 #include "Process.hpp"
 #include "Thread.hpp"
+#include "ThreadStats.hpp"
 #include "SysObjectIterator.hpp"
 
 namespace Synthetic
@@ -43,6 +44,24 @@ namespace Synthetic
 	{
 	public:
 
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Computes the change of all threads between two samples.
+		* Threads which exited in between are left out.
+		* @param previous The older sample.
+		* @param current The newer sample.
+		* @param dest Vector to be overwritten with the deltas, its storage gets reused.
+		* @return size_t Number of deltas, i.e. threads in current.
+		*/
+		static size_t diffStats(	const ThreadStatsSample& previous,
+											const ThreadStatsSample& current,
+											std::vector<ThreadStatsDelta>& dest);
+
 		/**********************************************************************
 		***********************************************************************
 		************************ PUBLIC MEMBER FUNCTIONS **********************
@@ -80,6 +99,16 @@ namespace Synthetic
 									bool suspended = false,
 									dword_t waitingTime = 0) const;
 
+		/**
+		* Samples CPU times, context switches, state and last CPU of all
+		* threads. Buffers are kept between calls, so sampling the same
+		* process repeatedly should be done through the same manager.
+		* Use ThreadStatsReader directly on Linux.
+		* @param dest Sample to be overwritten, its storage gets reused.
+		* @return size_t Number of sampled threads.
+		*/
+		size_t sampleStats(ThreadStatsSample& dest) const;
+
 	private:
 
 		/**********************************************************************
@@ -89,6 +118,7 @@ namespace Synthetic
 		**********************************************************************/
 
 		Process& proc_;
+		mutable ThreadStatsReader statsReader_;
 };
 
 }
@@ -0,0 +1,514 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	//Windows header files:
+	#include <Windows.h>
+#elif defined(SYNTHETIC_ISLINUX)
+	//Linux header files:
+	#include <sys/types.h>
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+	#include <time.h>
+	#include <stdio.h>
+#endif
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+
+//Synthetic header files:
+#include "ThreadStats.hpp"
+#include "Process.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+	#include "WinException.hpp"
+#elif defined(SYNTHETIC_ISLINUX)
+	#include "PosixException.hpp"
+#endif
+
+using namespace std;
+using namespace Synthetic;
+
+/**********************************************************************
+***********************************************************************
+****************************** PLATFORM *******************************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+namespace
+{
+	//Undocumented layout returned by NtQuerySystemInformation()
+	const ULONG SystemProcessInformation = 5;
+	const LONG STATUS_INFO_LENGTH_MISMATCH = static_cast<LONG>(0xC0000004);
+
+	//KTHREAD_STATE and KWAIT_REASON values we care about
+	const ULONG KTHREAD_READY = 1;
+	const ULONG KTHREAD_RUNNING = 2;
+	const ULONG KTHREAD_STANDBY = 3;
+	const ULONG KTHREAD_TERMINATED = 4;
+	const ULONG KTHREAD_WAITING = 5;
+	const ULONG KTHREAD_DEFERREDREADY = 7;
+	const ULONG KWAIT_SUSPENDED = 5;
+
+	struct NtUnicodeString
+	{
+		USHORT Length;
+		USHORT MaximumLength;
+		WCHAR* Buffer;
+	};
+
+	struct NtThreadInformation
+	{
+		LARGE_INTEGER KernelTime;
+		LARGE_INTEGER UserTime;
+		LARGE_INTEGER CreateTime;
+		ULONG WaitTime;
+		void* StartAddress;
+		HANDLE UniqueProcess;
+		HANDLE UniqueThread;
+		LONG Priority;
+		LONG BasePriority;
+		ULONG ContextSwitches;
+		ULONG ThreadState;
+		ULONG WaitReason;
+	};
+
+	struct NtProcessInformation
+	{
+		ULONG NextEntryOffset;
+		ULONG NumberOfThreads;
+		BYTE Reserved1[48];
+		NtUnicodeString ImageName;
+		LONG BasePriority;
+		HANDLE UniqueProcessId;
+		HANDLE InheritedFromUniqueProcessId;
+		ULONG HandleCount;
+		ULONG SessionId;
+		ULONG_PTR UniqueProcessKey;
+		SIZE_T Reserved2[12];
+		LARGE_INTEGER Reserved3[6];
+		NtThreadInformation Threads[1];
+	};
+
+	typedef LONG (WINAPI *NtQuerySystemInformation_t)(ULONG, void*, ULONG, ULONG*);
+
+	NtQuerySystemInformation_t getNtQuerySystemInformation()
+	{
+		static NtQuerySystemInformation_t function = reinterpret_cast<NtQuerySystemInformation_t>(
+			GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQuerySystemInformation"));
+
+		if(!function)
+		{
+			throw WinException(	"ThreadStatsReader::read()",
+										"GetProcAddress()",
+										GetLastError());
+		}
+
+		return function;
+	}
+
+	typedef ULONG (WINAPI *RtlNtStatusToDosError_t)(LONG);
+
+	/* WinException expects a Win32 error code, not an NTSTATUS */
+	dword_t ntStatusToError(LONG status)
+	{
+		static RtlNtStatusToDosError_t function = reinterpret_cast<RtlNtStatusToDosError_t>(
+			GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "RtlNtStatusToDosError"));
+
+		return function ? function(status) : ERROR_MR_MID_NOT_FOUND;
+	}
+
+	qword_t monotonicNanoseconds()
+	{
+		static LARGE_INTEGER frequency = { 0 };
+		if(!frequency.QuadPart)
+			QueryPerformanceFrequency(&frequency);
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		const qword_t ticks = counter.QuadPart;
+		const qword_t freq = frequency.QuadPart;
+		return (ticks / freq) * 1000000000ULL + (ticks % freq) * 1000000000ULL / freq;
+	}
+
+	ThreadRunState translateState(ULONG state, ULONG waitReason)
+	{
+		switch(state)
+		{
+		case KTHREAD_READY:
+		case KTHREAD_RUNNING:
+		case KTHREAD_STANDBY:
+		case KTHREAD_DEFERREDREADY:
+			return THREADSTATE_RUNNING;
+
+		case KTHREAD_WAITING:
+			return (waitReason == KWAIT_SUSPENDED) ? THREADSTATE_STOPPED : THREADSTATE_WAITING;
+
+		case KTHREAD_TERMINATED:
+			return THREADSTATE_TERMINATED;
+
+		default:
+			return THREADSTATE_UNKNOWN;
+		}
+	}
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+namespace
+{
+	qword_t monotonicNanoseconds()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<qword_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+	}
+
+	ThreadRunState translateState(char state)
+	{
+		switch(state)
+		{
+		case 'R':
+			return THREADSTATE_RUNNING;
+
+		case 'S':
+		case 'I':
+			return THREADSTATE_WAITING;
+
+		case 'D':
+			return THREADSTATE_UNINTERRUPTIBLE;
+
+		case 'T':
+		case 't':
+			return THREADSTATE_STOPPED;
+
+		case 'Z':
+		case 'X':
+			return THREADSTATE_TERMINATED;
+
+		default:
+			return THREADSTATE_UNKNOWN;
+		}
+	}
+
+	/*
+	* Reads a small procfs file relative to a directory into buffer,
+	* returns the number of bytes read or -1
+	*/
+	ssize_t readProcFile(int directory, const char* name, vector<char>& buffer)
+	{
+		int fd = openat(directory, name, O_RDONLY | O_CLOEXEC);
+		if(fd < 0)
+			return -1;
+
+		ssize_t length = read(fd, &buffer[0], buffer.size() - 1);
+		close(fd);
+
+		if(length >= 0)
+			buffer[length] = 0;
+
+		return length;
+	}
+
+	/*
+	* Parses an unsigned decimal number and advances the cursor
+	*/
+	qword_t parseNumber(const char*& cursor)
+	{
+		qword_t value = 0;
+		while(*cursor >= '0' && *cursor <= '9')
+			value = value * 10 + (*cursor++ - '0');
+
+		return value;
+	}
+
+	/*
+	* Parses the value of a "Key:\tValue" line in a status file
+	*/
+	qword_t parseStatusField(const char* status, const char* key)
+	{
+		const char* line = strstr(status, key);
+		if(!line)
+			return 0;
+
+		line += strlen(key);
+		while(*line == ' ' || *line == '\t')
+			++line;
+
+		return parseNumber(line);
+	}
+
+	/*
+	* Parses /proc/pid/task/tid/stat, returns false if malformed
+	*/
+	bool parseStat(const char* stat, ThreadStats& dest, qword_t nanosecondsPerTick)
+	{
+		//The command name may contain anything, the fields follow the last ')'
+		const char* cursor = strrchr(stat, ')');
+		if(!cursor || cursor[1] != ' ')
+			return false;
+
+		cursor += 2;
+		dest.state = translateState(*cursor);
+
+		//Field 3 is the state, walk up to utime(14), stime(15) and processor(39)
+		for(int field = 3; *cursor; ++field)
+		{
+			while(*cursor && *cursor != ' ')
+				++cursor;
+			while(*cursor == ' ')
+				++cursor;
+
+			const int current = field + 1;
+			if(current == 14)
+				dest.userTime = parseNumber(cursor) * nanosecondsPerTick;
+			else if(current == 15)
+				dest.systemTime = parseNumber(cursor) * nanosecondsPerTick;
+			else if(current == 39)
+			{
+				dest.lastCpu = static_cast<int32_t>(parseNumber(cursor));
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+#endif
+
+/**********************************************************************
+***********************************************************************
+************************* PUBLIC FREE FUNCTIONS ***********************
+***********************************************************************
+**********************************************************************/
+
+size_t ThreadStatsReader::diff(	const ThreadStatsSample& previous,
+											const ThreadStatsSample& current,
+											vector<ThreadStatsDelta>& dest)
+{
+	const double elapsed = (current.timestamp > previous.timestamp) ?
+		static_cast<double>(current.timestamp - previous.timestamp) : 0.0;
+
+	dest.clear();
+	dest.reserve(current.threads.size());
+
+	//Both samples are sorted by id, merge them
+	vector<ThreadStats>::const_iterator old = previous.threads.begin();
+	for(vector<ThreadStats>::const_iterator it = current.threads.begin();
+		it != current.threads.end(); ++it)
+	{
+		while(old != previous.threads.end() && old->id < it->id)
+			++old;
+
+		ThreadStatsDelta delta;
+		delta.id = it->id;
+		delta.state = it->state;
+		delta.lastCpu = it->lastCpu;
+		delta.isNew = (old == previous.threads.end() || old->id != it->id);
+
+		if(delta.isNew)
+		{
+			delta.userTime = it->userTime;
+			delta.systemTime = it->systemTime;
+			delta.voluntarySwitches = it->voluntarySwitches;
+			delta.involuntarySwitches = it->involuntarySwitches;
+		}
+		else
+		{
+			delta.userTime = it->userTime - old->userTime;
+			delta.systemTime = it->systemTime - old->systemTime;
+			delta.voluntarySwitches = it->voluntarySwitches - old->voluntarySwitches;
+			delta.involuntarySwitches = it->involuntarySwitches - old->involuntarySwitches;
+		}
+
+		delta.cpuUsage = (elapsed > 0.0 && !delta.isNew) ?
+			static_cast<double>(delta.userTime + delta.systemTime) / elapsed : 0.0;
+
+		dest.push_back(delta);
+	}
+
+	return dest.size();
+}
+
+/**********************************************************************
+***********************************************************************
+************************ PUBLIC MEMBER FUNCTIONS **********************
+***********************************************************************
+**********************************************************************/
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
+ThreadStatsReader::ThreadStatsReader() : buffer_(0x40000)
+{ }
+
+size_t ThreadStatsReader::read(pid_t pid, ThreadStatsSample& dest)
+{
+	NtQuerySystemInformation_t query = getNtQuerySystemInformation();
+
+	//One call returns every thread on the system, grow the buffer until
+	//the snapshot fits
+	LONG status;
+	for(;;)
+	{
+		ULONG needed = 0;
+		status = query(	SystemProcessInformation,
+							&buffer_[0],
+							static_cast<ULONG>(buffer_.size()),
+							&needed);
+
+		if(status != STATUS_INFO_LENGTH_MISMATCH)
+			break;
+
+		buffer_.resize(max<size_t>(buffer_.size() * 2, needed + 0x10000));
+	}
+
+	if(status < 0)
+	{
+		throw WinException(	"ThreadStatsReader::read()",
+									"NtQuerySystemInformation()",
+									ntStatusToError(status));
+	}
+
+	dest.timestamp = monotonicNanoseconds();
+	dest.threads.clear();
+
+	const char* entry = &buffer_[0];
+	for(;;)
+	{
+		const NtProcessInformation* process =
+			reinterpret_cast<const NtProcessInformation*>(entry);
+
+		if(reinterpret_cast<ULONG_PTR>(process->UniqueProcessId) == pid)
+		{
+			for(ULONG i = 0; i < process->NumberOfThreads; ++i)
+			{
+				const NtThreadInformation& thread = process->Threads[i];
+
+				ThreadStats stats;
+				stats.id = static_cast<tid_t>(reinterpret_cast<ULONG_PTR>(thread.UniqueThread));
+				stats.userTime = thread.UserTime.QuadPart * 100;
+				stats.systemTime = thread.KernelTime.QuadPart * 100;
+				stats.voluntarySwitches = thread.ContextSwitches;
+				stats.involuntarySwitches = 0;
+				stats.state = translateState(thread.ThreadState, thread.WaitReason);
+				stats.lastCpu = -1;
+				dest.threads.push_back(stats);
+			}
+
+			break;
+		}
+
+		if(!process->NextEntryOffset)
+			break;
+
+		entry += process->NextEntryOffset;
+	}
+
+	sort(dest.threads.begin(), dest.threads.end(), [](const ThreadStats& a, const ThreadStats& b)
+	{
+		return a.id < b.id;
+	});
+
+	return dest.threads.size();
+}
+
+#elif defined(SYNTHETIC_ISLINUX)
+
+ThreadStatsReader::ThreadStatsReader() : buffer_(0x1000)
+{
+	long ticksPerSecond = sysconf(_SC_CLK_TCK);
+	nanosecondsPerTick_ = 1000000000ULL / (ticksPerSecond > 0 ? ticksPerSecond : 100);
+}
+
+size_t ThreadStatsReader::read(pid_t pid, ThreadStatsSample& dest)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/task", static_cast<int>(pid));
+
+	DIR* tasks = opendir(path);
+	if(!tasks)
+	{
+		throw PosixException(	"ThreadStatsReader::read()",
+										"opendir()",
+										errno);
+	}
+
+	dest.timestamp = monotonicNanoseconds();
+	dest.threads.clear();
+
+	//One walk over the task directory, every file is opened relative to it
+	const int directory = dirfd(tasks);
+	while(dirent* entry = readdir(tasks))
+	{
+		const char* name = entry->d_name;
+		if(*name < '0' || *name > '9')
+			continue;
+
+		ThreadStats stats;
+		memset(&stats, 0, sizeof(stats));
+		stats.id = static_cast<tid_t>(parseNumber(name));
+
+		//Threads may exit while we are walking, just skip them
+		snprintf(path, sizeof(path), "%d/stat", static_cast<int>(stats.id));
+		if(readProcFile(directory, path, buffer_) <= 0)
+			continue;
+
+		if(!parseStat(&buffer_[0], stats, nanosecondsPerTick_))
+			continue;
+
+		snprintf(path, sizeof(path), "%d/status", static_cast<int>(stats.id));
+		if(readProcFile(directory, path, buffer_) <= 0)
+			continue;
+
+		stats.voluntarySwitches = parseStatusField(&buffer_[0], "\nvoluntary_ctxt_switches:");
+		stats.involuntarySwitches = parseStatusField(&buffer_[0], "\nnonvoluntary_ctxt_switches:");
+
+		dest.threads.push_back(stats);
+	}
+
+	closedir(tasks);
+
+	sort(dest.threads.begin(), dest.threads.end(), [](const ThreadStats& a, const ThreadStats& b)
+	{
+		return a.id < b.id;
+	});
+
+	return dest.threads.size();
+}
+
+#endif
+
+size_t ThreadStatsReader::read(const Process& proc, ThreadStatsSample& dest)
+{
+	return read(proc.getId(), dest);
+}
+
+/******************
+******* EOF *******
+******************/
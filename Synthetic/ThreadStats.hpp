@@ -0,0 +1,181 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_THREADSTATS_HPP
+#define SYNTHETIC_PROCESS_THREADSTATS_HPP
+
+//C++ header files:
+#include <vector>
+
+//Synthetic header Files:
+#include "System.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	class Process;
+
+	//Enumerations
+
+	/**
+	* Scheduling state of a thread at the time it was sampled
+	*/
+	enum ThreadRunState
+	{
+		THREADSTATE_UNKNOWN,
+		THREADSTATE_RUNNING,				//Running or ready to run
+		THREADSTATE_WAITING,				//Sleeping or waiting for an object
+		THREADSTATE_UNINTERRUPTIBLE,	//Waiting for I/O (Linux only)
+		THREADSTATE_STOPPED,				//Suspended or stopped by a debugger
+		THREADSTATE_TERMINATED			//Exited but not yet reaped
+	};
+
+	/**
+	* Counters of a single thread.\n
+	* Times are given in nanoseconds.\n
+	* Windows only knows the total number of context switches, they are
+	* reported as voluntary. Windows doesn't report the last CPU either,
+	* lastCpu is -1 there.\n
+	*/
+	struct ThreadStats
+	{
+		tid_t id;
+		qword_t userTime;
+		qword_t systemTime;
+		qword_t voluntarySwitches;
+		qword_t involuntarySwitches;
+		ThreadRunState state;
+		int32_t lastCpu;
+	};
+
+	/**
+	* All threads of a process at one point in time, sorted by id
+	*/
+	struct ThreadStatsSample
+	{
+		qword_t timestamp;	//Monotonic time in nanoseconds
+		std::vector<ThreadStats> threads;
+	};
+
+	/**
+	* Change of a thread's counters between two samples
+	*/
+	struct ThreadStatsDelta
+	{
+		tid_t id;
+		qword_t userTime;
+		qword_t systemTime;
+		qword_t voluntarySwitches;
+		qword_t involuntarySwitches;
+		ThreadRunState state;
+		int32_t lastCpu;
+
+		/**
+		* Share of one CPU the thread used between both samples,
+		* 1.0 means it was running all the time.
+		*/
+		double cpuUsage;
+
+		/**
+		* true if the thread didn't exist in the previous sample, the
+		* counters are the totals since its creation then
+		*/
+		bool isNew;
+	};
+
+	/**
+	* Reads the per-thread counters of processes.\n
+	* Buffers are kept between calls, so one reader should be reused for
+	* repeated sampling.\n
+	*/
+	class ThreadStatsReader
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************* PUBLIC FREE FUNCTIONS ***********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Computes the change of all threads between two samples.
+		* Threads which exited in between are left out.
+		* @param previous The older sample.
+		* @param current The newer sample.
+		* @param dest Vector to be overwritten with the deltas, its storage gets reused.
+		* @return size_t Number of deltas, i.e. threads in current.
+		*/
+		static size_t diff(	const ThreadStatsSample& previous,
+									const ThreadStatsSample& current,
+									std::vector<ThreadStatsDelta>& dest);
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		*/
+		ThreadStatsReader();
+
+		/**
+		* Samples all threads of a process.
+		* @param pid The process' PID.
+		* @param dest Sample to be overwritten, its storage gets reused.
+		* @return size_t Number of sampled threads.
+		*/
+		size_t read(pid_t pid, ThreadStatsSample& dest);
+
+		/**
+		* Samples all threads of a process.
+		* @param proc The process.
+		* @param dest Sample to be overwritten, its storage gets reused.
+		* @return size_t Number of sampled threads.
+		*/
+		size_t read(const Process& proc, ThreadStatsSample& dest);
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		std::vector<char> buffer_;
+
+		#if defined(SYNTHETIC_ISLINUX)
+			qword_t nanosecondsPerTick_;
+		#endif
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_THREADSTATS_HPP
+
+/******************
+******* EOF *******
+******************/
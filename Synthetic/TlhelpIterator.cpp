@@ -19,29 +19,35 @@
 */
 
 //Synthetic Header Files:
+#include "System.hpp"
+
+#if defined(SYNTHETIC_ISWINDOWS)
+
 #include "SysObjectIterator.hpp"
 
 using namespace Synthetic;
 
-template class SysObjectIterator<	PROCESSENTRY32W,
-												Process32FirstW,
-												Process32NextW,
-												TH32CS_SNAPPROCESS>;
-
-template class SysObjectIterator<	THREADENTRY32,
-												Thread32First,
-												Thread32Next,
-												TH32CS_SNAPTHREAD>;
-
-template class SysObjectIterator<	MODULEENTRY32W,
-												Module32FirstW,
-												Module32NextW,
-												TH32CS_SNAPMODULE>;
-
-template class SysObjectIterator<	HEAPLIST32,
-												Heap32ListFirst,
-												Heap32ListNext,
-												TH32CS_SNAPHEAPLIST>;
+template class ToolhelpBackend<	PROCESSENTRY32W,
+										Process32FirstW,
+										Process32NextW,
+										TH32CS_SNAPPROCESS>;
+
+template class ToolhelpBackend<	THREADENTRY32,
+										Thread32First,
+										Thread32Next,
+										TH32CS_SNAPTHREAD>;
+
+template class ToolhelpBackend<	MODULEENTRY32W,
+										Module32FirstW,
+										Module32NextW,
+										TH32CS_SNAPMODULE>;
+
+template class ToolhelpBackend<	HEAPLIST32,
+										Heap32ListFirst,
+										Heap32ListNext,
+										TH32CS_SNAPHEAPLIST>;
+
+#endif //defined(SYNTHETIC_ISWINDOWS)
 
 /******************
 ******* EOF *******
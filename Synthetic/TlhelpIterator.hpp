@@ -0,0 +1,188 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_TLHELPITERATOR_HPP
+#define SYNTHETIC_TLHELPITERATOR_HPP
+
+//Windows header files:
+#include <Windows.h>
+#include <TlHelp32.h>
+
+//Synthetic header files:
+#include "Types.hpp"
+#include "WinException.hpp"
+#include "Auxiliary.hpp"
+
+namespace Synthetic
+{
+	/**
+	* SysObjectIterator backend wrapping the Tlhelp32 API.\n
+	* entry_t			= Type of entry returned by the First/Next functions\n
+	* func_getfirst	= Functionpointer to function retrieving the first entry\n
+	* func_getnext		= Function pointer to function retrieving the next entry\n
+	* flag_spec			= Defines a flag for use in CreateToolhelp32Snapshot()\n
+	*/
+	template<	class entry_t,
+					BOOL (__stdcall *func_getfirst)(HANDLE, entry_t*),
+					BOOL (__stdcall *func_getnext)(HANDLE, entry_t*),
+					unsigned long flag_spec>
+	class ToolhelpBackend
+	{
+	public:
+
+		typedef entry_t entry_type;
+
+		/**
+		* Constructor creating a backend without snapshot.
+		*/
+		ToolhelpBackend() : snapshot_(0)
+		{ }
+
+		/**
+		* Copyconstructor for deep copy.
+		* @param backend ToolhelpBackend to copy.
+		*/
+		ToolhelpBackend(const ToolhelpBackend& backend) : snapshot_(0)
+		{
+			*this = backend;
+		}
+
+		/**
+		* Assignment operator for deep copy.
+		* @param backend ToolhelpBackend to copy.
+		* @return ToolhelpBackend& This backend.
+		*/
+		ToolhelpBackend& operator=(const ToolhelpBackend& backend)
+		{
+			if(this == &backend)
+				return *this;
+
+			close_();
+
+			if(backend.snapshot_)
+			{
+				snapshot_	= Aux::duplicateHandleLocal(backend.snapshot_);
+				entry_		= backend.entry_;
+			}
+
+			return *this;
+		}
+
+		/**
+		* Simple destructor freeing resources.
+		*/
+		~ToolhelpBackend()
+		{
+			close_();
+		}
+
+		/**
+		* Takes a snapshot and retrieves its first entry.
+		* @param pid The process id passed to CreateToolhelp32Snapshot().
+		* @param fields Unused.
+		* @return bool true, the snapshot can't be empty.
+		*/
+		bool first(pid_t pid, int fields)
+		{
+			errorcode_t error;
+			bool found = tryFirst(pid, fields, error);
+			if(error)
+			{
+				throw WinException(	"SysObjectIterator::SysObjectIterator()",
+											"CreateToolhelp32Snapshot()",
+											error);
+			}
+
+			return found;
+		}
+
+		/**
+		* Like first(), but returns errors instead of throwing them.
+		* @param pid The process id passed to CreateToolhelp32Snapshot().
+		* @param fields Unused.
+		* @param error Reference receiving the GetLastError() value, zero on
+		* success.
+		* @return bool false on error.
+		*/
+		bool tryFirst(pid_t pid, int, errorcode_t& error)
+		{
+			close_();
+
+			//Get a snapshot
+			entry_.dwSize = sizeof(entry_t);
+			snapshot_ = CreateToolhelp32Snapshot(flag_spec, pid);
+			if(snapshot_ == INVALID_HANDLE_VALUE)
+			{
+				snapshot_ = 0;
+				error = GetLastError();
+				return false;
+			}
+
+			//Get first entry
+			error = func_getfirst(snapshot_, &entry_) ? 0 : GetLastError();
+			return !error;
+		}
+
+		/**
+		* Retrieves the next entry.
+		* @return bool false if there are no more entries.
+		*/
+		bool next()
+		{
+			return func_getnext(snapshot_, &entry_) != FALSE;
+		}
+
+		/**
+		* @return const entry_t& The current entry.
+		*/
+		const entry_t& get() const
+		{
+			return entry_;
+		}
+
+	private:
+
+		/*
+		* Closes the snapshot
+		*/
+		void close_()
+		{
+			if(snapshot_)
+			{
+				CloseHandle(snapshot_);
+				snapshot_ = 0;
+			}
+		}
+
+		HANDLE snapshot_;
+		entry_t entry_;
+	};
+}
+
+#endif //SYNTHETIC_TLHELPITERATOR_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -70,13 +70,22 @@ namespace Synthetic
 		typedef ::DWORD	pid_t;
 		typedef ::DWORD	tid_t;
 
+		//GetLastError() value, zero on success
+		typedef ::DWORD	errorcode_t;
+
 	#elif defined(SYNTHETIC_ISLINUX)
 
 		typedef ::pid_t	pid_t;
 		typedef ::pid_t	tid_t;
 
+		//errno value, zero on success
+		typedef int			errorcode_t;
+
 	#endif
 
+	//Timeout in milliseconds which never expires, equals INFINITE on Windows
+	const dword_t TIMEOUT_INFINITE = 0xFFFFFFFF;
+
 }
 
 #endif //SYNTHETIC_PROCESS_TYPES_HPP
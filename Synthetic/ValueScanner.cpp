@@ -0,0 +1,786 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+#include "System.hpp"
+
+//C++ header files:
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+//Synthetic header files:
+#include "ScanKernels.hpp"
+#include "ValueScanner.hpp"
+
+using namespace std;
+using namespace Synthetic;
+using namespace Synthetic::Kernels;
+
+namespace
+{
+	//Memory captured per block, values may overlap into the next one
+	const size_t BLOCK_SIZE = 0x100000;
+
+	/*
+	* Filter arithmetic, integers wrap around
+	*/
+	template<class value_t>
+	value_t wrapAdd(value_t a, value_t b)
+	{
+		typedef typename make_unsigned<value_t>::type unsigned_t;
+		return static_cast<value_t>(static_cast<unsigned_t>(a) + static_cast<unsigned_t>(b));
+	}
+
+	template<class value_t>
+	value_t wrapSub(value_t a, value_t b)
+	{
+		typedef typename make_unsigned<value_t>::type unsigned_t;
+		return static_cast<value_t>(static_cast<unsigned_t>(a) - static_cast<unsigned_t>(b));
+	}
+
+	float wrapAdd(float a, float b)		{ return a + b; }
+	float wrapSub(float a, float b)		{ return a - b; }
+	double wrapAdd(double a, double b)	{ return a + b; }
+	double wrapSub(double a, double b)	{ return a - b; }
+
+	/*
+	* Converts a ScanValue to the type scanned for
+	*/
+	template<class value_t>
+	value_t toValue(const ScanValue& value)
+	{
+		return static_cast<value_t>(value.getInteger());
+	}
+
+	template<>
+	float toValue<float>(const ScanValue& value)
+	{
+		return static_cast<float>(value.getReal());
+	}
+
+	template<>
+	double toValue<double>(const ScanValue& value)
+	{
+		return value.getReal();
+	}
+
+	/*
+	* Whether a value passes a filter, filter is a constant so the switch
+	* folds away
+	*/
+	template<class value_t, ScanFilter filter>
+	bool passes(value_t before, value_t after, value_t delta)
+	{
+		switch(filter)
+		{
+		case FILTER_CHANGED:
+			return after != before;
+		case FILTER_UNCHANGED:
+			return after == before;
+		case FILTER_INCREASED:
+			return after > before;
+		case FILTER_DECREASED:
+			return after < before;
+		case FILTER_INCREASED_BY:
+			return after == wrapAdd(before, delta);
+		default:
+			return after == wrapSub(before, delta);
+		}
+	}
+
+#if defined(SYNTHETIC_HASSSE2)
+
+	/*
+	* Lanes of a vector passing a filter
+	*/
+	template<class value_t, ScanFilter filter>
+	int passesVector(const byte_t* before, const byte_t* after, typename Vector<value_t>::vector_t delta)
+	{
+		typedef Vector<value_t> lanes;
+		const typename lanes::vector_t b = lanes::load(before);
+		const typename lanes::vector_t a = lanes::load(after);
+
+		switch(filter)
+		{
+		case FILTER_CHANGED:
+			return ~lanes::equal(a, b) & ((1 << lanes::LANES) - 1);
+		case FILTER_UNCHANGED:
+			return lanes::equal(a, b);
+		case FILTER_INCREASED:
+			return lanes::greater(a, b);
+		case FILTER_DECREASED:
+			return lanes::greater(b, a);
+		case FILTER_INCREASED_BY:
+			return lanes::equal(a, lanes::add(b, delta));
+		default:
+			return lanes::equal(a, lanes::sub(b, delta));
+		}
+	}
+
+#endif
+
+	/*
+	* Runs a filter on up to 64 values, bit i is set if value i passes
+	*/
+	template<class value_t, ScanFilter filter, bool vectorized = Vector<value_t>::AVAILABLE>
+	struct Kernel
+	{
+		static qword_t run(	const byte_t* before,
+									const byte_t* after,
+									size_t count,
+									size_t stride,
+									value_t delta)
+		{
+			qword_t result = 0;
+			for(size_t i = 0; i < count; ++i)
+			{
+				value_t b, a;
+				memcpy(&b, before + i * stride, sizeof(value_t));
+				memcpy(&a, after + i * stride, sizeof(value_t));
+				if(passes<value_t, filter>(b, a, delta))
+					result |= 1ULL << i;
+			}
+
+			return result;
+		}
+	};
+
+#if defined(SYNTHETIC_HASSSE2)
+
+	//Values next to each other are compared a vector at a time
+	template<class value_t, ScanFilter filter>
+	struct Kernel<value_t, filter, true>
+	{
+		static qword_t run(	const byte_t* before,
+									const byte_t* after,
+									size_t count,
+									size_t stride,
+									value_t delta)
+		{
+			if(stride != sizeof(value_t))
+				return Kernel<value_t, filter, false>::run(before, after, count, stride, delta);
+
+			typedef Vector<value_t> lanes;
+			const typename lanes::vector_t deltas = lanes::splat(delta);
+
+			qword_t result = 0;
+			size_t i = 0;
+			for(; i + lanes::LANES <= count; i += lanes::LANES)
+			{
+				const size_t offset = i * sizeof(value_t);
+				result |= static_cast<qword_t>(passesVector<value_t, filter>(before + offset, after + offset, deltas)) << i;
+			}
+
+			if(i < count)
+			{
+				const size_t offset = i * sizeof(value_t);
+				result |= Kernel<value_t, filter, false>::run(before + offset, after + offset, count - i, stride, delta) << i;
+			}
+
+			return result;
+		}
+	};
+
+#endif
+
+	/*
+	* Runs a filter on the values of a block which are still results
+	*/
+	template<class value_t, ScanFilter filter>
+	void filterWords(	const byte_t* before,
+							const byte_t* after,
+							size_t count,
+							size_t stride,
+							value_t delta,
+							qword_t* results)
+	{
+		const size_t words = (count + WORD_BITS - 1) / WORD_BITS;
+		for(size_t word = 0; word < words; ++word)
+		{
+			if(!results[word])
+				continue;
+
+			const size_t first = word * WORD_BITS;
+			results[word] &= Kernel<value_t, filter>::run(	before + first * stride,
+																			after + first * stride,
+																			min(WORD_BITS, count - first),
+																			stride,
+																			delta);
+		}
+	}
+
+	template<class value_t>
+	void filterValues(	ScanFilter filter,
+								const byte_t* before,
+								const byte_t* after,
+								size_t count,
+								size_t stride,
+								value_t delta,
+								qword_t* results)
+	{
+		switch(filter)
+		{
+		case FILTER_CHANGED:
+			filterWords<value_t, FILTER_CHANGED>(before, after, count, stride, delta, results);
+			break;
+		case FILTER_UNCHANGED:
+			filterWords<value_t, FILTER_UNCHANGED>(before, after, count, stride, delta, results);
+			break;
+		case FILTER_INCREASED:
+			filterWords<value_t, FILTER_INCREASED>(before, after, count, stride, delta, results);
+			break;
+		case FILTER_DECREASED:
+			filterWords<value_t, FILTER_DECREASED>(before, after, count, stride, delta, results);
+			break;
+		case FILTER_INCREASED_BY:
+			filterWords<value_t, FILTER_INCREASED_BY>(before, after, count, stride, delta, results);
+			break;
+		case FILTER_DECREASED_BY:
+			filterWords<value_t, FILTER_DECREASED_BY>(before, after, count, stride, delta, results);
+			break;
+		}
+	}
+
+	/*
+	* Positions the temporary file
+	*/
+	bool seekFile(FILE* file, qword_t offset)
+	{
+	#if defined(SYNTHETIC_ISWINDOWS)
+		return !_fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+	#elif defined(SYNTHETIC_ISLINUX)
+		return !fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+	#endif
+	}
+}
+
+/******************************************************************************
+*******************************************************************************
+************************** PUBLIC MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+ValueMatch::ValueMatch(const ScanValue& value) :	mode_(MATCH_EXACT),
+																	value_(value),
+																	maximum_(value),
+																	parameter_(0)
+{ }
+
+ValueMatch::ValueMatch(const ScanValue& value, MatchMode mode, double parameter) :	mode_(mode),
+																												value_(value),
+																												maximum_(value),
+																												parameter_(parameter)
+{ }
+
+ValueMatch::ValueMatch(const ScanValue& minimum, const ScanValue& maximum) :	mode_(MATCH_RANGE),
+																									value_(minimum),
+																									maximum_(maximum),
+																									parameter_(0)
+{ }
+
+MatchMode ValueMatch::getMode() const
+{
+	return mode_;
+}
+
+const ScanValue& ValueMatch::getValue() const
+{
+	return value_;
+}
+
+const ScanValue& ValueMatch::getMaximum() const
+{
+	return maximum_;
+}
+
+double ValueMatch::getParameter() const
+{
+	return parameter_;
+}
+
+ValueScanner::ValueScanner(const Process& proc, ValueType type, size_t alignment) :	proc_(proc),
+																												type_(type),
+																												valueSize_(getValueSize(type)),
+																												alignment_(alignment ? alignment : getValueSize(type)),
+																												residency_(RESIDENCY_ANY),
+																												results_(0),
+																												budget_(0),
+																												memoryUsage_(0),
+																												spillFile_(NULL),
+																												spillSize_(0)
+{ }
+
+ValueScanner::~ValueScanner()
+{
+	reset();
+}
+
+void ValueScanner::setResidency(Residency residency)
+{
+	residency_ = residency;
+}
+
+void ValueScanner::setMemoryBudget(size_t bytes)
+{
+	budget_ = bytes;
+}
+
+size_t ValueScanner::firstScan(const RegionMap& regions, int protection)
+{
+	reset();
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(protection, residency_, ranges);
+
+	return capture_(regions, ranges, NULL);
+}
+
+size_t ValueScanner::firstScan(const RegionMap& regions, ptr_t address, size_t size)
+{
+	reset();
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(address, size, PROTECTION_READ, residency_, ranges);
+
+	return capture_(regions, ranges, NULL);
+}
+
+size_t ValueScanner::firstScan(const RegionMap& regions, const ValueMatch& match, int protection)
+{
+	reset();
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(protection, residency_, ranges);
+
+	return capture_(regions, ranges, &match);
+}
+
+size_t ValueScanner::firstScan(	const RegionMap& regions,
+											ptr_t address,
+											size_t size,
+											const ValueMatch& match)
+{
+	reset();
+
+	vector<MemoryRange> ranges;
+	regions.getRanges(address, size, PROTECTION_READ, residency_, ranges);
+
+	return capture_(regions, ranges, &match);
+}
+
+size_t ValueScanner::nextScan(ScanFilter filter, const ScanValue& delta)
+{
+	return rescan_(filter, delta, NULL);
+}
+
+size_t ValueScanner::nextScan(const ValueMatch& match)
+{
+	return rescan_(FILTER_UNCHANGED, ScanValue(), &match);
+}
+size_t ValueScanner::size() const
+{
+	return results_;
+}
+
+size_t ValueScanner::getResults(vector<ptr_t>& dest, size_t maximum) const
+{
+	size_t found = 0;
+	vector<qword_t> spilled;
+	for(vector<Block>::const_iterator i = blocks_.begin(); i != blocks_.end(); ++i)
+	{
+		const vector<qword_t>* results = &i->results;
+		if(i->spilled)
+		{
+			readResults_(*i, spilled);
+			results = &spilled;
+		}
+
+		for(size_t word = 0; word < results->size(); ++word)
+		{
+			for(qword_t bits = (*results)[word]; bits; bits &= bits - 1)
+			{
+				if(found == maximum)
+					return found;
+
+				const size_t index = word * WORD_BITS + lowestBit(bits);
+				dest.push_back(i->address + index * alignment_);
+				++found;
+			}
+		}
+	}
+
+	return found;
+}
+
+size_t ValueScanner::getMemoryUsage() const
+{
+	return memoryUsage_;
+}
+
+void ValueScanner::reset()
+{
+	blocks_.clear();
+	results_ = 0;
+	memoryUsage_ = 0;
+
+	if(spillFile_)
+	{
+		fclose(spillFile_);
+		spillFile_ = NULL;
+		spillSize_ = 0;
+	}
+}
+
+/******************************************************************************
+*******************************************************************************
+************************* PRIVATE MEMBER FUNCTIONS ****************************
+*******************************************************************************
+******************************************************************************/
+
+size_t ValueScanner::capture_(	const RegionMap& regions,
+											const vector<MemoryRange>& ranges,
+											const ValueMatch* match)
+{
+	//Blocks read a value's length into the next one
+	buffer_.resize(BLOCK_SIZE + valueSize_ - 1);
+
+	vector<MemoryRange> read;
+	for(vector<MemoryRange>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+	{
+		for(size_t offset = 0; offset < i->size; offset += BLOCK_SIZE)
+		{
+			const ptr_t address = i->address + offset;
+			const size_t amount = min(buffer_.size(), i->size - offset);
+
+			read.clear();
+			regions.readAvailable(address, &buffer_[0], amount, read);
+			for(vector<MemoryRange>::const_iterator j = read.begin(); j != read.end(); ++j)
+				addBlock_(j->address, &buffer_[j->address - address], j->size, address + BLOCK_SIZE, match);
+		}
+	}
+
+	return results_;
+}
+
+void ValueScanner::addBlock_(	ptr_t address,
+										const byte_t* data,
+										size_t size,
+										ptr_t limit,
+										const ValueMatch* match)
+{
+	//Values start at multiples of the alignment before the limit
+	const ptr_t first = ((address + alignment_ - 1) / alignment_) * alignment_;
+	const ptr_t end = address + size;
+	if(first >= limit || first + valueSize_ > end)
+		return;
+
+	blocks_.push_back(Block());
+	Block& block = blocks_.back();
+	block.address = first;
+	block.count = static_cast<size_t>(min(	(limit - first + alignment_ - 1) / alignment_,
+														(end - first - valueSize_) / alignment_ + 1));
+	block.size = (block.count - 1) * alignment_ + valueSize_;
+
+	const size_t words = (block.count + WORD_BITS - 1) / WORD_BITS;
+	block.results.assign(words, ~0ULL);
+	block.results.back() = lowBits(block.count - (words - 1) * WORD_BITS);
+
+	const byte_t* source = data + (first - address);
+	size_t results = block.count;
+	if(match)
+	{
+		matchBlock_(block, source, *match);
+
+		//Trimmed like a spilled block, only the offset into source moves
+		block.spilled = true;
+		block.offset = 0;
+		if(!trimBlock_(block))
+		{
+			blocks_.pop_back();
+			return;
+		}
+
+		source += block.offset;
+
+		results = 0;
+		for(size_t word = 0; word < block.results.size(); ++word)
+			results += countBits(block.results[word]);
+	}
+
+	const size_t resultsSize = block.results.size() * sizeof(qword_t);
+	block.spilled = budget_ && memoryUsage_ + block.size + resultsSize > budget_;
+	if(block.spilled)
+	{
+		if(!spillFile_)
+		{
+			spillFile_ = tmpfile();
+			if(!spillFile_)
+				throw runtime_error("ValueScanner::addBlock_() Error : Can't create the temporary file");
+		}
+
+		//Trimming only shrinks both, they are rewritten in place
+		block.offset = spillSize_;
+		block.resultsOffset = spillSize_ + block.size;
+		spillSize_ += block.size + resultsSize;
+		writeSpilled_(block, source);
+		writeResults_(block);
+	}
+	else
+	{
+		block.offset = 0;
+		block.data.assign(source, source + block.size);
+		memoryUsage_ += block.size + resultsSize;
+	}
+
+	results_ += results;
+}
+
+size_t ValueScanner::rescan_(ScanFilter filter, const ScanValue& delta, const ValueMatch* match)
+{
+	size_t results = 0;
+	size_t kept = 0;
+	for(size_t i = 0; i < blocks_.size(); ++i)
+	{
+		Block& block = blocks_[i];
+		if(block.spilled)
+			readResults_(block, block.results);
+
+		//Values which can't be read anymore are dropped, the count is set
+		//for reads stopping early as well
+		buffer_.resize(block.size);
+		size_t bytesRead = 0;
+		proc_.tryRead(block.address, &buffer_[0], block.size, bytesRead);
+
+		if(bytesRead < block.size)
+		{
+			const size_t readable = (bytesRead >= valueSize_) ? (bytesRead - valueSize_) / alignment_ + 1 : 0;
+			for(size_t word = readable / WORD_BITS; word < block.results.size(); ++word)
+				block.results[word] &= (word == readable / WORD_BITS) ? lowBits(readable % WORD_BITS) : 0;
+		}
+
+		//The new capture replaces the old one
+		if(match)
+		{
+			matchBlock_(block, &buffer_[0], *match);
+			if(block.spilled)
+				writeSpilled_(block, &buffer_[0]);
+			else
+				block.data.swap(buffer_);
+		}
+		else if(block.spilled)
+		{
+			previous_.resize(block.size);
+			readSpilled_(block, &previous_[0]);
+			filterBlock_(block, &previous_[0], &buffer_[0], filter, delta);
+			writeSpilled_(block, &buffer_[0]);
+		}
+		else
+		{
+			filterBlock_(block, &block.data[0], &buffer_[0], filter, delta);
+			block.data.swap(buffer_);
+		}
+
+		if(!trimBlock_(block))
+			continue;
+
+		for(size_t word = 0; word < block.results.size(); ++word)
+			results += countBits(block.results[word]);
+
+		if(block.spilled)
+			writeResults_(block);
+
+		if(kept != i)
+			swap(blocks_[kept], block);
+
+		++kept;
+	}
+
+	blocks_.resize(kept);
+	results_ = results;
+
+	memoryUsage_ = 0;
+	for(vector<Block>::const_iterator i = blocks_.begin(); i != blocks_.end(); ++i)
+		memoryUsage_ += i->data.size() + i->results.size() * sizeof(qword_t);
+
+	return results_;
+}
+
+void ValueScanner::matchBlock_(Block& block, const byte_t* data, const ValueMatch& match) const
+{
+	const Matcher matcher(type_, match);
+
+	const size_t words = block.results.size();
+	for(size_t word = 0; word < words; ++word)
+	{
+		if(!block.results[word])
+			continue;
+
+		const size_t first = word * WORD_BITS;
+		block.results[word] &= matcher.run(	data + first * alignment_,
+														min(WORD_BITS, block.count - first),
+														alignment_);
+	}
+}
+
+void ValueScanner::filterBlock_(	Block& block,
+											const byte_t* before,
+											const byte_t* after,
+											ScanFilter filter,
+											const ScanValue& delta) const
+{
+	qword_t* results = &block.results[0];
+	const size_t count = block.count;
+	const size_t stride = alignment_;
+
+	//Changes are bitwise, floats and signed values compare as unsigned
+	if(filter == FILTER_CHANGED || filter == FILTER_UNCHANGED)
+	{
+		switch(valueSize_)
+		{
+		case 1:
+			filterValues<unsigned char>(filter, before, after, count, stride, 0, results);
+			break;
+		case 2:
+			filterValues<unsigned short>(filter, before, after, count, stride, 0, results);
+			break;
+		case 4:
+			filterValues<unsigned int>(filter, before, after, count, stride, 0, results);
+			break;
+		default:
+			filterValues<unsigned long long>(filter, before, after, count, stride, 0, results);
+			break;
+		}
+
+		return;
+	}
+
+	switch(type_)
+	{
+	case VALUE_INT8:
+		filterValues<signed char>(filter, before, after, count, stride, toValue<signed char>(delta), results);
+		break;
+	case VALUE_UINT8:
+		filterValues<unsigned char>(filter, before, after, count, stride, toValue<unsigned char>(delta), results);
+		break;
+	case VALUE_INT16:
+		filterValues<short>(filter, before, after, count, stride, toValue<short>(delta), results);
+		break;
+	case VALUE_UINT16:
+		filterValues<unsigned short>(filter, before, after, count, stride, toValue<unsigned short>(delta), results);
+		break;
+	case VALUE_INT32:
+		filterValues<int>(filter, before, after, count, stride, toValue<int>(delta), results);
+		break;
+	case VALUE_UINT32:
+		filterValues<unsigned int>(filter, before, after, count, stride, toValue<unsigned int>(delta), results);
+		break;
+	case VALUE_INT64:
+		filterValues<long long>(filter, before, after, count, stride, toValue<long long>(delta), results);
+		break;
+	case VALUE_UINT64:
+		filterValues<unsigned long long>(filter, before, after, count, stride, toValue<unsigned long long>(delta), results);
+		break;
+	case VALUE_FLOAT:
+		filterValues<float>(filter, before, after, count, stride, toValue<float>(delta), results);
+		break;
+	case VALUE_DOUBLE:
+		filterValues<double>(filter, before, after, count, stride, toValue<double>(delta), results);
+		break;
+	}
+}
+
+bool ValueScanner::trimBlock_(Block& block)
+{
+	vector<qword_t>& results = block.results;
+
+	size_t first = 0;
+	while(first < results.size() && !results[first])
+		++first;
+
+	if(first == results.size())
+		return false;
+
+	size_t last = results.size();
+	while(!results[last - 1])
+		--last;
+
+	if(!first && last == results.size())
+		return true;
+
+	const size_t skipped = first * WORD_BITS;
+	const size_t count = min(block.count, last * WORD_BITS) - skipped;
+	const size_t offset = skipped * alignment_;
+	const size_t size = (count - 1) * alignment_ + valueSize_;
+
+	vector<qword_t>(results.begin() + first, results.begin() + last).swap(results);
+	if(block.spilled)
+		block.offset += offset;
+	else
+		vector<byte_t>(block.data.begin() + offset, block.data.begin() + offset + size).swap(block.data);
+
+	block.address += offset;
+	block.size = size;
+	block.count = count;
+	return true;
+}
+
+void ValueScanner::readSpilled_(const Block& block, byte_t* dest) const
+{
+	if(	!seekFile(spillFile_, block.offset) ||
+		fread(dest, 1, block.size, spillFile_) != block.size)
+	{
+		throw runtime_error("ValueScanner::readSpilled_() Error : Can't read the temporary file");
+	}
+}
+
+void ValueScanner::writeSpilled_(const Block& block, const byte_t* source)
+{
+	if(	!seekFile(spillFile_, block.offset) ||
+		fwrite(source, 1, block.size, spillFile_) != block.size)
+	{
+		throw runtime_error("ValueScanner::writeSpilled_() Error : Can't write the temporary file");
+	}
+}
+
+void ValueScanner::readResults_(const Block& block, vector<qword_t>& dest) const
+{
+	dest.resize((block.count + WORD_BITS - 1) / WORD_BITS);
+	if(	!seekFile(spillFile_, block.resultsOffset) ||
+		fread(&dest[0], sizeof(qword_t), dest.size(), spillFile_) != dest.size())
+	{
+		throw runtime_error("ValueScanner::readResults_() Error : Can't read the temporary file");
+	}
+}
+
+void ValueScanner::writeResults_(Block& block)
+{
+	if(	!seekFile(spillFile_, block.resultsOffset) ||
+		fwrite(&block.results[0], sizeof(qword_t), block.results.size(), spillFile_) != block.results.size())
+	{
+		throw runtime_error("ValueScanner::writeResults_() Error : Can't write the temporary file");
+	}
+
+	vector<qword_t>().swap(block.results);
+}
+
+/******************
+******* EOF *******
+******************/
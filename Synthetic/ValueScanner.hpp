@@ -0,0 +1,481 @@
+/*
+	This file is part of the Synthetic library.
+	Synthetic is a little library for writing custom gamecheats etc
+
+	Synthetic is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	Synthetic is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Synthetic.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) [2010] [Ethon <Ethon@list.ru>]
+*/
+
+
+#if (defined _MSC_VER) && (_MSC_VER >= 1200)
+	#pragma once
+#endif
+
+#ifndef SYNTHETIC_PROCESS_VALUESCANNER_HPP
+#define SYNTHETIC_PROCESS_VALUESCANNER_HPP
+
+//C header files:
+#include <stdio.h>
+
+//C++ Header Files:
+#include <vector>
+
+//Synthetic Header Files:
+#include "Process.hpp"
+#include "RegionMap.hpp"
+#include "Types.hpp"
+
+namespace Synthetic
+{
+	//Enumerations
+
+	/**
+	* Type of the values a ValueScanner searches
+	*/
+	enum ValueType
+	{
+		VALUE_INT8,
+		VALUE_UINT8,
+		VALUE_INT16,
+		VALUE_UINT16,
+		VALUE_INT32,
+		VALUE_UINT32,
+		VALUE_INT64,
+		VALUE_UINT64,
+		VALUE_FLOAT,
+		VALUE_DOUBLE
+	};
+
+	/**
+	* How a value has to compare to its previous capture to stay a result
+	*/
+	enum ScanFilter
+	{
+		FILTER_CHANGED,
+		FILTER_UNCHANGED,
+		FILTER_INCREASED,
+		FILTER_DECREASED,
+		FILTER_INCREASED_BY,		//By exactly the delta, integers wrap around
+		FILTER_DECREASED_BY
+	};
+
+	/**
+	* How a ValueMatch compares values to its number
+	*/
+	enum MatchMode
+	{
+		MATCH_EXACT,
+		MATCH_TOLERANCE,		//Within an epsilon
+		MATCH_TRUNCATED,		//Equal after cutting off digits behind some decimals
+		MATCH_ROUNDED,			//Equal after rounding to some decimals
+		MATCH_RANGE				//Between a minimum and a maximum, both included
+	};
+
+	/**
+	* A number given to a scan, converted to the scanner's ValueType
+	*/
+	class ScanValue
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructors.
+		* @param value The number.
+		*/
+		ScanValue() : integer_(0), real_(0) { }
+		ScanValue(int value) : integer_(value), real_(value) { }
+		ScanValue(unsigned int value) : integer_(value), real_(value) { }
+		ScanValue(long value) : integer_(value), real_(static_cast<double>(value)) { }
+		ScanValue(unsigned long value) : integer_(value), real_(static_cast<double>(value)) { }
+		ScanValue(long long value) : integer_(value), real_(static_cast<double>(value)) { }
+		ScanValue(unsigned long long value) : integer_(value), real_(static_cast<double>(value)) { }
+		ScanValue(float value) : integer_(static_cast<qword_t>(static_cast<long long>(value))), real_(value) { }
+		ScanValue(double value) : integer_(static_cast<qword_t>(static_cast<long long>(value))), real_(value) { }
+
+		/**
+		* @return qword_t The number as integer, negative numbers in two's
+		* complement.
+		*/
+		qword_t getInteger() const
+		{
+			return integer_;
+		}
+
+		/**
+		* @return double The number as floating point number.
+		*/
+		double getReal() const
+		{
+			return real_;
+		}
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		qword_t integer_;
+		double real_;
+	};
+
+	/**
+	* Which values a scan keeps.\n
+	* Floating point values in games are hardly ever exactly the number
+	* shown, so they can be matched with a tolerance, by their truncated
+	* or rounded digits or by a range. Every mode comes down to a range of
+	* values of the scanned type. Integers are matched exactly, truncated
+	* and rounded like their digits behind the point were zero.\n
+	*/
+	class ValueMatch
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Constructor.
+		* Matches a number exactly.
+		* @param value The number.
+		*/
+		ValueMatch(const ScanValue& value);
+
+		/**
+		* Constructor.
+		* @param value The number.
+		* @param mode MATCH_TOLERANCE, MATCH_TRUNCATED or MATCH_ROUNDED.
+		* @param parameter The epsilon for MATCH_TOLERANCE, the number of
+		* decimals kept otherwise.
+		*/
+		ValueMatch(const ScanValue& value, MatchMode mode, double parameter);
+
+		/**
+		* Constructor.
+		* Matches a range.
+		* @param minimum The smallest number matching.
+		* @param maximum The biggest number matching.
+		*/
+		ValueMatch(const ScanValue& minimum, const ScanValue& maximum);
+
+		/**
+		* @return MatchMode The mode.
+		*/
+		MatchMode getMode() const;
+
+		/**
+		* @return const ScanValue& The number, the minimum for MATCH_RANGE.
+		*/
+		const ScanValue& getValue() const;
+
+		/**
+		* @return const ScanValue& The maximum for MATCH_RANGE.
+		*/
+		const ScanValue& getMaximum() const;
+
+		/**
+		* @return double The epsilon or the number of decimals.
+		*/
+		double getParameter() const;
+
+	private:
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		MatchMode mode_;
+		ScanValue value_;
+		ScanValue maximum_;
+		double parameter_;
+	};
+
+	/**
+	* Searches values by how they change, without knowing them.\n
+	* The first scan captures the raw memory, no addresses. Every next scan
+	* reads the memory again, compares it to the previous capture and keeps
+	* the values passing the filter. Results are kept as one bit per
+	* possible address, comparisons run 64 values at once with SSE2.\n
+	* Scans can also search known values, exact or with the tolerances
+	* of a ValueMatch. Those run as kernels per type and mode as well.\n
+	* Memory is held in blocks, blocks without results are dropped and
+	* the others are cut down to their results. Blocks exceeding the
+	* memory budget are moved to a temporary file, captures and results.\n
+	*/
+	class ValueScanner
+	{
+	public:
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PUBLIC MEMBER FUNCTIONS **********************
+		***********************************************************************
+		**********************************************************************/
+
+		/**
+		* Default constructor.
+		* @param proc The process to scan. Has to be valid the whole
+		* lifetime.
+		* @param type Type of the values.
+		* @param alignment (optional) Distance of the possible addresses,
+		* 0 for the size of the type.
+		*/
+		ValueScanner(const Process& proc, ValueType type, size_t alignment = 0);
+
+		/**
+		* Destructor.
+		* Removes the temporary file.
+		*/
+		~ValueScanner();
+
+		/**
+		* Sets which pages the first scan captures, RESIDENCY_ANY by
+		* default.
+		* @param residency Which pages to capture.
+		*/
+		void setResidency(Residency residency);
+
+		/**
+		* Limits the memory holding captures and results, blocks which
+		* don't fit are moved to a temporary file with their results. The
+		* few bytes describing each block aren't counted.
+		* @param bytes The limit, 0 for no limit.
+		*/
+		void setMemoryBudget(size_t bytes);
+
+		/**
+		* Captures all readable memory of the process, every possible
+		* address is a result afterwards.
+		* @param regions The regions of the process.
+		* @param protection (optional) MemoryProtection flags a region needs
+		* to have all of.
+		* @return size_t Number of results.
+		*/
+		size_t firstScan(	const RegionMap& regions,
+									int protection = PROTECTION_READ | PROTECTION_WRITE);
+
+		/**
+		* Captures the readable memory of a range.
+		* @param regions The regions of the process.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @return size_t Number of results.
+		*/
+		size_t firstScan(const RegionMap& regions, ptr_t address, size_t size);
+
+		/**
+		* Captures all readable memory of the process and keeps the values
+		* matching.
+		* @param regions The regions of the process.
+		* @param match The values to keep.
+		* @param protection (optional) MemoryProtection flags a region needs
+		* to have all of.
+		* @return size_t Number of results.
+		*/
+		size_t firstScan(	const RegionMap& regions,
+									const ValueMatch& match,
+									int protection = PROTECTION_READ | PROTECTION_WRITE);
+
+		/**
+		* Captures the readable memory of a range and keeps the values
+		* matching.
+		* @param regions The regions of the process.
+		* @param address Start of the range.
+		* @param size Size of the range.
+		* @param match The values to keep.
+		* @return size_t Number of results.
+		*/
+		size_t firstScan(	const RegionMap& regions,
+									ptr_t address,
+									size_t size,
+									const ValueMatch& match);
+
+		/**
+		* Captures the memory again and keeps the results passing a filter.
+		* @param filter The filter.
+		* @param delta (optional) The difference for FILTER_INCREASED_BY and
+		* FILTER_DECREASED_BY.
+		* @return size_t Number of results.
+		*/
+		size_t nextScan(ScanFilter filter, const ScanValue& delta = ScanValue());
+
+		/**
+		* Captures the memory again and keeps the results matching.
+		* @param match The values to keep.
+		* @return size_t Number of results.
+		*/
+		size_t nextScan(const ValueMatch& match);
+
+		/**
+		* @return size_t Number of results.
+		*/
+		size_t size() const;
+
+		/**
+		* Collects the addresses of the results.
+		* @param dest Reference to a vector the addresses are appended to.
+		* @param maximum (optional) Number of addresses to collect at most.
+		* @return size_t Number of addresses collected.
+		*/
+		size_t getResults(std::vector<ptr_t>& dest, size_t maximum = ~static_cast<size_t>(0)) const;
+
+		/**
+		* @return size_t Bytes of memory held by captures and results.
+		*/
+		size_t getMemoryUsage() const;
+
+		/**
+		* Drops all captures and results.
+		*/
+		void reset();
+
+	private:
+
+		/*
+		* A captured piece of memory, results are bits of the values
+		* starting at address + index * alignment_
+		*/
+		struct Block
+		{
+			ptr_t address;
+			size_t size;
+			size_t count;
+			std::vector<byte_t> data;
+
+			//Where the capture and the results are in the temporary file, if
+			//the block was moved. Its results are only loaded while needed
+			bool spilled;
+			qword_t offset;
+			qword_t resultsOffset;
+
+			std::vector<qword_t> results;
+		};
+
+		/**********************************************************************
+		***********************************************************************
+		************************ PRIVATE MEMBER FUNCTIONS *********************
+		***********************************************************************
+		**********************************************************************/
+
+		/*
+		* Not copyable
+		*/
+		ValueScanner(const ValueScanner&);
+		ValueScanner& operator=(const ValueScanner&);
+
+		/*
+		* Captures the ranges in blocks, keeps only values matching if
+		* match is given
+		*/
+		size_t capture_(	const RegionMap& regions,
+								const std::vector<MemoryRange>& ranges,
+								const ValueMatch* match);
+
+		/*
+		* Adds a block of the values starting before limit, moves it and
+		* its results to the file if it exceeds the budget
+		*/
+		void addBlock_(	ptr_t address,
+								const byte_t* data,
+								size_t size,
+								ptr_t limit,
+								const ValueMatch* match);
+
+		/*
+		* Captures the blocks again, runs match on them if given and filter
+		* otherwise
+		*/
+		size_t rescan_(ScanFilter filter, const ScanValue& delta, const ValueMatch* match);
+
+		/*
+		* Runs a filter on a block, the capture in before is replaced by
+		* after
+		*/
+		void filterBlock_(	Block& block,
+									const byte_t* before,
+									const byte_t* after,
+									ScanFilter filter,
+									const ScanValue& delta) const;
+
+		/*
+		* Keeps the results of a block matching
+		*/
+		void matchBlock_(Block& block, const byte_t* data, const ValueMatch& match) const;
+
+		/*
+		* Drops leading and trailing words without results, false if none
+		* are left
+		*/
+		bool trimBlock_(Block& block);
+
+		/*
+		* Reads or writes a capture in the temporary file
+		*/
+		void readSpilled_(const Block& block, byte_t* dest) const;
+		void writeSpilled_(const Block& block, const byte_t* source);
+
+		/*
+		* Reads the results of a moved block from the temporary file, or
+		* writes them back and frees them
+		*/
+		void readResults_(const Block& block, std::vector<qword_t>& dest) const;
+		void writeResults_(Block& block);
+
+		/**********************************************************************
+		***********************************************************************
+		*********************** PRIVATE MEMBER VARIABLES **********************
+		***********************************************************************
+		**********************************************************************/
+
+		const Process& proc_;
+		ValueType type_;
+		size_t valueSize_;
+		size_t alignment_;
+		Residency residency_;
+
+		std::vector<Block> blocks_;
+		size_t results_;
+
+		size_t budget_;
+		size_t memoryUsage_;
+
+		//Blocks exceeding the budget
+		FILE* spillFile_;
+		qword_t spillSize_;
+
+		//Reused read buffers
+		std::vector<byte_t> buffer_;
+		std::vector<byte_t> previous_;
+	};
+}
+
+#endif //SYNTHETIC_PROCESS_VALUESCANNER_HPP
+
+/******************
+******* EOF *******
+******************/
@@ -32,7 +32,6 @@
 #include <string>
 #include <exception>
 #include <sstream>
-#include <vector>
 
 namespace Synthetic {
 
@@ -42,7 +41,7 @@ public:
 
 	/**
 	*Constructor
-	*Prepares error information
+	*Prepares error information, the message is only formatted by what()
 	*@param causedIn Where did the error happen?
 	*@param failedName Which WinAPI-function failed?
 	*@param errorCode What does GetLastError say?
@@ -52,35 +51,34 @@ public:
 						DWORD errorCode) :	causedIn_(causedIn),
 													failedName_(failedName),
 													errorCode_(errorCode)
+	{ }
+
+	/**
+	*@return A formatted error message
+	*/
+	const char* what() const
 	{
+		if(!formattedError_.empty())
+			return formattedError_.c_str();
+
 		//Create a describing error string
-		std::vector<char> buffer(MAX_PATH);
+		char buffer[MAX_PATH];
 		DWORD flags = FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
 		DWORD ec = FormatMessageA(	flags,
 											NULL,
-											errorCode,
+											errorCode_,
 											MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-											&buffer[0],
-											static_cast<DWORD>(buffer.size()),
+											buffer,
+											MAX_PATH,
 											NULL);
-		std::string errString;
-		ec ?	errString.assign(buffer.begin(), buffer.begin() + ec) :
-				errString.assign("Unknown Error");
 
 		//Format a meaningfull error message
 		std::stringstream errorMessage;
 		errorMessage << causedIn_ << " Error : " << failedName_ <<
 		" failed with errorcode " << errorCode_ << "(" << 
-		(ec ? &buffer[0] : "Unknown Error") << ")";
+		(ec ? buffer : "Unknown Error") << ")";
 
 		formattedError_.assign(errorMessage.str());
-	}
-
-	/**
-	*@return A formatted error message
-	*/
-	const char* what() const
-	{
 		return formattedError_.c_str();
 	}
 
@@ -110,7 +108,8 @@ public:
 
 protected:
 
-	std::string formattedError_;
+	//Formatted by the first call to what()
+	mutable std::string formattedError_;
 	std::string causedIn_;
 	std::string failedName_;
 	DWORD errorCode_;